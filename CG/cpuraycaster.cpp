@@ -0,0 +1,726 @@
+#include "cpuraycaster.h"
+#include "structures.h"
+#include "parallelutils.h"
+#include "luts.h"
+#include "itkSpatialOrientation.h"
+#include <climits>
+#include <cmath>
+#include <new>
+
+namespace
+{
+
+// Largest axis of the normalized volume, as typical
+// GL_MAX_3D_TEXTURE_SIZE.
+const int max_volume_dim = 512;
+// Macro cells of 8x8x8 voxels.
+const int cell_shift = 3;
+// Transfer function bins, the upper 12 bits of the 16 bit value.
+const int tf_shift = 4;
+const int tf_size = 1 << (16 - tf_shift);
+const int render_tile_size = 32;
+
+// Texture axis 0, 1, 2: cube axis and direction,
+// from the color arrays of raycast_cube_*.
+class OrientationMap
+{
+public:
+	unsigned int orientation;
+	int m[6];
+};
+
+const OrientationMap orientation_maps[] =
+{
+	{ itk::SpatialOrientation::ITK_COORDINATE_ORIENTATION_RIP, { 0,  1, 2,  1, 1, -1 } },
+	{ itk::SpatialOrientation::ITK_COORDINATE_ORIENTATION_LIP, { 0, -1, 2,  1, 1, -1 } },
+	{ itk::SpatialOrientation::ITK_COORDINATE_ORIENTATION_RSP, { 0,  1, 2, -1, 1, -1 } },
+	{ itk::SpatialOrientation::ITK_COORDINATE_ORIENTATION_LSP, { 0, -1, 2, -1, 1, -1 } },
+	{ itk::SpatialOrientation::ITK_COORDINATE_ORIENTATION_RIA, { 0,  1, 2,  1, 1,  1 } },
+	{ itk::SpatialOrientation::ITK_COORDINATE_ORIENTATION_LIA, { 0, -1, 2,  1, 1,  1 } },
+	{ itk::SpatialOrientation::ITK_COORDINATE_ORIENTATION_RSA, { 0,  1, 2, -1, 1,  1 } },
+	{ itk::SpatialOrientation::ITK_COORDINATE_ORIENTATION_LSA, { 0, -1, 2, -1, 1,  1 } },
+	{ itk::SpatialOrientation::ITK_COORDINATE_ORIENTATION_IRP, { 2,  1, 0,  1, 1, -1 } },
+	{ itk::SpatialOrientation::ITK_COORDINATE_ORIENTATION_ILP, { 2,  1, 0, -1, 1, -1 } },
+	{ itk::SpatialOrientation::ITK_COORDINATE_ORIENTATION_SRP, { 2, -1, 0,  1, 1, -1 } },
+	{ itk::SpatialOrientation::ITK_COORDINATE_ORIENTATION_SLP, { 2, -1, 0, -1, 1, -1 } },
+	{ itk::SpatialOrientation::ITK_COORDINATE_ORIENTATION_IRA, { 2,  1, 0,  1, 1,  1 } },
+	{ itk::SpatialOrientation::ITK_COORDINATE_ORIENTATION_ILA, { 2,  1, 0, -1, 1,  1 } },
+	{ itk::SpatialOrientation::ITK_COORDINATE_ORIENTATION_SRA, { 2, -1, 0,  1, 1,  1 } },
+	{ itk::SpatialOrientation::ITK_COORDINATE_ORIENTATION_SLA, { 2, -1, 0, -1, 1,  1 } },
+	{ itk::SpatialOrientation::ITK_COORDINATE_ORIENTATION_RPI, { 0,  1, 1, -1, 2,  1 } },
+	{ itk::SpatialOrientation::ITK_COORDINATE_ORIENTATION_LPI, { 0, -1, 1, -1, 2,  1 } },
+	{ itk::SpatialOrientation::ITK_COORDINATE_ORIENTATION_RAI, { 0,  1, 1,  1, 2,  1 } },
+	{ itk::SpatialOrientation::ITK_COORDINATE_ORIENTATION_LAI, { 0, -1, 1,  1, 2,  1 } },
+	{ itk::SpatialOrientation::ITK_COORDINATE_ORIENTATION_RPS, { 0,  1, 1, -1, 2, -1 } },
+	{ itk::SpatialOrientation::ITK_COORDINATE_ORIENTATION_LPS, { 0, -1, 1, -1, 2, -1 } },
+	{ itk::SpatialOrientation::ITK_COORDINATE_ORIENTATION_RAS, { 0,  1, 1,  1, 2, -1 } },
+	{ itk::SpatialOrientation::ITK_COORDINATE_ORIENTATION_LAS, { 0, -1, 1,  1, 2, -1 } },
+	{ itk::SpatialOrientation::ITK_COORDINATE_ORIENTATION_PRI, { 1, -1, 0,  1, 2,  1 } },
+	{ itk::SpatialOrientation::ITK_COORDINATE_ORIENTATION_PLI, { 1, -1, 0, -1, 2,  1 } },
+	{ itk::SpatialOrientation::ITK_COORDINATE_ORIENTATION_ARI, { 1,  1, 0,  1, 2,  1 } },
+	{ itk::SpatialOrientation::ITK_COORDINATE_ORIENTATION_ALI, { 1,  1, 0, -1, 2,  1 } },
+	{ itk::SpatialOrientation::ITK_COORDINATE_ORIENTATION_PRS, { 1, -1, 0,  1, 2, -1 } },
+	{ itk::SpatialOrientation::ITK_COORDINATE_ORIENTATION_PLS, { 1, -1, 0, -1, 2, -1 } },
+	{ itk::SpatialOrientation::ITK_COORDINATE_ORIENTATION_ARS, { 1,  1, 0,  1, 2, -1 } },
+	{ itk::SpatialOrientation::ITK_COORDINATE_ORIENTATION_ALS, { 1,  1, 0, -1, 2, -1 } },
+	{ itk::SpatialOrientation::ITK_COORDINATE_ORIENTATION_IPR, { 2,  1, 1, -1, 0,  1 } },
+	{ itk::SpatialOrientation::ITK_COORDINATE_ORIENTATION_SPR, { 2, -1, 1, -1, 0,  1 } },
+	{ itk::SpatialOrientation::ITK_COORDINATE_ORIENTATION_IAR, { 2,  1, 1,  1, 0,  1 } },
+	{ itk::SpatialOrientation::ITK_COORDINATE_ORIENTATION_SAR, { 2, -1, 1,  1, 0,  1 } },
+	{ itk::SpatialOrientation::ITK_COORDINATE_ORIENTATION_IPL, { 2,  1, 1, -1, 0, -1 } },
+	{ itk::SpatialOrientation::ITK_COORDINATE_ORIENTATION_SPL, { 2, -1, 1, -1, 0, -1 } },
+	{ itk::SpatialOrientation::ITK_COORDINATE_ORIENTATION_IAL, { 2,  1, 1,  1, 0, -1 } },
+	{ itk::SpatialOrientation::ITK_COORDINATE_ORIENTATION_SAL, { 2, -1, 1,  1, 0, -1 } },
+	{ itk::SpatialOrientation::ITK_COORDINATE_ORIENTATION_PIR, { 1, -1, 2,  1, 0,  1 } },
+	{ itk::SpatialOrientation::ITK_COORDINATE_ORIENTATION_PSR, { 1, -1, 2, -1, 0,  1 } },
+	{ itk::SpatialOrientation::ITK_COORDINATE_ORIENTATION_AIR, { 1,  1, 2,  1, 0,  1 } },
+	{ itk::SpatialOrientation::ITK_COORDINATE_ORIENTATION_ASR, { 1,  1, 2, -1, 0,  1 } },
+	{ itk::SpatialOrientation::ITK_COORDINATE_ORIENTATION_PIL, { 1, -1, 2,  1, 0, -1 } },
+	{ itk::SpatialOrientation::ITK_COORDINATE_ORIENTATION_PSL, { 1, -1, 2, -1, 0, -1 } },
+	{ itk::SpatialOrientation::ITK_COORDINATE_ORIENTATION_AIL, { 1,  1, 2,  1, 0, -1 } },
+	{ itk::SpatialOrientation::ITK_COORDINATE_ORIENTATION_ASL, { 1,  1, 2, -1, 0, -1 } }
+};
+
+bool get_lut_data__(short lut, const unsigned char ** data, int * size)
+{
+	switch (lut)
+	{
+	case 1: *data = default_lut;       *size = default_lut_size;     break;
+	case 2: *data = black_rainbow_lut; *size = black_rainbow_size;   break;
+	case 3: *data = syngo_lut;         *size = syngo_lut_size;       break;
+	case 4: *data = hot_iron;          *size = hot_iron_size;        break;
+	case 5: *data = hot_metal_blue;    *size = hot_metal_blue_size;  break;
+	case 6: *data = pet_dicom_lut;     *size = pet_dicom_lut_size;   break;
+	case 7: *data = pet20_dicom_lut;   *size = pet20_dicom_lut_size; break;
+	default: *data = NULL; *size = 0; return false;
+	}
+	return true;
+}
+
+// 'm' - opacity of one step, 'r', 'g', 'b' - color premultiplied
+// with 'm' (composite), 'cr', 'cg', 'cb' - color (projections).
+class TFEntry
+{
+public:
+	float m;
+	float r;
+	float g;
+	float b;
+	float cr;
+	float cg;
+	float cb;
+	float unused;
+};
+
+template<typename T> class BuildTask_ : public ParallelTask
+{
+public:
+	typedef typename T::PixelType PixelType;
+	BuildTask_(
+		const PixelType * in_, const int * in_dim_,
+		unsigned short * out_, const int * dim_,
+		const std::vector<int> & ix_,
+		double rmin, double rmax)
+		:
+		in(in_), in_dim(in_dim_),
+		out(out_), dim(dim_),
+		ix(ix_)
+	{
+		const double d = (rmax - rmin > 0) ? rmax - rmin : 1e-9;
+		fmin = static_cast<float>(rmin);
+		fscale = static_cast<float>(USHRT_MAX/d);
+	}
+
+	~BuildTask_()
+	{
+	}
+
+	void process(int z) override
+	{
+		const int iz = (dim[2] == in_dim[2])
+			? z
+			: static_cast<int>(((z + 0.5)*in_dim[2])/dim[2]);
+		for (int y = 0; y < dim[1]; ++y)
+		{
+			const int iy = (dim[1] == in_dim[1])
+				? y
+				: static_cast<int>(((y + 0.5)*in_dim[1])/dim[1]);
+			const PixelType * r =
+				in + (static_cast<size_t>(iz)*in_dim[1] + iy)*in_dim[0];
+			unsigned short * o =
+				out + (static_cast<size_t>(z)*dim[1] + y)*dim[0];
+			// same as GL_R16 in generate_tex3d, contiguous
+			// rows are a plain vectorizable loop
+			if (dim[0] == in_dim[0])
+			{
+				for (int x = 0; x < dim[0]; ++x)
+				{
+					float f = (static_cast<float>(r[x]) - fmin)*fscale;
+					f = (f < 0.0f) ? 0.0f : ((f > 65535.0f) ? 65535.0f : f);
+					o[x] = static_cast<unsigned short>(f);
+				}
+			}
+			else
+			{
+				for (int x = 0; x < dim[0]; ++x)
+				{
+					float f = (static_cast<float>(r[ix[x]]) - fmin)*fscale;
+					f = (f < 0.0f) ? 0.0f : ((f > 65535.0f) ? 65535.0f : f);
+					o[x] = static_cast<unsigned short>(f);
+				}
+			}
+		}
+	}
+
+private:
+	const PixelType * in;
+	const int * in_dim;
+	unsigned short * out;
+	const int * dim;
+	const std::vector<int> & ix;
+	float fmin;
+	float fscale;
+};
+
+template<typename T> bool build_volume__(
+	const typename T::Pointer & image,
+	double rmin, double rmax,
+	std::vector<unsigned short> & voxels,
+	int * dim)
+{
+	if (image.IsNull()) return false;
+	const typename T::RegionType region = image->GetLargestPossibleRegion();
+	if (image->GetBufferedRegion() != region) return false;
+	const typename T::SizeType size = region.GetSize();
+	int in_dim[3];
+	for (int x = 0; x < 3; ++x)
+	{
+		in_dim[x] = static_cast<int>(size[x]);
+		if (in_dim[x] < 2) return false;
+		dim[x] = (in_dim[x] > max_volume_dim) ? max_volume_dim : in_dim[x];
+	}
+	std::vector<int> ix;
+	try
+	{
+		voxels.resize(static_cast<size_t>(dim[0])*dim[1]*dim[2]);
+		ix.resize(dim[0]);
+	}
+	catch (const std::bad_alloc&)
+	{
+		std::vector<unsigned short>().swap(voxels);
+		return false;
+	}
+	for (int x = 0; x < dim[0]; ++x)
+		ix[x] = static_cast<int>(((x + 0.5)*in_dim[0])/dim[0]);
+	BuildTask_<T> t(
+		image->GetBufferPointer(), in_dim,
+		&voxels[0], dim, ix, rmin, rmax);
+	ParallelUtils::run(&t, dim[2]);
+	return true;
+}
+
+class CellsTask : public ParallelTask
+{
+public:
+	CellsTask(
+		const unsigned short * voxels_, const int * dim_,
+		unsigned short * cells_, const int * cdim_)
+		:
+		voxels(voxels_), dim(dim_),
+		cells(cells_), cdim(cdim_)
+	{
+	}
+
+	~CellsTask()
+	{
+	}
+
+	void process(int cz) override
+	{
+		const int z0 = cz << cell_shift;
+		const int z1 = qMin(z0 + (1 << cell_shift), dim[2] - 1);
+		for (int cy = 0; cy < cdim[1]; ++cy)
+		{
+			const int y0 = cy << cell_shift;
+			const int y1 = qMin(y0 + (1 << cell_shift), dim[1] - 1);
+			for (int cx = 0; cx < cdim[0]; ++cx)
+			{
+				const int x0 = cx << cell_shift;
+				const int x1 = qMin(x0 + (1 << cell_shift), dim[0] - 1);
+				unsigned short vmin = USHRT_MAX;
+				unsigned short vmax = 0;
+				for (int z = z0; z <= z1; ++z)
+				{
+					for (int y = y0; y <= y1; ++y)
+					{
+						const unsigned short * r =
+							voxels + (static_cast<size_t>(z)*dim[1] + y)*dim[0];
+						for (int x = x0; x <= x1; ++x)
+						{
+							vmin = (r[x] < vmin) ? r[x] : vmin;
+							vmax = (r[x] > vmax) ? r[x] : vmax;
+						}
+					}
+				}
+				const size_t j =
+					2*((static_cast<size_t>(cz)*cdim[1] + cy)*cdim[0] + cx);
+				cells[j]     = vmin >> tf_shift;
+				cells[j + 1] = vmax >> tf_shift;
+			}
+		}
+	}
+
+private:
+	const unsigned short * voxels;
+	const int * dim;
+	unsigned short * cells;
+	const int * cdim;
+};
+
+class RenderTask : public ParallelTask
+{
+public:
+	RenderTask(
+		const unsigned short * voxels_, const int * dim_,
+		const unsigned short * cells_, const int * cdim_,
+		const TFEntry * tf_, int qlo_, int qhi_,
+		const CPURaycasterParams & p_,
+		const float * u0_, const float * ux_, const float * uy_,
+		const float * d_, const float * box_,
+		int width_, int height_, int tiles_x_,
+		QRgb * out_, int stride_)
+		:
+		voxels(voxels_), dim(dim_),
+		cells(cells_), cdim(cdim_),
+		tf(tf_), qlo(qlo_), qhi(qhi_),
+		p(p_),
+		u0(u0_), ux(ux_), uy(uy_),
+		d(d_), box(box_),
+		width(width_), height(height_), tiles_x(tiles_x_),
+		out(out_), stride(stride_)
+	{
+		bg = qRgb(p.bg_r, p.bg_g, p.bg_b);
+	}
+
+	~RenderTask()
+	{
+	}
+
+	void process(int i) override
+	{
+		const int x0 = (i % tiles_x)*render_tile_size;
+		const int y0 = (i / tiles_x)*render_tile_size;
+		const int x1 = qMin(x0 + render_tile_size, width);
+		const int y1 = qMin(y0 + render_tile_size, height);
+		for (int y = y0; y < y1; ++y)
+		{
+			QRgb * o = out + static_cast<size_t>(y)*stride;
+			for (int x = x0; x < x1; ++x)
+			{
+				o[x] = cast(
+					u0[0] + x*ux[0] + y*uy[0],
+					u0[1] + x*ux[1] + y*uy[1],
+					u0[2] + x*ux[2] + y*uy[2]);
+			}
+		}
+	}
+
+private:
+	inline float sample(float px, float py, float pz) const
+	{
+		const size_t sy = dim[0];
+		const size_t sz = static_cast<size_t>(dim[0])*dim[1];
+		if (p.fast)
+		{
+			const int ix = static_cast<int>(px + 0.5f);
+			const int iy = static_cast<int>(py + 0.5f);
+			const int iz = static_cast<int>(pz + 0.5f);
+			return voxels[iz*sz + iy*sy + ix];
+		}
+		const int ix = qMin(static_cast<int>(px), dim[0] - 2);
+		const int iy = qMin(static_cast<int>(py), dim[1] - 2);
+		const int iz = qMin(static_cast<int>(pz), dim[2] - 2);
+		const float fx = px - ix;
+		const float fy = py - iy;
+		const float fz = pz - iz;
+		const unsigned short * v = voxels + (iz*sz + iy*sy + ix);
+		const float c00 = v[0]       + fx*(v[1]          - v[0]);
+		const float c10 = v[sy]      + fx*(v[sy + 1]     - v[sy]);
+		const float c01 = v[sz]      + fx*(v[sz + 1]     - v[sz]);
+		const float c11 = v[sz + sy] + fx*(v[sz + sy + 1] - v[sz + sy]);
+		const float c0 = c00 + fy*(c10 - c00);
+		const float c1 = c01 + fy*(c11 - c01);
+		return c0 + fz*(c1 - c0);
+	}
+
+	// Steps to leave the cell of 'f' in direction 'd', at least 1.
+	inline int cell_exit(
+		float px, float py, float pz,
+		int fx, int fy, int fz) const
+	{
+		const float q[3] = { px, py, pz };
+		const int   f[3] = { fx, fy, fz };
+		float s = 1e30f;
+		for (int k = 0; k < 3; ++k)
+		{
+			if (d[k] > 1e-6f)
+			{
+				const float b = static_cast<float>(((f[k] >> cell_shift) + 1) << cell_shift);
+				s = qMin(s, (b - q[k])/d[k]);
+			}
+			else if (d[k] < -1e-6f)
+			{
+				const float b = static_cast<float>((f[k] >> cell_shift) << cell_shift);
+				s = qMin(s, (b - q[k])/d[k]);
+			}
+		}
+		const int n = static_cast<int>(ceilf(s - 1e-4f));
+		return (n > 1) ? n : 1;
+	}
+
+	QRgb cast(float ox, float oy, float oz) const
+	{
+		const float o[3] = { ox, oy, oz };
+		float t0 = -1e30f, t1 = 1e30f;
+		for (int k = 0; k < 3; ++k)
+		{
+			if (fabsf(d[k]) < 1e-6f)
+			{
+				if (o[k] < box[2*k] || o[k] > box[2*k + 1]) return bg;
+			}
+			else
+			{
+				float a = (box[2*k]     - o[k])/d[k];
+				float b = (box[2*k + 1] - o[k])/d[k];
+				if (a > b) { const float tmp = a; a = b; b = tmp; }
+				t0 = qMax(t0, a);
+				t1 = qMin(t1, b);
+			}
+		}
+		if (t0 > t1) return bg;
+		// along the ray, 'd' is one step
+		const int n = static_cast<int>(t1 - t0) + 1;
+		const float sx = o[0] + t0*d[0];
+		const float sy = o[1] + t0*d[1];
+		const float sz = o[2] + t0*d[2];
+		const size_t row   = cdim[0];
+		const size_t slice = static_cast<size_t>(cdim[0])*cdim[1];
+		size_t last_cell = static_cast<size_t>(-1);
+		bool skip = false;
+		// composite front to back, same result as back to front
+		// blending of the shader, but can stop early
+		float cr = 0.0f, cg = 0.0f, cb = 0.0f, tr = 1.0f;
+		int best = (p.mode == CPURaycaster::MODE_MINIP) ? tf_size : -1;
+		int k = 0;
+		while (k < n)
+		{
+			const float px = qMax(sx + k*d[0], 0.0f);
+			const float py = qMax(sy + k*d[1], 0.0f);
+			const float pz = qMax(sz + k*d[2], 0.0f);
+			const int fx = static_cast<int>(px);
+			const int fy = static_cast<int>(py);
+			const int fz = static_cast<int>(pz);
+			const size_t c =
+				(fz >> cell_shift)*slice +
+				(fy >> cell_shift)*row +
+				(fx >> cell_shift);
+			if (c != last_cell)
+			{
+				last_cell = c;
+				const int cmin = cells[2*c];
+				const int cmax = cells[2*c + 1];
+				if (p.mode == CPURaycaster::MODE_MIP)
+					skip = (cmax <= best);
+				else if (p.mode == CPURaycaster::MODE_MINIP)
+					skip = (cmin >= best);
+				else
+					skip = (cmax < qlo || cmin > qhi);
+			}
+			if (skip)
+			{
+				k += cell_exit(px, py, pz, fx, fy, fz);
+				continue;
+			}
+			const int q = static_cast<int>(sample(px, py, pz)) >> tf_shift;
+			if (p.mode == CPURaycaster::MODE_MIP)
+			{
+				if (q > best)
+				{
+					best = q;
+					// brighter values look the same
+					if (best >= qhi) break;
+					skip = (cells[2*c + 1] <= best);
+				}
+			}
+			else if (p.mode == CPURaycaster::MODE_MINIP)
+			{
+				if (q < best)
+				{
+					best = q;
+					if (best <= qlo) break;
+					skip = (cells[2*c] >= best);
+				}
+			}
+			else if (q >= qlo && q <= qhi)
+			{
+				const TFEntry & e = tf[q];
+				cr += tr*e.r;
+				cg += tr*e.g;
+				cb += tr*e.b;
+				tr *= 1.0f - e.m;
+				if (tr < 1.0f/512.0f) break;
+			}
+			++k;
+		}
+		float r, g, b;
+		if (p.mode == CPURaycaster::MODE_COMPOSITE)
+		{
+			// as GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA over the
+			// clear color
+			const float a = 1.0f - tr;
+			r = cr*a*255.0f + tr*p.bg_r;
+			g = cg*a*255.0f + tr*p.bg_g;
+			b = cb*a*255.0f + tr*p.bg_b;
+		}
+		else
+		{
+			if (best < 0 || best >= tf_size) return bg;
+			r = tf[best].cr*255.0f;
+			g = tf[best].cg*255.0f;
+			b = tf[best].cb*255.0f;
+		}
+		r = (r > 255.0f) ? 255.0f : r;
+		g = (g > 255.0f) ? 255.0f : g;
+		b = (b > 255.0f) ? 255.0f : b;
+		return qRgb(
+			static_cast<int>(r + 0.5f),
+			static_cast<int>(g + 0.5f),
+			static_cast<int>(b + 0.5f));
+	}
+
+	const unsigned short * voxels;
+	const int * dim;
+	const unsigned short * cells;
+	const int * cdim;
+	const TFEntry * tf;
+	const int qlo;
+	const int qhi;
+	const CPURaycasterParams & p;
+	const float * u0;
+	const float * ux;
+	const float * uy;
+	const float * d;
+	const float * box;
+	const int width;
+	const int height;
+	const int tiles_x;
+	QRgb * out;
+	const int stride;
+	QRgb bg;
+};
+
+}
+
+CPURaycaster::CPURaycaster()
+{
+	clear();
+}
+
+CPURaycaster::~CPURaycaster()
+{
+}
+
+void CPURaycaster::clear()
+{
+	std::vector<unsigned short>().swap(voxels);
+	std::vector<unsigned short>().swap(cells);
+	for (int x = 0; x < 3; ++x)
+	{
+		dim[x] = 0;
+		cdim[x] = 0;
+		ext[x] = 1.0f;
+		axis[x] = x;
+		sign[x] = 1.0f;
+	}
+	id = -1;
+}
+
+bool CPURaycaster::set_volume(const ImageVariant * v)
+{
+	clear();
+	if (!v || !v->equi) return false;
+	const double rmin = v->di->rmin;
+	const double rmax = v->di->rmax;
+	bool ok = false;
+	switch (v->image_type)
+	{
+	case 0: ok = build_volume__<ImageTypeSS>(v->pSS, rmin, rmax, voxels, dim);   break;
+	case 1: ok = build_volume__<ImageTypeUS>(v->pUS, rmin, rmax, voxels, dim);   break;
+	case 2: ok = build_volume__<ImageTypeSI>(v->pSI, rmin, rmax, voxels, dim);   break;
+	case 3: ok = build_volume__<ImageTypeUI>(v->pUI, rmin, rmax, voxels, dim);   break;
+	case 4: ok = build_volume__<ImageTypeUC>(v->pUC, rmin, rmax, voxels, dim);   break;
+	case 5: ok = build_volume__<ImageTypeF>(v->pF, rmin, rmax, voxels, dim);     break;
+	case 6: ok = build_volume__<ImageTypeD>(v->pD, rmin, rmax, voxels, dim);     break;
+	case 7: ok = build_volume__<ImageTypeSLL>(v->pSLL, rmin, rmax, voxels, dim); break;
+	case 8: ok = build_volume__<ImageTypeULL>(v->pULL, rmin, rmax, voxels, dim); break;
+	default: break;
+	}
+	if (!ok || !build_cells())
+	{
+		clear();
+		return false;
+	}
+	ext[0] = static_cast<float>(v->di->idimx*v->di->ix_spacing*0.5);
+	ext[1] = static_cast<float>(v->di->idimy*v->di->iy_spacing*0.5);
+	ext[2] = static_cast<float>(v->di->idimz*v->di->iz_spacing*0.5);
+	for (int x = 0; x < 3; ++x)
+	{
+		if (!(ext[x] > 0.0f)) ext[x] = 0.5f*dim[x];
+	}
+	const int n = sizeof(orientation_maps)/sizeof(OrientationMap);
+	for (int x = 0; x < n; ++x)
+	{
+		if (orientation_maps[x].orientation == v->orientation)
+		{
+			for (int j = 0; j < 3; ++j)
+			{
+				axis[j] = orientation_maps[x].m[2*j];
+				sign[j] = static_cast<float>(orientation_maps[x].m[2*j + 1]);
+			}
+			break;
+		}
+	}
+	id = v->id;
+	return true;
+}
+
+bool CPURaycaster::build_cells()
+{
+	for (int x = 0; x < 3; ++x)
+		cdim[x] = ((dim[x] - 1) >> cell_shift) + 1;
+	try
+	{
+		cells.resize(2*static_cast<size_t>(cdim[0])*cdim[1]*cdim[2]);
+	}
+	catch (const std::bad_alloc&)
+	{
+		return false;
+	}
+	CellsTask t(&voxels[0], dim, &cells[0], cdim);
+	ParallelUtils::run(&t, cdim[2]);
+	return true;
+}
+
+int CPURaycaster::get_id() const
+{
+	return id;
+}
+
+float CPURaycaster::get_extent() const
+{
+	return 2.0f*sqrtf(ext[0]*ext[0] + ext[1]*ext[1] + ext[2]*ext[2]);
+}
+
+void CPURaycaster::render(QImage & image, const CPURaycasterParams & p) const
+{
+	if (image.isNull()) return;
+	if (image.format() != QImage::Format_RGB32)
+		image = image.convertToFormat(QImage::Format_RGB32);
+	if (voxels.empty() || cells.empty())
+	{
+		image.fill(qRgb(p.bg_r, p.bg_g, p.bg_b));
+		return;
+	}
+	const int w = image.width();
+	const int h = image.height();
+	const float step = p.fast ? 2.0f : 1.0f;
+	//
+	// transfer function, as the raycast shaders
+	const float lo = p.window_center - 0.5f*p.window_width;
+	const float hi = p.window_center + 0.5f*p.window_width;
+	const float ww = (p.window_width > 0.0f) ? p.window_width : 1e-6f;
+	const unsigned char * lut_data = NULL;
+	int lut_size = 0;
+	get_lut_data__(p.lut, &lut_data, &lut_size);
+	std::vector<TFEntry> tf(tf_size);
+	int qlo = tf_size, qhi = -1;
+	for (int x = 0; x < tf_size; ++x)
+	{
+		TFEntry & e = tf[x];
+		const float t = (x + 0.5f)/tf_size;
+		float r = (p.lut_function == 2)
+			? 1.0f/(1.0f + expf(-6.0f*((t - p.window_center)/ww)))
+			: (t - lo)/ww;
+		r = (r < 0.0f) ? 0.0f : ((r > 1.0f) ? 1.0f : r);
+		if (lut_data && lut_size > 0)
+		{
+			const int j = qMin(static_cast<int>(r*lut_size), lut_size - 1);
+			e.cr = p.brightness*lut_data[3*j]/255.0f;
+			e.cg = p.brightness*lut_data[3*j + 1]/255.0f;
+			e.cb = p.brightness*lut_data[3*j + 2]/255.0f;
+		}
+		else
+		{
+			e.cr = e.cg = e.cb = p.brightness*r;
+		}
+		float m = r*p.alpha;
+		m = (m < 0.0f) ? 0.0f : ((m > 1.0f) ? 1.0f : m);
+		// opacity of the longer step
+		if (step != 1.0f) m = 1.0f - powf(1.0f - m, step);
+		e.m = m;
+		e.r = m*e.cr;
+		e.g = m*e.cg;
+		e.b = m*e.cb;
+		e.unused = 0.0f;
+		if (t >= lo && t <= hi)
+		{
+			if (x < qlo) qlo = x;
+			qhi = x;
+		}
+	}
+	//
+	// pixel and depth to voxel coordinates, depth in mm,
+	// texture coordinate j is 0.5 + 0.5*sign*cube[axis]/ext,
+	// voxel center of texel i is at (i + 0.5)/dim
+	const float * R = p.rotation;
+	const float zoom = (p.zoom > 0.0f) ? p.zoom : 1.0f;
+	const float vx0 = (0.5f - 0.5f*w - p.pan_x)/zoom;
+	const float vy0 = -(0.5f - 0.5f*h - p.pan_y)/zoom;
+	float u0[3], ux[3], uy[3], us[3];
+	for (int j = 0; j < 3; ++j)
+	{
+		const int a = axis[j];
+		const float A = 0.5f*sign[j]*dim[j]/ext[a];
+		const float B = 0.5f*dim[j] - 0.5f;
+		u0[j] = B + A*(R[a]*vx0 + R[3 + a]*vy0);
+		ux[j] =  A*R[a]/zoom;
+		uy[j] = -A*R[3 + a]/zoom;
+		us[j] = -A*R[6 + a];
+	}
+	const float len = sqrtf(us[0]*us[0] + us[1]*us[1] + us[2]*us[2]);
+	if (!(len > 0.0f))
+	{
+		image.fill(qRgb(p.bg_r, p.bg_g, p.bg_b));
+		return;
+	}
+	float d[3];
+	for (int j = 0; j < 3; ++j) d[j] = step*us[j]/len;
+	//
+	// z range and bounding box
+	float box[6];
+	for (int j = 0; j < 3; ++j)
+	{
+		box[2*j]     = qMax(p.clip[2*j]*dim[j] - 0.5f, 0.0f);
+		box[2*j + 1] = qMin(p.clip[2*j + 1]*dim[j] - 0.5f, dim[j] - 1.0f);
+	}
+	const int tiles_x = (w + render_tile_size - 1)/render_tile_size;
+	const int tiles_y = (h + render_tile_size - 1)/render_tile_size;
+	RenderTask t(
+		&voxels[0], dim, &cells[0], cdim,
+		&tf[0], qlo, qhi, p,
+		u0, ux, uy, d, box,
+		w, h, tiles_x,
+		reinterpret_cast<QRgb*>(image.bits()),
+		image.bytesPerLine()/4);
+	ParallelUtils::run(&t, tiles_x*tiles_y);
+}
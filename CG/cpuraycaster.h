@@ -0,0 +1,94 @@
+#ifndef CPURAYCASTER__H_
+#define CPURAYCASTER__H_
+
+#include <QtGlobal>
+#include <QImage>
+#include <vector>
+
+class ImageVariant;
+
+class CPURaycasterParams
+{
+public:
+	CPURaycasterParams()
+		:
+		mode(0),
+		zoom(1.0f), pan_x(0.0f), pan_y(0.0f),
+		window_center(0.5f), window_width(1.0f),
+		lut(0), lut_function(0),
+		alpha(1.0f), brightness(1.0f),
+		fast(false),
+		bg_r(0), bg_g(0), bg_b(0)
+	{
+		for (int x = 0; x < 9; ++x) rotation[x] = (x%4 == 0) ? 1.0f : 0.0f;
+		clip[0] = clip[2] = clip[4] = 0.0f;
+		clip[1] = clip[3] = clip[5] = 1.0f;
+	}
+	short mode;
+	// World to view, row-major, the view looks along -z.
+	float rotation[9];
+	// Pixels per mm, pan in pixels.
+	float zoom;
+	float pan_x;
+	float pan_y;
+	// Normalized like the 3D texture (DisplayInterface).
+	float window_center;
+	float window_width;
+	short lut;
+	short lut_function;
+	float alpha;
+	float brightness;
+	// Texture coordinates x0, x1, y0, y1, z0, z1, as z range
+	// and bounding box of the GL raycaster.
+	float clip[6];
+	// Nearest neighbour and double step, for interaction.
+	bool fast;
+	unsigned char bg_r;
+	unsigned char bg_g;
+	unsigned char bg_b;
+};
+
+// Software raycaster for the 3D view without OpenGL 3. The volume
+// is normalized to 16 bit as the GL_R16 texture, the cube geometry
+// follows the raycast_cube_* family, composite mode uses the
+// transfer function of the raycast shaders. Rays are cast in tiles
+// on the ParallelUtils pool, macro cells with min/max are skipped
+// if no value can contribute, composite rays stop when opaque.
+class CPURaycaster
+{
+public:
+	enum
+	{
+		MODE_COMPOSITE = 0,
+		MODE_MIP,
+		MODE_MINIP
+	};
+	CPURaycaster();
+	~CPURaycaster();
+	// Returns false if the image is not supported (RGB, not
+	// uniform) or memory can not be allocated.
+	bool set_volume(const ImageVariant*);
+	void clear();
+	// Id of the image, -1 if empty.
+	int get_id() const;
+	// Size of the cube in mm.
+	float get_extent() const;
+	void render(QImage&, const CPURaycasterParams&) const;
+
+private:
+	bool build_cells();
+	std::vector<unsigned short> voxels;
+	// Per macro cell min and max of the 12 bit transfer
+	// function index, 1 voxel overlap for trilinear sampling.
+	std::vector<unsigned short> cells;
+	int dim[3];
+	int cdim[3];
+	// Half size of the cube in mm and mapping of texture
+	// axes to cube axes, as raycast_cube_*.
+	float ext[3];
+	int axis[3];
+	float sign[3];
+	int id;
+};
+
+#endif // CPURAYCASTER__H_
@@ -1844,6 +1844,42 @@ void GLWidget::paint_raycaster()
 	mparams[14] = (float)di->window_center;
 	mparams[15] = 0.0f; // unused
 	//
+	// Empty space skipping: samples are taken only inside of the
+	// box of bricks with values in the window, s. generate_tex3d().
+	bool bb = rect_selection;
+	if (!rect_selection)
+	{
+		// bb_* keep the last rectangle
+		mparams[7]  = 0.0f;
+		mparams[8]  = 1.0f;
+		mparams[9]  = 0.0f;
+		mparams[10] = 1.0f;
+	}
+	{
+		float box[6];
+		if (di->bricks.get_box(mparams[1], mparams[2], box))
+		{
+			const float x0 = qMax(mparams[9],  box[0]);
+			const float x1 = qMin(mparams[10], box[1]);
+			const float y0 = qMax(mparams[7],  box[2]);
+			const float y1 = qMin(mparams[8],  box[3]);
+			const float z0 = qMax(mparams[5],  box[4]);
+			const float z1 = qMin(mparams[6],  box[5]);
+			if (x0 > mparams[9]  || x1 < mparams[10] ||
+				y0 > mparams[7]  || y1 < mparams[8]  ||
+				z0 > mparams[5]  || z1 < mparams[6])
+			{
+				mparams[9]  = x0;
+				mparams[10] = x1;
+				mparams[7]  = y0;
+				mparams[8]  = y1;
+				mparams[5]  = z0;
+				mparams[6]  = z1;
+				bb = true;
+			}
+		}
+	}
+	//
 	glEnable(GL_CULL_FACE);
 	//
 	glUseProgram(zero_shader.program);
@@ -1893,7 +1929,7 @@ void GLWidget::paint_raycaster()
 	{
 		if (di->selected_lut==0)
 		{
-			if (rect_selection)
+			if (bb)
 			{
 				glUseProgram(raycast_shader_bb_sigm.program);
 				glUniform4fv(raycast_shader_bb_sigm.location_mparams, 16/4, mparams);
@@ -1934,7 +1970,7 @@ void GLWidget::paint_raycaster()
 			case  7: glBindTexture(GL_TEXTURE_1D, gradient7);  break;
 			default: break;
 			}
-			if (rect_selection)
+			if (bb)
 			{
 				glUseProgram(raycast_color_shader_bb_sigm.program);
 				glUniform4fv(raycast_color_shader_bb_sigm.location_mparams, 16/4, mparams);
@@ -1968,7 +2004,7 @@ void GLWidget::paint_raycaster()
 	{
 		if (di->selected_lut==0)
 		{
-			if (rect_selection)
+			if (bb)
 			{
 				glUseProgram(raycast_shader_bb.program);
 				glUniform4fv(raycast_shader_bb.location_mparams, 16/4, mparams);
@@ -2009,7 +2045,7 @@ void GLWidget::paint_raycaster()
 			case  7: glBindTexture(GL_TEXTURE_1D, gradient7);  break;
 			default: break;
 			}
-			if (rect_selection)
+			if (bb)
 			{
 				glUseProgram(raycast_color_shader_bb.program);
 				glUniform4fv(raycast_color_shader_bb.location_mparams, 16/4, mparams);
@@ -17,6 +17,9 @@
 #include "dicomutils.h"
 #include "updateqtcommand.h"
 #include "histogramgen.h"
+#include "fileprefetch.h"
+#include "seriesdecoder.h"
+#include "parallelutils.h"
 #include "studyframewidget.h"
 #include "studygraphicswidget.h"
 #include "itkVersion.h"
@@ -619,6 +622,7 @@ static void check_slice_collisions2(StudyViewWidget * w)
 Aliza::Aliza()
 {
 	glwidget  = NULL;
+	cpuvolumewidget = NULL;
 	imagesbox = NULL;
 	toolbox = NULL;
 	toolbox2D = NULL;
@@ -773,10 +777,12 @@ void Aliza::load_dicom_series(QProgressDialog * pb)
 	unsigned int count_messages = 0;
 	std::vector<ImageVariant*> ivariants;
 	std::vector<int> rows;
-	QStringList filenames;
+	std::vector<QStringList> series;
 	ShaderObj * mesh_shader = NULL;
 	int max_3d_tex_size = 0;
+	bool selected = false;
 	QModelIndexList selection;
+	FilePrefetch prefetch;
 	const bool ok3d = check_3d();
 	if (ok3d)
 	{
@@ -793,7 +799,6 @@ void Aliza::load_dicom_series(QProgressDialog * pb)
 		const QModelIndex index = selection.at(x);
 		rows.push_back(index.row());
 	}
-	if (rows.empty()) goto quit__;
 	for (unsigned int x = 0; x < rows.size(); ++x)
 	{
 		const int row = rows.at(x);
@@ -803,38 +808,183 @@ void Aliza::load_dicom_series(QProgressDialog * pb)
 				browser2->tableWidget->item(row, 0));
 		if (!item) continue;
 		if ((item->files.empty())) continue;
-		filenames = item->files;
-		try
+		series.push_back(item->files);
+	}
+	if (series.empty()) goto quit__;
+	{
+		// Series are checked on the pool, a few at once, plain
+		// image series are decoded there too, textures, icons
+		// and histograms are created here as soon as a series
+		// is finished. Other series are returned and read here,
+		// meanwhile the next of them is read into the system
+		// cache.
+		const int max_series =
+			qBound(1, ParallelUtils::get_num_threads() / 2, 4);
+		const SettingsValues settings_values =
+			settingswidget->get_values();
+		SeriesDecoder decoder(
+			max_3d_tex_size,
+			ok3d,
+			settings_values,
+			settingswidget->get_ignore_dim_org(),
+			CommonUtils::get_total_memory_saved());
+		QList<QStringList> on_gui;
+		size_t next = 0;
+		while (
+			next < series.size() ||
+			decoder.get_count() > 0 ||
+			!on_gui.empty())
 		{
-			const QString tmp_message = DicomUtils::read_dicom(
-				ivariants,
-				filenames,
-				max_3d_tex_size,
-				(ok3d ? glwidget : NULL),
-				mesh_shader,
-				ok3d,
-				static_cast<QWidget*>(settingswidget),
-				pb,
-				0,
-				settingswidget->get_ignore_dim_org());
-			if (!tmp_message.isEmpty())
+			while (
+				next < series.size() &&
+				decoder.get_count() < max_series)
+			{
+				decoder.start(series.at(next));
+				++next;
+			}
+			bool taken = false;
+			while (add_decoded_images(
+				&decoder, &selected, ok3d, pb,
+				message_, &count_messages, on_gui))
+			{
+				taken = true;
+			}
+			if (!on_gui.empty())
+			{
+				const QStringList l = on_gui.takeFirst();
+				if (!on_gui.empty()) prefetch.add(on_gui.first());
+				try
+				{
+					const QString tmp_message = DicomUtils::read_dicom(
+						ivariants,
+						l,
+						max_3d_tex_size,
+						(ok3d ? glwidget : NULL),
+						mesh_shader,
+						ok3d,
+						&settings_values,
+						pb,
+						0,
+						settingswidget->get_ignore_dim_org());
+					if (!tmp_message.isEmpty())
+					{
+						++count_messages;
+						message_.append(tmp_message + QString("\n"));
+					}
+				}
+				catch(mdcm::ParseException & pe)
+				{
+					std::cout << "mdcm::ParseException in Aliza::load_dicom_series:\n"
+						<< pe.GetLastElement().GetTag() << std::endl;
+				}
+				catch(std::exception & ex)
+				{
+					std::cout << "Exception in Aliza::load_dicom_series\n"
+						<< ex.what() << std::endl;
+				}
+				add_loaded_images(ivariants, &selected, ok3d, pb);
+				ivariants.clear();
+			}
+			else if (!taken && decoder.get_count() > 0)
 			{
-				++count_messages;
-				message_.append(tmp_message + QString("\n"));
+				if (pb)
+				{
+					pb->setLabelText(QString("Loading ..."));
+					pb->show();
+					pb->setValue(-1);
+				}
+				decoder.wait(50);
 			}
+			qApp->processEvents();
 		}
-		catch(mdcm::ParseException & pe)
+		prefetch.cancel();
+	}
+quit__:
+	if (!message_.isEmpty())
+	{
+		QString message;
+		if (count_messages > 1)
 		{
-			std::cout << "mdcm::ParseException in Aliza::load_dicom_series:\n"
-				<< pe.GetLastElement().GetTag() << std::endl;
+			message = QVariant(count_messages).toString() +
+				QString(" errors or warnings\n");
 		}
-		catch(std::exception & ex)
+		if (message_.size() > 500)
 		{
-			std::cout << "Exception in Aliza::load_dicom_series\n"
-				<< ex.what() << std::endl;
+			message_.truncate(500);
+			message += message_;
+			message += QString("\n<truncated>");
 		}
+		else
+		{
+			message += message_;
+		}
+		QMessageBox mbox;
+		mbox.addButton(QMessageBox::Close);
+		mbox.setIcon(QMessageBox::Warning);
+		mbox.setText(message);
+		qApp->processEvents();
+		mbox.exec();
 	}
-quit__:
+	if (lock) mutex0.unlock();
+	if (ok3d) glwidget->set_skip_draw(false);
+#ifdef ALIZA_PRINT_COUNT_GL_OBJ
+	std::cout << "Num VBOs " << GLWidget::get_count_vbos() << std::endl;
+#endif
+}
+
+// Images of a series decoded on the pool or the files of a series
+// to be read here, false if none is finished.
+bool Aliza::add_decoded_images(
+	SeriesDecoder * decoder,
+	bool * selected,
+	bool ok3d,
+	QProgressDialog * pb,
+	QString & message_,
+	unsigned int * count_messages,
+	QList<QStringList> & on_gui)
+{
+	std::vector<ImageVariant*> ivariants;
+	QString tmp_message;
+	QStringList files;
+	if (!decoder->take(ivariants, tmp_message, files)) return false;
+	// not a plain series, read on the GUI thread
+	if (!files.empty())
+	{
+		on_gui.push_back(files);
+		return true;
+	}
+	if (!tmp_message.isEmpty())
+	{
+		++(*count_messages);
+		message_.append(tmp_message + QString("\n"));
+	}
+	for (unsigned int x = 0; x < ivariants.size(); ++x)
+	{
+		ImageVariant * v = ivariants[x];
+		if (!v) continue;
+		// decoded without GL context
+		if (ok3d) v->di->gl = glwidget;
+		if (ok3d &&
+			v->image_type >= 0 && v->image_type < 10 &&
+			!v->di->skip_texture)
+		{
+			load_3d(v, false, false, false, true);
+		}
+		else
+		{
+			IconUtils::icon(v);
+		}
+	}
+	add_loaded_images(ivariants, selected, ok3d, pb);
+	return true;
+}
+
+void Aliza::add_loaded_images(
+	std::vector<ImageVariant*> & ivariants,
+	bool * selected,
+	bool ok3d,
+	QProgressDialog * pb)
+{
 	imagesbox->listWidget->blockSignals(true);
 	disconnect(imagesbox->listWidget,SIGNAL(itemSelectionChanged()),this,SLOT(update_selection()));
 	disconnect(imagesbox->listWidget,SIGNAL(itemChanged(QListWidgetItem*)),this,SLOT(update_selection()));
@@ -885,6 +1035,7 @@ quit__:
 		scene3dimages[ivariants.at(x)->id] = ivariants[x];
 		imagesbox->listWidget->reset();
 		imagesbox->add_image(ivariants.at(x)->id, ivariants[x], &ivariants[x]->icon);
+		if (*selected) continue;
 		int r = -1;
 		for (int j = 0; j < imagesbox->listWidget->count(); ++j)
 		{
@@ -894,48 +1045,18 @@ quit__:
 			if (item) id0 = item->get_id();
 			if (id0 == ivariants.at(x)->id) { r = j; break; }
 		}
-		if (x == ivariants.size()-1 && r>-1)
+		if (r > -1)
 		{
 			imagesbox->listWidget->setCurrentRow(r);
 			update_selection2();
 			if (ok3d) glwidget->fit_to_screen(ivariants.at(x));
 			emit image_opened();
+			*selected = true;
 		}
 	}
 	connect(imagesbox->listWidget,SIGNAL(itemSelectionChanged()),this,SLOT(update_selection()));
 	connect(imagesbox->listWidget,SIGNAL(itemChanged(QListWidgetItem*)),this,SLOT(update_selection()));
 	imagesbox->listWidget->blockSignals(false);
-	ivariants.clear();
-	if (!message_.isEmpty())
-	{
-		QString message;
-		if (count_messages > 1)
-		{
-			message = QVariant(count_messages).toString() +
-				QString(" errors or warnings\n");
-		}
-		if (message_.size() > 500)
-		{
-			message_.truncate(500);
-			message += message_;
-			message += QString("\n<truncated>");
-		}
-		else
-		{
-			message += message_;
-		}
-		QMessageBox mbox;
-		mbox.addButton(QMessageBox::Close);
-		mbox.setIcon(QMessageBox::Warning);
-		mbox.setText(message);
-		qApp->processEvents();
-		mbox.exec();
-	}
-	if (lock) mutex0.unlock();
-	if (ok3d) glwidget->set_skip_draw(false);
-#ifdef ALIZA_PRINT_COUNT_GL_OBJ
-	std::cout << "Num VBOs " << GLWidget::get_count_vbos() << std::endl;
-#endif
 }
 
 void Aliza::add_histogram(ImageVariant * v, QProgressDialog * pb, bool check_settings)
@@ -988,6 +1109,7 @@ void Aliza::clear_ram()
 	}
 	scene3dimages.clear();
 	if (ok3d && glwidget->isVisible()) glwidget->updateGL();
+	if (cpuvolumewidget && cpuvolumewidget->isVisible()) cpuvolumewidget->update_volume();
 	connect(imagesbox->listWidget,SIGNAL(itemSelectionChanged()),this,SLOT(update_selection()));
 	connect(imagesbox->listWidget,SIGNAL(itemChanged(QListWidgetItem*)),this,SLOT(update_selection()));
 	imagesbox->listWidget->blockSignals(false);
@@ -1387,6 +1509,7 @@ void Aliza::center_from_spinbox(double i)
 #endif
 	{
 		if (check_3d() && glwidget->isVisible()) glwidget->updateGL();
+		if (cpuvolumewidget && cpuvolumewidget->isVisible()) cpuvolumewidget->update_volume();
 		if (!graphicswidget_m->run__)
 			graphicswidget_m->update_image(0, false, true);
 		if (multiview)
@@ -1412,6 +1535,7 @@ void Aliza::width_from_spinbox(double i)
 #endif
 	{
 		if (check_3d() && glwidget->isVisible()) glwidget->updateGL();
+		if (cpuvolumewidget && cpuvolumewidget->isVisible()) cpuvolumewidget->update_volume();
 		if (!graphicswidget_m->run__)
 			graphicswidget_m->update_image(0, false, true);
 		if (multiview)
@@ -1449,6 +1573,7 @@ void Aliza::set_lut_function1(int x)
 #endif
 	{
 		if (check_3d() && glwidget->isVisible()) glwidget->updateGL();
+		if (cpuvolumewidget && cpuvolumewidget->isVisible()) cpuvolumewidget->update_volume();
 		if (!graphicswidget_m->run__)
 			graphicswidget_m->update_image(0, false, true);
 		if (multiview)
@@ -1499,6 +1624,7 @@ void Aliza::set_lut(int i)
 		{
 			if (glwidget->isVisible()) glwidget->updateGL();
 		}
+		if (cpuvolumewidget && cpuvolumewidget->isVisible()) cpuvolumewidget->update_volume();
 	}
 }
 
@@ -1534,6 +1660,19 @@ void Aliza::set_glwidget(GLWidget * i)
 		glwidget->set_selected_images_ptr(&selected_images);
 }
 
+void Aliza::set_cpuvolumewidget(CPUVolumeWidget * i)
+{
+	cpuvolumewidget = i;
+	if (!cpuvolumewidget) return;
+	cpuvolumewidget->set_selected_images_ptr(&selected_images);
+	cpuvolumewidget->set_rect_selection(rect_selection);
+	if (toolbox)
+	{
+		connect(toolbox->alpha_doubleSpinBox, SIGNAL(valueChanged(double)), cpuvolumewidget, SLOT(set_alpha(double)));
+		connect(toolbox->bright_doubleSpinBox,SIGNAL(valueChanged(double)), cpuvolumewidget, SLOT(set_brightness(double)));
+	}
+}
+
 void Aliza::set_graphicswidget_m(GraphicsWidget * i)
 {
 	graphicswidget_m = i;
@@ -2195,6 +2334,7 @@ void Aliza::toggle_rect(bool t)
 	rect_selection = t;
 	const bool ok3d = check_3d();
 	if (ok3d) glwidget->rect_selection = rect_selection;
+	if (cpuvolumewidget) cpuvolumewidget->set_rect_selection(rect_selection);
 	graphicswidget_m->set_bb(t);
 	graphicswidget_y->set_bb(t);
 	graphicswidget_x->set_bb(t);
@@ -2399,6 +2539,7 @@ void Aliza::calculate_bb()
 			graphicswidget_x->update_selection_item();
 		}
 		if (check_3d() && glwidget->isVisible()) glwidget->updateGL();
+		if (cpuvolumewidget && cpuvolumewidget->isVisible()) cpuvolumewidget->update_volume();
 	}
 }
 
@@ -2782,6 +2923,7 @@ void Aliza::clear_views()
 	{
 		if (glwidget->isVisible()) glwidget->updateGL();
 	}
+	if (cpuvolumewidget) cpuvolumewidget->clear_();
 	histogramview->clear__();
 }
 
@@ -2972,6 +3114,7 @@ void Aliza::update_slice_from_animation(const ImageVariant * v)
 			zrangewidget->set_span(v->di->from_slice, v->di->to_slice);
 			zrangewidget->spanslider->blockSignals(false);
 			if (check_3d() && glwidget->isVisible()) glwidget->updateGL();
+			if (cpuvolumewidget && cpuvolumewidget->isVisible()) cpuvolumewidget->update_volume();
 			if (multiview)
 			{
 				graphicswidget_y->update_selection_item();
@@ -3042,6 +3185,7 @@ void Aliza::width_from_histogram_min(double x)
 #endif
 	{
 		if (check_3d() && glwidget->isVisible()) glwidget->updateGL();
+		if (cpuvolumewidget && cpuvolumewidget->isVisible()) cpuvolumewidget->update_volume();
 		if (!graphicswidget_m->run__) graphicswidget_m->update_image(0, false, true);
 		if (multiview)
 		{
@@ -3089,6 +3233,7 @@ void Aliza::width_from_histogram_max(double x)
 #endif
 	{
 		if (check_3d() && glwidget->isVisible()) glwidget->updateGL();
+		if (cpuvolumewidget && cpuvolumewidget->isVisible()) cpuvolumewidget->update_volume();
 		if (!graphicswidget_m->run__) graphicswidget_m->update_image(0, false, true);
 		if (multiview)
 		{
@@ -3121,6 +3266,7 @@ void Aliza::center_from_histogram(double x)
 #endif
 	{
 		if (check_3d() && glwidget->isVisible()) glwidget->updateGL();
+		if (cpuvolumewidget && cpuvolumewidget->isVisible()) cpuvolumewidget->update_volume();
 		if (!graphicswidget_m->run__) graphicswidget_m->update_image(0, false, true);
 		if (multiview)
 		{
@@ -3437,6 +3583,7 @@ void Aliza::animate_()
 	selected_images.clear();
 	selected_images.push_back(animation_images.at(anim_idx));
 	if (check_3d() && glwidget->isVisible()) glwidget->updateGL();
+	if (cpuvolumewidget && cpuvolumewidget->isVisible()) cpuvolumewidget->update_volume();
 	if (graphicswidget_m->isVisible())
 	{
 		graphicswidget_m->set_slice_2D(animation_images[anim_idx],0,false);
@@ -4154,6 +4301,7 @@ void Aliza::load_dicom_file(int * image_id,
 	int max_3d_tex_size =
 		(ok3d) ? glwidget->max_3d_texture_size : 0;
 	QStringList tmp_filenames__;
+	const SettingsValues settings_values = settingswidget->get_values();
 	bool lock = false;
 	if (lock_mutex)
 	{
@@ -4173,7 +4321,7 @@ void Aliza::load_dicom_file(int * image_id,
 			(ok3d ? glwidget : NULL),
 			mesh_shader,
 			ok3d,
-			static_cast<QWidget*>(settingswidget),
+			&settings_values,
 			pb,
 			0,
 			settingswidget->get_ignore_dim_org());
@@ -24,6 +24,7 @@
 #include "browser/browserwidget2.h"
 #include "settingswidget.h"
 #include "graphicswidget.h"
+#include "cpuvolumewidget.h"
 #include "studyviewwidget.h"
 #include "lutwidget.h"
 #include "histogramview.h"
@@ -41,6 +42,8 @@
 #include <QTimer>
 #include <QTableWidgetItem>
 
+class SeriesDecoder;
+
 class Aliza : public QObject
 {
 Q_OBJECT
@@ -60,6 +63,7 @@ public:
 	void set_toolbox(ToolBox*);
 	void set_toolbox2D(ToolBox2D*);
 	void set_glwidget(GLWidget*);
+	void set_cpuvolumewidget(CPUVolumeWidget*);
 	void set_graphicswidget_m(GraphicsWidget*);
 	void set_graphicswidget_y(GraphicsWidget*);
 	void set_graphicswidget_x(GraphicsWidget*);
@@ -171,6 +175,7 @@ signals:
 
 private:
 	GLWidget       * glwidget;
+	CPUVolumeWidget * cpuvolumewidget;
 	ImagesBox      * imagesbox;
 	ToolBox        * toolbox;
 	ToolBox2D      * toolbox2D;
@@ -237,6 +242,11 @@ private:
 		ImageVariant*,bool=false,bool=false,bool=false,bool=false);
 	void update_center(ImageVariant*);
 	void add_histogram(ImageVariant*,QProgressDialog*,bool=true);
+	void add_loaded_images(
+		std::vector<ImageVariant*>&,bool*,bool,QProgressDialog*);
+	bool add_decoded_images(
+		SeriesDecoder*,bool*,bool,QProgressDialog*,QString&,unsigned int*,
+		QList<QStringList>&);
 	void update_group_center(const ImageVariant*);
 	void update_group_width(const ImageVariant*);
 	void set_us_center(ImageVariant*,double);
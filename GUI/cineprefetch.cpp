@@ -0,0 +1,125 @@
+#include "cineprefetch.h"
+#include <QRunnable>
+#include <QMutexLocker>
+#include "parallelutils.h"
+
+class CinePrefetch::Runnable : public QRunnable
+{
+public:
+	Runnable(CinePrefetch * p_, int frame_, qint64 t0_)
+		: p(p_), frame(frame_), t0(t0_)
+	{
+		setAutoDelete(true);
+	}
+	void run() override
+	{
+		QImage i;
+#if QT_VERSION >= QT_VERSION_CHECK(5,14,0)
+		if (!p->canceled.loadRelaxed()) i = p->source->render(frame);
+#else
+		if (!p->canceled.load()) i = p->source->render(frame);
+#endif
+		p->finish(frame, i, t0);
+	}
+private:
+	CinePrefetch * p;
+	const int frame;
+	const qint64 t0;
+};
+
+CinePrefetch::CinePrefetch() : canceled(0), source(NULL), depth(0)
+{
+	// keep threads alive while playing
+	pool.setExpiryTimeout(-1);
+}
+
+CinePrefetch::~CinePrefetch()
+{
+	stop();
+}
+
+void CinePrefetch::start(CineFrameSource * s, int d)
+{
+	stop();
+	// the GUI thread renders and displays too
+	pool.setMaxThreadCount(qBound(1, ParallelUtils::get_num_threads() - 1, 4));
+	QMutexLocker locker(&mutex);
+	source = s;
+	depth = qMax(1, d);
+	render_times.reset();
+	clock.start();
+}
+
+void CinePrefetch::stop()
+{
+	canceled.fetchAndStoreOrdered(1);
+	pool.waitForDone();
+	canceled.fetchAndStoreOrdered(0);
+	QMutexLocker locker(&mutex);
+	ready.clear();
+	pending.clear();
+	delete source;
+	source = NULL;
+	depth = 0;
+}
+
+bool CinePrefetch::is_running() const
+{
+	QMutexLocker locker(&mutex);
+	return (source != NULL);
+}
+
+void CinePrefetch::request(const QList<int> & frames)
+{
+	QMutexLocker locker(&mutex);
+	if (!source) return;
+	QSet<int> keep;
+	for (int x = 0; x < frames.size(); ++x) keep.insert(frames.at(x));
+	QMap<int, QImage>::iterator it = ready.begin();
+	while (it != ready.end())
+	{
+		if (keep.contains(it.key())) ++it;
+		else it = ready.erase(it);
+	}
+	for (int x = 0; x < frames.size(); ++x)
+	{
+		if (ready.size() + pending.size() >= depth) break;
+		const int frame = frames.at(x);
+		if (ready.contains(frame) || pending.contains(frame)) continue;
+		pending.insert(frame);
+		pool.start(new Runnable(this, frame, clock.nsecsElapsed()));
+	}
+}
+
+bool CinePrefetch::take(int frame, QImage & i)
+{
+	QMutexLocker locker(&mutex);
+	if (!ready.contains(frame)) return false;
+	i = ready.take(frame);
+	return true;
+}
+
+QImage CinePrefetch::render(int frame) const
+{
+	if (!source) return QImage();
+	return source->render(frame);
+}
+
+TimeCounter CinePrefetch::get_render_times() const
+{
+	QMutexLocker locker(&mutex);
+	return render_times;
+}
+
+void CinePrefetch::finish(int frame, const QImage & i, qint64 t0)
+{
+	QMutexLocker locker(&mutex);
+	pending.remove(frame);
+#if QT_VERSION >= QT_VERSION_CHECK(5,14,0)
+	if (canceled.loadRelaxed() || i.isNull()) return;
+#else
+	if (canceled.load() || i.isNull()) return;
+#endif
+	ready.insert(frame, i);
+	render_times.add(clock.nsecsElapsed() - t0);
+}
@@ -0,0 +1,61 @@
+#ifndef CINEPREFETCH__H_
+#define CINEPREFETCH__H_
+
+#include <QtGlobal>
+#include <QThreadPool>
+#include <QAtomicInt>
+#include <QMutex>
+#include <QElapsedTimer>
+#include <QImage>
+#include <QList>
+#include <QMap>
+#include <QSet>
+#include "timecounter.h"
+
+// Renders one frame, called concurrently from the pool.
+class CineFrameSource
+{
+public:
+	CineFrameSource() {}
+	virtual ~CineFrameSource() {}
+	virtual QImage render(int) const = 0;
+};
+
+// Renders 2D cine frames ahead on a small pool into a bounded
+// set of ready images, so the animation timer only swaps them.
+// Render latency is measured from the request to the ready image.
+class CinePrefetch
+{
+public:
+	CinePrefetch();
+	~CinePrefetch();
+	// Takes ownership of the source, 'depth' - max. number of
+	// ready and pending frames.
+	void start(CineFrameSource*, int);
+	// Skips queued renders, waits for running ones.
+	void stop();
+	bool is_running() const;
+	// Queues frames not ready or pending, in the given order,
+	// ready frames not in the list are dropped.
+	void request(const QList<int>&);
+	// Moves the ready image to 'i', false if not ready.
+	bool take(int, QImage&);
+	// Renders on the calling thread.
+	QImage render(int) const;
+	TimeCounter get_render_times() const;
+
+private:
+	class Runnable;
+	void finish(int, const QImage&, qint64);
+	QThreadPool pool;
+	mutable QMutex mutex;
+	QAtomicInt canceled;
+	QElapsedTimer clock;
+	QMap<int, QImage> ready;
+	QSet<int> pending;
+	CineFrameSource * source;
+	TimeCounter render_times;
+	int depth;
+};
+
+#endif // CINEPREFETCH__H_
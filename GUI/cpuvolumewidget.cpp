@@ -0,0 +1,290 @@
+#include "cpuvolumewidget.h"
+#include "structures.h"
+#include <QApplication>
+#include <QPainter>
+#include <QPalette>
+#include <QColor>
+#include <QMenu>
+#include <QAction>
+#include <QActionGroup>
+#include <QCursor>
+#include <cmath>
+
+CPUVolumeWidget::CPUVolumeWidget()
+	:
+	selected_images(NULL),
+	zoom_factor(1.0f),
+	pan_x(0.0f), pan_y(0.0f),
+	alpha(1.0f), brightness(1.0f),
+	mode(CPURaycaster::MODE_COMPOSITE),
+	rect_selection(false),
+	interactive(false),
+	dirty(true)
+{
+	for (int x = 0; x < 9; ++x) rotation[x] = (x%4 == 0) ? 1.0f : 0.0f;
+	final_timer = new QTimer(this);
+	final_timer->setSingleShot(true);
+	final_timer->setInterval(150);
+	connect(final_timer, SIGNAL(timeout()), this, SLOT(render_final()));
+	setAttribute(Qt::WA_OpaquePaintEvent);
+	setMouseTracking(false);
+	setMinimumSize(64, 64);
+}
+
+CPUVolumeWidget::~CPUVolumeWidget()
+{
+}
+
+QSize CPUVolumeWidget::sizeHint() const
+{
+	return QSize(512, 512);
+}
+
+void CPUVolumeWidget::set_selected_images_ptr(QList<ImageVariant*> * i)
+{
+	selected_images = i;
+}
+
+void CPUVolumeWidget::set_rect_selection(bool t)
+{
+	rect_selection = t;
+	update_volume();
+}
+
+void CPUVolumeWidget::clear_()
+{
+	final_timer->stop();
+	raycaster.clear();
+	image = QImage();
+	dirty = true;
+	update();
+}
+
+void CPUVolumeWidget::update_volume()
+{
+	// window/level and z range are usually dragged
+	interactive = true;
+	dirty = true;
+	final_timer->start();
+	update();
+}
+
+void CPUVolumeWidget::set_mode(int x)
+{
+	mode = static_cast<short>(x);
+	dirty = true;
+	update();
+}
+
+void CPUVolumeWidget::set_alpha(double x)
+{
+	alpha = static_cast<float>(x);
+	update_volume();
+}
+
+void CPUVolumeWidget::set_brightness(double x)
+{
+	brightness = static_cast<float>(x);
+	update_volume();
+}
+
+void CPUVolumeWidget::reset_view()
+{
+	for (int x = 0; x < 9; ++x) rotation[x] = (x%4 == 0) ? 1.0f : 0.0f;
+	zoom_factor = 1.0f;
+	pan_x = 0.0f;
+	pan_y = 0.0f;
+	dirty = true;
+	update();
+}
+
+void CPUVolumeWidget::render_final()
+{
+	interactive = false;
+	dirty = true;
+	update();
+}
+
+void CPUVolumeWidget::render_()
+{
+	const ImageVariant * v =
+		(selected_images && !selected_images->empty())
+		? selected_images->at(0)
+		: NULL;
+	const bool ok =
+		v &&
+		v->equi &&
+		v->di->slices_generated &&
+		v->di->idimz >= 2;
+	if (!ok)
+	{
+		if (raycaster.get_id() >= 0) raycaster.clear();
+	}
+	else if (raycaster.get_id() != v->id)
+	{
+		QApplication::setOverrideCursor(QCursor(Qt::WaitCursor));
+		raycaster.set_volume(v);
+		QApplication::restoreOverrideCursor();
+	}
+	const int scale = interactive ? 2 : 1;
+	const int w = qMax(width()/scale, 1);
+	const int h = qMax(height()/scale, 1);
+	if (image.width() != w || image.height() != h)
+		image = QImage(w, h, QImage::Format_RGB32);
+	CPURaycasterParams p;
+	const QColor bg = qApp->palette().color(QPalette::Window);
+	p.bg_r = static_cast<unsigned char>(bg.red());
+	p.bg_g = static_cast<unsigned char>(bg.green());
+	p.bg_b = static_cast<unsigned char>(bg.blue());
+	if (ok && raycaster.get_id() == v->id)
+	{
+		p.mode = mode;
+		for (int x = 0; x < 9; ++x) p.rotation[x] = rotation[x];
+		const float extent = raycaster.get_extent();
+		p.zoom = (extent > 0.0f)
+			? zoom_factor*qMin(w, h)/extent
+			: 1.0f;
+		p.pan_x = pan_x/scale;
+		p.pan_y = pan_y/scale;
+		p.window_center = static_cast<float>(v->di->window_center);
+		p.window_width  = static_cast<float>(v->di->window_width);
+		p.lut = v->di->selected_lut;
+		p.lut_function = v->di->lut_function;
+		p.alpha = alpha;
+		p.brightness = brightness;
+		if (rect_selection)
+		{
+			p.clip[0] = static_cast<float>(v->di->bb_x_min);
+			p.clip[1] = static_cast<float>(v->di->bb_x_max);
+			p.clip[2] = static_cast<float>(v->di->bb_y_min);
+			p.clip[3] = static_cast<float>(v->di->bb_y_max);
+		}
+		p.clip[4] = static_cast<float>(v->di->from_slice)/v->di->idimz;
+		p.clip[5] = static_cast<float>(v->di->to_slice)/v->di->idimz;
+		p.fast = interactive;
+		raycaster.render(image, p);
+	}
+	else
+	{
+		image.fill(qRgb(p.bg_r, p.bg_g, p.bg_b));
+	}
+	dirty = false;
+}
+
+void CPUVolumeWidget::paintEvent(QPaintEvent*)
+{
+	if (dirty) render_();
+	QPainter painter(this);
+	if (image.isNull())
+	{
+		painter.fillRect(rect(), qApp->palette().color(QPalette::Window));
+		return;
+	}
+	painter.setRenderHint(QPainter::SmoothPixmapTransform, interactive);
+	painter.drawImage(rect(), image);
+}
+
+void CPUVolumeWidget::resizeEvent(QResizeEvent * e)
+{
+	QWidget::resizeEvent(e);
+	dirty = true;
+}
+
+// Rotation about the view axes, applied after the current one.
+void CPUVolumeWidget::rotate_(float ax, float ay)
+{
+	const float cx = cosf(ax), sx = sinf(ax);
+	const float cy = cosf(ay), sy = sinf(ay);
+	const float r[9] =
+	{
+		 cy,     0.0f,  sy,
+		 sx*sy,  cx,   -sx*cy,
+		-cx*sy,  sx,    cx*cy
+	};
+	float tmp[9];
+	for (int i = 0; i < 3; ++i)
+	{
+		for (int j = 0; j < 3; ++j)
+		{
+			tmp[3*i + j] =
+				r[3*i    ]*rotation[j] +
+				r[3*i + 1]*rotation[3 + j] +
+				r[3*i + 2]*rotation[6 + j];
+		}
+	}
+	for (int x = 0; x < 9; ++x) rotation[x] = tmp[x];
+}
+
+void CPUVolumeWidget::mousePressEvent(QMouseEvent * e)
+{
+	last_pos = e->pos();
+	press_pos = e->pos();
+}
+
+void CPUVolumeWidget::mouseMoveEvent(QMouseEvent * e)
+{
+	const QPoint p = e->pos();
+	const int dx = p.x() - last_pos.x();
+	const int dy = p.y() - last_pos.y();
+	if (dx == 0 && dy == 0) return;
+	if (e->buttons() & Qt::LeftButton)
+	{
+		rotate_(dy*0.01f, dx*0.01f);
+	}
+	else if (e->buttons() & Qt::MiddleButton)
+	{
+		pan_x += dx;
+		pan_y += dy;
+	}
+	else if (e->buttons() & Qt::RightButton)
+	{
+		zoom_factor *= powf(1.01f, static_cast<float>(dy));
+		zoom_factor = qBound(0.05f, zoom_factor, 50.0f);
+	}
+	else
+	{
+		return;
+	}
+	last_pos = p;
+	update_volume();
+}
+
+void CPUVolumeWidget::mouseReleaseEvent(QMouseEvent * e)
+{
+	if (e->button() != Qt::RightButton) return;
+	if ((e->pos() - press_pos).manhattanLength() > 3) return;
+	QMenu menu(this);
+	QActionGroup group(&menu);
+	QAction * a0 = menu.addAction(QString("Composite"));
+	QAction * a1 = menu.addAction(QString("Maximum intensity projection"));
+	QAction * a2 = menu.addAction(QString("Minimum intensity projection"));
+	a0->setCheckable(true);
+	a1->setCheckable(true);
+	a2->setCheckable(true);
+	group.addAction(a0);
+	group.addAction(a1);
+	group.addAction(a2);
+	a0->setChecked(mode == CPURaycaster::MODE_COMPOSITE);
+	a1->setChecked(mode == CPURaycaster::MODE_MIP);
+	a2->setChecked(mode == CPURaycaster::MODE_MINIP);
+	menu.addSeparator();
+	QAction * a3 = menu.addAction(QString("Reset view"));
+	QAction * a = menu.exec(mapToGlobal(e->pos()));
+	if      (a == a0) set_mode(CPURaycaster::MODE_COMPOSITE);
+	else if (a == a1) set_mode(CPURaycaster::MODE_MIP);
+	else if (a == a2) set_mode(CPURaycaster::MODE_MINIP);
+	else if (a == a3) reset_view();
+}
+
+void CPUVolumeWidget::wheelEvent(QWheelEvent * e)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
+	const int d = e->angleDelta().y();
+#else
+	const int d = e->delta();
+#endif
+	if (d == 0) return;
+	zoom_factor *= static_cast<float>(pow(2.0, d/480.0));
+	zoom_factor = qBound(0.05f, zoom_factor, 50.0f);
+	update_volume();
+}
@@ -0,0 +1,75 @@
+#ifndef CPUVOLUMEWIDGET_H__
+#define CPUVOLUMEWIDGET_H__
+
+#include "CG/cpuraycaster.h"
+#include <QWidget>
+#include <QImage>
+#include <QList>
+#include <QPoint>
+#include <QTimer>
+#include <QPaintEvent>
+#include <QResizeEvent>
+#include <QMouseEvent>
+#include <QWheelEvent>
+
+class ImageVariant;
+
+// 3D view without OpenGL 3, the first selected image is rendered
+// by CPURaycaster with its window, LUT, z range and bounding box.
+// While the view is changing a half size image with nearest
+// neighbour sampling is shown, the full image follows after
+// a short pause. Mouse as in GLWidget: left button rotates,
+// middle button pans, right button and wheel zoom, right click
+// opens the menu with the mode.
+class CPUVolumeWidget : public QWidget
+{
+Q_OBJECT
+public:
+	CPUVolumeWidget();
+	~CPUVolumeWidget();
+	void set_selected_images_ptr(QList<ImageVariant*>*);
+	void set_rect_selection(bool);
+	void clear_();
+	QSize sizeHint() const override;
+
+public slots:
+	// Parameters or selection changed.
+	void update_volume();
+	void set_mode(int);
+	void set_alpha(double);
+	void set_brightness(double);
+	void reset_view();
+
+protected:
+	void paintEvent(QPaintEvent*) override;
+	void resizeEvent(QResizeEvent*) override;
+	void mousePressEvent(QMouseEvent*) override;
+	void mouseMoveEvent(QMouseEvent*) override;
+	void mouseReleaseEvent(QMouseEvent*) override;
+	void wheelEvent(QWheelEvent*) override;
+
+private slots:
+	void render_final();
+
+private:
+	void render_();
+	void rotate_(float, float);
+	CPURaycaster raycaster;
+	QList<ImageVariant*> * selected_images;
+	QImage image;
+	QTimer * final_timer;
+	QPoint last_pos;
+	QPoint press_pos;
+	float rotation[9];
+	float zoom_factor;
+	float pan_x;
+	float pan_y;
+	float alpha;
+	float brightness;
+	short mode;
+	bool rect_selection;
+	bool interactive;
+	bool dirty;
+};
+
+#endif // CPUVOLUMEWIDGET_H__
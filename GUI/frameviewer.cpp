@@ -0,0 +1,363 @@
+#include "frameviewer.h"
+#include "dicomutils.h"
+#include "ybrutils.h"
+#include "parallelutils.h"
+#include "mdcmImage.h"
+#include "mdcmDataSet.h"
+#include <QApplication>
+#include <QStyle>
+#include <QPainter>
+#include <QSlider>
+#include <QToolButton>
+#include <QLabel>
+#include <QTimer>
+#include <QFileInfo>
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <vector>
+#include <cmath>
+#include <climits>
+#include <cstring>
+
+class FrameViewer::View : public QWidget
+{
+public:
+	View()
+	{
+		setAttribute(Qt::WA_OpaquePaintEvent);
+		setMinimumSize(64, 64);
+	}
+	void set_image(const QImage & i)
+	{
+		image = i;
+		update();
+	}
+	QSize sizeHint() const override
+	{
+		return QSize(512, 512);
+	}
+protected:
+	void paintEvent(QPaintEvent*) override
+	{
+		QPainter painter(this);
+		painter.fillRect(rect(), Qt::black);
+		if (image.isNull()) return;
+		const double f = qMin(
+			(double)width() / image.width(),
+			(double)height() / image.height());
+		const int w = (int)(image.width() * f);
+		const int h = (int)(image.height() * f);
+		painter.setRenderHint(QPainter::SmoothPixmapTransform, true);
+		painter.drawImage(
+			QRect((width() - w) / 2, (height() - h) / 2, w, h), image);
+	}
+private:
+	QImage image;
+};
+
+FrameViewer::FrameViewer() : signed_values(false)
+{
+	setAttribute(Qt::WA_DeleteOnClose);
+	view = new View();
+	slider = new QSlider(Qt::Horizontal);
+	slider->setFocusPolicy(Qt::NoFocus);
+	play_toolButton = new QToolButton();
+	play_toolButton->setFocusPolicy(Qt::NoFocus);
+	play_toolButton->setIcon(style()->standardIcon(QStyle::SP_MediaPlay));
+	label = new QLabel();
+	timer = new QTimer(this);
+	QHBoxLayout * hl = new QHBoxLayout();
+	hl->addWidget(play_toolButton);
+	hl->addWidget(slider);
+	hl->addWidget(label);
+	QVBoxLayout * vl = new QVBoxLayout(this);
+	vl->setContentsMargins(0, 0, 0, 0);
+	vl->addWidget(view, 1);
+	vl->addLayout(hl);
+	setFocusPolicy(Qt::StrongFocus);
+	connect(slider, SIGNAL(valueChanged(int)), this, SLOT(set_frame(int)));
+	connect(play_toolButton, SIGNAL(clicked()), this, SLOT(toggle_play()));
+	connect(timer, SIGNAL(timeout()), this, SLOT(next_frame()));
+}
+
+FrameViewer::~FrameViewer()
+{
+	timer->stop();
+	cache.close();
+}
+
+bool FrameViewer::open(const QString & f)
+{
+	// 256 MB of decoded frames, a few frames per thread ahead
+	if (!cache.open(
+			f,
+			268435456ULL,
+			qMax(4, 2 * ParallelUtils::get_num_threads())))
+	{
+		return false;
+	}
+	init_lut();
+	const mdcm::DataSet * ds = cache.get_dataset();
+	double frame_time = 0.0;
+	std::vector<double> v;
+	if (DicomUtils::get_ds_values(*ds, mdcm::Tag(0x0018,0x1063), v) &&
+		!v.empty())
+	{
+		frame_time = v.at(0);
+	}
+	else if (
+		DicomUtils::get_ds_values(*ds, mdcm::Tag(0x0018,0x0040), v) &&
+		!v.empty() && v.at(0) > 0.0)
+	{
+		frame_time = 1000.0 / v.at(0);
+	}
+	if (!(frame_time > 0.0)) frame_time = 33.0;
+	timer->setInterval(qBound(5, (int)frame_time, 1000));
+	const QFileInfo fi(f);
+	setWindowTitle(
+		fi.fileName() + QString(" (") +
+		QString::number(cache.get_number_of_frames()) +
+		QString(" frames, decoded on demand)"));
+	slider->blockSignals(true);
+	slider->setRange(0, (int)cache.get_number_of_frames() - 1);
+	slider->setValue(0);
+	slider->blockSignals(false);
+	set_frame(0);
+	return true;
+}
+
+void FrameViewer::wheelEvent(QWheelEvent * e)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
+	const int d = e->angleDelta().y();
+#else
+	const int d = e->delta();
+#endif
+	if (d == 0) return;
+	step((d > 0) ? -1 : 1);
+}
+
+void FrameViewer::keyPressEvent(QKeyEvent * e)
+{
+	switch (e->key())
+	{
+	case Qt::Key_Left:
+	case Qt::Key_Up:
+	case Qt::Key_PageUp:
+		step(-1);
+		break;
+	case Qt::Key_Right:
+	case Qt::Key_Down:
+	case Qt::Key_PageDown:
+		step(1);
+		break;
+	case Qt::Key_Space:
+		toggle_play();
+		break;
+	default:
+		QWidget::keyPressEvent(e);
+		break;
+	}
+}
+
+void FrameViewer::closeEvent(QCloseEvent * e)
+{
+	timer->stop();
+	cache.close();
+	e->accept();
+}
+
+void FrameViewer::set_frame(int x)
+{
+	const QImage i = render(
+		cache.get_frame((unsigned int)x),
+		(int)cache.get_dimx(),
+		(int)cache.get_dimy(),
+		cache.is_rgb(),
+		cache.is_ybr(),
+		cache.is_planar(),
+		lut,
+		signed_values);
+	view->set_image(i);
+	label->setText(
+		QString::number(x + 1) + QString(" / ") +
+		QString::number(cache.get_number_of_frames()));
+}
+
+void FrameViewer::toggle_play()
+{
+	if (timer->isActive())
+	{
+		timer->stop();
+		play_toolButton->setIcon(style()->standardIcon(QStyle::SP_MediaPlay));
+	}
+	else
+	{
+		timer->start();
+		play_toolButton->setIcon(style()->standardIcon(QStyle::SP_MediaPause));
+	}
+}
+
+void FrameViewer::next_frame()
+{
+	step(1);
+}
+
+void FrameViewer::step(int d)
+{
+	const int n = slider->maximum() + 1;
+	if (n < 2) return;
+	slider->setValue((slider->value() + d + n) % n);
+}
+
+void FrameViewer::init_lut()
+{
+	lut.clear();
+	const mdcm::Image * image = cache.get_image();
+	if (!image || cache.is_rgb() || cache.is_ybr()) return;
+	signed_values =
+		(image->GetPixelFormat().GetPixelRepresentation() == 1);
+	make_lut(
+		image, cache.get_dataset(), cache.get_frame(0), signed_values, lut);
+}
+
+// Monochrome stored values to 8 bit grey with Rescale Slope/Intercept
+// and window of the object, else min/max of 'b'.
+void FrameViewer::make_lut(
+	const mdcm::Image * image,
+	const mdcm::DataSet * ds,
+	const QByteArray & b,
+	bool signed_,
+	QVector<unsigned char> & lut)
+{
+	lut.clear();
+	const mdcm::PixelFormat & pf = image->GetPixelFormat();
+	const bool bits8 = (pf.GetBitsAllocated() == 8);
+	const int size = bits8 ? 256 : 65536;
+	const double slope = image->GetSlope();
+	const double intercept = image->GetIntercept();
+	double center = 0.0, width = 0.0;
+	short lut_function = 0;
+	DicomUtils::read_window(*ds, &center, &width, &lut_function);
+	if (!(width > 0.0))
+	{
+		const size_t n = (size_t)b.size() / (bits8 ? 1 : 2);
+		if (n == 0) return;
+		int vmin = INT_MAX, vmax = INT_MIN;
+		for (size_t x = 0; x < n; ++x)
+		{
+			int v;
+			if (bits8)
+				v = signed_
+					? (int)reinterpret_cast<const signed char*>(b.constData())[x]
+					: (int)reinterpret_cast<const unsigned char*>(b.constData())[x];
+			else
+				v = signed_
+					? (int)reinterpret_cast<const short*>(b.constData())[x]
+					: (int)reinterpret_cast<const unsigned short*>(b.constData())[x];
+			if (v < vmin) vmin = v;
+			if (v > vmax) vmax = v;
+		}
+		const double m0 = vmin * slope + intercept;
+		const double m1 = vmax * slope + intercept;
+		center = 0.5 * (m0 + m1);
+		width = qMax(1.0, fabs(m1 - m0));
+	}
+	const bool invert =
+		(image->GetPhotometricInterpretation() ==
+			mdcm::PhotometricInterpretation::MONOCHROME1);
+	const double low = center - 0.5 * width;
+	lut.resize(size);
+	for (int x = 0; x < size; ++x)
+	{
+		int v = x;
+		if (signed_) v -= (bits8 ? 128 : 32768);
+		const double m = v * slope + intercept;
+		const int y = qBound(0, (int)((m - low) / width * 255.0 + 0.5), 255);
+		lut[x] = (unsigned char)(invert ? 255 - y : y);
+	}
+}
+
+QImage FrameViewer::render(
+	const QByteArray & b,
+	int dimx,
+	int dimy,
+	bool rgb,
+	bool ybr,
+	bool planar,
+	const QVector<unsigned char> & lut,
+	bool signed_values)
+{
+	const size_t n = (size_t)dimx * dimy;
+	if (n == 0 ||
+		(size_t)b.size() < n * ((rgb || ybr) ? 3 : (lut.size() == 256 ? 1 : 2)))
+	{
+		return QImage();
+	}
+	QImage i(dimx, dimy, QImage::Format_RGB32);
+	if (i.isNull()) return QImage();
+	if (rgb || ybr)
+	{
+		const unsigned char * p =
+			reinterpret_cast<const unsigned char*>(b.constData());
+		std::vector<unsigned char> tmp0;
+		if (planar || ybr)
+		{
+			tmp0.resize(3 * n);
+			if (planar)
+			{
+				for (size_t x = 0; x < n; ++x)
+				{
+					tmp0[3 * x]     = p[x];
+					tmp0[3 * x + 1] = p[n + x];
+					tmp0[3 * x + 2] = p[2 * n + x];
+				}
+			}
+			else
+			{
+				memcpy(&tmp0[0], p, 3 * n);
+			}
+			if (ybr)
+			{
+				YBRUtils::ybr_to_rgb(&tmp0[0], &tmp0[0], n, 8);
+			}
+			p = &tmp0[0];
+		}
+		for (int y = 0; y < dimy; ++y)
+		{
+			QRgb * l = reinterpret_cast<QRgb*>(i.scanLine(y));
+			const unsigned char * q = p + 3 * (size_t)y * dimx;
+			for (int x = 0; x < dimx; ++x)
+			{
+				l[x] = qRgb(q[3 * x], q[3 * x + 1], q[3 * x + 2]);
+			}
+		}
+		return i;
+	}
+	if (lut.empty()) return QImage();
+	const bool bits8 = (lut.size() == 256);
+	const unsigned char * t = lut.constData();
+	for (int y = 0; y < dimy; ++y)
+	{
+		QRgb * l = reinterpret_cast<QRgb*>(i.scanLine(y));
+		const size_t k = (size_t)y * dimx;
+		for (int x = 0; x < dimx; ++x)
+		{
+			// the table starts at the min. of signed values
+			unsigned int v;
+			if (bits8)
+			{
+				v = reinterpret_cast<const unsigned char*>(b.constData())[k + x];
+				if (signed_values) v ^= 0x80;
+			}
+			else
+			{
+				v = reinterpret_cast<const unsigned short*>(b.constData())[k + x];
+				if (signed_values) v ^= 0x8000;
+			}
+			const unsigned char g = t[v];
+			l[x] = qRgb(g, g, g);
+		}
+	}
+	return i;
+}
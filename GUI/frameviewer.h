@@ -0,0 +1,66 @@
+#ifndef FRAMEVIEWER_H__
+#define FRAMEVIEWER_H__
+
+#include "framecache.h"
+#include <QWidget>
+#include <QImage>
+#include <QVector>
+#include <QWheelEvent>
+#include <QKeyEvent>
+#include <QCloseEvent>
+
+class QSlider;
+class QToolButton;
+class QLabel;
+class QTimer;
+
+// Window for multi-frame objects too large to be loaded as an
+// image, s. DicomUtils::read_dicom(). Frames are decoded on demand
+// by FrameCache, ahead in the direction of scrolling or playing.
+// Monochrome frames use the window of the object or min/max of
+// the first frame. Wheel and arrow keys - previous/next frame,
+// space - play/stop with Frame Time.
+class FrameViewer : public QWidget
+{
+Q_OBJECT
+public:
+	FrameViewer();
+	~FrameViewer();
+	bool open(const QString&);
+	// 8 bit grey table for stored values of monochrome frames,
+	// the window of the object or min/max of a decoded frame
+	// (or a part of it), empty for color.
+	static void make_lut(
+		const mdcm::Image*, const mdcm::DataSet*,
+		const QByteArray&, bool, QVector<unsigned char>&);
+	// Decoded samples to RGB32, width, height, RGB,
+	// YBR_FULL, planar, table, signed values.
+	static QImage render(
+		const QByteArray&, int, int, bool, bool, bool,
+		const QVector<unsigned char>&, bool);
+
+protected:
+	void wheelEvent(QWheelEvent*) override;
+	void keyPressEvent(QKeyEvent*) override;
+	void closeEvent(QCloseEvent*) override;
+
+private slots:
+	void set_frame(int);
+	void toggle_play();
+	void next_frame();
+
+private:
+	class View;
+	void step(int);
+	void init_lut();
+	FrameCache cache;
+	View * view;
+	QSlider * slider;
+	QToolButton * play_toolButton;
+	QLabel * label;
+	QTimer * timer;
+	QVector<unsigned char> lut;
+	bool signed_values;
+};
+
+#endif // FRAMEVIEWER_H__
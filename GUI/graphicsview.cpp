@@ -259,11 +259,25 @@ void GraphicsView::drawForeground(QPainter * painter, const QRectF & rect)
 	Q_UNUSED(painter);
 }
 
+// Tiled images render only the visible part, s. GraphicsWidget.
+void GraphicsView::scrollContentsBy(int dx, int dy)
+{
+	QGraphicsView::scrollContentsBy(dx, dy);
+	if (parent) parent->schedule_tiles();
+}
+
+void GraphicsView::resizeEvent(QResizeEvent * e)
+{
+	QGraphicsView::resizeEvent(e);
+	if (parent) parent->schedule_tiles();
+}
+
 void GraphicsView::scale_view(double scale_factor)
 {
 	m_scale *= scale_factor;
 	setTransform(transform().scale(scale_factor, scale_factor));
 	update_selection_rect_width();
+	if (parent) parent->schedule_tiles();
 }
 
 void GraphicsView::update_selection_rect_width()
@@ -647,6 +661,7 @@ void GraphicsView::flip()
 void GraphicsView::animate_flip()
 {
 	if (!image_item) return;
+	if (parent && parent->is_tiled()) return;
 	if (m_angle >= 360) return;
 	m_angle += 10;
 	QRectF r = image_item->boundingRect();
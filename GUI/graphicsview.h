@@ -15,6 +15,7 @@
 #include <QKeyEvent>
 #include <QWheelEvent>
 #include <QMouseEvent>
+#include <QResizeEvent>
 #include <QPainter>
 #include <QMap>
 #include <QList>
@@ -93,6 +94,8 @@ protected:
 	void mouseMoveEvent(QMouseEvent*) override;
 	void drawBackground(QPainter*, const QRectF&) override;
 	void drawForeground(QPainter*, const QRectF&) override;
+	void scrollContentsBy(int, int) override;
+	void resizeEvent(QResizeEvent*) override;
 
 signals:
 	void bb_changed();
@@ -1,3 +1,6 @@
+//#define ALIZA_PRINT_LUT_TIME
+//#define ALIZA_PRINT_CINE_STATS
+
 #include "graphicswidget.h"
 #include <QtGlobal>
 #include <QVBoxLayout>
@@ -18,6 +21,7 @@
 #include <QFileInfo>
 #include <QDir>
 #include <QScrollBar>
+#include <QPoint>
 #include "itk/itkSigmoid2ImageFilter.h"
 #include "itkIntensityWindowingImageFilter.h"
 #include "itkExtractImageFilter.h"
@@ -27,6 +31,7 @@
 #include "itkImageRegionIterator.h"
 #include "itkImageRegionConstIterator.h"
 #include "processimagethreadLUT.hxx"
+#include "sliceview.hxx"
 #include "graphicsutils.h"
 #include "commonutils.h"
 #include "contourutils.h"
@@ -159,6 +164,18 @@ template<typename Tin, typename Tout> QString get_slice_(
 {
 	if (image.IsNull())
 		return QString("get_slice_<>() : image.IsNull()");
+	if (v2d)
+	{
+		if (get_slice_view<Tin, Tout>(
+				axis, image, idx, out_image,
+				v2d->slice_source, v2d->slice_buffer))
+		{
+			v2d->idimx = out_image->GetLargestPossibleRegion().GetSize()[0];
+			v2d->idimy = out_image->GetLargestPossibleRegion().GetSize()[1];
+			return QString();
+		}
+		v2d->slice_source = NULL;
+	}
 	typedef itk::ExtractImageFilter<Tin, Tout> FilterType;
 	const typename Tin::RegionType inRegion =
 		image->GetLargestPossibleRegion();
@@ -1166,6 +1183,186 @@ template<typename T> void load_rgba_char_image(
 #endif
 }
 
+// Slices with at least this number of pixels are rendered as
+// tiles of the visible area at the visible resolution. This is
+// render-side only: the slice is decoded whole at load time, the
+// tiles bound the RGB copy by the viewport and the tile cache.
+// Larger JPEG 2000 images are decoded by area and resolution
+// level in RegionViewer.
+static const unsigned long long tiled_min_pixels = 4096ULL*4096ULL;
+
+// One output tile per part, 'level' - each tile pixel covers
+// (1 << level)^2 image pixels, box filtered if smooth, else
+// nearest. Rows are gathered and mapped with the LUT table.
+template<typename T> class TileTask_ : public ParallelTask
+{
+public:
+	typedef typename T::PixelType PixelType;
+	TileTask_(
+		const PixelType * buffer_,
+		const int size_0_, const int size_1_,
+		const int level_, const bool smooth_,
+		const LUTTable * table_,
+		const QVector<QPoint> & tiles_,
+		QVector<QImage> & images_)
+		:
+		buffer(buffer_),
+		size_0(size_0_), size_1(size_1_),
+		level(level_), smooth(smooth_),
+		table(table_),
+		tiles(tiles_),
+		images(images_)
+	{
+	}
+
+	~TileTask_()
+	{
+	}
+
+	void process(int i) override
+	{
+		const int tile_size = TileCache::get_tile_size();
+		const int step = 1 << level;
+		const int x0 = tiles.at(i).x()*tile_size*step;
+		const int y0 = tiles.at(i).y()*tile_size*step;
+		const int w = qMin(tile_size, (size_0 - x0 + step - 1) / step);
+		const int h = qMin(tile_size, (size_1 - y0 + step - 1) / step);
+		if (w < 1 || h < 1) return;
+		QImage tile(w, h, QImage::Format_RGB888);
+		if (tile.isNull()) return;
+		std::vector<PixelType> row;
+		try { row.resize(w); }
+		catch (const std::bad_alloc&) { return; }
+		const bool integer = LUTPixelTraits<PixelType>::integer();
+		for (int y = 0; y < h; ++y)
+		{
+			const int iy = y0 + y*step;
+			if (smooth && step > 1)
+			{
+				const int ey = qMin(iy + step, size_1);
+				for (int x = 0; x < w; ++x)
+				{
+					const int ix = x0 + x*step;
+					const int ex = qMin(ix + step, size_0);
+					double sum = 0.0;
+					for (int k = iy; k < ey; ++k)
+					{
+						const PixelType * r = buffer + static_cast<size_t>(k)*size_0;
+						for (int j = ix; j < ex; ++j) sum += r[j];
+					}
+					const double v = sum / ((ey - iy)*(ex - ix));
+					row[x] = static_cast<PixelType>(integer ? floor(v + 0.5) : v);
+				}
+			}
+			else
+			{
+				const PixelType * r = buffer + static_cast<size_t>(iy)*size_0;
+				for (int x = 0; x < w; ++x) row[x] = r[x0 + x*step];
+			}
+			LUTPixelTraits<PixelType>::apply(&row[0], tile.scanLine(y), w, table);
+		}
+		images[i] = tile;
+	}
+
+private:
+	const PixelType * buffer;
+	const int size_0;
+	const int size_1;
+	const int level;
+	const bool smooth;
+	const LUTTable * table;
+	const QVector<QPoint> & tiles;
+	QVector<QImage> & images;
+};
+
+// Called after the view transform is set, the image item shows
+// the visible tiles plus one tile margin at the level closest
+// to the screen resolution.
+template<typename T> void load_image_tiles(
+	const typename T::PixelType * buffer,
+	GraphicsWidget * widget,
+	const int size_0, const int size_1,
+	const LUTTable * table)
+{
+	GraphicsView * view = widget->graphicsview;
+	if (!view->image_item) return;
+	const QTransform & vt = view->transform();
+	const double s = qMax(
+		qMax(qAbs(vt.m11()), qAbs(vt.m12())),
+		qMax(qAbs(vt.m21()), qAbs(vt.m22())));
+	int level = 0;
+	while (level < 8 && s*(2 << level) <= 1.0) ++level;
+	const int step = 1 << level;
+	const int tile_size = TileCache::get_tile_size();
+	const int tile_pixels = tile_size*step;
+	const QRectF visible =
+		view->mapToScene(view->viewport()->rect()).boundingRect().intersected(
+			QRectF(0, 0, size_0, size_1));
+	if (visible.isEmpty())
+	{
+		view->image_item->setPixmap(QPixmap());
+		return;
+	}
+	const int tx0 = qMax(0, static_cast<int>(floor(visible.left() / tile_pixels)) - 1);
+	const int ty0 = qMax(0, static_cast<int>(floor(visible.top()  / tile_pixels)) - 1);
+	const int tx1 = qMin((size_0 - 1) / tile_pixels, static_cast<int>(floor(visible.right()  / tile_pixels)) + 1);
+	const int ty1 = qMin((size_1 - 1) / tile_pixels, static_cast<int>(floor(visible.bottom() / tile_pixels)) + 1);
+	const int nx = tx1 - tx0 + 1;
+	const int ny = ty1 - ty0 + 1;
+	QVector<QImage> images(nx*ny);
+	QVector<QPoint> missing;
+	QVector<int> missing_idx;
+	for (int ty = ty0; ty <= ty1; ++ty)
+	{
+		for (int tx = tx0; tx <= tx1; ++tx)
+		{
+			const int idx = (ty - ty0)*nx + (tx - tx0);
+			const QImage * i = widget->tile_cache.get(level, tx, ty);
+			if (i)
+			{
+				images[idx] = *i;
+			}
+			else
+			{
+				missing.push_back(QPoint(tx, ty));
+				missing_idx.push_back(idx);
+			}
+		}
+	}
+	if (!missing.empty())
+	{
+		QVector<QImage> tmp(missing.size());
+		TileTask_<T> t(
+			buffer, size_0, size_1,
+			level, widget->get_smooth(),
+			table, missing, tmp);
+		ParallelUtils::run(&t, missing.size());
+		for (int x = 0; x < missing.size(); ++x)
+		{
+			widget->tile_cache.insert(level, missing.at(x).x(), missing.at(x).y(), tmp.at(x));
+			images[missing_idx.at(x)] = tmp.at(x);
+		}
+	}
+	const int w = (qMin(size_0, (tx1 + 1)*tile_pixels) - tx0*tile_pixels + step - 1) / step;
+	const int h = (qMin(size_1, (ty1 + 1)*tile_pixels) - ty0*tile_pixels + step - 1) / step;
+	QImage region(w, h, QImage::Format_RGB888);
+	if (region.isNull()) return;
+	region.fill(Qt::black);
+	QPainter painter(&region);
+	for (int y = 0; y < ny; ++y)
+	{
+		for (int x = 0; x < nx; ++x)
+		{
+			const QImage & i = images.at(y*nx + x);
+			if (!i.isNull()) painter.drawImage(x*tile_size, y*tile_size, i);
+		}
+	}
+	painter.end();
+	view->image_item->setPixmap(QPixmap::fromImage(region));
+	view->image_item->setPos(tx0*tile_pixels, ty0*tile_pixels);
+	view->image_item->setTransform(QTransform::fromScale(step, step));
+}
+
 template<typename T> void load_image(
 	const typename T::Pointer & image,
 	const ImageContainer & image_container,
@@ -1188,12 +1385,6 @@ template<typename T> void load_image(
 	const typename T::SizeType size       = region.GetSize();
 	const short lut = ivariant->di->selected_lut;
 	const bool alt_mode = widget->get_alt_mode();
-	//
-	const unsigned int p_size = 3*size[0]*size[1];
-	unsigned char * p = NULL;
-	try { p = new unsigned char[p_size]; }
-	catch (const std::bad_alloc&) { p = NULL; }
-	if (!p) return;
 	const short axis = widget->get_axis();
 	//
 	double window_center, window_width;
@@ -1234,106 +1425,64 @@ template<typename T> void load_image(
 	//
 	const bool global_flip_x = widget->graphicsview->global_flip_x;
 	const bool global_flip_y = widget->graphicsview->global_flip_y;
-	const int num_threads = QThread::idealThreadCount();
-	const int tmp99 = size[1]%num_threads;
-	if (!widget->threadsLUT_.empty())
-	{
-		std::cout << "load_image<>() : widget->threadsLUT_.size()>0" << std::endl;
-	}
-	if (tmp99 == 0)
-	{
-		int j = 0;
-		for (int i = 0; i < num_threads; ++i)
-		{
-			const int size_0 = size[0];
-			const int size_1 = size[1]/num_threads;
-			const int index_0 = 0;
-			const int index_1 = i*size_1;
-			ProcessImageThreadLUT_<T> * t__ = new ProcessImageThreadLUT_<T>(
-						image,
-						p,
-						size_0,  size_1,
-						index_0, index_1, j,
-						window_center, window_width,
-						lut, alt_mode,lut_function);
-			j += 3*size_0*size_1;
-			widget->threadsLUT_.push_back(static_cast<QThread*>(t__));
-			t__->start();
-		}
+	//
+	typedef typename T::PixelType PixelType;
+	const PixelType * buffer = NULL;
+	QSharedPointer<const LUTTable> table;
+	if (axis == 2 &&
+		LUTPixelTraits<PixelType>::supported() &&
+		static_cast<unsigned long long>(size[0])*size[1] >= tiled_min_pixels &&
+		!(widget->get_enable_overlays() &&
+			ivariant->image_overlays.all_overlays.contains(
+				ivariant->di->selected_z_slice)))
+	{
+		const typename T::RegionType & r = image->GetBufferedRegion();
+		if (r.GetIndex()[0] == 0 && r.GetIndex()[1] == 0 &&
+			r.GetSize()[0] == size[0] && r.GetSize()[1] == size[1])
+		{
+			table = LUTUtils::get_table(
+				LUTPixelTraits<PixelType>::integer(),
+				LUTPixelTraits<PixelType>::min(),
+				LUTPixelTraits<PixelType>::max(),
+				window_center, window_width,
+				lut, alt_mode, lut_function);
+			if (!table.isNull()) buffer = image->GetBufferPointer();
+		}
+	}
+	const bool tiled = (buffer != NULL);
+	unsigned char * p = NULL;
+	if (tiled)
+	{
+		widget->tile_cache.set_signature(
+			QString::number(reinterpret_cast<quintptr>(image.GetPointer())) +
+			QString(" ") + QString::number(image->GetMTime()) +
+			QString(" ") + QString::number(ivariant->id) +
+			QString(" ") + QString::number(ivariant->di->selected_z_slice) +
+			QString(" ") + QString::number(window_center, 'g', 17) +
+			QString(" ") + QString::number(window_width, 'g', 17) +
+			QString(" ") + QString::number(lut) +
+			QString(" ") + QString::number(lut_function) +
+			QString(" ") + QString::number(alt_mode ? 1 : 0) +
+			QString(" ") + QString::number(widget->get_smooth() ? 1 : 0));
+		widget->set_tiled(true);
 	}
 	else
 	{
-		int j = 0;
-		unsigned int block = 64;
-		if (static_cast<float>(size[1])/static_cast<float>(block)>16.0f) block=128;
-		const int tmp100 = size[1]%block;
-		const int incr = (int)floor(size[1]/(double)block);
-		if (size[1] > block)
-		{
-			for (int i = 0; i < incr; ++i)
-			{
-				const int size_0 = size[0];
-				const int index_0 = 0;
-				const int index_1 = i*block;
-				ProcessImageThreadLUT_<T> * t__ = new ProcessImageThreadLUT_<T>(
-							image,
-							p,
-							size_0,  block,
-							index_0, index_1, j,
-							window_center, window_width,
-							lut, alt_mode,lut_function);
-				j += 3*size_0*block;
-				widget->threadsLUT_.push_back(static_cast<QThread*>(t__));
-				t__->start();
-			}
-			ProcessImageThreadLUT_<T> * lt__ = new ProcessImageThreadLUT_<T>(
-						image,
-						p,
-						size[0],  tmp100,
-						0, incr*block, j,
-						window_center, window_width,
-						lut, alt_mode,lut_function);
-			widget->threadsLUT_.push_back(static_cast<QThread*>(lt__));
-			lt__->start();
-		}
-		else
-		{
-			ProcessImageThreadLUT_<T> * lt__ = new ProcessImageThreadLUT_<T>(
-						image,
-						p,
-						size[0],  size[1],
-						0, 0, 0,
-						window_center, window_width,
-						lut, alt_mode,lut_function);
-			widget->threadsLUT_.push_back(static_cast<QThread*>(lt__));
-			lt__->start();
-		}
-	}
-	//
-#if 0
-#ifdef _WIN32
-	Sleep(1);
-#else
-	usleep(1000);
-#endif
+		const unsigned int p_size = 3*size[0]*size[1];
+		try { p = new unsigned char[p_size]; }
+		catch (const std::bad_alloc&) { p = NULL; }
+		if (!p) return;
+		widget->lut_times.add(
+			process_image_lut<T>(
+				image, p,
+				size[0], size[1],
+				window_center, window_width,
+				lut, alt_mode, lut_function));
+#ifdef ALIZA_PRINT_LUT_TIME
+		std::cout << "LUT pass: "
+			<< widget->lut_times.to_string().toStdString() << std::endl;
 #endif
-	//
-	const unsigned short threadsLUT_size = widget->threadsLUT_.size();
-	while (true)
-	{
-		unsigned short b__ = 0;
-		for (int i = 0; i < threadsLUT_size; ++i)
-		{
-			if (widget->threadsLUT_.at(i)->isFinished()) { ++b__; }
-		}
-		if (b__ == threadsLUT_size) break;
-	}
-	for (int i = 0; i < threadsLUT_size; ++i)
-	{
-		delete widget->threadsLUT_[i];
-		widget->threadsLUT_[i] = NULL;
 	}
-	widget->threadsLUT_.clear();
 	//
 	double coeff_size_0 = 1.0, coeff_size_1 = 1.0;
 	const QRectF rectf(0,0,size[0],size[1]);
@@ -1367,21 +1516,25 @@ template<typename T> void load_image(
 	widget->graphicsview->image_item->setZValue(-1.0);
 	widget->graphicsview->scene()->addItem(widget->graphicsview->image_item);
 #endif
+	QImage tmpi;
+	if (p)
+	{
 #if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
-	QImage tmpi(p,size[0],size[1],3*size[0],QImage::Format_RGB888,gImageCleanupHandler,p);
+		tmpi = QImage(p,size[0],size[1],3*size[0],QImage::Format_RGB888,gImageCleanupHandler,p);
 #else
-	QImage tmpi(p,size[0],size[1],3*size[0],QImage::Format_RGB888);
+		tmpi = QImage(p,size[0],size[1],3*size[0],QImage::Format_RGB888);
 #endif
-	//
-	if (axis==2)
-	{
-		if (widget->get_enable_overlays())
-			GraphicsUtils::draw_overlays(ivariant, tmpi);
-	}
-	else
-	{
-		if (!ivariant->equi||ivariant->orientation_string.isEmpty())
-			GraphicsUtils::draw_cross_out(tmpi);
+		//
+		if (axis==2)
+		{
+			if (widget->get_enable_overlays())
+				GraphicsUtils::draw_overlays(ivariant, tmpi);
+		}
+		else
+		{
+			if (!ivariant->equi||ivariant->orientation_string.isEmpty())
+				GraphicsUtils::draw_cross_out(tmpi);
+		}
 	}
 	//
 	const double xratio = (double)widget->graphicsview->width()  / (double)(size[0]*coeff_size_0);
@@ -1393,7 +1546,7 @@ template<typename T> void load_image(
 	}
 	else scale__ = widget->graphicsview->m_scale;
 	//
-	widget->graphicsview->image_item->setPixmap(QPixmap::fromImage(tmpi));
+	if (!tiled) widget->graphicsview->image_item->setPixmap(QPixmap::fromImage(tmpi));
 	QTransform t = QTransform();
 	if (spacing[1]!=spacing[0]) t = t.scale(coeff_size_0, coeff_size_1);
 	t = t.scale(scale__, scale__);
@@ -1428,6 +1581,9 @@ template<typename T> void load_image(
 	//
 	widget->graphicsview->setTransform(t);
 	//
+	if (tiled)
+		load_image_tiles<T>(buffer, widget, size[0], size[1], table.data());
+	//
 #if QT_VERSION < QT_VERSION_CHECK(5,0,0)
 	tmpi = QImage();
 	if (p)
@@ -1438,6 +1594,149 @@ template<typename T> void load_image(
 #endif
 }
 
+// Axial cine frames of a buffered scalar volume with the
+// window/level and LUT of load_image(), s. CinePrefetch.
+template<typename T> class CineFrameSource_ : public CineFrameSource
+{
+public:
+	typedef typename T::PixelType PixelType;
+	CineFrameSource_(
+		const typename T::Pointer & image_,
+		const ImageVariant * ivariant,
+		const short lut_, const bool alt_mode_)
+		:
+		image(image_),
+		buffer(image_->GetBufferPointer()),
+		size_0(image_->GetLargestPossibleRegion().GetSize()[0]),
+		size_1(image_->GetLargestPossibleRegion().GetSize()[1]),
+		size_2(image_->GetLargestPossibleRegion().GetSize()[2]),
+		lock_level(ivariant->di->lock_level2D),
+		frame_levels(ivariant->frame_levels),
+		default_center(ivariant->di->default_us_window_center),
+		default_width(ivariant->di->default_us_window_width),
+		default_lut_function(ivariant->di->default_lut_function),
+		center(ivariant->di->us_window_center),
+		width(ivariant->di->us_window_width),
+		lut_function(ivariant->di->lut_function),
+		lut(lut_),
+		alt_mode(alt_mode_)
+	{
+	}
+
+	~CineFrameSource_()
+	{
+	}
+
+	QImage render(int k) const override
+	{
+		if (!buffer || k < 0 || k >= size_2) return QImage();
+		double window_center = center, window_width = width;
+		short lut_function_ = lut_function;
+		if (lock_level)
+		{
+			if (frame_levels.contains(k))
+			{
+				const FrameLevel fl = frame_levels.value(k);
+				window_center = fl.us_window_center;
+				window_width = fl.us_window_width;
+				lut_function_ = fl.lut_function;
+			}
+			else
+			{
+				window_center = default_center;
+				window_width = default_width;
+				lut_function_ = default_lut_function;
+			}
+		}
+		QSharedPointer<const LUTTable> table = LUTUtils::get_table(
+			LUTPixelTraits<PixelType>::integer(),
+			LUTPixelTraits<PixelType>::min(),
+			LUTPixelTraits<PixelType>::max(),
+			window_center, window_width,
+			lut, alt_mode, lut_function_);
+		if (table.isNull()) return QImage();
+		QImage i(size_0, size_1, QImage::Format_RGB888);
+		if (i.isNull()) return QImage();
+		const PixelType * p =
+			buffer + static_cast<size_t>(k)*size_0*size_1;
+		for (int y = 0; y < size_1; ++y)
+		{
+			LUTPixelTraits<PixelType>::apply(
+				p + static_cast<size_t>(y)*size_0,
+				i.scanLine(y), size_0, table.data());
+		}
+		return i;
+	}
+
+private:
+	const typename T::Pointer image;
+	const PixelType * buffer;
+	const int size_0;
+	const int size_1;
+	const int size_2;
+	const bool lock_level;
+	const FrameLevels frame_levels;
+	const double default_center;
+	const double default_width;
+	const short default_lut_function;
+	const double center;
+	const double width;
+	const short lut_function;
+	const short lut;
+	const bool alt_mode;
+};
+
+template<typename T> CineFrameSource * create_cine_source(
+	const typename T::Pointer & image,
+	const ImageVariant * ivariant,
+	const short lut, const bool alt_mode)
+{
+	if (image.IsNull()) return NULL;
+	if (!LUTPixelTraits<typename T::PixelType>::supported()) return NULL;
+	const typename T::RegionType region = image->GetLargestPossibleRegion();
+	if (image->GetBufferedRegion() != region) return NULL;
+	if (!image->GetBufferPointer()) return NULL;
+	// large slices are tiled, s. load_image()
+	if (static_cast<unsigned long long>(region.GetSize()[0])*region.GetSize()[1] >=
+			tiled_min_pixels)
+		return NULL;
+	CineFrameSource * s = NULL;
+	try { s = new CineFrameSource_<T>(image, ivariant, lut, alt_mode); }
+	catch (const std::bad_alloc&) { s = NULL; }
+	return s;
+}
+
+static CineFrameSource * create_cine_source__(
+	const ImageVariant * v, const short lut, const bool alt_mode)
+{
+	switch (v->image_type)
+	{
+	case 0: return create_cine_source<ImageTypeSS>(v->pSS, v, lut, alt_mode);
+	case 1: return create_cine_source<ImageTypeUS>(v->pUS, v, lut, alt_mode);
+	case 2: return create_cine_source<ImageTypeSI>(v->pSI, v, lut, alt_mode);
+	case 4: return create_cine_source<ImageTypeUC>(v->pUC, v, lut, alt_mode);
+	case 5: return create_cine_source<ImageTypeF>(v->pF, v, lut, alt_mode);
+	case 6: return create_cine_source<ImageTypeD>(v->pD, v, lut, alt_mode);
+	default: break;
+	}
+	return NULL;
+}
+
+static double get_frame_time__(
+	const ImageVariant * v, const int k,
+	const int frametime_2D, const int frame_time_unit,
+	bool * time_defined)
+{
+	if (v->frame_times.size() > static_cast<unsigned int>(k))
+	{
+		*time_defined = true;
+		const double t = v->frame_times.at(k);
+		return (frame_time_unit == 1) ? t*1000 : t;
+	}
+	*time_defined = false;
+	return frametime_2D;
+}
+
 static double get_distance2(
 	const double x0,
 	const double y0,
@@ -1578,6 +1877,14 @@ GraphicsWidget::GraphicsWidget(
 	anim2D_timer = new QTimer(this);
 	anim2D_timer->setSingleShot(true);
 	connect(anim2D_timer, SIGNAL(timeout()), this, SLOT(animate_()));
+	tiled = false;
+	cine_next_due = 0.0;
+	cine_dropped = 0;
+	cine_late = 0;
+	tiles_timer = new QTimer(this);
+	tiles_timer->setSingleShot(true);
+	tiles_timer->setInterval(30);
+	connect(tiles_timer, SIGNAL(timeout()), this, SLOT(update_tiles()));
 	image_container.image3D = NULL;
 	image_container.image2D = new ImageVariant2D();
 	graphicsview = new GraphicsView(this);
@@ -1602,16 +1909,6 @@ GraphicsWidget::~GraphicsWidget()
 				threads_[i] = NULL;
 			}
 		}
-		for (unsigned int i = 0; i < threadsLUT_.size(); ++i)
-		{
-			if (threadsLUT_.at(i))
-			{
-				if (threadsLUT_.at(i)->isRunning())
-					threadsLUT_[i]->exit();
-				delete threadsLUT_[i];
-				threadsLUT_[i] = NULL;
-			}
-		}
 		if (image_container.image2D)
 		{
 			delete image_container.image2D;
@@ -1737,6 +2034,7 @@ void GraphicsWidget::update_image(
 	//
 	if (lock) mutex.lock();
 	//
+	tiled = false;
 	switch(image_container.image2D->image_type)
 	{
 	case 0: load_image<Image2DTypeSS>(
@@ -1919,6 +2217,8 @@ void GraphicsWidget::update_image(
 void GraphicsWidget::clear_(bool lock)
 {
 	if (lock) mutex.lock();
+	tiled = false;
+	tile_cache.clear();
 	if (graphicsview->image_item)
 	{
 #ifdef DELETE_GRAPHICSIMAGEITEM
@@ -2057,6 +2357,8 @@ void GraphicsWidget::clear_(bool lock)
 			image_container.image2D->pD_rgba->DisconnectPipeline();
 			image_container.image2D->pD_rgba =NULL;
 		}
+		image_container.image2D->slice_source = NULL;
+		image_container.image2D->slice_buffer = NULL;
 	}
 	image_container.image3D = NULL;
 	set_top_label_text(QString(""));
@@ -2480,6 +2782,8 @@ bool GraphicsWidget::get_bb() const
 
 void GraphicsWidget::start_animation()
 {
+	cine_dropped = 0;
+	cine_late = 0;
 	animate_();
 }
 
@@ -2487,6 +2791,150 @@ void GraphicsWidget::stop_animation()
 {
 	run__ = false;
 	anim2D_timer->stop();
+	if (cine.is_running())
+	{
+		stop_cine_();
+#ifdef ALIZA_PRINT_CINE_STATS
+		std::cout << "Cine: " << get_cine_stats().toStdString() << std::endl;
+#endif
+		// displayed frames are not in the 2D image
+		if (image_container.image3D)
+			set_slice_2D(image_container.image3D, 0, false);
+	}
+}
+
+qint64 GraphicsWidget::get_cine_dropped_frames() const
+{
+	return cine_dropped;
+}
+
+qint64 GraphicsWidget::get_cine_late_frames() const
+{
+	return cine_late;
+}
+
+QString GraphicsWidget::get_cine_stats() const
+{
+	return
+		QString("dropped ") + QString::number(cine_dropped) +
+		QString(", late ") + QString::number(cine_late) +
+		QString(", render ") + cine.get_render_times().to_string();
+}
+
+void GraphicsWidget::stop_cine_()
+{
+	cine.stop();
+	cine_signature = QString();
+}
+
+// Axial cine of scalar volumes without visible contours or
+// overlays. Frames are rendered ahead by CinePrefetch, the
+// tick only swaps the pixmap. Ticks are scheduled from the
+// start of playback, so frame times do not drift. Frames
+// whose display time is already over are dropped. Returns
+// false if the frame has to be set with set_slice_2D().
+bool GraphicsWidget::animate_cine_()
+{
+	ImageVariant * v = image_container.image3D;
+	const int dimz = v->di->idimz;
+	bool supported = (dimz > 1 && graphicsview->image_item);
+	if (supported && enable_overlays && !v->image_overlays.all_overlays.empty())
+		supported = false;
+	for (int x = 0; supported && x < v->di->rois.size(); ++x)
+	{
+		if (v->di->rois.at(x).show) supported = false;
+	}
+	if (!supported)
+	{
+		if (cine.is_running()) stop_cine_();
+		return false;
+	}
+	const QString signature =
+		QString::number(reinterpret_cast<quintptr>(v)) +
+		QString(" ") + QString::number(v->di->lock_level2D ? 1 : 0) +
+		QString(" ") + QString::number(v->di->us_window_center, 'g', 17) +
+		QString(" ") + QString::number(v->di->us_window_width, 'g', 17) +
+		QString(" ") + QString::number(v->di->lut_function) +
+		QString(" ") + QString::number(v->di->selected_lut) +
+		QString(" ") + QString::number(alt_mode ? 1 : 0);
+	const bool first = (!cine.is_running() || signature != cine_signature);
+	if (first)
+	{
+		CineFrameSource * source =
+			create_cine_source__(v, v->di->selected_lut, alt_mode);
+		if (!source)
+		{
+			if (cine.is_running()) stop_cine_();
+			return false;
+		}
+		const int depth = qBound(2, 2*ParallelUtils::get_num_threads(), 8);
+		cine.start(source, depth);
+		cine_signature = signature;
+		cine_clock.start();
+		cine_next_due = 0.0;
+	}
+	const double now = cine_clock.nsecsElapsed()*1e-6;
+	if (first) cine_next_due = now;
+	int k = v->di->selected_z_slice;
+	k = (k >= dimz - 1 || k < 0) ? 0 : k + 1;
+	bool time_defined = false;
+	double requested_time =
+		get_frame_time__(v, k, frametime_2D, frame_time_unit, &time_defined);
+	bool dropped = false;
+	for (int x = 0; x < dimz - 1; ++x)
+	{
+		if (now < cine_next_due + requested_time) break;
+		cine_next_due += requested_time;
+		k = (k >= dimz - 1) ? 0 : k + 1;
+		requested_time =
+			get_frame_time__(v, k, frametime_2D, frame_time_unit, &time_defined);
+		++cine_dropped;
+		dropped = true;
+	}
+	QImage i;
+	bool late = false;
+	if (!cine.take(k, i))
+	{
+		i = cine.render(k);
+		if (!first)
+		{
+			++cine_late;
+			late = true;
+		}
+	}
+	QList<int> next;
+	const int depth = qBound(2, 2*ParallelUtils::get_num_threads(), 8);
+	for (int x = 1; x <= depth && x < dimz; ++x) next.push_back((k + x) % dimz);
+	cine.request(next);
+	//
+	if (v->di->lock_2Dview)
+	{
+		v->di->from_slice = k;
+		v->di->to_slice = (v->di->lock_single) ? k : dimz - 1;
+	}
+	v->di->selected_z_slice = k;
+	if (!i.isNull()) graphicsview->image_item->setPixmap(QPixmap::fromImage(i));
+	aliza->update_slice_from_animation(const_cast<const ImageVariant*>(v));
+	//
+	cine_next_due += requested_time;
+	const double t = cine_next_due - cine_clock.nsecsElapsed()*1e-6;
+	anim2D_timer->start((t > 0.0) ? static_cast<int>(t + 0.5) : 0);
+	if (dropped || late)
+	{
+		if (!toolbox2D->is_red())
+			toolbox2D->set_indicator_red();
+	}
+	else if (time_defined)
+	{
+		if (!toolbox2D->is_green())
+			toolbox2D->set_indicator_green();
+	}
+	else
+	{
+		if (!toolbox2D->is_blue())
+			toolbox2D->set_indicator_blue();
+	}
+	return true;
 }
 
 void GraphicsWidget::animate_()
@@ -2496,6 +2944,7 @@ void GraphicsWidget::animate_()
 	double requested_time = frametime_2D;
 	bool time_defined = false;
 	if (!image_container.image3D) return;
+	if (axis == 2 && animate_cine_()) return;
 	const qint64 t0 = QDateTime::currentMSecsSinceEpoch();
 	switch(axis)
 	{
@@ -2663,6 +3112,27 @@ bool GraphicsWidget::get_smooth() const
 	return smooth_;
 }
 
+bool GraphicsWidget::is_tiled() const
+{
+	return tiled;
+}
+
+void GraphicsWidget::set_tiled(bool t)
+{
+	tiled = t;
+}
+
+void GraphicsWidget::schedule_tiles()
+{
+	if (tiled && !tiles_timer->isActive()) tiles_timer->start();
+}
+
+void GraphicsWidget::update_tiles()
+{
+	if (!tiled) return;
+	update_image(0, false, true);
+}
+
 void GraphicsWidget::update_measurement(
 	double x0,
 	double y0,
@@ -4,6 +4,9 @@
 #include "graphicsview.h"
 #include "structures.h"
 #include "toolbox2D.h"
+#include "timecounter.h"
+#include "tilecache.h"
+#include "cineprefetch.h"
 #include "sliderwidget.h"
 #include <QWidget>
 #include <QLabel>
@@ -15,6 +18,7 @@
 #include <QPointF>
 #include <QPen>
 #include <QTimer>
+#include <QElapsedTimer>
 #include <QMutex>
 #include <QMouseEvent>
 #include <QEvent>
@@ -51,7 +55,8 @@ public:
 	ToolBox2D    * toolbox2D;
 	SliderWidget * slider_m;
 	std::vector<ProcessImageThread_*> threads_;
-	std::vector<QThread*> threadsLUT_;
+	TimeCounter lut_times;
+	TileCache tile_cache;
 	void set_slice_2D(
 		ImageVariant*,
 		const short/*fit*/,
@@ -109,6 +114,15 @@ public:
 	bool get_enable_overlays() const;
 	void set_enable_shutter(bool);
 	void set_enable_overlays(bool);
+	// Large slices are rendered as tiles of the visible area,
+	// updated after pan and zoom.
+	bool is_tiled() const;
+	void set_tiled(bool);
+	void schedule_tiles();
+	// 2D cine counters since start_animation().
+	qint64 get_cine_dropped_frames() const;
+	qint64 get_cine_late_frames() const;
+	QString get_cine_stats() const;
 
 public slots:
 	void set_frame_time_unit(bool);
@@ -119,6 +133,7 @@ public slots:
 
 private slots:
 	void animate_();
+	void update_tiles();
 
 signals:
 	void slice_changed(int);
@@ -128,6 +143,8 @@ protected:
 	void leaveEvent(QEvent*) override;
 
 private:
+	bool animate_cine_();
+	void stop_cine_();
 	short  axis;
 	bool   main;
 	bool   multi;
@@ -141,6 +158,14 @@ private:
 	int    frametime_2D;
 	double contours_width;
 	QTimer    * anim2D_timer;
+	QTimer    * tiles_timer;
+	bool        tiled;
+	CinePrefetch  cine;
+	QElapsedTimer cine_clock;
+	QString       cine_signature;
+	double        cine_next_due;
+	qint64        cine_dropped;
+	qint64        cine_late;
 	QLabel    * top_label;
 	QLabel    * left_label;
 	QLabel    * measure_label;
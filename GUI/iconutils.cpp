@@ -4,6 +4,8 @@
 #include <QPainter>
 #include <QImage>
 #include <QColor>
+#include <QThread>
+#include <QCoreApplication>
 #include <vector>
 #include "iconutils.h"
 #ifndef _WIN32
@@ -913,6 +915,10 @@ template<typename Tin, typename Tout> void extract_icon_rgba(
 void IconUtils::icon(ImageVariant * ivariant)
 {
 	if (!ivariant) return;
+	// QPixmap is GUI thread only, series decoded on the pool
+	// get the icon when they are added
+	if (QThread::currentThread() !=
+		QCoreApplication::instance()->thread()) return;
 	switch(ivariant->image_type)
 	{
 	case 0:
@@ -0,0 +1,545 @@
+#include "lututils.h"
+#include <QtGlobal>
+#include <QMutex>
+#include <QMutexLocker>
+#include <climits>
+#include <cmath>
+#include <limits>
+#include "luts.h"
+
+#ifndef DISABLE_SIMDMATH
+#if (defined __SSE2__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2))
+#define LUTUTILS_USE_SSE2
+#include <emmintrin.h>
+#endif
+#endif
+
+namespace
+{
+
+const int float_table_size = 65536;
+const int max_cached_tables = 8;
+
+QMutex tables_mutex;
+std::vector< QSharedPointer<const LUTTable> > tables;
+
+bool get_lut_data(short lut, const unsigned char ** data, int * size)
+{
+	switch (lut)
+	{
+	case 0: *data = NULL;              *size = 0;                    break;
+	case 1: *data = default_lut;       *size = default_lut_size;     break;
+	case 2: *data = black_rainbow_lut; *size = black_rainbow_size;   break;
+	case 3: *data = syngo_lut;         *size = syngo_lut_size;       break;
+	case 4: *data = hot_iron;          *size = hot_iron_size;        break;
+	case 5: *data = hot_metal_blue;    *size = hot_metal_blue_size;  break;
+	case 6: *data = pet_dicom_lut;     *size = pet_dicom_lut_size;   break;
+	case 7: *data = pet20_dicom_lut;   *size = pet20_dicom_lut_size; break;
+	default: return false;
+	}
+	return true;
+}
+
+void out_of_window(
+	bool above, unsigned char * p,
+	const unsigned char * data, int size, bool alt_mode)
+{
+	if (!data)
+	{
+		const unsigned char c = (above && !alt_mode) ? UCHAR_MAX : 0;
+		p[0] = c;
+		p[1] = c;
+		p[2] = c;
+	}
+	else
+	{
+		const int z = (above && !alt_mode) ? size - 1 : 0;
+		p[0] = data[z*3+0];
+		p[1] = data[z*3+1];
+		p[2] = data[z*3+2];
+	}
+}
+
+// Smallest float >= d and largest float <= d,
+// so that comparisons with float values are exact.
+float float_ge(double d)
+{
+	float f = static_cast<float>(d);
+	if (static_cast<double>(f) < d) f = std::nextafter(f, std::numeric_limits<float>::infinity());
+	return f;
+}
+
+float float_le(double d)
+{
+	float f = static_cast<float>(d);
+	if (static_cast<double>(f) > d) f = std::nextafter(f, -std::numeric_limits<float>::infinity());
+	return f;
+}
+
+LUTTable * build_table(
+	bool integer, int t_min, int t_max,
+	double center, double width,
+	short lut, bool alt_mode, short lut_function)
+{
+	const unsigned char * data = NULL;
+	int size = 0;
+	if (!get_lut_data(lut, &data, &size)) return NULL;
+	const double wmin = center - width*0.5;
+	const double wmax = center + width*0.5;
+	LUTTable * t = new LUTTable();
+	t->center = center;
+	t->width = width;
+	t->lut = lut;
+	t->alt_mode = alt_mode;
+	t->lut_function = lut_function;
+	t->type_integer = integer;
+	t->type_min = t_min;
+	t->type_max = t_max;
+	t->t0 = t_min;
+	t->t1 = t_max;
+	bool integer_table = false;
+	if (integer)
+	{
+		// Values outside of the window map to two constant
+		// colors, so the window range is sufficient.
+		double a = std::floor(wmin) - 1.0;
+		double b = std::ceil(wmax) + 1.0;
+		if (a < t_min) a = t_min;
+		if (b > t_max) b = t_max;
+		if (a > b) b = a;
+		if (b - a < float_table_size)
+		{
+			t->t0 = static_cast<int>(a);
+			t->t1 = static_cast<int>(b);
+			integer_table = true;
+		}
+	}
+	t->integer = integer_table;
+	t->wmin = float_ge(wmin);
+	t->wmax = float_le(wmax);
+	if (integer_table)
+	{
+		t->n = t->t1 - t->t0 + 1;
+		t->rgb.resize(3*(t->n + 2));
+		for (int i = 0; i < t->n; ++i)
+		{
+			LUTUtils::map_value(
+				static_cast<float>(t->t0 + i),
+				&(t->rgb[3*i]),
+				center, width, lut, alt_mode, lut_function);
+		}
+	}
+	else
+	{
+		const double div_ = (width > 0.0) ? width : 0.00001;
+		const double span = (wmax > wmin) ? (wmax - wmin) : 0.0;
+		t->n = float_table_size;
+		t->scale = static_cast<float>(t->n / div_);
+		t->rgb.resize(3*(t->n + 2));
+		for (int i = 0; i < t->n; ++i)
+		{
+			double v = wmin + (i + 0.5) * (span / t->n);
+			if (v < t->wmin) v = t->wmin;
+			if (v > t->wmax) v = t->wmax;
+			LUTUtils::map_value(
+				static_cast<float>(v),
+				&(t->rgb[3*i]),
+				center, width, lut, alt_mode, lut_function);
+		}
+	}
+	out_of_window(false, &(t->rgb[3*t->n]),     data, size, alt_mode);
+	out_of_window(true,  &(t->rgb[3*(t->n+1)]), data, size, alt_mode);
+	return t;
+}
+
+inline void put_rgb(unsigned char * p, const unsigned char * rgb, int k)
+{
+	const unsigned char * c = rgb + 3*k;
+	p[0] = c[0];
+	p[1] = c[1];
+	p[2] = c[2];
+}
+
+template<typename T> void apply_integer_scalar(
+	const T * in, unsigned char * out, size_t count, const LUTTable * t)
+{
+	const long long t0 = t->t0;
+	const long long t1 = t->t1;
+	const int below = t->n;
+	const int above = t->n + 1;
+	const unsigned char * rgb = &(t->rgb[0]);
+	for (size_t i = 0; i < count; ++i)
+	{
+		const long long v = static_cast<long long>(in[i]);
+		const int k =
+			(v < t0) ? below : ((v > t1) ? above : static_cast<int>(v - t0));
+		put_rgb(out + 3*i, rgb, k);
+	}
+}
+
+template<typename T> void apply_float_scalar(
+	const T * in, unsigned char * out, size_t count, const LUTTable * t)
+{
+	const float wmin = t->wmin;
+	const float wmax = t->wmax;
+	const float scale = t->scale;
+	const float max_bin = static_cast<float>(t->n - 1);
+	const int below = t->n;
+	const int above = t->n + 1;
+	const unsigned char * rgb = &(t->rgb[0]);
+	for (size_t i = 0; i < count; ++i)
+	{
+		const float v = static_cast<float>(in[i]);
+		int k;
+		if (v >= wmin && v <= wmax)
+		{
+			float x = (v - wmin) * scale;
+			if (x > max_bin) x = max_bin;
+			if (x < 0.0f) x = 0.0f;
+			k = static_cast<int>(x);
+		}
+		else
+		{
+			k = (v > wmax) ? above : below;
+		}
+		put_rgb(out + 3*i, rgb, k);
+	}
+}
+
+#ifdef LUTUTILS_USE_SSE2
+// Color indices of 4 integer values, s. LUTTable.
+inline void index_epi32(
+	__m128i v, __m128i t0, __m128i t1,
+	__m128i below, __m128i above, int * idx)
+{
+	const __m128i lo = _mm_cmplt_epi32(v, t0);
+	const __m128i hi = _mm_cmpgt_epi32(v, t1);
+	__m128i k = _mm_sub_epi32(v, t0);
+	k = _mm_or_si128(_mm_andnot_si128(lo, k), _mm_and_si128(lo, below));
+	k = _mm_or_si128(_mm_andnot_si128(hi, k), _mm_and_si128(hi, above));
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(idx), k);
+}
+
+// Color indices of 4 float values, NaN is 'below'.
+inline void index_ps(
+	__m128 v, __m128 wmin, __m128 wmax, __m128 scale, __m128 max_bin,
+	__m128i below, __m128i above, int * idx)
+{
+	const __m128 in =
+		_mm_and_ps(_mm_cmpge_ps(v, wmin), _mm_cmple_ps(v, wmax));
+	const __m128i in_i = _mm_castps_si128(in);
+	const __m128i hi = _mm_castps_si128(_mm_cmpgt_ps(v, wmax));
+	__m128 x = _mm_mul_ps(_mm_sub_ps(v, wmin), scale);
+	x = _mm_min_ps(_mm_max_ps(x, _mm_setzero_ps()), max_bin);
+	__m128i k = _mm_cvttps_epi32(x);
+	const __m128i out =
+		_mm_or_si128(_mm_and_si128(hi, above), _mm_andnot_si128(hi, below));
+	k = _mm_or_si128(_mm_and_si128(in_i, k), _mm_andnot_si128(in_i, out));
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(idx), k);
+}
+
+inline void put_rgb16(unsigned char * p, const unsigned char * rgb, const int * idx)
+{
+	for (int x = 0; x < 16; ++x) put_rgb(p + 3*x, rgb, idx[x]);
+}
+
+inline void put_rgb8(unsigned char * p, const unsigned char * rgb, const int * idx)
+{
+	for (int x = 0; x < 8; ++x) put_rgb(p + 3*x, rgb, idx[x]);
+}
+
+inline void put_rgb4(unsigned char * p, const unsigned char * rgb, const int * idx)
+{
+	for (int x = 0; x < 4; ++x) put_rgb(p + 3*x, rgb, idx[x]);
+}
+
+void apply_float_sse2(
+	const float * in, unsigned char * out, size_t count, const LUTTable * t)
+{
+	const __m128 wmin = _mm_set1_ps(t->wmin);
+	const __m128 wmax = _mm_set1_ps(t->wmax);
+	const __m128 scale = _mm_set1_ps(t->scale);
+	const __m128 max_bin = _mm_set1_ps(static_cast<float>(t->n - 1));
+	const __m128i below = _mm_set1_epi32(t->n);
+	const __m128i above = _mm_set1_epi32(t->n + 1);
+	const unsigned char * rgb = &(t->rgb[0]);
+	int idx[4];
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		index_ps(_mm_loadu_ps(in + i), wmin, wmax, scale, max_bin, below, above, idx);
+		put_rgb4(out + 3*i, rgb, idx);
+	}
+	apply_float_scalar<float>(in + i, out + 3*i, count - i, t);
+}
+#endif
+
+}
+
+LUTUtils::LUTUtils()
+{
+}
+
+LUTUtils::~LUTUtils()
+{
+}
+
+bool LUTUtils::is_valid_lut(short lut)
+{
+	return (lut >= 0 && lut <= 7);
+}
+
+void LUTUtils::map_value(
+	float v, unsigned char * p,
+	double window_center, double window_width,
+	short lut, bool alt_mode, short lut_function)
+{
+	const unsigned char * data = NULL;
+	int size = 0;
+	if (!get_lut_data(lut, &data, &size)) return;
+	const double wmin = window_center - window_width*0.5;
+	const double wmax = window_center + window_width*0.5;
+	const double div_ = (window_width > 0.0) ? window_width : 0.00001;
+	if ((v >= wmin) && (v <= wmax))
+	{
+		double r;
+		if (lut_function == 2)
+		{
+			const double x = -6.0 * ((v-window_center) / div_);
+			r = 1.0 / (1.0+exp(x));
+		}
+		else
+		{
+			r = (v-wmin) / div_;
+		}
+		if (!data)
+		{
+			const unsigned char c = static_cast<unsigned char>(UCHAR_MAX*r);
+			p[0] = c;
+			p[1] = c;
+			p[2] = c;
+		}
+		else
+		{
+			int z = static_cast<int>(r*size);
+			if (z < 0) z = 0;
+			if (z > (size-1)) z = size-1;
+			p[0] = data[z*3+0];
+			p[1] = data[z*3+1];
+			p[2] = data[z*3+2];
+		}
+	}
+	else if (v < wmin)
+	{
+		out_of_window(false, p, data, size, alt_mode);
+	}
+	else if (v > wmax)
+	{
+		out_of_window(true, p, data, size, alt_mode);
+	}
+}
+
+QSharedPointer<const LUTTable> LUTUtils::get_table(
+	bool integer, int t_min, int t_max,
+	double center, double width,
+	short lut, bool alt_mode, short lut_function)
+{
+	QMutexLocker locker(&tables_mutex);
+	for (size_t x = 0; x < tables.size(); ++x)
+	{
+		const LUTTable * t = tables.at(x).data();
+		if (t->center == center && t->width == width &&
+			t->lut == lut && t->alt_mode == alt_mode &&
+			t->lut_function == lut_function &&
+			t->type_integer == integer &&
+			t->type_min == t_min && t->type_max == t_max)
+		{
+			QSharedPointer<const LUTTable> tmp0 = tables.at(x);
+			if (x > 0)
+			{
+				tables.erase(tables.begin() + x);
+				tables.insert(tables.begin(), tmp0);
+			}
+			return tmp0;
+		}
+	}
+	LUTTable * t = build_table(
+		integer, t_min, t_max,
+		center, width, lut, alt_mode, lut_function);
+	if (!t) return QSharedPointer<const LUTTable>();
+	QSharedPointer<const LUTTable> tmp1(t);
+	tables.insert(tables.begin(), tmp1);
+	if (tables.size() > static_cast<size_t>(max_cached_tables))
+		tables.pop_back();
+	return tmp1;
+}
+
+void LUTUtils::apply(
+	const signed short * in, unsigned char * out, size_t count, const LUTTable * t)
+{
+	if (!t->integer)
+	{
+		apply_float_scalar<signed short>(in, out, count, t);
+		return;
+	}
+#ifdef LUTUTILS_USE_SSE2
+	const __m128i t0 = _mm_set1_epi32(t->t0);
+	const __m128i t1 = _mm_set1_epi32(t->t1);
+	const __m128i below = _mm_set1_epi32(t->n);
+	const __m128i above = _mm_set1_epi32(t->n + 1);
+	const unsigned char * rgb = &(t->rgb[0]);
+	int idx[8];
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+		index_epi32(_mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16), t0, t1, below, above, idx);
+		index_epi32(_mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16), t0, t1, below, above, idx + 4);
+		put_rgb8(out + 3*i, rgb, idx);
+	}
+	apply_integer_scalar<signed short>(in + i, out + 3*i, count - i, t);
+#else
+	apply_integer_scalar<signed short>(in, out, count, t);
+#endif
+}
+
+void LUTUtils::apply(
+	const unsigned short * in, unsigned char * out, size_t count, const LUTTable * t)
+{
+	if (!t->integer)
+	{
+		apply_float_scalar<unsigned short>(in, out, count, t);
+		return;
+	}
+#ifdef LUTUTILS_USE_SSE2
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i t0 = _mm_set1_epi32(t->t0);
+	const __m128i t1 = _mm_set1_epi32(t->t1);
+	const __m128i below = _mm_set1_epi32(t->n);
+	const __m128i above = _mm_set1_epi32(t->n + 1);
+	const unsigned char * rgb = &(t->rgb[0]);
+	int idx[8];
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+		index_epi32(_mm_unpacklo_epi16(x, zero), t0, t1, below, above, idx);
+		index_epi32(_mm_unpackhi_epi16(x, zero), t0, t1, below, above, idx + 4);
+		put_rgb8(out + 3*i, rgb, idx);
+	}
+	apply_integer_scalar<unsigned short>(in + i, out + 3*i, count - i, t);
+#else
+	apply_integer_scalar<unsigned short>(in, out, count, t);
+#endif
+}
+
+void LUTUtils::apply(
+	const unsigned char * in, unsigned char * out, size_t count, const LUTTable * t)
+{
+	if (!t->integer)
+	{
+		apply_float_scalar<unsigned char>(in, out, count, t);
+		return;
+	}
+#ifdef LUTUTILS_USE_SSE2
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i t0 = _mm_set1_epi32(t->t0);
+	const __m128i t1 = _mm_set1_epi32(t->t1);
+	const __m128i below = _mm_set1_epi32(t->n);
+	const __m128i above = _mm_set1_epi32(t->n + 1);
+	const unsigned char * rgb = &(t->rgb[0]);
+	int idx[16];
+	size_t i = 0;
+	for (; i + 16 <= count; i += 16)
+	{
+		const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+		const __m128i lo = _mm_unpacklo_epi8(x, zero);
+		const __m128i hi = _mm_unpackhi_epi8(x, zero);
+		index_epi32(_mm_unpacklo_epi16(lo, zero), t0, t1, below, above, idx);
+		index_epi32(_mm_unpackhi_epi16(lo, zero), t0, t1, below, above, idx + 4);
+		index_epi32(_mm_unpacklo_epi16(hi, zero), t0, t1, below, above, idx + 8);
+		index_epi32(_mm_unpackhi_epi16(hi, zero), t0, t1, below, above, idx + 12);
+		put_rgb16(out + 3*i, rgb, idx);
+	}
+	apply_integer_scalar<unsigned char>(in + i, out + 3*i, count - i, t);
+#else
+	apply_integer_scalar<unsigned char>(in, out, count, t);
+#endif
+}
+
+void LUTUtils::apply(
+	const signed int * in, unsigned char * out, size_t count, const LUTTable * t)
+{
+#ifdef LUTUTILS_USE_SSE2
+	int idx[4];
+	size_t i = 0;
+	const unsigned char * rgb = &(t->rgb[0]);
+	const __m128i below = _mm_set1_epi32(t->n);
+	const __m128i above = _mm_set1_epi32(t->n + 1);
+	if (t->integer)
+	{
+		const __m128i t0 = _mm_set1_epi32(t->t0);
+		const __m128i t1 = _mm_set1_epi32(t->t1);
+		for (; i + 4 <= count; i += 4)
+		{
+			const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+			index_epi32(x, t0, t1, below, above, idx);
+			put_rgb4(out + 3*i, rgb, idx);
+		}
+		apply_integer_scalar<signed int>(in + i, out + 3*i, count - i, t);
+	}
+	else
+	{
+		const __m128 wmin = _mm_set1_ps(t->wmin);
+		const __m128 wmax = _mm_set1_ps(t->wmax);
+		const __m128 scale = _mm_set1_ps(t->scale);
+		const __m128 max_bin = _mm_set1_ps(static_cast<float>(t->n - 1));
+		for (; i + 4 <= count; i += 4)
+		{
+			const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+			index_ps(_mm_cvtepi32_ps(x), wmin, wmax, scale, max_bin, below, above, idx);
+			put_rgb4(out + 3*i, rgb, idx);
+		}
+		apply_float_scalar<signed int>(in + i, out + 3*i, count - i, t);
+	}
+#else
+	if (t->integer) apply_integer_scalar<signed int>(in, out, count, t);
+	else            apply_float_scalar<signed int>(in, out, count, t);
+#endif
+}
+
+void LUTUtils::apply(
+	const float * in, unsigned char * out, size_t count, const LUTTable * t)
+{
+#ifdef LUTUTILS_USE_SSE2
+	apply_float_sse2(in, out, count, t);
+#else
+	apply_float_scalar<float>(in, out, count, t);
+#endif
+}
+
+void LUTUtils::apply(
+	const double * in, unsigned char * out, size_t count, const LUTTable * t)
+{
+#ifdef LUTUTILS_USE_SSE2
+	const __m128 wmin = _mm_set1_ps(t->wmin);
+	const __m128 wmax = _mm_set1_ps(t->wmax);
+	const __m128 scale = _mm_set1_ps(t->scale);
+	const __m128 max_bin = _mm_set1_ps(static_cast<float>(t->n - 1));
+	const __m128i below = _mm_set1_epi32(t->n);
+	const __m128i above = _mm_set1_epi32(t->n + 1);
+	const unsigned char * rgb = &(t->rgb[0]);
+	int idx[4];
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		const __m128 lo = _mm_cvtpd_ps(_mm_loadu_pd(in + i));
+		const __m128 hi = _mm_cvtpd_ps(_mm_loadu_pd(in + i + 2));
+		index_ps(_mm_movelh_ps(lo, hi), wmin, wmax, scale, max_bin, below, above, idx);
+		put_rgb4(out + 3*i, rgb, idx);
+	}
+	apply_float_scalar<double>(in + i, out + 3*i, count - i, t);
+#else
+	apply_float_scalar<double>(in, out, count, t);
+#endif
+}
@@ -0,0 +1,66 @@
+#ifndef LUTUTILS__H_
+#define LUTUTILS__H_
+
+#include <QSharedPointer>
+#include <vector>
+#include <cstddef>
+
+// Window/level + palette as a table of RGB triplets.
+// Integer tables have one entry per value in [t0, t0+n-1],
+// float tables n bins over the window. Entry n is the color
+// below the window, n+1 above the window.
+class LUTTable
+{
+public:
+	LUTTable()
+		:
+		integer(true),
+		t0(0), t1(0), n(0),
+		wmin(0.0f), wmax(0.0f), scale(0.0f),
+		center(0.0), width(0.0),
+		lut(0), alt_mode(false), lut_function(0),
+		type_integer(true), type_min(0), type_max(0)
+	{
+	}
+	bool integer;
+	int t0;
+	int t1;
+	int n;
+	float wmin;
+	float wmax;
+	float scale;
+	double center;
+	double width;
+	short lut;
+	bool  alt_mode;
+	short lut_function;
+	bool  type_integer;
+	int   type_min;
+	int   type_max;
+	std::vector<unsigned char> rgb;
+};
+
+class LUTUtils
+{
+public:
+	LUTUtils();
+	~LUTUtils();
+	static bool is_valid_lut(short);
+	// Reference mapping of one value, 3 bytes to 'p'.
+	static void map_value(
+		float, unsigned char*,
+		double, double, short, bool, short);
+	// 't_min', 't_max' - value range of integer pixel type,
+	// integer=false for float types. Tables are cached.
+	static QSharedPointer<const LUTTable> get_table(
+		bool, int, int,
+		double, double, short, bool, short);
+	static void apply(const signed short*,   unsigned char*, size_t, const LUTTable*);
+	static void apply(const unsigned short*, unsigned char*, size_t, const LUTTable*);
+	static void apply(const unsigned char*,  unsigned char*, size_t, const LUTTable*);
+	static void apply(const signed int*,     unsigned char*, size_t, const LUTTable*);
+	static void apply(const float*,          unsigned char*, size_t, const LUTTable*);
+	static void apply(const double*,         unsigned char*, size_t, const LUTTable*);
+};
+
+#endif // LUTUTILS__H_
@@ -33,6 +33,7 @@ MainWindow::MainWindow(
 	adjust_scale_icons = 1.2f;
 	hide_gl3_frame_later = false;
 	saved_ok3d = false;
+	cpuvolumewidget = NULL;
 	int dock_area = 2;
 	QString saved_style;
 	{
@@ -323,6 +324,10 @@ MainWindow::MainWindow(
 	else
 	{
 		glwidget = NULL;
+		cpuvolumewidget = new CPUVolumeWidget();
+		QVBoxLayout * vl2 = new QVBoxLayout(gl_frame);
+		vl2->setContentsMargins(0,0,0,0);
+		vl2->addWidget(cpuvolumewidget);
 	}
 	//
 	aliza = new Aliza();
@@ -352,6 +357,7 @@ MainWindow::MainWindow(
 	aliza->set_anim2Dwidget(anim2Dwidget);
 	aliza->set_toolbox2D(toolbox2D);
 	aliza->set_glwidget(glwidget);
+	aliza->set_cpuvolumewidget(cpuvolumewidget);
 	aliza->set_graphicswidget_m(graphicswidget_m);
 	aliza->set_graphicswidget_y(graphicswidget_y);
 	aliza->set_graphicswidget_x(graphicswidget_x);
@@ -414,7 +420,15 @@ MainWindow::MainWindow(
 	else
 	{
 		saved_ok3d = false;
-		gl_frame->hide();
+		if (cpuvolumewidget)
+		{
+			gl_frame->show();
+			view3d_label->setText(QString("Intensity projection, CPU"));
+		}
+		else
+		{
+			gl_frame->hide();
+		}
 		slicesAct->setChecked(false);
 		raycastAct->setChecked(false);
 		trans3DAct->setEnabled(false);
@@ -1036,7 +1050,8 @@ void MainWindow::toggle_showgl(bool t)
 		else
 		{
 			toolbar3D_frame->hide();
-			view3d_frame->hide();
+			if (cpuvolumewidget) view3d_frame->show();
+			else view3d_frame->hide();
 		}
 	}
 	else
@@ -1502,6 +1517,11 @@ void MainWindow::set_ui()
 			toolbar3D_frame->show();
 			view3d_frame->show();
 		}
+		else if (cpuvolumewidget)
+		{
+			show3DAct->setEnabled(true);
+			view3d_frame->show();
+		}
 		first_image_loaded = true;
 	}
 }
@@ -1925,6 +1945,16 @@ void MainWindow::check_3d_frame()
 {
 	if (hide_gl3_frame_later)
 	{
+		// OpenGL 3 failed at runtime, CPU raycaster instead
+		if (glwidget && !cpuvolumewidget)
+		{
+			glwidget->hide();
+			cpuvolumewidget = new CPUVolumeWidget();
+			if (gl_frame->layout())
+				gl_frame->layout()->addWidget(cpuvolumewidget);
+			aliza->set_cpuvolumewidget(cpuvolumewidget);
+			view3d_label->setText(QString("Intensity projection, CPU"));
+		}
 		show3DAct->blockSignals(true);
 		toggle_showgl(false);
 		show3DAct->setChecked(false);
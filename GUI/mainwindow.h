@@ -156,6 +156,7 @@ private:
 	//
 	Aliza             * aliza;
 	GLWidget          * glwidget;
+	CPUVolumeWidget   * cpuvolumewidget;
 	ToolBox           * toolbox;
 	ImagesBox         * imagesbox;
 	BrowserWidget2    * browser2;
@@ -1,28 +1,72 @@
 #ifndef ProcessImageThreadLUT_H___
 #define ProcessImageThreadLUT_H___
 
-#include <QThread>
+#include <QtGlobal>
+#include <QElapsedTimer>
 
 #include "itkImage.h"
 #include "itkImageRegionConstIterator.h"
 
 #include "luts.h"
+#include "lututils.h"
+#include "parallelutils.h"
+#include <climits>
 
-template<typename T> class ProcessImageThreadLUT_ : public QThread
+// Pixel types with a table kernel, s. LUTUtils.
+template<typename P> class LUTPixelTraits
 {
 public:
+	static bool supported() { return false; }
+	static bool integer() { return false; }
+	static int  min() { return 0; }
+	static int  max() { return 0; }
+	static void apply(const P*, unsigned char*, size_t, const LUTTable*) {}
+};
+
+#define ALIZA_LUT_PIXEL_TRAITS(P, I, MIN, MAX) \
+template<> class LUTPixelTraits<P> \
+{ \
+public: \
+	static bool supported() { return true; } \
+	static bool integer() { return I; } \
+	static int  min() { return MIN; } \
+	static int  max() { return MAX; } \
+	static void apply(const P * in, unsigned char * out, size_t n, const LUTTable * t) \
+	{ \
+		LUTUtils::apply(in, out, n, t); \
+	} \
+};
+
+ALIZA_LUT_PIXEL_TRAITS(signed short,   true,  SHRT_MIN, SHRT_MAX)
+ALIZA_LUT_PIXEL_TRAITS(unsigned short, true,  0,        USHRT_MAX)
+ALIZA_LUT_PIXEL_TRAITS(unsigned char,  true,  0,        UCHAR_MAX)
+ALIZA_LUT_PIXEL_TRAITS(signed int,     true,  INT_MIN,  INT_MAX)
+ALIZA_LUT_PIXEL_TRAITS(float,          false, 0,        0)
+ALIZA_LUT_PIXEL_TRAITS(double,         false, 0,        0)
+
+#undef ALIZA_LUT_PIXEL_TRAITS
+
+// Window/level + LUT pass, one part is a band of rows.
+// With a table and contiguous buffer the band is processed
+// by LUTUtils, otherwise with the image iterator.
+template<typename T> class ProcessImageThreadLUT_ : public ParallelTask
+{
+public:
+	typedef typename T::PixelType PixelType;
 	ProcessImageThreadLUT_(
 		const typename T::Pointer & image_, unsigned char * p_,
 		const int size_0_,   const int size_1_,
-		const int index_0_,  const int index_1_, const unsigned int j_,
+		const int rows_,
 		const double window_center_, const double window_width_,
-		const short lut_, const bool alt_mode_, const short lut_function_)
+		const short lut_, const bool alt_mode_, const short lut_function_,
+		const PixelType * buffer_ = NULL, const LUTTable * table_ = NULL)
 		:
 		image(image_),
 		p(p_),
-		size_0(size_0_),   size_1(size_1_),
-		index_0(index_0_), index_1(index_1_),
-		j(j_),
+		size_0(size_0_), size_1(size_1_),
+		rows(rows_),
+		buffer(buffer_),
+		table(table_),
 		window_center(window_center_), window_width(window_width_),
 		lut(lut_),
 		alt_mode(alt_mode_),
@@ -34,13 +78,33 @@ public:
 	{
 	}
 
-	void run() override
+	void process(int i) override
+	{
+		const int index_1 = i*rows;
+		if (index_1 >= size_1) return;
+		const int rows_ = (index_1 + rows > size_1) ? size_1 - index_1 : rows;
+		const unsigned int j = 3*size_0*index_1;
+		if (buffer && table)
+		{
+			const size_t offset = static_cast<size_t>(size_0)*index_1;
+			LUTPixelTraits<PixelType>::apply(
+				buffer + offset, p + j,
+				static_cast<size_t>(size_0)*rows_, table);
+		}
+		else
+		{
+			process_band(index_1, rows_, j);
+		}
+	}
+
+private:
+	void process_band(const int index_1, const int rows_, const unsigned int j)
 	{
 		typename T::SizeType size;
 		size[0] = size_0;
-		size[1] = size_1;
+		size[1] = rows_;
 		typename T::IndexType index;
-		index[0] = index_0;
+		index[0] = 0;
 		index[1] = index_1;
  		typename T::RegionType region;
 		region.SetSize(size);
@@ -256,14 +320,13 @@ public:
 		}
 	}
 
-private:
 	typename T::Pointer image;
 	unsigned char * p;
 	const int size_0;
 	const int size_1;
-	const int index_0;
-	const int index_1;
-	const unsigned int j;
+	const int rows;
+	const PixelType * buffer;
+	const LUTTable  * table;
 	const double window_center;
 	const double window_width;
 	const short lut;
@@ -271,4 +334,55 @@ private:
 	const short lut_function;
 };
 
+// Runs the LUT pass on the shared pool, 'p' must hold
+// 3*size_0*size_1 bytes. Returns elapsed nanoseconds.
+template<typename T> qint64 process_image_lut(
+	const typename T::Pointer & image, unsigned char * p,
+	const int size_0, const int size_1,
+	const double window_center, const double window_width,
+	const short lut, const bool alt_mode, const short lut_function)
+{
+	QElapsedTimer timer;
+	timer.start();
+	if (image.IsNull() || !p || size_0 < 1 || size_1 < 1) return 0;
+	// Several bands per thread, so that a slow band
+	// does not leave other threads idle.
+	const int num_threads = ParallelUtils::get_num_threads();
+	int rows = size_1 / (4 * num_threads);
+	if (rows < 16) rows = 16;
+	const int count = (size_1 + rows - 1) / rows;
+	typedef typename T::PixelType PixelType;
+	const PixelType * buffer = NULL;
+	QSharedPointer<const LUTTable> table;
+	if (LUTPixelTraits<PixelType>::supported())
+	{
+		const typename T::RegionType & r = image->GetBufferedRegion();
+		if (r.GetIndex()[0] == 0 && r.GetIndex()[1] == 0 &&
+			static_cast<int>(r.GetSize()[0]) == size_0 &&
+			static_cast<int>(r.GetSize()[1]) == size_1)
+		{
+			buffer = image->GetBufferPointer();
+		}
+		if (buffer)
+		{
+			table = LUTUtils::get_table(
+				LUTPixelTraits<PixelType>::integer(),
+				LUTPixelTraits<PixelType>::min(),
+				LUTPixelTraits<PixelType>::max(),
+				window_center, window_width,
+				lut, alt_mode, lut_function);
+			if (table.isNull()) return timer.nsecsElapsed();
+		}
+	}
+	ProcessImageThreadLUT_<T> t(
+		image, p,
+		size_0, size_1,
+		rows,
+		window_center, window_width,
+		lut, alt_mode, lut_function,
+		buffer, table.data());
+	ParallelUtils::run(&t, count);
+	return timer.nsecsElapsed();
+}
+
 #endif // ProcessImageThreadLUT_H___
@@ -0,0 +1,194 @@
+#include "regionviewer.h"
+#include "frameviewer.h"
+#include "mdcmImage.h"
+#include <QPainter>
+#include <QFileInfo>
+#include <cmath>
+
+RegionViewer::RegionViewer()
+	:
+	scale(0.0),
+	overview_level(0),
+	signed_values(false)
+{
+	setAttribute(Qt::WA_DeleteOnClose);
+	setAttribute(Qt::WA_OpaquePaintEvent);
+	setMinimumSize(64, 64);
+	setFocusPolicy(Qt::StrongFocus);
+	resize(1024, 768);
+}
+
+RegionViewer::~RegionViewer()
+{
+	cache.close();
+}
+
+bool RegionViewer::open(const QString & f)
+{
+	// 256 MB of decoded tiles
+	if (!cache.open(f, 268435456ULL, this)) return false;
+	// the highest level with max. 1024 pixels per side
+	const unsigned int dim = qMax(cache.get_dimx(), cache.get_dimy());
+	int level = 0;
+	while (level < cache.get_max_level() && (dim >> level) > 1024) ++level;
+	// too few levels, the image is loaded
+	if ((dim >> level) > 4096)
+	{
+		cache.close();
+		return false;
+	}
+	int w = 0, h = 0;
+	const QByteArray b = cache.get_image_at(&level, &w, &h);
+	if (b.isEmpty())
+	{
+		cache.close();
+		return false;
+	}
+	const mdcm::Image * image = cache.get_image();
+	if (!cache.is_rgb() && !cache.is_ybr())
+	{
+		signed_values =
+			(image->GetPixelFormat().GetPixelRepresentation() == 1);
+		FrameViewer::make_lut(
+			image, cache.get_dataset(), b, signed_values, lut);
+	}
+	overview = FrameViewer::render(
+		b, w, h, cache.is_rgb(), cache.is_ybr(), false, lut, signed_values);
+	if (overview.isNull())
+	{
+		cache.close();
+		return false;
+	}
+	overview_level = level;
+	const QFileInfo fi(f);
+	setWindowTitle(
+		fi.fileName() + QString(" (") +
+		QString::number(cache.get_dimx()) + QString("x") +
+		QString::number(cache.get_dimy()) +
+		QString(", decoded on demand)"));
+	return true;
+}
+
+void RegionViewer::paintEvent(QPaintEvent*)
+{
+	QPainter painter(this);
+	painter.fillRect(rect(), Qt::black);
+	if (overview.isNull()) return;
+	if (!(scale > 0.0)) fit();
+	const double dimx = cache.get_dimx();
+	const double dimy = cache.get_dimy();
+	const double ox = 0.5 * width() - center.x() * scale;
+	const double oy = 0.5 * height() - center.y() * scale;
+	painter.setRenderHint(QPainter::SmoothPixmapTransform, true);
+	painter.drawImage(
+		QRectF(ox, oy, dimx * scale, dimy * scale), overview);
+	// a level pixel is not smaller than a screen pixel
+	int level = 0;
+	while (level < overview_level && (2 << level) * scale <= 1.0)
+		++level;
+	cache.clear_wanted();
+	if (level >= overview_level) return;
+	const double span = (double)(RegionCache::get_tile_size() << level);
+	const int tx0 = qMax(0, (int)floor((0.0 - ox) / scale / span));
+	const int ty0 = qMax(0, (int)floor((0.0 - oy) / scale / span));
+	const int tx1 = qMin(
+		(int)ceil(dimx / span) - 1,
+		(int)floor((width() - ox) / scale / span));
+	const int ty1 = qMin(
+		(int)ceil(dimy / span) - 1,
+		(int)floor((height() - oy) / scale / span));
+	for (int ty = ty0; ty <= ty1; ++ty)
+	{
+		for (int tx = tx0; tx <= tx1; ++tx)
+		{
+			QByteArray b;
+			int w = 0, h = 0;
+			if (!cache.get_tile(level, tx, ty, b, &w, &h)) continue;
+			const QImage i = FrameViewer::render(
+				b, w, h,
+				cache.is_rgb(), cache.is_ybr(), false,
+				lut, signed_values);
+			if (i.isNull()) continue;
+			const double f = (double)(1 << level) * scale;
+			painter.drawImage(
+				QRectF(ox + tx * span * scale, oy + ty * span * scale, w * f, h * f),
+				i);
+		}
+	}
+}
+
+void RegionViewer::mousePressEvent(QMouseEvent * e)
+{
+	last_pos = e->pos();
+}
+
+void RegionViewer::mouseMoveEvent(QMouseEvent * e)
+{
+	if (!(e->buttons() & Qt::LeftButton) || !(scale > 0.0)) return;
+	const QPoint d = e->pos() - last_pos;
+	last_pos = e->pos();
+	center -= QPointF(d.x() / scale, d.y() / scale);
+	update();
+}
+
+void RegionViewer::mouseDoubleClickEvent(QMouseEvent*)
+{
+	fit();
+	update();
+}
+
+void RegionViewer::wheelEvent(QWheelEvent * e)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
+	const int d = e->angleDelta().y();
+#else
+	const int d = e->delta();
+#endif
+#if QT_VERSION >= QT_VERSION_CHECK(5,15,0)
+	const QPointF p = e->position();
+#else
+	const QPointF p = e->pos();
+#endif
+	if (d == 0 || !(scale > 0.0)) return;
+	// the image point under the cursor stays
+	const QPointF c(0.5 * width(), 0.5 * height());
+	const QPointF ip = center + (p - c) / scale;
+	const double fit_scale = qMin(
+		(double)width() / cache.get_dimx(),
+		(double)height() / cache.get_dimy());
+	scale = qBound(
+		0.5 * fit_scale,
+		scale * ((d > 0) ? 1.25 : 0.8),
+		8.0);
+	center = ip - (p - c) / scale;
+	update();
+}
+
+void RegionViewer::keyPressEvent(QKeyEvent * e)
+{
+	if (e->key() == Qt::Key_Home)
+	{
+		fit();
+		update();
+	}
+	else
+	{
+		QWidget::keyPressEvent(e);
+	}
+}
+
+void RegionViewer::closeEvent(QCloseEvent * e)
+{
+	cache.close();
+	overview = QImage();
+	e->accept();
+}
+
+void RegionViewer::fit()
+{
+	if (cache.get_dimx() < 1 || cache.get_dimy() < 1) return;
+	scale = qMin(
+		(double)width() / cache.get_dimx(),
+		(double)height() / cache.get_dimy());
+	center = QPointF(0.5 * cache.get_dimx(), 0.5 * cache.get_dimy());
+}
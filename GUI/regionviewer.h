@@ -0,0 +1,50 @@
+#ifndef REGIONVIEWER_H__
+#define REGIONVIEWER_H__
+
+#include "regioncache.h"
+#include <QWidget>
+#include <QImage>
+#include <QVector>
+#include <QPoint>
+#include <QPointF>
+#include <QPaintEvent>
+#include <QMouseEvent>
+#include <QWheelEvent>
+#include <QKeyEvent>
+#include <QCloseEvent>
+
+// Window for single-frame JPEG 2000 images too large to be loaded
+// as an image, s. DicomUtils::read_dicom(). Only the visible area
+// is decoded, at the resolution level closest to the zoom, by
+// RegionCache. A small image of the highest level is shown while
+// tiles are decoded. Wheel - zoom, drag - pan, Home or double
+// click - fit.
+class RegionViewer : public QWidget
+{
+public:
+	RegionViewer();
+	~RegionViewer();
+	bool open(const QString&);
+
+protected:
+	void paintEvent(QPaintEvent*) override;
+	void mousePressEvent(QMouseEvent*) override;
+	void mouseMoveEvent(QMouseEvent*) override;
+	void mouseDoubleClickEvent(QMouseEvent*) override;
+	void wheelEvent(QWheelEvent*) override;
+	void keyPressEvent(QKeyEvent*) override;
+	void closeEvent(QCloseEvent*) override;
+
+private:
+	void fit();
+	RegionCache cache;
+	QImage overview;
+	QVector<unsigned char> lut;
+	QPointF center;
+	QPoint last_pos;
+	double scale;
+	int overview_level;
+	bool signed_values;
+};
+
+#endif // REGIONVIEWER_H__
@@ -0,0 +1,202 @@
+#include "seriesdecoder.h"
+#include <QRunnable>
+#include <QThreadPool>
+#include <QMutexLocker>
+#include "structures.h"
+#include "dicomutils.h"
+#include "parallelutils.h"
+#include "mdcmParseException.h"
+#include <iostream>
+#include <exception>
+
+class SeriesDecoder::Runnable : public QRunnable
+{
+public:
+	// 'b_' - approx. size, 0 if the series is not checked yet
+	Runnable(SeriesDecoder * d_, const QStringList & f_, unsigned long long b_)
+		: d(d_), filenames(f_), bytes(b_)
+	{
+		setAutoDelete(true);
+	}
+	void run() override
+	{
+		Result r;
+		unsigned long long b = bytes;
+		if (b == 0)
+		{
+			bool plain = false;
+			try
+			{
+				plain = DicomUtils::is_plain_series(filenames, &b);
+			}
+			catch(std::exception & ex)
+			{
+				std::cout << "Exception in SeriesDecoder\n"
+					<< ex.what() << std::endl;
+			}
+			if (!plain || d->too_large(b))
+			{
+				r.files = filenames;
+				d->finish(r);
+				return;
+			}
+		}
+		if (!d->reserve(filenames, b)) return;
+		r.bytes = b;
+		try
+		{
+			// no GL and no progress dialog on the pool,
+			// the image is not drawn yet
+			r.message = DicomUtils::read_dicom(
+				r.ivariants,
+				filenames,
+				d->max_3d_tex_size,
+				NULL,
+				NULL,
+				d->ok3d,
+				&d->settings,
+				NULL,
+				0,
+				d->ignore_dim_org);
+		}
+		catch(mdcm::ParseException & pe)
+		{
+			std::cout << "mdcm::ParseException in SeriesDecoder:\n"
+				<< pe.GetLastElement().GetTag() << std::endl;
+		}
+		catch(std::exception & ex)
+		{
+			std::cout << "Exception in SeriesDecoder\n"
+				<< ex.what() << std::endl;
+		}
+		d->finish(r);
+	}
+private:
+	SeriesDecoder * d;
+	const QStringList filenames;
+	const unsigned long long bytes;
+};
+
+SeriesDecoder::SeriesDecoder(
+	int max_3d_tex_size_,
+	bool ok3d_,
+	const SettingsValues & settings_,
+	bool ignore_dim_org_,
+	double total_ram_)
+	:
+	max_3d_tex_size(max_3d_tex_size_),
+	ok3d(ok3d_),
+	settings(settings_),
+	ignore_dim_org(ignore_dim_org_),
+	total_ram(total_ram_),
+	count(0),
+	running(0),
+	bytes(0)
+{
+}
+
+SeriesDecoder::~SeriesDecoder()
+{
+	QMutexLocker locker(&mutex);
+	while (running > 0) finished.wait(&mutex);
+	for (int x = 0; x < results.size(); ++x)
+	{
+		for (unsigned int j = 0; j < results.at(x).ivariants.size(); ++j)
+		{
+			delete results[x].ivariants[j];
+		}
+	}
+	results.clear();
+	waiting.clear();
+}
+
+void SeriesDecoder::start(const QStringList & l)
+{
+	{
+		QMutexLocker locker(&mutex);
+		++count;
+		++running;
+	}
+	// nested ParallelUtils::run() inside of decoding is safe,
+	// the calling thread takes parts too
+	ParallelUtils::get_pool()->start(new Runnable(this, l, 0));
+}
+
+int SeriesDecoder::get_count() const
+{
+	QMutexLocker locker(&mutex);
+	return count;
+}
+
+bool SeriesDecoder::take(
+	std::vector<ImageVariant*> & ivariants,
+	QString & message,
+	QStringList & files)
+{
+	QList<QPair<QStringList, unsigned long long> > restart;
+	{
+		QMutexLocker locker(&mutex);
+		if (results.empty()) return false;
+		const Result r = results.takeFirst();
+		for (unsigned int x = 0; x < r.ivariants.size(); ++x)
+		{
+			ivariants.push_back(r.ivariants.at(x));
+		}
+		message = r.message;
+		files = r.files;
+		--count;
+		bytes -= r.bytes;
+		// waiting series try again, memory is released
+		if (r.bytes > 0)
+		{
+			restart = waiting;
+			waiting.clear();
+			running += restart.size();
+		}
+	}
+	for (int x = 0; x < restart.size(); ++x)
+	{
+		ParallelUtils::get_pool()->start(
+			new Runnable(this, restart.at(x).first, restart.at(x).second));
+	}
+	return true;
+}
+
+void SeriesDecoder::wait(unsigned long ms)
+{
+	QMutexLocker locker(&mutex);
+	if (!results.empty() || running < 1) return;
+	finished.wait(&mutex, ms);
+}
+
+// Reserves the approx. size of a series, if it doesn't fit next
+// to others, the series waits for take() and false is returned.
+bool SeriesDecoder::reserve(const QStringList & l, unsigned long long b)
+{
+	QMutexLocker locker(&mutex);
+	if (bytes == 0 || total_ram <= 0.0 ||
+		(((bytes + b) / 1073741824.0) * 3) < total_ram)
+	{
+		bytes += b;
+		return true;
+	}
+	waiting.push_back(qMakePair(l, b));
+	--running;
+	finished.wakeAll();
+	return false;
+}
+
+// Too large to be decoded next to others, read_dicom()
+// on the GUI thread asks about the size.
+bool SeriesDecoder::too_large(unsigned long long b) const
+{
+	return (total_ram > 0.0 && ((b / 1073741824.0) * 3) >= total_ram);
+}
+
+void SeriesDecoder::finish(const Result & r)
+{
+	QMutexLocker locker(&mutex);
+	results.push_back(r);
+	--running;
+	finished.wakeAll();
+}
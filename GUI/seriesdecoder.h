@@ -0,0 +1,67 @@
+#ifndef SERIESDECODER__H_
+#define SERIESDECODER__H_
+
+#include <QtGlobal>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QStringList>
+#include <QList>
+#include <QPair>
+#include <vector>
+#include "settingswidget.h"
+
+class ImageVariant;
+
+// Checks and decodes plain image series (DicomUtils::is_plain_series())
+// on the shared pool, without GL context, progress dialog, message
+// boxes and event loop, with a copy of the settings. Textures, icons
+// and histograms are created on the GUI thread after the images are
+// taken. Other series are returned to be read on the GUI thread.
+class SeriesDecoder
+{
+public:
+	// max. 3D texture size, OpenGL is available, settings,
+	// skip dimensions organization, total RAM in GB (0 - unknown)
+	SeriesDecoder(int, bool, const SettingsValues&, bool, double);
+	// Waits for running series, images not taken are deleted.
+	~SeriesDecoder();
+	// A series is decoded if its approx. size fits into memory
+	// next to series decoded and not taken yet, else it waits.
+	void start(const QStringList&);
+	// Series started and not taken.
+	int get_count() const;
+	// Appends images of a finished series or sets the files of
+	// a series to be read on the GUI thread, false if none.
+	bool take(std::vector<ImageVariant*>&, QString&, QStringList&);
+	// Waits max. 'ms' for a finished series.
+	void wait(unsigned long);
+
+private:
+	class Runnable;
+	class Result
+	{
+	public:
+		Result() : bytes(0) {}
+		std::vector<ImageVariant*> ivariants;
+		QString message;
+		QStringList files;
+		unsigned long long bytes;
+	};
+	bool reserve(const QStringList&, unsigned long long);
+	bool too_large(unsigned long long) const;
+	void finish(const Result&);
+	mutable QMutex mutex;
+	QWaitCondition finished;
+	QList<Result> results;
+	QList<QPair<QStringList, unsigned long long> > waiting;
+	const int max_3d_tex_size;
+	const bool ok3d;
+	const SettingsValues settings;
+	const bool ignore_dim_org;
+	const double total_ram;
+	int count;
+	int running;
+	unsigned long long bytes;
+};
+
+#endif // SERIESDECODER__H_
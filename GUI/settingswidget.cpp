@@ -21,6 +21,30 @@
 #include <QFileInfo>
 #include "commonutils.h"
 #include "dicomutils.h"
+#include "parallelutils.h"
+
+SettingsValues::SettingsValues()
+	:
+	filtering(0),
+	resize(false),
+	size_x(0),
+	size_y(0),
+	rescale(true),
+	gl3d(false),
+	mosaic(true),
+	overlays(true),
+	level_for_PET(true),
+	clean_unused_bits(false),
+	scale_icons(1.0f),
+	sr_info(false),
+	sr_image_width(0),
+	sr_chapters(true),
+	sr_skip_images(false),
+	predictor_workaround(false),
+	cornell_workaround(false),
+	sort_frames(true)
+{
+}
 
 SettingsWidget::SettingsWidget(float si)
 {
@@ -42,6 +66,7 @@ SettingsWidget::SettingsWidget(float si)
 	styleComboBox->setCurrentIndex(saved_idx);
 	connect(reload_pushButton,SIGNAL(clicked()),this,SLOT(set_default()));
 	connect(pt_doubleSpinBox,SIGNAL(valueChanged(double)),this,SLOT(update_font_pt(double)));
+	connect(threads_spinBox,SIGNAL(valueChanged(int)),this,SLOT(update_max_threads(int)));
 }
 
 SettingsWidget::~SettingsWidget()
@@ -117,6 +142,7 @@ void SettingsWidget::set_default()
 	styleComboBox->setCurrentIndex(0);
 	gl3D_checkBox->setChecked(true);
 	si_doubleSpinBox->setValue(1.0);
+	threads_spinBox->setValue(0);
 	original_radioButton->setChecked(true);
 	resample_radioButton->setChecked(false);
 #if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
@@ -195,6 +221,11 @@ void SettingsWidget::update_font_pt(double x)
 	QApplication::processEvents();
 }
 
+void SettingsWidget::update_max_threads(int x)
+{
+	ParallelUtils::set_max_threads(x);
+}
+
 bool SettingsWidget::get_level_for_PET() const
 {
 	return !pet_no_level_checkBox->isChecked();
@@ -225,6 +256,7 @@ void SettingsWidget::readSettings()
 	const int tmp8  = settings.value(QString("dcm_overlays"),    1).toInt();
 	const int tmp9  = settings.value(QString("dcm_mosaic"),      1).toInt();
 	const int tmp10 = settings.value(QString("dcm_sort_mf"),     1).toInt();
+	const int tmp11 = settings.value(QString("max_threads"),     0).toInt();
 	settings.endGroup();
 	settings.beginGroup(QString("StyleDialog"));
 	saved_idx = settings.value(QString("saved_idx"), 0).toInt();
@@ -256,6 +288,7 @@ void SettingsWidget::readSettings()
 	overlays_checkBox->setChecked((tmp8 == 1));
 	mosaic_checkBox->setChecked((tmp9 == 1));
 	sortframes_checkBox->setChecked((tmp10 == 1));
+	threads_spinBox->setValue((tmp11 > 0) ? tmp11 : 0);
 }
 
 void SettingsWidget::writeSettings(QSettings & s)
@@ -273,6 +306,7 @@ void SettingsWidget::writeSettings(QSettings & s)
 	s.setValue(QString("dcm_overlays"),  QVariant((int)(overlays_checkBox->isChecked() ? 1 : 0)));
 	s.setValue(QString("dcm_mosaic"),    QVariant((int)(mosaic_checkBox->isChecked() ? 1 : 0)));
 	s.setValue(QString("dcm_sort_mf"),   QVariant((int)(sortframes_checkBox->isChecked() ? 1 : 0)));
+	s.setValue(QString("max_threads"),   QVariant(threads_spinBox->value()));
 	s.endGroup();
 	s.beginGroup(QString("StyleDialog"));
 	s.setValue(QString("saved_idx"), QVariant(styleComboBox->currentIndex()));
@@ -329,3 +363,27 @@ bool SettingsWidget::get_sort_frames() const
 {
 	return sortframes_checkBox->isChecked();
 }
+
+SettingsValues SettingsWidget::get_values() const
+{
+	SettingsValues v;
+	v.filtering            = get_filtering();
+	v.resize               = get_resize();
+	v.size_x               = get_size_x();
+	v.size_y               = get_size_y();
+	v.rescale              = get_rescale();
+	v.gl3d                 = get_3d();
+	v.mosaic               = get_mosaic();
+	v.overlays             = get_overlays();
+	v.level_for_PET        = get_level_for_PET();
+	v.clean_unused_bits    = get_clean_unused_bits();
+	v.scale_icons          = get_scale_icons();
+	v.sr_info              = get_sr_info();
+	v.sr_image_width       = get_sr_image_width();
+	v.sr_chapters          = get_sr_chapters();
+	v.sr_skip_images       = get_sr_skip_images();
+	v.predictor_workaround = get_predictor_workaround();
+	v.cornell_workaround   = get_cornell_workaround();
+	v.sort_frames          = get_sort_frames();
+	return v;
+}
@@ -5,6 +5,53 @@
 #include <QWidget>
 #include <QSettings>
 
+// Values of the settings used for reading images, taken
+// on the GUI thread, reading may run on the pool.
+class SettingsValues
+{
+public:
+	SettingsValues();
+	short  get_filtering() const            { return filtering; }
+	bool   get_resize() const               { return resize; }
+	int    get_size_x() const               { return size_x; }
+	int    get_size_y() const               { return size_y; }
+	bool   get_rescale() const              { return rescale; }
+	bool   get_3d() const                   { return gl3d; }
+	bool   get_mosaic() const               { return mosaic; }
+	bool   get_overlays() const             { return overlays; }
+	bool   get_level_for_PET() const        { return level_for_PET; }
+	bool   get_clean_unused_bits() const    { return clean_unused_bits; }
+	float  get_scale_icons() const          { return scale_icons; }
+	bool   get_sr_info() const              { return sr_info; }
+	int    get_sr_image_width() const       { return sr_image_width; }
+	bool   get_sr_chapters() const          { return sr_chapters; }
+	bool   get_sr_skip_images() const       { return sr_skip_images; }
+	bool   get_predictor_workaround() const { return predictor_workaround; }
+	bool   get_cornell_workaround() const   { return cornell_workaround; }
+	bool   get_sort_frames() const          { return sort_frames; }
+
+private:
+	friend class SettingsWidget;
+	short filtering;
+	bool  resize;
+	int   size_x;
+	int   size_y;
+	bool  rescale;
+	bool  gl3d;
+	bool  mosaic;
+	bool  overlays;
+	bool  level_for_PET;
+	bool  clean_unused_bits;
+	float scale_icons;
+	bool  sr_info;
+	int   sr_image_width;
+	bool  sr_chapters;
+	bool  sr_skip_images;
+	bool  predictor_workaround;
+	bool  cornell_workaround;
+	bool  sort_frames;
+};
+
 class SettingsWidget: public QWidget, public Ui::SettingsWidget
 {
 Q_OBJECT
@@ -36,6 +83,7 @@ public:
 	bool   get_predictor_workaround() const;
 	bool   get_cornell_workaround() const;
 	bool   get_sort_frames() const;
+	SettingsValues get_values() const;
 
 private:
 	int   saved_idx;
@@ -46,6 +94,7 @@ private slots:
 
 public slots:
 	void update_font_pt(double);
+	void update_max_threads(int);
 	void force_no_gl3();
 
 
@@ -0,0 +1,126 @@
+#ifndef SliceView_H___
+#define SliceView_H___
+
+#include "itkImage.h"
+#include <algorithm>
+#include <cstddef>
+#include <new>
+
+// 2D slice of a 3D image without ExtractImageFilter, geometry is
+// the same as with SetDirectionCollapseToIdentity(). Slices along
+// axis 2 share the volume's buffer, 'source' keeps the volume.
+// Slices along axes 0 and 1 are read with strides into 'buffer',
+// it is reused if it is an image of the same type and size not
+// referenced elsewhere. Returns false if the volume is not
+// buffered as a whole, the caller should extract the slice.
+template<typename Tin, typename Tout> bool get_slice_view(
+	const short axis,
+	const typename Tin::Pointer & image,
+	const int idx,
+	typename Tout::Pointer & out_image,
+	itk::DataObject::Pointer & source,
+	itk::DataObject::Pointer & buffer)
+{
+	typedef typename Tin::PixelType PixelType;
+	if (image.IsNull()) return false;
+	const typename Tin::RegionType region = image->GetLargestPossibleRegion();
+	if (image->GetBufferedRegion() != region) return false;
+	const PixelType * p = image->GetBufferPointer();
+	if (!p) return false;
+	int d0, d1;
+	switch (axis)
+	{
+	case 0: d0 = 1; d1 = 2; break;
+	case 1: d0 = 0; d1 = 2; break;
+	case 2: d0 = 0; d1 = 1; break;
+	default: return false;
+	}
+	const typename Tin::SizeType size = region.GetSize();
+	const typename Tin::IndexType index = region.GetIndex();
+	const long long k = static_cast<long long>(idx) - index[axis];
+	if (k < 0 || k >= static_cast<long long>(size[axis])) return false;
+	const size_t s0 = size[0];
+	const size_t s01 = s0*size[1];
+	//
+	typename Tout::IndexType out_index;
+	out_index[0] = index[d0];
+	out_index[1] = index[d1];
+	typename Tout::SizeType out_size;
+	out_size[0] = size[d0];
+	out_size[1] = size[d1];
+	typename Tout::RegionType out_region;
+	out_region.SetIndex(out_index);
+	out_region.SetSize(out_size);
+	typename Tout::SpacingType out_spacing;
+	out_spacing[0] = image->GetSpacing()[d0];
+	out_spacing[1] = image->GetSpacing()[d1];
+	typename Tout::PointType out_origin;
+	out_origin[0] = image->GetOrigin()[d0];
+	out_origin[1] = image->GetOrigin()[d1];
+	typename Tout::DirectionType out_direction;
+	out_direction.SetIdentity();
+	//
+	typename Tout::Pointer out;
+	if (axis == 2)
+	{
+		out = Tout::New();
+		out->SetRegions(out_region);
+		typename Tout::PixelContainer::Pointer c = Tout::PixelContainer::New();
+		c->SetImportPointer(
+			const_cast<PixelType*>(p) + k*s01,
+			out_size[0]*out_size[1],
+			false);
+		out->SetPixelContainer(c);
+		source = image.GetPointer();
+	}
+	else
+	{
+		Tout * tmp = dynamic_cast<Tout*>(buffer.GetPointer());
+		if (tmp &&
+			tmp->GetReferenceCount() == 1 &&
+			tmp->GetBufferPointer() &&
+			tmp->GetBufferedRegion().GetSize() == out_size)
+		{
+			out = tmp;
+			out->SetRegions(out_region);
+		}
+		else
+		{
+			buffer = NULL;
+			out = Tout::New();
+			out->SetRegions(out_region);
+			try { out->Allocate(); }
+			catch (const itk::ExceptionObject &) { return false; }
+			catch (const std::bad_alloc &) { return false; }
+			buffer = out.GetPointer();
+		}
+		PixelType * o = out->GetBufferPointer();
+		if (axis == 1)
+		{
+			for (size_t z = 0; z < size[2]; ++z)
+			{
+				const PixelType * r = p + z*s01 + k*s0;
+				std::copy(r, r + s0, o + z*s0);
+			}
+		}
+		else
+		{
+			const size_t s1 = size[1];
+			for (size_t z = 0; z < size[2]; ++z)
+			{
+				const PixelType * r = p + z*s01 + k;
+				PixelType * w = o + z*s1;
+				for (size_t y = 0; y < s1; ++y) w[y] = r[y*s0];
+			}
+		}
+		source = NULL;
+	}
+	out->SetSpacing(out_spacing);
+	out->SetOrigin(out_origin);
+	out->SetDirection(out_direction);
+	out->Modified();
+	out_image = out;
+	return true;
+}
+
+#endif // SliceView_H___
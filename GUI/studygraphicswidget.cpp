@@ -9,6 +9,7 @@
 #include "itkImageRegionIterator.h"
 #include "itkImageRegionConstIterator.h"
 #include "processimagethreadLUT.hxx"
+#include "sliceview.hxx"
 #include "graphicsutils.h"
 #include "commonutils.h"
 #include "updateqtcommand.h"
@@ -33,6 +34,18 @@ template<typename Tin, typename Tout> QString get_slice2_(
 {
 	if (image.IsNull())
 		return QString("get_slice2_<>() : image.IsNull()");
+	if (v2d)
+	{
+		if (get_slice_view<Tin, Tout>(
+				2, image, idx, out_image,
+				v2d->slice_source, v2d->slice_buffer))
+		{
+			v2d->idimx = out_image->GetLargestPossibleRegion().GetSize()[0];
+			v2d->idimy = out_image->GetLargestPossibleRegion().GetSize()[1];
+			return QString();
+		}
+		v2d->slice_source = NULL;
+	}
 	typedef itk::ExtractImageFilter<Tin, Tout> FilterType;
 	const typename Tin::RegionType inRegion =
 		image->GetLargestPossibleRegion();
@@ -839,106 +852,12 @@ template<typename T> void load_image2(
 	//
 	const bool global_flip_x = widget->graphicsview->global_flip_x;
 	const bool global_flip_y = widget->graphicsview->global_flip_y;
-	const int num_threads = QThread::idealThreadCount();
-	const int tmp99 = size[1]%num_threads;
-	if (!widget->threadsLUT_.empty())
-	{
-		std::cout << "load_image2<>() : widget->threadsLUT_.size()>0" << std::endl;
-	}
-	if (tmp99 == 0)
-	{
-		int j = 0;
-		for (int i = 0; i < num_threads; ++i)
-		{
-			const int size_0 = size[0];
-			const int size_1 = size[1]/num_threads;
-			const int index_0 = 0;
-			const int index_1 = i*size_1;
-			ProcessImageThreadLUT_<T> * t__ = new ProcessImageThreadLUT_<T>(
-						image,
-						p,
-						size_0,  size_1,
-						index_0, index_1, j,
-						window_center, window_width,
-						lut, false, lut_function);
-			j += 3*size_0*size_1;
-			widget->threadsLUT_.push_back(static_cast<QThread*>(t__));
-			t__->start();
-		}
-	}
-	else
-	{
-		int j = 0;
-		unsigned int block = 64;
-		if (static_cast<float>(size[1])/static_cast<float>(block)>16.0f) block=128;
-		const int tmp100 = size[1]%block;
-		const int incr = (int)floor(size[1]/(double)block);
-		if (size[1] > block)
-		{
-			for (int i = 0; i < incr; ++i)
-			{
-				const int size_0 = size[0];
-				const int index_0 = 0;
-				const int index_1 = i*block;
-				ProcessImageThreadLUT_<T> * t__ = new ProcessImageThreadLUT_<T>(
-							image,
-							p,
-							size_0,  block,
-							index_0, index_1, j,
-							window_center, window_width,
-							lut, false,lut_function);
-				j += 3*size_0*block;
-				widget->threadsLUT_.push_back(static_cast<QThread*>(t__));
-				t__->start();
-			}
-			ProcessImageThreadLUT_<T> * lt__ = new ProcessImageThreadLUT_<T>(
-						image,
-						p,
-						size[0],  tmp100,
-						0, incr*block, j,
-						window_center, window_width,
-						lut, false,lut_function);
-			widget->threadsLUT_.push_back(static_cast<QThread*>(lt__));
-			lt__->start();
-		}
-		else
-		{
-			ProcessImageThreadLUT_<T> * lt__ = new ProcessImageThreadLUT_<T>(
-						image,
-						p,
-						size[0],  size[1],
-						0, 0, 0,
-						window_center, window_width,
-						lut, false,lut_function);
-			widget->threadsLUT_.push_back(static_cast<QThread*>(lt__));
-			lt__->start();
-		}
-	}
-	//
-#if 0
-#ifdef _WIN32
-	Sleep(1);
-#else
-	usleep(1000);
-#endif
-#endif
-	//
-	const unsigned short threadsLUT_size = widget->threadsLUT_.size();
-	while (true)
-	{
-		unsigned short b__ = 0;
-		for (int i = 0; i < threadsLUT_size; ++i)
-		{
-			if (widget->threadsLUT_.at(i)->isFinished()) { ++b__; }
-		}
-		if (b__ == threadsLUT_size) break;
-	}
-	for (int i = 0; i < threadsLUT_size; ++i)
-	{
-		delete widget->threadsLUT_[i];
-		widget->threadsLUT_[i] = NULL;
-	}
-	widget->threadsLUT_.clear();
+	widget->lut_times.add(
+		process_image_lut<T>(
+			image, p,
+			size[0], size[1],
+			window_center, window_width,
+			lut, false, lut_function));
 	//
 	double coeff_size_0 = 1.0, coeff_size_1 = 1.0;
 	const QRectF rectf(0, 0, size[0], size[1]);
@@ -1126,16 +1045,6 @@ StudyGraphicsWidget::~StudyGraphicsWidget()
 				threads_[i] = NULL;
 			}
 		}
-		for (unsigned int i = 0; i < threadsLUT_.size(); ++i)
-		{
-			if (threadsLUT_.at(i))
-			{
-				if (threadsLUT_.at(i)->isRunning())
-					threadsLUT_[i]->exit();
-				delete threadsLUT_[i];
-				threadsLUT_[i] = NULL;
-			}
-		}
 		if (image_container.image2D)
 		{
 			delete image_container.image2D;
@@ -1603,6 +1512,8 @@ void StudyGraphicsWidget::clear_(bool lock)
 			image_container.image2D->pD_rgba->DisconnectPipeline();
 			image_container.image2D->pD_rgba =NULL;
 		}
+		image_container.image2D->slice_source = NULL;
+		image_container.image2D->slice_buffer = NULL;
 	}
 	image_container.image3D = NULL;
 	graphicsview->set_empty_distance();
@@ -3,6 +3,7 @@
 
 #include "structures.h"
 #include "studygraphicsview.h"
+#include "timecounter.h"
 #include <QWidget>
 #include <QLabel>
 #include <QToolButton>
@@ -70,7 +71,7 @@ public:
 	void  set_active();
 	void  update_measurement(double, double, double, double);
 	std::vector<ProcessImageThread_*> threads_;
-	std::vector<QThread*> threadsLUT_;
+	TimeCounter lut_times;
 	unsigned long long widget_id;
 
 private slots:
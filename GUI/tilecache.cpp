@@ -0,0 +1,61 @@
+#include "tilecache.h"
+
+namespace
+{
+
+const int tile_size = 256;
+const int default_max_size = 96*1024; // kB
+
+quint64 make_key(int level, int x, int y)
+{
+	return
+		(static_cast<quint64>(level & 0xff) << 56) |
+		(static_cast<quint64>(x & 0xfffffff) << 28) |
+		 static_cast<quint64>(y & 0xfffffff);
+}
+
+}
+
+TileCache::TileCache()
+{
+	cache.setMaxCost(default_max_size);
+}
+
+TileCache::~TileCache()
+{
+}
+
+int TileCache::get_tile_size()
+{
+	return tile_size;
+}
+
+void TileCache::set_max_size(int x)
+{
+	cache.setMaxCost(x > 0 ? x : 1);
+}
+
+void TileCache::set_signature(const QString & s)
+{
+	if (s == signature) return;
+	cache.clear();
+	signature = s;
+}
+
+const QImage * TileCache::get(int level, int x, int y) const
+{
+	return cache.object(make_key(level, x, y));
+}
+
+void TileCache::insert(int level, int x, int y, const QImage & i)
+{
+	if (i.isNull()) return;
+	const int cost = qMax(1, (i.bytesPerLine() * i.height()) / 1024);
+	cache.insert(make_key(level, x, y), new QImage(i), cost);
+}
+
+void TileCache::clear()
+{
+	cache.clear();
+	signature = QString();
+}
@@ -0,0 +1,32 @@
+#ifndef TILECACHE__H_
+#define TILECACHE__H_
+
+#include <QtGlobal>
+#include <QCache>
+#include <QImage>
+#include <QString>
+
+// Rendered (not decoded) tiles of a large 2D image. A tile at 'level' has
+// get_tile_size() pixels per side and covers
+// get_tile_size() << level image pixels. The least recently used
+// tiles are dropped above the memory limit. Tiles are valid for
+// one signature (image, slice, window/level, LUT), a new
+// signature clears the cache.
+class TileCache
+{
+public:
+	TileCache();
+	~TileCache();
+	static int get_tile_size();
+	void set_max_size(int); // kB
+	void set_signature(const QString&);
+	const QImage * get(int, int, int) const;
+	void insert(int, int, int, const QImage&);
+	void clear();
+
+private:
+	QString signature;
+	QCache<quint64, QImage> cache;
+};
+
+#endif // TILECACHE__H_
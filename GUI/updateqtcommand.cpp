@@ -1,5 +1,5 @@
 #include "updateqtcommand.h"
-#include <QApplication>
+#include "commonutils.h"
 
 void UpdateQtCommand::Execute(itk::Object * caller, const itk::EventObject & e)
 {
@@ -7,6 +7,6 @@ void UpdateQtCommand::Execute(itk::Object * caller, const itk::EventObject & e)
 }
 void UpdateQtCommand::Execute(const itk::Object *, const itk::EventObject &)
 {
-	QApplication::processEvents();
+	CommonUtils::process_events();
 }
 
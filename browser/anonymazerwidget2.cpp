@@ -10,6 +10,7 @@
 #include <QDate>
 #include <QTime>
 #include <QMimeData>
+#include <QElapsedTimer>
 #include <QUrl>
 #include "mdcmUIDGenerator.h"
 #include "mdcmGlobal.h"
@@ -28,9 +29,11 @@
 #include "dicomutils.h"
 #include "codecutils.h"
 #include "alizams_version.h"
+#include "parallelutils.h"
 #include <cstdlib>
 #include <chrono>
 #include <random>
+#include <vector>
 
 static mdcm::VR get_vr(
 	const mdcm::DataSet & ds,
@@ -217,67 +220,34 @@ static void replace__(
 	}
 }
 
-static void replace_uid_recurs__(
+static void replace_uid__(
 	mdcm::DataSet & ds,
-	const std::set<mdcm::Tag> & ts,
+	const mdcm::Tag & t,
 	const QMap<QString, QString> & m,
 	const bool implicit,
 	const mdcm::Dicts & dicts)
 {
-	mdcm::DataSet::Iterator it = ds.Begin();
-	for (; it != ds.End();)
+	const mdcm::DataElement & de = ds.GetDataElement(t);
+	const mdcm::ByteValue * bv = de.GetByteValue();
+	if (bv)
 	{
-		const mdcm::DataElement & de1 = *it;
-		mdcm::DataSet::Iterator dup = it;
-		mdcm::Tag t = de1.GetTag();
-		mdcm::VR vr = get_vr(ds, t, implicit, dicts);
-		++it;
-		const mdcm::DataElement & de = *dup;
-		if (ts.find(t) != ts.end() || vr == mdcm::VR::UI)
-		{		
-			const mdcm::ByteValue * bv = de.GetByteValue();
-			if (bv)
-			{
-				const QString s = QString::fromLatin1(
-					bv->GetPointer(),
-					bv->GetLength()).trimmed();
-				if (!s.isEmpty())
-				{
-					if (m.contains(s))
-					{
-						const QString v = m.value(s);
-						replace__(ds, t, v.toLatin1().constData(), v.size(), implicit, dicts);
-					}
-				}
-			}
-		}
-		else
+		const QString s = QString::fromLatin1(
+			bv->GetPointer(),
+			bv->GetLength()).trimmed();
+		if (!s.isEmpty())
 		{
-			if (vr.Compatible(mdcm::VR::SQ))
+			if (m.contains(s))
 			{
-				mdcm::SmartPointer<mdcm::SequenceOfItems> sq = de.GetValueAsSQ();
-				if (sq && sq->GetNumberOfItems() > 0)
-				{
-					mdcm::SequenceOfItems::SizeType n = sq->GetNumberOfItems();
-					for (mdcm::SequenceOfItems::SizeType i = 1; i <= n; ++i)
-					{
-						mdcm::Item    & item   = sq->GetItem(i);
-						mdcm::DataSet & nested = item.GetNestedDataSet();
-						replace_uid_recurs__(nested, ts, m, implicit, dicts);
-					}
-					mdcm::DataElement de_dup = *dup;
-					de_dup.SetValue(*sq);
-					de_dup.SetVLToUndefined();
-					ds.Replace(de_dup);
-				}
+				const QString v = m.value(s);
+				replace__(ds, t, v.toLatin1().constData(), v.size(), implicit, dicts);
 			}
 		}
 	}
 }
 
-static void replace_pn_recurs__(
+static void replace_pn__(
 	mdcm::DataSet & ds,
-	const std::set<mdcm::Tag> & ts,
+	const mdcm::Tag & t,
 	const QMap<QString, QString> & m,
 	const bool implicit,
 	const bool one_patient,
@@ -285,93 +255,54 @@ static void replace_pn_recurs__(
 	const QString & charset,
 	const mdcm::Dicts & dicts)
 {
-	mdcm::DataSet::Iterator it = ds.Begin();
-	for (; it != ds.End();)
+	const mdcm::DataElement & de = ds.GetDataElement(t);
+	if (!single_name.isEmpty() && one_patient && t == mdcm::Tag(0x0010,0x0010))
 	{
-		const mdcm::DataElement & de1 = *it;
-		mdcm::Tag t = de1.GetTag();
-		mdcm::VR vr = get_vr(ds, t, implicit, dicts);
-		mdcm::DataSet::Iterator dup = it;
-		++it;
-		const mdcm::DataElement & de = *dup;
-		if (ts.find(t) != ts.end() || vr == mdcm::VR::PN)
+		QString sn = single_name.simplified();
+		sn.replace(QString(" "), QString("^"));
+		if (!charset.isEmpty())
 		{
-			if (!single_name.isEmpty() && one_patient && t == mdcm::Tag(0x0010,0x0010))
+			bool ok = false;
+			const QByteArray ba = CodecUtils::fromUTF8(
+				sn,
+				charset.toLatin1().constData(),
+				&ok);
+			if (!ok)
 			{
-				QString sn = single_name.simplified();
-				sn.replace(QString(" "), QString("^"));
-				if (!charset.isEmpty())
-				{
-					bool ok = false;
-					const QByteArray ba = CodecUtils::fromUTF8(
-						sn,
-						charset.toLatin1().constData(),
-						&ok);
-					if (!ok)
-					{
-						std::cout << "Warning: provided Patient Name may be incorrectly encoded"
-							<< std::endl;
-					}
-					replace__(ds, t, ba.constData(), ba.size(), implicit, dicts);
-				}
-				else
-				{
-					replace__(ds, t, sn.toLatin1().constData(), sn.toLatin1().size(), implicit, dicts);
-				}
-			}
-			else
-			{
-				const mdcm::ByteValue * bv = de.GetByteValue();
-				if (bv)
-				{
-					const QString s = QString::fromLatin1(
-						bv->GetPointer(),
-						bv->GetLength()).trimmed();
-					if (!s.isEmpty())
-					{
-						if (m.contains(s))
-						{
-							const QString v = m.value(s);
-							replace__(
-								ds, t, v.toUtf8().constData(), v.size(), implicit, dicts);
-						}
-					}
-				}
+				std::cout << "Warning: provided Patient Name may be incorrectly encoded"
+					<< std::endl;
 			}
+			replace__(ds, t, ba.constData(), ba.size(), implicit, dicts);
 		}
 		else
 		{
-			if (vr.Compatible(mdcm::VR::SQ))
+			replace__(ds, t, sn.toLatin1().constData(), sn.toLatin1().size(), implicit, dicts);
+		}
+	}
+	else
+	{
+		const mdcm::ByteValue * bv = de.GetByteValue();
+		if (bv)
+		{
+			const QString s = QString::fromLatin1(
+				bv->GetPointer(),
+				bv->GetLength()).trimmed();
+			if (!s.isEmpty())
 			{
-				mdcm::SmartPointer<mdcm::SequenceOfItems> sq = de.GetValueAsSQ();
-				if (sq && sq->GetNumberOfItems() > 0)
+				if (m.contains(s))
 				{
-					mdcm::SequenceOfItems::SizeType n = sq->GetNumberOfItems();
-					for (mdcm::SequenceOfItems::SizeType i = 1; i <= n; ++i)
-					{
-						mdcm::Item    & item   = sq->GetItem(i);
-						mdcm::DataSet & nested = item.GetNestedDataSet();
-						replace_pn_recurs__(
-							nested,
-							ts,
-							m,
-							implicit,
-							one_patient, single_name, charset,
-							dicts);
-					}
-					mdcm::DataElement de_dup = *dup;
-					de_dup.SetValue(*sq);
-					de_dup.SetVLToUndefined();
-					ds.Replace(de_dup);
+					const QString v = m.value(s);
+					replace__(
+						ds, t, v.toUtf8().constData(), v.size(), implicit, dicts);
 				}
 			}
 		}
 	}
 }
 
-static void replace_id_recurs__(
+static void replace_id__(
 	mdcm::DataSet & ds,
-	const std::set<mdcm::Tag> & ts,
+	const mdcm::Tag & t,
 	const QMap<QString, QString> & m,
 	const bool implicit,
 	const bool one_patient,
@@ -379,84 +310,45 @@ static void replace_id_recurs__(
 	const QString & charset,
 	const mdcm::Dicts & dicts)
 {
-	mdcm::DataSet::Iterator it = ds.Begin();
-	for (; it != ds.End();)
+	const mdcm::DataElement & de = ds.GetDataElement(t);
+	if (one_patient && t == mdcm::Tag(0x0010,0x0020))
 	{
-		const mdcm::DataElement & de1 = *it;
-		mdcm::Tag t = de1.GetTag();
-		mdcm::VR vr = get_vr(ds, t, implicit, dicts);
-		mdcm::DataSet::Iterator dup = it;
-		++it;
-		const mdcm::DataElement & de = *dup;
-		if (ts.find(t) != ts.end())
+		QString si = single_id.simplified();
+		si.replace(QString(" "), QString("^"));
+		if (!charset.isEmpty())
 		{
-			if (one_patient && t == mdcm::Tag(0x0010,0x0020))
+			bool ok = false;
+			const QByteArray ba = CodecUtils::fromUTF8(
+				si,
+				charset.toLatin1().constData(),
+				&ok);
+			if (!ok)
 			{
-				QString si = single_id.simplified();
-				si.replace(QString(" "), QString("^"));
-				if (!charset.isEmpty())
-				{
-					bool ok = false;
-					const QByteArray ba = CodecUtils::fromUTF8(
-						si,
-						charset.toLatin1().constData(),
-						&ok);
-					if (!ok)
-					{
-						std::cout << "Warning: provided Patient ID may be incorrectly encoded"
-							<< std::endl;
-					}
-					replace__(ds, t, ba.constData(), ba.size(), implicit, dicts);
-				}
-				else
-				{
-					replace__(ds, t, si.toLatin1().constData(), si.toLatin1().size(), implicit, dicts);
-				}
-			}
-			else
-			{
-				const mdcm::ByteValue * bv = de.GetByteValue();
-				if (bv)
-				{
-					const QString s = QString::fromLatin1(
-						bv->GetPointer(),
-						bv->GetLength()).trimmed();
-					if (!s.isEmpty())
-					{
-						if (m.contains(s))
-						{
-							const QString v = m.value(s);
-							replace__(
-								ds, t, v.toUtf8().constData(), v.size(), implicit, dicts);
-						}
-					}
-				}
+				std::cout << "Warning: provided Patient ID may be incorrectly encoded"
+					<< std::endl;
 			}
+			replace__(ds, t, ba.constData(), ba.size(), implicit, dicts);
 		}
 		else
 		{
-			if (vr.Compatible(mdcm::VR::SQ))
+			replace__(ds, t, si.toLatin1().constData(), si.toLatin1().size(), implicit, dicts);
+		}
+	}
+	else
+	{
+		const mdcm::ByteValue * bv = de.GetByteValue();
+		if (bv)
+		{
+			const QString s = QString::fromLatin1(
+				bv->GetPointer(),
+				bv->GetLength()).trimmed();
+			if (!s.isEmpty())
 			{
-				mdcm::SmartPointer<mdcm::SequenceOfItems> sq = de.GetValueAsSQ();
-				if (sq && sq->GetNumberOfItems() > 0)
+				if (m.contains(s))
 				{
-					mdcm::SequenceOfItems::SizeType n = sq->GetNumberOfItems();
-					for (mdcm::SequenceOfItems::SizeType i = 1; i <= n; ++i)
-					{
-						mdcm::Item    & item   = sq->GetItem(i);
-						mdcm::DataSet & nested = item.GetNestedDataSet();
-						replace_id_recurs__(
-							nested,
-							ts,
-							m,
-							implicit,
-							one_patient, single_id, charset,
-							dicts);
-					}
-					mdcm::DataElement de_dup = *dup;
-					de_dup.SetValue(*sq);
-					de_dup.SetVLToUndefined();
-					ds.Replace(de_dup);
+					const QString v = m.value(s);
+					replace__(
+						ds, t, v.toUtf8().constData(), v.size(), implicit, dicts);
 				}
 			}
 		}
@@ -505,54 +397,20 @@ static void remove_recurs__(
 	}
 }
 
-static void zero_sq_recurs__(
+static void zero_sq__(
 	mdcm::DataSet & ds,
-	const std::set<mdcm::Tag> & ts,
-	const bool implicit,
-	const mdcm::Dicts & dicts)
+	const mdcm::Tag & t,
+	const bool implicit)
 {
-	mdcm::DataSet::Iterator it = ds.Begin();
-	for (; it != ds.End();)
-	{
-		const mdcm::DataElement & de1 = *it;
-		mdcm::Tag t = de1.GetTag();
-		mdcm::DataSet::Iterator dup = it;
-		++it;
-		if (ts.find(t) != ts.end())
-		{
-			mdcm::SmartPointer<mdcm::SequenceOfItems> sq =
-				new mdcm::SequenceOfItems();
-			sq->SetLength(0);
-			sq->SetNumberOfItems(0);
-			mdcm::DataElement e(t);
-			if (!implicit) e.SetVR(mdcm::VR::SQ);
-			e.SetValue(*sq);
-			e.SetVLToUndefined();
-			ds.Replace(e);
-		}
-		else
-		{
-			const mdcm::DataElement & de = *dup;
-			if (compatible_sq(const_cast<const mdcm::DataSet&>(ds), t, implicit, dicts))
-			{
-				mdcm::SmartPointer<mdcm::SequenceOfItems> sq = de.GetValueAsSQ();
-				if (sq && sq->GetNumberOfItems() > 0)
-				{
-					mdcm::SequenceOfItems::SizeType n = sq->GetNumberOfItems();
-					for (mdcm::SequenceOfItems::SizeType i = 1; i <= n; ++i)
-					{
-						mdcm::Item    & item   = sq->GetItem(i);
-						mdcm::DataSet & nested = item.GetNestedDataSet();
-						zero_sq_recurs__(nested, ts, implicit, dicts);
-					}
-					mdcm::DataElement de_dup = *dup;
-					de_dup.SetValue(*sq);
-					de_dup.SetVLToUndefined();
-					ds.Replace(de_dup);
-				}
-			}
-		}
-	}
+	mdcm::SmartPointer<mdcm::SequenceOfItems> sq =
+		new mdcm::SequenceOfItems();
+	sq->SetLength(0);
+	sq->SetNumberOfItems(0);
+	mdcm::DataElement e(t);
+	if (!implicit) e.SetVR(mdcm::VR::SQ);
+	e.SetValue(*sq);
+	e.SetVLToUndefined();
+	ds.Replace(e);
 }
 
 #if 0
@@ -616,11 +474,96 @@ static void remove_date_time_recurs__(
 }
 #endif
 
+// Attribute rewrites of the profile in the order they are applied.
+// Each element is visited once (rewrite_recurs__), the rules
+// matching its tag or VR change it, the others are applied to
+// the items if it is a sequence. Same results as separate passes
+// for each rule, rules only depend on the element itself.
+enum RewriteType
+{
+	REWRITE_ZERO_SQ,
+	REWRITE_EMPTY,
+	REWRITE_REMOVE,
+	REWRITE_DATE_TIME,
+	REWRITE_UID,
+	REWRITE_PN,
+	REWRITE_ID
+};
+
+struct RewriteRule
+{
+	RewriteRule(RewriteType type_, const std::set<mdcm::Tag> * tags_)
+		: type(type_), tags(tags_)
+	{
+	}
+	RewriteType type;
+	const std::set<mdcm::Tag> * tags;
+};
+
+struct RewriteContext
+{
+	std::vector<RewriteRule> rules;
+	const QMap<QString, QString> * uid_map;
+	const QMap<QString, QString> * pn_map;
+	const QMap<QString, QString> * id_map;
+	const mdcm::Dicts * dicts;
+	QString charset;
+	QString single_name;
+	QString single_id;
+	bool implicit;
+	bool one_patient;
+	bool less1h;
+	int y_off;
+	int m_off;
+	int d_off;
+	int s_off;
+};
+
+static bool rule_matches(
+	const RewriteRule & r,
+	const mdcm::Tag & t,
+	const mdcm::VR & vr)
+{
+	switch (r.type)
+	{
+	case REWRITE_DATE_TIME:
+		return is_date_time(vr, t);
+	case REWRITE_UID:
+		return (r.tags->find(t) != r.tags->end() || vr == mdcm::VR::UI);
+	case REWRITE_PN:
+		return (r.tags->find(t) != r.tags->end() || vr == mdcm::VR::PN);
+	default:
+		break;
+	}
+	return (r.tags->find(t) != r.tags->end());
+}
+
+// Removed or emptied by a rule applied before date/time rewrite.
+static bool is_cleared(
+	const RewriteContext & c,
+	const mdcm::Tag & t)
+{
+	for (size_t x = 0; x < c.rules.size(); ++x)
+	{
+		const RewriteRule & r = c.rules.at(x);
+		if (r.type == REWRITE_DATE_TIME) break;
+		if ((r.type == REWRITE_ZERO_SQ ||
+				r.type == REWRITE_EMPTY ||
+				r.type == REWRITE_REMOVE) &&
+			r.tags->find(t) != r.tags->end())
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
 static bool find_time_less_1h_recurs__(
 	const mdcm::DataSet & ds,
-	const bool implicit,
-	const mdcm::Dicts & dicts)
+	const RewriteContext & c)
 {
+	const bool implicit = c.implicit;
+	const mdcm::Dicts & dicts = *c.dicts;
 	mdcm::DataSet::ConstIterator it = ds.Begin();
 	for (; it != ds.End();)
 	{
@@ -629,6 +572,7 @@ static bool find_time_less_1h_recurs__(
 		mdcm::VR vr = get_vr(ds, t, implicit, dicts);
 		mdcm::DataSet::ConstIterator dup = it;
 		++it;
+		if (is_cleared(c, t)) continue;
 		if (is_date_time(vr, t))
 		{
 			if (t == mdcm::Tag(0x0008,0x0201)) continue; // UTC offset
@@ -699,7 +643,7 @@ static bool find_time_less_1h_recurs__(
 					{
 						const mdcm::Item    & item   = sq->GetItem(i);
 						const mdcm::DataSet & nested = item.GetNestedDataSet();
-						const bool t = find_time_less_1h_recurs__(nested, implicit, dicts);
+						const bool t = find_time_less_1h_recurs__(nested, c);
 						if (t) return true;
 					}
 				}
@@ -709,310 +653,314 @@ static bool find_time_less_1h_recurs__(
 	return false;
 }
 
-static void modify_date_time_recurs__(
+static void modify_date_time__(
 	mdcm::DataSet & ds,
+	const mdcm::Tag & t,
+	const mdcm::VR & vr,
 	const bool less1h,
 	const bool implicit,
-	const mdcm::Dicts & dicts,
 	const int y_off,
 	const int m_off,
 	const int d_off,
 	const int s_off)
 {
-	mdcm::DataSet::Iterator it = ds.Begin();
-	for (; it != ds.End();)
+	const mdcm::DataElement & de = ds.GetDataElement(t);
+	const mdcm::ByteValue * bv = de.GetByteValue();
+	if (t == mdcm::Tag(0x0008,0x0201))
 	{
-		const mdcm::DataElement & de1 = *it;
-		mdcm::Tag t = de1.GetTag();
-		mdcm::VR vr = get_vr(ds, t, implicit, dicts);
-		mdcm::DataSet::Iterator dup = it;
-		++it;
-		if (is_date_time(vr, t))
+		const QString r = QString("+0000");
+		mdcm::DataElement de2(t);
+		if (!implicit) de2.SetVR(mdcm::VR::SH);
+		de2.SetByteValue(r.toLatin1(), r.length());
+		ds.Replace(de2);
+	}
+	else
+	{
+		if (bv)
 		{
-			const mdcm::DataElement & de = *dup;
-			const mdcm::ByteValue * bv = de.GetByteValue();
-			if (t == mdcm::Tag(0x0008,0x0201))
+			QString r("");
+			const QString s = QString::fromLatin1(
+				bv->GetPointer(),
+				bv->GetLength()).trimmed().remove(QChar('\0'));
+			if (!s.isEmpty())
 			{
-				const QString r = QString("+0000");
-				mdcm::DataElement de2(t);
-				if (!implicit) de2.SetVR(mdcm::VR::SH);
-				de2.SetByteValue(r.toLatin1(), r.length());
-				ds.Replace(de2);
-			}
-			else
-			{
-				if (bv)
-				{
-					QString r("");
-					const QString s = QString::fromLatin1(
-						bv->GetPointer(),
-						bv->GetLength()).trimmed().remove(QChar('\0'));
-					if (!s.isEmpty())
-					{
 #if QT_VERSION >= QT_VERSION_CHECK(5,14,0)
-  						const QStringList l = s.split(QString("\\"), Qt::KeepEmptyParts);
+  				const QStringList l = s.split(QString("\\"), Qt::KeepEmptyParts);
 #else
-  						const QStringList l = s.split(QString("\\"), QString::KeepEmptyParts);
+  				const QStringList l = s.split(QString("\\"), QString::KeepEmptyParts);
 #endif
-						const int l_size = l.size();
-						for (int x = 0; x < l_size; ++x)
+				const int l_size = l.size();
+				for (int x = 0; x < l_size; ++x)
+				{
+					const QString s0 = l.at(x).trimmed();
+					if (!s0.isEmpty())
+					{
+						const int s0_length = s0.length();
+						if (vr == mdcm::VR::DA)
+						{
+							if (s0_length == 8)
+							{
+								QDate d = QDate::fromString(s0, QString("yyyyMMdd"));
+								d = d.addYears(-y_off);
+								d = d.addMonths(-m_off);
+								d = d.addDays(-d_off);
+								r += d.toString(QString("yyyyMMdd"));
+							}
+						}
+						else if (vr == mdcm::VR::TM)
 						{
-							const QString s0 = l.at(x).trimmed();
-							if (!s0.isEmpty())
+							const int tmp0 = s0.indexOf(QString("."));
+							if (tmp0 == 6)
 							{
-								const int s0_length = s0.length();
-								if (vr == mdcm::VR::DA)
+								const QString s1 = s0.left(6);
+								if (less1h)
 								{
-									if (s0_length == 8)
-									{
-										QDate d = QDate::fromString(s0, QString("yyyyMMdd"));
-										d = d.addYears(-y_off);
-										d = d.addMonths(-m_off);
-										d = d.addDays(-d_off);
-										r += d.toString(QString("yyyyMMdd"));
-									}
+									r += s1 + QString(".000000");
 								}
-								else if (vr == mdcm::VR::TM)
+								else
 								{
-									const int tmp0 = s0.indexOf(QString("."));
-									if (tmp0 == 6)
-									{
-										const QString s1 = s0.left(6);
-										if (less1h)
-										{
-											r += s1 + QString(".000000");
-										}
-										else
-										{
-											QTime t = QTime::fromString(s1, QString("HHmmss"));
-											t = t.addSecs(-s_off);
-											r += t.toString(QString("HHmmss")) + QString(".000000");
-										}
-									}
-									else if (tmp0 == -1)
-									{
-										if (less1h)
-										{
-											if (s0_length == 6)
-											{
-												r += s0 + QString(".000000");
-											}
-											else if (s0_length == 4 || s0_length == 2)
-											{
-												r += s0;
-											}
-										}
-										else
-										{
-											if (s0_length == 2)
-											{
-												r += s0;
-											}
-											else if (s0_length == 4)
-											{
-												QTime t = QTime::fromString(s0, QString("HHmm"));
-												t = t.addSecs(-s_off);
-												r += t.toString(QString("HHmm"));
-											}
-											else if (s0_length == 6)
-											{
-												QTime t = QTime::fromString(s0, QString("HHmmss"));
-												t = t.addSecs(-s_off);
-												r += t.toString(QString("HHmmss"));
-											}
-										}
-									}
+									QTime t = QTime::fromString(s1, QString("HHmmss"));
+									t = t.addSecs(-s_off);
+									r += t.toString(QString("HHmmss")) + QString(".000000");
 								}
-								else if (vr == mdcm::VR::DT)
+							}
+							else if (tmp0 == -1)
+							{
+								if (less1h)
 								{
-									const int tmp0 = s0.indexOf(QString("-"));
-									const int tmp1 = s0.indexOf(QString("+"));
-									QString s1("");
-									if (tmp0 == -1 && tmp1 == -1)
-									{
-										s1 = s0;
-									}
-									else
+									if (s0_length == 6)
 									{
-										if (tmp0 >= 0 && tmp1 >= 0)
-										{
-											;; // error
-										}
-										else if (tmp0 >= 4)
-										{
-											s1 = s0.left(tmp0);
-										}
-										else if (tmp1 >= 4)
-										{
-											s1 = s0.left(tmp1);
-										}
+										r += s0 + QString(".000000");
 									}
-									const int s1_length = s1.length();
-									if (s1_length == 4)
+									else if (s0_length == 4 || s0_length == 2)
 									{
-										QDate d = QDate::fromString(s1, QString("yyyy"));
-										d = d.addYears(-y_off);
-										r += d.toString(QString("yyyy"));
+										r += s0;
 									}
-									else if (s1_length == 6)
-									{
-										QDate d = QDate::fromString(s1, QString("yyyyMM"));
-										d = d.addYears(-y_off);
-										d = d.addMonths(-m_off);
-										r += d.toString(QString("yyyyMM"));
-									}
-									else if (s1_length == 8)
-									{
-										QDate d = QDate::fromString(s1, QString("yyyyMMdd"));
-										d = d.addYears(-y_off);
-										d = d.addMonths(-m_off);
-										d = d.addDays(-d_off);
-										r += d.toString(QString("yyyyMMdd"));
-									}
-									else if (s1_length == 10)
-									{
-										QDateTime d = QDateTime::fromString(s1, QString("yyyyMMddHH"));
-										d = d.addYears(-y_off);
-										d = d.addMonths(-m_off);
-										d = d.addDays(-d_off);
-										if (less1h)
-										{
-											;;
-										}
-										else
-										{
-											d = d.addSecs(-s_off);
-										}
-										r += d.toString("yyyyMMddHH");
-									}
-									else if (s1_length == 12)
+								}
+								else
+								{
+									if (s0_length == 2)
 									{
-										QDateTime d = QDateTime::fromString(s1, QString("yyyyMMddHHmm"));
-										d = d.addYears(-y_off);
-										d = d.addMonths(-m_off);
-										d = d.addDays(-d_off);
-										if (less1h)
-										{
-											;;
-										}
-										else
-										{
-											d = d.addSecs(-s_off);
-										}
-										r += d.toString("yyyyMMddHHmm");
+										r += s0;
 									}
-									else if (s1_length == 14)
+									else if (s0_length == 4)
 									{
-										QDateTime d = QDateTime::fromString(s1, QString("yyyyMMddHHmmss"));
-										d = d.addYears(-y_off);
-										d = d.addMonths(-m_off);
-										d = d.addDays(-d_off);
-										if (less1h)
-										{
-											;;
-										}
-										else
-										{
-											d = d.addSecs(-s_off);
-										}
-										r += d.toString("yyyyMMddHHmmss");
+										QTime t = QTime::fromString(s0, QString("HHmm"));
+										t = t.addSecs(-s_off);
+										r += t.toString(QString("HHmm"));
 									}
-									else if (s1_length >= 15 && s1.indexOf(QString(".")) == 14)
+									else if (s0_length == 6)
 									{
-										const QString s2 = s1.left(14);
-										QDateTime d = QDateTime::fromString(s2, QString("yyyyMMddHHmmss"));
-										d = d.addYears(-y_off);
-										d = d.addMonths(-m_off);
-										d = d.addDays(-d_off);
-										if (less1h)
-										{
-											;;
-										}
-										else
-										{
-											d = d.addSecs(-s_off);
-										}
-										r += d.toString("yyyyMMddHHmmss") + QString(".000000");
+										QTime t = QTime::fromString(s0, QString("HHmmss"));
+										t = t.addSecs(-s_off);
+										r += t.toString(QString("HHmmss"));
 									}
 								}
 							}
-							if ((l_size > 1) && (x < (l_size - 1)))
+						}
+						else if (vr == mdcm::VR::DT)
+						{
+							const int tmp0 = s0.indexOf(QString("-"));
+							const int tmp1 = s0.indexOf(QString("+"));
+							QString s1("");
+							if (tmp0 == -1 && tmp1 == -1)
+							{
+								s1 = s0;
+							}
+							else
+							{
+								if (tmp0 >= 0 && tmp1 >= 0)
+								{
+									;; // error
+								}
+								else if (tmp0 >= 4)
+								{
+									s1 = s0.left(tmp0);
+								}
+								else if (tmp1 >= 4)
+								{
+									s1 = s0.left(tmp1);
+								}
+							}
+							const int s1_length = s1.length();
+							if (s1_length == 4)
+							{
+								QDate d = QDate::fromString(s1, QString("yyyy"));
+								d = d.addYears(-y_off);
+								r += d.toString(QString("yyyy"));
+							}
+							else if (s1_length == 6)
+							{
+								QDate d = QDate::fromString(s1, QString("yyyyMM"));
+								d = d.addYears(-y_off);
+								d = d.addMonths(-m_off);
+								r += d.toString(QString("yyyyMM"));
+							}
+							else if (s1_length == 8)
+							{
+								QDate d = QDate::fromString(s1, QString("yyyyMMdd"));
+								d = d.addYears(-y_off);
+								d = d.addMonths(-m_off);
+								d = d.addDays(-d_off);
+								r += d.toString(QString("yyyyMMdd"));
+							}
+							else if (s1_length == 10)
+							{
+								QDateTime d = QDateTime::fromString(s1, QString("yyyyMMddHH"));
+								d = d.addYears(-y_off);
+								d = d.addMonths(-m_off);
+								d = d.addDays(-d_off);
+								if (less1h)
+								{
+									;;
+								}
+								else
+								{
+									d = d.addSecs(-s_off);
+								}
+								r += d.toString("yyyyMMddHH");
+							}
+							else if (s1_length == 12)
+							{
+								QDateTime d = QDateTime::fromString(s1, QString("yyyyMMddHHmm"));
+								d = d.addYears(-y_off);
+								d = d.addMonths(-m_off);
+								d = d.addDays(-d_off);
+								if (less1h)
+								{
+									;;
+								}
+								else
+								{
+									d = d.addSecs(-s_off);
+								}
+								r += d.toString("yyyyMMddHHmm");
+							}
+							else if (s1_length == 14)
+							{
+								QDateTime d = QDateTime::fromString(s1, QString("yyyyMMddHHmmss"));
+								d = d.addYears(-y_off);
+								d = d.addMonths(-m_off);
+								d = d.addDays(-d_off);
+								if (less1h)
+								{
+									;;
+								}
+								else
+								{
+									d = d.addSecs(-s_off);
+								}
+								r += d.toString("yyyyMMddHHmmss");
+							}
+							else if (s1_length >= 15 && s1.indexOf(QString(".")) == 14)
 							{
-								r += QString("\\");
+								const QString s2 = s1.left(14);
+								QDateTime d = QDateTime::fromString(s2, QString("yyyyMMddHHmmss"));
+								d = d.addYears(-y_off);
+								d = d.addMonths(-m_off);
+								d = d.addDays(-d_off);
+								if (less1h)
+								{
+									;;
+								}
+								else
+								{
+									d = d.addSecs(-s_off);
+								}
+								r += d.toString("yyyyMMddHHmmss") + QString(".000000");
 							}
 						}
-						mdcm::DataElement de2(t);
-						if (!implicit) de2.SetVR(vr);
-						de2.SetByteValue(r.toLatin1(), r.length());
-						ds.Replace(de2);
 					}
-				}
-			}
-		}
-		else
-		{
-			const mdcm::DataElement & de = *dup;
-			if (vr.Compatible(mdcm::VR::SQ))
-			{
-				mdcm::SmartPointer<mdcm::SequenceOfItems> sq = de.GetValueAsSQ();
-				if (sq && sq->GetNumberOfItems() > 0)
-				{
-					mdcm::SequenceOfItems::SizeType n = sq->GetNumberOfItems();
-					for (mdcm::SequenceOfItems::SizeType i = 1; i <= n; ++i)
+					if ((l_size > 1) && (x < (l_size - 1)))
 					{
-						mdcm::Item    & item   = sq->GetItem(i);
-						mdcm::DataSet & nested = item.GetNestedDataSet();
-						modify_date_time_recurs__(
-							nested, less1h, implicit, dicts, y_off, m_off, d_off, s_off);
+						r += QString("\\");
 					}
-					mdcm::DataElement de_dup = *dup;
-					de_dup.SetValue(*sq);
-					de_dup.SetVLToUndefined();
-					ds.Replace(de_dup);
 				}
+				mdcm::DataElement de2(t);
+				if (!implicit) de2.SetVR(vr);
+				de2.SetByteValue(r.toLatin1(), r.length());
+				ds.Replace(de2);
 			}
 		}
 	}
 }
 
-static void empty_recurs__(
+static void rewrite_recurs__(
 	mdcm::DataSet & ds,
-	const std::set<mdcm::Tag> & ts,
-	const bool implicit,
-	const mdcm::Dicts & dicts)
+	const RewriteContext & c,
+	const std::vector<size_t> & rules)
 {
+	const bool implicit = c.implicit;
+	const mdcm::Dicts & dicts = *c.dicts;
 	mdcm::DataSet::Iterator it = ds.Begin();
 	for (; it != ds.End();)
 	{
-		const mdcm::DataElement & de1 = *it;
-		mdcm::DataSet::Iterator dup = it;
-		mdcm::Tag t = de1.GetTag();
+		const mdcm::Tag t = it->GetTag();
+		mdcm::VR vr = get_vr(ds, t, implicit, dicts);
 		++it;
-		if (ts.find(t) != ts.end())
-		{
-			replace__(ds, t, "", 0, implicit, dicts);
-		}
-		else
+		std::vector<size_t> nested_rules;
+		bool removed = false;
+		for (size_t x = 0; x < rules.size(); ++x)
 		{
-			const mdcm::DataElement & de = *dup;
-			if (compatible_sq(const_cast<const mdcm::DataSet&>(ds), t, implicit, dicts))
+			const RewriteRule & r = c.rules.at(rules.at(x));
+			if (!rule_matches(r, t, vr))
 			{
-				mdcm::SmartPointer<mdcm::SequenceOfItems> sq = de.GetValueAsSQ();
-				if (sq && sq->GetNumberOfItems() > 0)
+				if (vr.Compatible(mdcm::VR::SQ))
 				{
-					mdcm::SequenceOfItems::SizeType n = sq->GetNumberOfItems();
-					for (mdcm::SequenceOfItems::SizeType i = 1; i <= n; ++i)
-					{
-						mdcm::Item    & item   = sq->GetItem(i);
-						mdcm::DataSet & nested = item.GetNestedDataSet();
-						empty_recurs__(nested, ts, implicit, dicts);
-					}
-					mdcm::DataElement de_dup = *dup;
-					de_dup.SetValue(*sq);
-					de_dup.SetVLToUndefined();
-					ds.Replace(de_dup);
+					nested_rules.push_back(rules.at(x));
 				}
-			}
+				continue;
+			}
+			switch (r.type)
+			{
+			case REWRITE_ZERO_SQ:
+				zero_sq__(ds, t, implicit);
+				break;
+			case REWRITE_EMPTY:
+				replace__(ds, t, "", 0, implicit, dicts);
+				break;
+			case REWRITE_REMOVE:
+				ds.Remove(t);
+				removed = true;
+				break;
+			case REWRITE_DATE_TIME:
+				modify_date_time__(
+					ds, t, vr, c.less1h, implicit, c.y_off, c.m_off, c.d_off, c.s_off);
+				break;
+			case REWRITE_UID:
+				replace_uid__(ds, t, *c.uid_map, implicit, dicts);
+				break;
+			case REWRITE_PN:
+				replace_pn__(
+					ds, t, *c.pn_map, implicit, c.one_patient, c.single_name, c.charset, dicts);
+				break;
+			case REWRITE_ID:
+				replace_id__(
+					ds, t, *c.id_map, implicit, c.one_patient, c.single_id, c.charset, dicts);
+				break;
+			default:
+				break;
+			}
+			if (removed) break;
+			vr = get_vr(ds, t, implicit, dicts);
+		}
+		if (removed || nested_rules.empty()) continue;
+		// Sequence emptied by a rule has no items here.
+		const mdcm::DataElement & de = ds.GetDataElement(t);
+		mdcm::SmartPointer<mdcm::SequenceOfItems> sq = de.GetValueAsSQ();
+		if (sq && sq->GetNumberOfItems() > 0)
+		{
+			mdcm::SequenceOfItems::SizeType n = sq->GetNumberOfItems();
+			for (mdcm::SequenceOfItems::SizeType i = 1; i <= n; ++i)
+			{
+				mdcm::Item    & item   = sq->GetItem(i);
+				mdcm::DataSet & nested = item.GetNestedDataSet();
+				rewrite_recurs__(nested, c, nested_rules);
+			}
+			mdcm::DataElement de_dup = de;
+			de_dup.SetValue(*sq);
+			de_dup.SetVLToUndefined();
+			ds.Replace(de_dup);
 		}
 	}
 }
@@ -1311,6 +1259,14 @@ static void anonymize_file__(
 	const QString & single_id)
 {
 	mdcm::Reader reader;
+	// Pixel Data (large values, fragments) reference the mapped
+	// input file and are written from there, not copied, the
+	// output must be an other file.
+	if (QFileInfo(filename).canonicalFilePath() !=
+		QFileInfo(outfilename).canonicalFilePath())
+	{
+		reader.SetMemoryMapping(true);
+	}
 #ifdef _WIN32
 #if (defined(_MSC_VER) && defined(MDCM_WIN32_UNC))
 	reader.SetFileName(QDir::toNativeSeparators(filename).toUtf8().constData());
@@ -1385,77 +1341,88 @@ static void anonymize_file__(
 		remove_overlays__(ds);
 	}
 	//
-	zero_sq_recurs__(ds, zero_seq_tags, implicit, dicts);
+	RewriteContext c;
+	c.uid_map     = &uid_map;
+	c.pn_map      = &pn_map;
+	c.id_map      = &id_map;
+	c.dicts       = &dicts;
+	c.charset     = charset;
+	c.single_name = single_name;
+	c.single_id   = single_id;
+	c.implicit    = implicit;
+	c.one_patient = one_patient;
+	c.less1h      = false;
+	c.y_off       = y_off;
+	c.m_off       = m_off;
+	c.d_off       = d_off;
+	c.s_off       = s_off;
+	//
+	c.rules.push_back(RewriteRule(REWRITE_ZERO_SQ, &zero_seq_tags));
 	//
 	if (remove_struct)
 	{
-		zero_sq_recurs__(ds, struct_zero_tags, implicit, dicts);
+		c.rules.push_back(RewriteRule(REWRITE_ZERO_SQ, &struct_zero_tags));
 	}
 	//
-	empty_recurs__(ds, empty_tags, implicit, dicts);
+	c.rules.push_back(RewriteRule(REWRITE_EMPTY, &empty_tags));
 	//
-	remove_recurs__(ds, remove_tags, implicit, dicts);
+	c.rules.push_back(RewriteRule(REWRITE_REMOVE, &remove_tags));
 	//
 	if (remove_descriptions)
 	{
-		remove_recurs__(ds, descr_remove_tags, implicit, dicts);
-		empty_recurs__(ds, descr_empty_tags, implicit, dicts);
-		empty_recurs__(ds, descr_replace_tags, implicit, dicts); // FIXME
+		c.rules.push_back(RewriteRule(REWRITE_REMOVE, &descr_remove_tags));
+		c.rules.push_back(RewriteRule(REWRITE_EMPTY, &descr_empty_tags));
+		c.rules.push_back(RewriteRule(REWRITE_EMPTY, &descr_replace_tags)); // FIXME
 	}
 	//
 	if (!retain_device_id)
 	{
-		remove_recurs__(ds, dev_remove_tags, implicit, dicts);
-		empty_recurs__(ds, dev_empty_tags, implicit, dicts);
-		empty_recurs__(ds, dev_replace_tags, implicit, dicts); // FIXME
+		c.rules.push_back(RewriteRule(REWRITE_REMOVE, &dev_remove_tags));
+		c.rules.push_back(RewriteRule(REWRITE_EMPTY, &dev_empty_tags));
+		c.rules.push_back(RewriteRule(REWRITE_EMPTY, &dev_replace_tags)); // FIXME
 	}
 	//
 	if (!retain_patient_chars)
 	{
-		remove_recurs__(ds, patient_tags, implicit, dicts);
+		c.rules.push_back(RewriteRule(REWRITE_REMOVE, &patient_tags));
 	}
 	//
 	if (!retain_institution_id)
 	{
-		remove_recurs__(ds, inst_remove_tags, implicit, dicts);
-		empty_recurs__(ds, inst_empty_tags, implicit, dicts);
-		empty_recurs__(ds, inst_replace_tags, implicit, dicts); // FIXME
+		c.rules.push_back(RewriteRule(REWRITE_REMOVE, &inst_remove_tags));
+		c.rules.push_back(RewriteRule(REWRITE_EMPTY, &inst_empty_tags));
+		c.rules.push_back(RewriteRule(REWRITE_EMPTY, &inst_replace_tags)); // FIXME
 	}
 	//
 	if (!retain_dates_times)
 	{
-		// always modify
-#if 0
-		if (true)
-		{
-#endif
-			const bool less1h = find_time_less_1h_recurs__(
-				const_cast<const mdcm::DataSet&>(ds), implicit, dicts);
-			modify_date_time_recurs__(
-				ds, less1h, implicit, dicts, y_off, m_off, d_off, s_off);
-#if 0
-		}
-		else
-		{
-			remove_date_time_recurs__(ds, time_tags, implicit, dicts);
-		}
-#endif
+		// always modify, times are checked as they are after
+		// the rules above
+		c.less1h = find_time_less_1h_recurs__(
+			const_cast<const mdcm::DataSet&>(ds), c);
+		c.rules.push_back(RewriteRule(REWRITE_DATE_TIME, NULL));
 	}
 	//
+	std::set<mdcm::Tag> always_replace;
 	if (preserve_uids)
 	{
-		std::set<mdcm::Tag> always_replace;
 		always_replace.insert(mdcm::Tag(0x0400,0x0100)); // Digital Signature UID, replace always
-		replace_uid_recurs__(ds, always_replace, uid_map, implicit, dicts);
+		c.rules.push_back(RewriteRule(REWRITE_UID, &always_replace));
 	}
 	else
 	{
-		replace_uid_recurs__(ds, uid_tags, uid_map, implicit, dicts);
+		c.rules.push_back(RewriteRule(REWRITE_UID, &uid_tags));
 	}
 	//
-	replace_pn_recurs__(ds, pn_tags, pn_map, implicit, one_patient, single_name, charset, dicts);
+	c.rules.push_back(RewriteRule(REWRITE_PN, &pn_tags));
+	//
+	c.rules.push_back(RewriteRule(REWRITE_ID, &id_tags));
 	//
-	replace_id_recurs__(ds, id_tags, id_map, implicit, one_patient, single_id, charset, dicts);
+	{
+		std::vector<size_t> rules;
+		for (size_t x = 0; x < c.rules.size(); ++x) rules.push_back(x);
+		rewrite_recurs__(ds, c, rules);
+	}
 	//
 	remove_group_length__(ds, implicit, dicts);
 	//
@@ -2070,6 +2037,155 @@ static void anonymize_file__(
 	if (!writer.Write()) *ok = false;
 }
 
+// Options of a run, read-only for the threads, the maps are
+// built before.
+struct AnonymizeParams
+{
+	const mdcm::Dicts * dicts;
+	const std::set<mdcm::Tag> * pn_tags;
+	const std::set<mdcm::Tag> * uid_tags;
+	const std::set<mdcm::Tag> * id_tags;
+	const std::set<mdcm::Tag> * empty_tags;
+	const std::set<mdcm::Tag> * remove_tags;
+	const std::set<mdcm::Tag> * zero_seq_tags;
+	const std::set<mdcm::Tag> * dev_remove_tags;
+	const std::set<mdcm::Tag> * dev_empty_tags;
+	const std::set<mdcm::Tag> * dev_replace_tags;
+	const std::set<mdcm::Tag> * patient_tags;
+	const std::set<mdcm::Tag> * inst_remove_tags;
+	const std::set<mdcm::Tag> * inst_empty_tags;
+	const std::set<mdcm::Tag> * inst_replace_tags;
+	const std::set<mdcm::Tag> * time_tags;
+	const std::set<mdcm::Tag> * descr_remove_tags;
+	const std::set<mdcm::Tag> * descr_empty_tags;
+	const std::set<mdcm::Tag> * descr_replace_tags;
+	const std::set<mdcm::Tag> * struct_zero_tags;
+	const QMap<QString, QString> * uid_map;
+	const QMap<QString, QString> * pn_map;
+	const QMap<QString, QString> * id_map;
+	bool preserve_uids;
+	bool remove_private;
+	bool remove_graphics;
+	bool remove_descriptions;
+	bool remove_struct;
+	bool retain_dates_times;
+	bool retain_device_id;
+	bool retain_patient_chars;
+	bool retain_institution_id;
+	bool confirm_clean_pixel;
+	bool confirm_no_recognizable;
+	int y_off;
+	int m_off;
+	int d_off;
+	int s_off;
+	bool one_patient;
+	QString single_name;
+	QString single_id;
+};
+
+// Files are independent, results are stored per file.
+class AnonymizeTask : public ParallelTask
+{
+public:
+	AnonymizeTask(
+		const AnonymizeParams & p_,
+		const QStringList & in_files_,
+		const QStringList & out_files_,
+		std::vector<char> & ok_,
+		std::vector<char> & overlay_,
+		std::vector<qint64> & sizes_,
+		int first_)
+		:
+		p(p_),
+		in_files(in_files_),
+		out_files(out_files_),
+		ok(ok_),
+		overlay(overlay_),
+		sizes(sizes_),
+		first(first_)
+	{
+	}
+	void process(int i) override
+	{
+		const int j = first + i;
+		bool ok_ = false;
+		bool overlay_in_data = false;
+		try
+		{
+			anonymize_file__(
+				&ok_,
+				&overlay_in_data,
+				in_files.at(j),
+				out_files.at(j),
+				*p.dicts,
+				*p.pn_tags,
+				*p.uid_tags,
+				*p.id_tags,
+				*p.empty_tags,
+				*p.remove_tags,
+				*p.zero_seq_tags,
+				*p.dev_remove_tags,
+				*p.dev_empty_tags,
+				*p.dev_replace_tags,
+				*p.patient_tags,
+				*p.inst_remove_tags,
+				*p.inst_empty_tags,
+				*p.inst_replace_tags,
+				*p.time_tags,
+				*p.descr_remove_tags,
+				*p.descr_empty_tags,
+				*p.descr_replace_tags,
+				*p.struct_zero_tags,
+				*p.uid_map,
+				*p.pn_map,
+				*p.id_map,
+				p.preserve_uids,
+				p.remove_private,
+				p.remove_graphics,
+				p.remove_descriptions,
+				p.remove_struct,
+				p.retain_dates_times,
+				p.retain_device_id,
+				p.retain_patient_chars,
+				p.retain_institution_id,
+				p.confirm_clean_pixel,
+				p.confirm_no_recognizable,
+				p.y_off,
+				p.m_off,
+				p.d_off,
+				p.s_off,
+				p.one_patient,
+				p.single_name,
+				p.single_id);
+		}
+		catch(mdcm::ParseException & pe)
+		{
+			std::cout
+				<< "mdcm::ParseException in AnonymizeTask\n"
+				<< pe.GetLastElement().GetTag() << std::endl;
+			ok_ = false;
+		}
+		catch(std::exception & ex)
+		{
+			std::cout << "Exception in AnonymizeTask\n"
+				<< ex.what() << std::endl;
+			ok_ = false;
+		}
+		ok[j] = ok_ ? 1 : 0;
+		overlay[j] = overlay_in_data ? 1 : 0;
+		sizes[j] = QFileInfo(in_files.at(j)).size();
+	}
+
+private:
+	const AnonymizeParams & p;
+	const QStringList & in_files;
+	const QStringList & out_files;
+	std::vector<char> & ok;
+	std::vector<char> & overlay;
+	std::vector<qint64> & sizes;
+	const int first;
+};
+
 AnonymazerWidget2::AnonymazerWidget2(float si)
 {
 	setupUi(this);
@@ -2339,6 +2455,16 @@ static QString generate_uid()
 	return r;
 }
 
+// Keeps the progress dialog responsive, there is no dialog
+// in batch mode.
+static bool check_canceled__(QProgressDialog * pd)
+{
+	if (!pd) return false;
+	pd->setValue(-1);
+	QApplication::processEvents();
+	return pd->wasCanceled();
+}
+
 static void build_maps(
 	const QStringList & l,
 	const std::set<mdcm::Tag> & uid_tags,
@@ -2355,11 +2481,13 @@ static void build_maps(
 	QStringList pids;
 	QStringList ids;
 	QStringList pat_ids_l;   // only to check for single patient
+	std::set<mdcm::Tag> pixel_tags;
+	pixel_tags.insert(mdcm::Tag(0x7fe0,0x0008));
+	pixel_tags.insert(mdcm::Tag(0x7fe0,0x0009));
+	pixel_tags.insert(mdcm::Tag(0x7fe0,0x0010));
 	for (int x = 0; x < l.size(); ++x)
 	{
-		QApplication::processEvents();
-		pd->setValue(-1);
-		if (pd->wasCanceled()) return;
+		if (check_canceled__(pd)) return;
 		try
 		{
 			mdcm::Reader reader;
@@ -2372,7 +2500,9 @@ static void build_maps(
 #else
 			reader.SetFileName(l.at(x).toLocal8Bit().constData());
 #endif
-			if (!reader.Read()) continue;
+			// Only attributes are required, Pixel Data are skipped,
+			// elements after Pixel Data are read too.
+			if (!reader.ReadUpToTag(mdcm::Tag(0xffff,0xffff), pixel_tags)) continue;
 			const mdcm::File    & f  = reader.GetFile();
 			const mdcm::DataSet & ds = f.GetDataSet();
 			if (ds.IsEmpty()) continue;
@@ -2410,9 +2540,7 @@ static void build_maps(
 		QSetIterator<QString> it0(uset);
 		while (it0.hasNext())
 		{
-			QApplication::processEvents();
-			pd->setValue(-1);
-			if (pd->wasCanceled()) return;
+			if (check_canceled__(pd)) return;
 			const QString s = it0.next();
 			const QString v = generate_uid();
 			m0[s] = v;
@@ -2435,9 +2563,7 @@ static void build_maps(
 		QSetIterator<QString> it1(pset);
 		while (it1.hasNext())
 		{
-			QApplication::processEvents();
-			pd->setValue(-1);
-			if (pd->wasCanceled()) return;
+			if (check_canceled__(pd)) return;
 			const QString s = it1.next();
 			const QString v = generate_random_name(random_names);
 			m1[s] = v;
@@ -2460,9 +2586,7 @@ static void build_maps(
 		QSetIterator<QString> it2(iset);
 		while (it2.hasNext())
 		{
-			QApplication::processEvents();
-			pd->setValue(-1);
-			if (pd->wasCanceled()) return;
+			if (check_canceled__(pd)) return;
 			const QString s = it2.next();
 			const QString v = DicomUtils::generate_id();
 			m2[s] = v;
@@ -2486,34 +2610,12 @@ static void build_maps(
 
 static unsigned int count_files = 0;
 static unsigned int count_dirs = 0;
-void AnonymazerWidget2::process_directory(
+static void process_directory(
 	const QString & p,
 	const QString & outp,
-	const QMap<QString,QString> & uid_m,
-	const QMap<QString,QString> & pn_m,
-	const QMap<QString,QString> & id_m,
-	unsigned int * count_overlay_in_data,
-	unsigned int * count_errors,
-	const mdcm::Dicts & dicts,
-	const int y_off,
-	const int m_off,
-	const int d_off,
-	const int s_off,
-	const bool one_patient,
-	const QString & single_name,
-	const QString & single_id,
-	const bool preserve_uids,
-	const bool remove_private,
-	const bool remove_graphics,
-	const bool remove_descriptions,
-	const bool remove_struct,
-	const bool retain_device_id,
-	const bool retain_patient_chars,
-	const bool retain_institution_id,
-	const bool retain_dates_times,
-	const bool confirm_clean_pixel,
-	const bool confirm_no_recognizable,
 	const bool rename_files,
+	QStringList & in_files,
+	QStringList & out_files,
 	QProgressDialog * pd)
 {
 	QDir dir(p);
@@ -2525,18 +2627,14 @@ void AnonymazerWidget2::process_directory(
 		QStringList filenames;
 		for (int x = 0; x < flist.size(); ++x)
 		{
-			pd->setValue(-1);
-			QApplication::processEvents();
-			if (pd->wasCanceled()) return;
+			if (check_canceled__(pd)) return;
 			const QString tmp0 = dir.absolutePath() + QString("/") + flist.at(x);
 			filenames.push_back(tmp0);
 		}
 		for (int x = 0; x < filenames.size(); ++x)
 		{
 			++count_files;
-			pd->setValue(-1);
-			QApplication::processEvents();
-			if (pd->wasCanceled()) return;
+			if (check_canceled__(pd)) return;
 			QString out_filename;
 			if (rename_files)
 			{
@@ -2576,62 +2674,8 @@ void AnonymazerWidget2::process_directory(
 				outp +
 				QString("/") +
 				out_filename;
-			bool ok_ = false;
-			bool overlay_in_data = false;
-			anonymize_file__(
-				&ok_,
-				&overlay_in_data,
-				filenames.at(x),
-				out_file,
-				dicts,
-				pn_tags,
-				uid_tags,
-				id_tags,
-				empty_tags,
-				remove_tags,
-				zero_seq_tags,
-				dev_remove_tags,
-				dev_empty_tags,
-				dev_replace_tags,
-				patient_tags,
-				inst_remove_tags,
-				inst_empty_tags,
-				inst_replace_tags,
-				time_tags,
-				descr_remove_tags,
-				descr_empty_tags,
-				descr_replace_tags,
-				struct_zero_tags,
-				uid_m,
-				pn_m,
-				id_m,
-				preserve_uids,
-				remove_private,
-				remove_graphics,
-				remove_descriptions,
-				remove_struct,
-				retain_dates_times,
-				retain_device_id,
-				retain_patient_chars,
-				retain_institution_id,
-				confirm_clean_pixel,
-				confirm_no_recognizable,
-				y_off,
-				m_off,
-				d_off,
-				s_off,
-				one_patient,
-				single_name,
-				single_id);
-			if (overlay_in_data)
-			{
-				(*count_overlay_in_data)++;
-			}
-			if (!ok_)
-			{
-				(*count_errors)++;
-			}
-			QApplication::processEvents();
+			in_files.push_back(filenames.at(x));
+			out_files.push_back(out_file);
 		}
 	}
 	//
@@ -2639,7 +2683,7 @@ void AnonymazerWidget2::process_directory(
 		for (int j = 0; j < dlist.size(); ++j)
 		{
 			++count_dirs;
-			QApplication::processEvents();
+			if (pd) QApplication::processEvents();
 			QDir d;
 			if (rename_files)
 			{
@@ -2676,77 +2720,35 @@ void AnonymazerWidget2::process_directory(
 			process_directory(
 				dir.absolutePath() + QString("/") + dlist.at(j),
 				d.absolutePath(),
-				uid_m,
-				pn_m,
-				id_m,
-				count_overlay_in_data,
-				count_errors,
-				dicts,
-				y_off, m_off, d_off, s_off,
-				one_patient,
-				single_name,
-				single_id,
-				preserve_uids,
-				remove_private,
-				remove_graphics,
-				remove_descriptions,
-				remove_struct,
-				retain_device_id,
-				retain_patient_chars,
-				retain_institution_id,
-				retain_dates_times,
-				confirm_clean_pixel,
-				confirm_no_recognizable,
 				rename_files,
+				in_files,
+				out_files,
 				pd);
 		}
 	}
 }
 
-void AnonymazerWidget2::run_()
+// De-identifies all files of 'in_path' into 'out_path', used by the
+// widget and by the batch mode. Options in 'params' are set by the
+// caller, tag sets, maps and offsets are set here. Without progress
+// dialog the progress is printed to stdout. Returns false if nothing
+// was written, 'error' is empty if canceled.
+static bool anonymize_directory__(
+	const AnonymazerProfile & profile,
+	const QString & in_path,
+	const QString & out_path,
+	AnonymizeParams & params,
+	const bool random_names,
+	const bool rename_files,
+	QProgressDialog * pd,
+	unsigned int * count_errors,
+	unsigned int * count_overlay_in_data,
+	QString & error)
 {
 	count_dirs = 0;
-	const QString in_path = in_lineEdit->text();
-	const QString out_path = dir_lineEdit->text();
-	if (in_path.isEmpty() || out_path.isEmpty())
-	{
-		run_pushButton->setEnabled(false);
-		QMessageBox::information(
-			NULL,
-			QString("De-identify"),
-			QString("Select input and output directories"));
-		return;
-	}
-	//
-	if (out_path == in_path)
-	{
-		QMessageBox::information(
-			NULL,
-			QString("De-identify"),
-			QString("Error: input and output are the same directory"));
-		return;
-	}
-	//
-	bool one_patient = false;
-	const bool random_names            = random_checkBox->isChecked();
-	const bool preserve_uids           = uids_checkBox->isChecked();
-	const bool remove_private          = private_checkBox->isChecked();
-	const bool remove_graphics         = graphics_checkBox->isChecked();
-	const bool remove_descriptions     = desc_checkBox->isChecked();
-	const bool remove_struct           = struct_checkBox->isChecked();
-	const bool retain_device_id        = device_checkBox->isChecked();
-	const bool retain_patient_chars    = chars_checkBox->isChecked();
-	const bool retain_institution_id   = institution_checkBox->isChecked();
-	const bool retain_dates_times      = dates_checkBox->isChecked();
-	const bool confirm_clean_pixel     = confirm1_checkBox->isChecked();
-	const bool confirm_no_recognizable = confirm2_checkBox->isChecked();
-	const bool rename_files            = rename_checkBox->isChecked();
-	const QString single_name = name_lineEdit->text().trimmed();
-	const QString single_id   = id_lineEdit->text().trimmed();
-	if (!single_name.isEmpty() || !single_id.isEmpty())
-	{
-		one_patient = true;
-	}
+	*count_errors = 0;
+	*count_overlay_in_data = 0;
+	error = QString("");
 	//
 	const unsigned long long seed =
 		std::chrono::high_resolution_clock::now()
@@ -2767,12 +2769,6 @@ void AnonymazerWidget2::run_()
 	QMap<QString, QString> pn_m;
 	QMap<QString, QString> id_m;
 	QSet<QString> pat_ids_set; // to check for one patient
-	QProgressDialog * pd =
-		new QProgressDialog(QString("De-identifying"),QString("Cancel"),0,0);
-	pd->setWindowModality(Qt::ApplicationModal);
-	pd->setWindowFlags(
-		pd->windowFlags()^Qt::WindowContextHelpButtonHint);
-	pd->show();
 	{
 		QStringList filenames;
 		QDir dir(in_path);
@@ -2784,77 +2780,205 @@ void AnonymazerWidget2::run_()
 			{
 				filenames.push_back(fi.absoluteFilePath());
 			}
-			pd->setValue(-1);
-			QApplication::processEvents();
-			if (pd->wasCanceled()) return;
+			if (check_canceled__(pd)) return false;
+		}
+		if (!pd)
+		{
+			std::cout << "Reading attributes of "
+				<< filenames.size() << " files" << std::endl;
 		}
 		build_maps(
 			filenames,
-			uid_tags, id_tags,
+			profile.uid_tags, profile.id_tags,
 			dicts, uid_m, pn_m, id_m,
 			pat_ids_set,
 			random_names,
 			pd);
 		filenames.clear();
 	}
-	if (one_patient)
+	if (params.one_patient)
 	{
 		if (pat_ids_set.size() > 1)
 		{
-			pd->close();
-			delete pd;
-			QMessageBox::information(
-				NULL,
-				QString("De-identify"),
-				QString(
-					"Error: can not replace Patient Name/ID -\n"
-					"multiple patients IDs found in the folder.\n"
-					"Use a folder with a single patient or let\n"
-					"auto-generate names and IDs."));
-			return;
+			error = QString(
+				"Error: can not replace Patient Name/ID -\n"
+				"multiple patients IDs found in the folder.\n"
+				"Use a folder with a single patient or let\n"
+				"auto-generate names and IDs.");
+			return false;
 		}
 	}
-	unsigned int count_overlay_in_data = 0;
-	unsigned int count_errors = 0;
-	try
-	{
-		process_directory(
-			in_path,
-			out_path,
-			uid_m,
-			pn_m,
-			id_m,
-			&count_overlay_in_data,
-			&count_errors,
-			dicts,
-			y_off, m_off, d_off, s_off,
-			one_patient,
-			single_name,
-			single_id,
-			preserve_uids,
-			remove_private,
-			remove_graphics,
-			remove_descriptions,
-			remove_struct,
-			retain_device_id,
-			retain_patient_chars,
-			retain_institution_id,
-			retain_dates_times,
-			confirm_clean_pixel,
-			confirm_no_recognizable,
-			rename_files,
-			pd);
+	QStringList in_files;
+	QStringList out_files;
+	process_directory(
+		in_path,
+		out_path,
+		rename_files,
+		in_files,
+		out_files,
+		pd);
+	//
+	params.dicts                   = &dicts;
+	params.pn_tags                 = &profile.pn_tags;
+	params.uid_tags                = &profile.uid_tags;
+	params.id_tags                 = &profile.id_tags;
+	params.empty_tags              = &profile.empty_tags;
+	params.remove_tags             = &profile.remove_tags;
+	params.zero_seq_tags           = &profile.zero_seq_tags;
+	params.dev_remove_tags         = &profile.dev_remove_tags;
+	params.dev_empty_tags          = &profile.dev_empty_tags;
+	params.dev_replace_tags        = &profile.dev_replace_tags;
+	params.patient_tags            = &profile.patient_tags;
+	params.inst_remove_tags        = &profile.inst_remove_tags;
+	params.inst_empty_tags         = &profile.inst_empty_tags;
+	params.inst_replace_tags       = &profile.inst_replace_tags;
+	params.time_tags               = &profile.time_tags;
+	params.descr_remove_tags       = &profile.descr_remove_tags;
+	params.descr_empty_tags        = &profile.descr_empty_tags;
+	params.descr_replace_tags      = &profile.descr_replace_tags;
+	params.struct_zero_tags        = &profile.struct_zero_tags;
+	params.uid_map                 = &uid_m;
+	params.pn_map                  = &pn_m;
+	params.id_map                  = &id_m;
+	params.y_off                   = y_off;
+	params.m_off                   = m_off;
+	params.d_off                   = d_off;
+	params.s_off                   = s_off;
+	//
+	// Files are processed in batches on the pool, the progress
+	// is updated between batches.
+	const int nfiles = in_files.size();
+	const int batch = 4 * ParallelUtils::get_num_threads();
+	std::vector<char> ok_files(nfiles, 0);
+	std::vector<char> overlay_files(nfiles, 0);
+	std::vector<qint64> sizes(nfiles, 0);
+	int processed = 0;
+	qint64 processed_bytes = 0;
+	qint64 last_print = 0;
+	QElapsedTimer timer;
+	timer.start();
+	for (int x = 0; x < nfiles; x += batch)
+	{
+		if (check_canceled__(pd)) break;
+		const int count = qMin(batch, nfiles - x);
+		AnonymizeTask t(params, in_files, out_files, ok_files, overlay_files, sizes, x);
+		ParallelUtils::run(&t, count);
+		for (int j = x; j < x + count; ++j)
+		{
+			if (overlay_files[j]) ++(*count_overlay_in_data);
+			if (!ok_files[j]) ++(*count_errors);
+			processed_bytes += sizes[j];
+		}
+		processed += count;
+		const qint64 ms = timer.elapsed();
+		const double seconds = ms * 0.001;
+		if (seconds > 0.0)
+		{
+			const QString s =
+				QString("%1 of %2 files, %3 files/s, %4 MB/s")
+					.arg(processed)
+					.arg(nfiles)
+					.arg(processed / seconds, 0, 'f', 1)
+					.arg(processed_bytes / (seconds * 1048576.0), 0, 'f', 1);
+			if (pd)
+			{
+				pd->setLabelText(QString("De-identifying\n") + s);
+			}
+			else if (ms - last_print >= 1000 || processed == nfiles)
+			{
+				std::cout << s.toStdString() << std::endl;
+				last_print = ms;
+			}
+		}
+	}
+	{
+		const double seconds = timer.elapsed() * 0.001;
+		std::cout << "De-identified " << processed << " files ("
+			<< (processed_bytes / 1048576.0) << " MB) in " << seconds << " s";
+		if (seconds > 0.0)
+		{
+			std::cout << ", " << (processed / seconds) << " files/s, "
+				<< (processed_bytes / (seconds * 1048576.0)) << " MB/s";
+		}
+		std::cout << std::endl;
+	}
+	return true;
+}
+
+void AnonymazerWidget2::run_()
+{
+	const QString in_path = in_lineEdit->text();
+	const QString out_path = dir_lineEdit->text();
+	if (in_path.isEmpty() || out_path.isEmpty())
+	{
+		run_pushButton->setEnabled(false);
+		QMessageBox::information(
+			NULL,
+			QString("De-identify"),
+			QString("Select input and output directories"));
+		return;
 	}
-	catch(mdcm::ParseException & pe)
+	//
+	if (out_path == in_path)
 	{
-		std::cout
-			<< "mdcm::ParseException in AnonymazerWidget2::run_\n"
-			<< pe.GetLastElement().GetTag() << std::endl;
+		QMessageBox::information(
+			NULL,
+			QString("De-identify"),
+			QString("Error: input and output are the same directory"));
+		return;
 	}
-	catch(std::exception & ex)
+	//
+	const bool random_names = random_checkBox->isChecked();
+	const bool rename_files = rename_checkBox->isChecked();
+	AnonymizeParams params;
+	params.preserve_uids           = uids_checkBox->isChecked();
+	params.remove_private          = private_checkBox->isChecked();
+	params.remove_graphics         = graphics_checkBox->isChecked();
+	params.remove_descriptions     = desc_checkBox->isChecked();
+	params.remove_struct           = struct_checkBox->isChecked();
+	params.retain_dates_times      = dates_checkBox->isChecked();
+	params.retain_device_id        = device_checkBox->isChecked();
+	params.retain_patient_chars    = chars_checkBox->isChecked();
+	params.retain_institution_id   = institution_checkBox->isChecked();
+	params.confirm_clean_pixel     = confirm1_checkBox->isChecked();
+	params.confirm_no_recognizable = confirm2_checkBox->isChecked();
+	params.single_name             = name_lineEdit->text().trimmed();
+	params.single_id               = id_lineEdit->text().trimmed();
+	params.one_patient =
+		(!params.single_name.isEmpty() || !params.single_id.isEmpty());
+	//
+	QProgressDialog * pd =
+		new QProgressDialog(QString("De-identifying"),QString("Cancel"),0,0);
+	pd->setWindowModality(Qt::ApplicationModal);
+	pd->setWindowFlags(
+		pd->windowFlags()^Qt::WindowContextHelpButtonHint);
+	pd->show();
+	unsigned int count_overlay_in_data = 0;
+	unsigned int count_errors = 0;
+	QString error;
+	const bool ok = anonymize_directory__(
+		*this,
+		in_path,
+		out_path,
+		params,
+		random_names,
+		rename_files,
+		pd,
+		&count_errors,
+		&count_overlay_in_data,
+		error);
+	pd->close();
+	delete pd;
+	if (!ok)
 	{
-		std::cout << "Exception in AnonymazerWidget2::run_\n"
-			<< ex.what() << std::endl;
+		if (!error.isEmpty())
+		{
+			QMessageBox::information(
+				NULL,
+				QString("De-identify"),
+				error);
+		}
+		return;
 	}
 	QString message("");
 	if (count_errors > 0)
@@ -2866,8 +2990,6 @@ void AnonymazerWidget2::run_()
 	{
 		message.append(QString("\nWarning: some files may contain overlays in pixel data\n"));
 	}
-	pd->close();
-	delete pd;
 	QApplication::processEvents();
 	if (!message.isEmpty())
 	{
@@ -2882,6 +3004,124 @@ void AnonymazerWidget2::run_()
 	run_pushButton->setEnabled(false);
 }
 
+int AnonymazerWidget2::run_headless(
+	const QString & in,
+	const QString & out,
+	const QString & options)
+{
+	const QFileInfo in_fi(in);
+	if (!in_fi.isDir())
+	{
+		std::cout << "Error: input is not a directory" << std::endl;
+		return 1;
+	}
+	const QString in_path = in_fi.canonicalFilePath();
+	QDir out_dir(out);
+	if (!out_dir.exists() && !out_dir.mkpath(out_dir.absolutePath()))
+	{
+		std::cout << "Error: can not create output directory" << std::endl;
+		return 1;
+	}
+	const QString out_path = QFileInfo(out_dir.absolutePath()).canonicalFilePath();
+	if (out_path == in_path)
+	{
+		std::cout << "Error: input and output are the same directory" << std::endl;
+		return 1;
+	}
+	// Same keys as in settings, random names are on by default.
+	QMap<QString, bool> flags;
+	flags[QString("remove_private")]          = false;
+	flags[QString("remove_overlays")]         = false;
+	flags[QString("preserve_uids")]           = false;
+	flags[QString("retain_device_id")]        = false;
+	flags[QString("retain_dates_times")]      = false;
+	flags[QString("retain_patient_chars")]    = false;
+	flags[QString("retain_institution_id")]   = false;
+	flags[QString("remove_desc")]             = false;
+	flags[QString("remove_struct")]           = false;
+	flags[QString("random_names")]            = true;
+	flags[QString("rename_files")]            = false;
+	flags[QString("confirm_clean_pixel")]     = false;
+	flags[QString("confirm_no_recognizable")] = false;
+	QString single_name;
+	QString single_id;
+#if QT_VERSION >= QT_VERSION_CHECK(5,14,0)
+	const QStringList l = options.split(QString(","), Qt::SkipEmptyParts);
+#else
+	const QStringList l = options.split(QString(","), QString::SkipEmptyParts);
+#endif
+	for (int x = 0; x < l.size(); ++x)
+	{
+		const int i = l.at(x).indexOf(QChar('='));
+		const QString k = (i < 0) ? l.at(x).trimmed() : l.at(x).left(i).trimmed();
+		const QString v = (i < 0) ? QString("1") : l.at(x).mid(i + 1).trimmed();
+		if (k == QString("name"))
+		{
+			single_name = v;
+		}
+		else if (k == QString("id"))
+		{
+			single_id = v;
+		}
+		else if (flags.contains(k) && (v == QString("0") || v == QString("1")))
+		{
+			flags[k] = (v == QString("1"));
+		}
+		else
+		{
+			std::cout << "Error: invalid profile option \""
+				<< l.at(x).toStdString() << "\"" << std::endl;
+			return 1;
+		}
+	}
+	AnonymazerProfile profile;
+	profile.init_profile();
+	AnonymizeParams params;
+	params.preserve_uids           = flags.value(QString("preserve_uids"));
+	params.remove_private          = flags.value(QString("remove_private"));
+	params.remove_graphics         = flags.value(QString("remove_overlays"));
+	params.remove_descriptions     = flags.value(QString("remove_desc"));
+	params.remove_struct           = flags.value(QString("remove_struct"));
+	params.retain_dates_times      = flags.value(QString("retain_dates_times"));
+	params.retain_device_id        = flags.value(QString("retain_device_id"));
+	params.retain_patient_chars    = flags.value(QString("retain_patient_chars"));
+	params.retain_institution_id   = flags.value(QString("retain_institution_id"));
+	params.confirm_clean_pixel     = flags.value(QString("confirm_clean_pixel"));
+	params.confirm_no_recognizable = flags.value(QString("confirm_no_recognizable"));
+	params.single_name             = single_name;
+	params.single_id               = single_id;
+	params.one_patient = (!single_name.isEmpty() || !single_id.isEmpty());
+	unsigned int count_overlay_in_data = 0;
+	unsigned int count_errors = 0;
+	QString error;
+	const bool ok = anonymize_directory__(
+		profile,
+		in_path,
+		out_path,
+		params,
+		flags.value(QString("random_names")),
+		flags.value(QString("rename_files")),
+		NULL,
+		&count_errors,
+		&count_overlay_in_data,
+		error);
+	if (!ok)
+	{
+		std::cout << error.toStdString() << std::endl;
+		return 1;
+	}
+	if (count_overlay_in_data > 0)
+	{
+		std::cout << "Warning: some files may contain overlays in pixel data" << std::endl;
+	}
+	if (count_errors > 0)
+	{
+		std::cout << "Warning: " << count_errors << " file(s) failed" << std::endl;
+		return 2;
+	}
+	return 0;
+}
+
 void AnonymazerWidget2::set_output_dir()
 {
 	const QString dirname= QFileDialog::getExistingDirectory(
@@ -2928,7 +3168,7 @@ void AnonymazerWidget2::show_help()
 }
 
 // clang-format off
-void AnonymazerWidget2::init_profile()
+void AnonymazerProfile::init_profile()
 {
 /*
  *
@@ -19,13 +19,44 @@
 
 class HelpWidget;
 
-class AnonymazerWidget2 : public QWidget, private Ui::AnonymazerWidget2
+// Tag sets of the confidentiality profile, used by the widget
+// and by the headless batch mode.
+class AnonymazerProfile
+{
+public:
+	void init_profile();
+	std::set<mdcm::Tag> pn_tags;
+	std::set<mdcm::Tag> id_tags;
+	std::set<mdcm::Tag> uid_tags;
+	std::set<mdcm::Tag> empty_tags;
+	std::set<mdcm::Tag> remove_tags;
+	std::set<mdcm::Tag> dev_remove_tags;
+	std::set<mdcm::Tag> dev_empty_tags;
+	std::set<mdcm::Tag> dev_replace_tags;
+	std::set<mdcm::Tag> patient_tags;
+	std::set<mdcm::Tag> inst_remove_tags;
+	std::set<mdcm::Tag> inst_empty_tags;
+	std::set<mdcm::Tag> inst_replace_tags;
+	std::set<mdcm::Tag> time_tags;
+	std::set<mdcm::Tag> descr_remove_tags;
+	std::set<mdcm::Tag> descr_empty_tags;
+	std::set<mdcm::Tag> descr_replace_tags;
+	std::set<mdcm::Tag> struct_zero_tags;
+	std::set<mdcm::Tag> zero_seq_tags;
+};
+
+class AnonymazerWidget2 : public QWidget, private Ui::AnonymazerWidget2, private AnonymazerProfile
 {
 Q_OBJECT
 public:
 	AnonymazerWidget2(float);
 	~AnonymazerWidget2();
 	void writeSettings(QSettings&);
+	// Batch mode, de-identifies the input directory into the output
+	// directory, options are comma separated "key=value" pairs,
+	// e.g. "remove_private=1,retain_dates_times=1". Progress is
+	// printed to stdout, returns the exit code.
+	static int run_headless(const QString&, const QString&, const QString&);
 
 public slots:
 	void run_();
@@ -42,54 +73,6 @@ protected:
 	void dragLeaveEvent(QDragLeaveEvent*) override;
 
 private:
-	void process_directory(
-		const QString&,
-		const QString&,
-		const QMap<QString,QString> &,
-		const QMap<QString,QString> &,
-		const QMap<QString,QString> &,
-		unsigned int*,
-		unsigned int*,
-		const mdcm::Dicts&,
-		const int,
-		const int,
-		const int,
-		const int,
-		const bool,
-		const QString&,
-		const QString&,
-		const bool preserve_uids,
-		const bool remove_private,
-		const bool remove_graphics,
-		const bool remove_descriptions,
-		const bool remove_struct,
-		const bool retain_device_id,
-		const bool retain_patient_chars,
-		const bool retain_institution_id,
-		const bool retain_dates_times,
-		const bool confirm_clean_pixel,
-		const bool confirm_no_recognizable,
-		const bool rename_files,
-		QProgressDialog*);
-	void init_profile();
-	std::set<mdcm::Tag> pn_tags;
-	std::set<mdcm::Tag> id_tags;
-	std::set<mdcm::Tag> uid_tags;
-	std::set<mdcm::Tag> empty_tags;
-	std::set<mdcm::Tag> remove_tags;
-	std::set<mdcm::Tag> dev_remove_tags;
-	std::set<mdcm::Tag> dev_empty_tags;
-	std::set<mdcm::Tag> dev_replace_tags;
-	std::set<mdcm::Tag> patient_tags;
-	std::set<mdcm::Tag> inst_remove_tags;
-	std::set<mdcm::Tag> inst_empty_tags;
-	std::set<mdcm::Tag> inst_replace_tags;
-	std::set<mdcm::Tag> time_tags;
-	std::set<mdcm::Tag> descr_remove_tags;
-	std::set<mdcm::Tag> descr_empty_tags;
-	std::set<mdcm::Tag> descr_replace_tags;
-	std::set<mdcm::Tag> struct_zero_tags;
-	std::set<mdcm::Tag> zero_seq_tags;
 	QString output_dir;
 	QString input_dir;
 	HelpWidget * help_widget;
@@ -0,0 +1,90 @@
+#include "batchmode.h"
+#include <QtGlobal>
+#include <QString>
+#include "browserwidget2.h"
+#include "anonymazerwidget2.h"
+#include "transcoder.h"
+#include "scanindex.h"
+#include "parallelutils.h"
+#include <cstring>
+#include <iostream>
+
+// Value of the option, e.g. "--ts jpegls", empty if not found.
+static QString option_value(const QStringList & args, const QString & name)
+{
+	const int i = args.indexOf(name);
+	if (i < 0 || i + 1 >= args.size()) return QString("");
+	return args.at(i + 1);
+}
+
+bool BatchMode::is_batch(int argc, char ** argv)
+{
+	if (argc < 2) return false;
+	return (
+		!strcmp(argv[1], "--scan")       ||
+		!strcmp(argv[1], "--anonymize")  ||
+		!strcmp(argv[1], "--convert-ts") ||
+		!strcmp(argv[1], "--batch-help"));
+}
+
+void BatchMode::print_usage()
+{
+	std::cout
+		<< "Usage:\n"
+		<< "  alizams --scan DIR [--index FILE]\n"
+		<< "      Scans DIR recursively, updates the index FILE\n"
+		<< "      (default is the browser's index), writes a table\n"
+		<< "      if FILE ends with \".csv\".\n"
+		<< "  alizams --anonymize IN OUT [--profile OPTIONS]\n"
+		<< "      De-identifies IN into OUT, OPTIONS are comma separated\n"
+		<< "      key=0/1: remove_private, remove_overlays, preserve_uids,\n"
+		<< "      retain_device_id, retain_dates_times, retain_patient_chars,\n"
+		<< "      retain_institution_id, remove_desc, remove_struct,\n"
+		<< "      random_names (default 1), rename_files, confirm_clean_pixel,\n"
+		<< "      confirm_no_recognizable, and name=NAME, id=ID for\n"
+		<< "      a single patient.\n"
+		<< "  alizams --convert-ts IN OUT --ts SYNTAX\n"
+		<< "      Changes the transfer syntax of images in IN, writes to\n"
+		<< "      OUT, SYNTAX is a UID or one of implicit, explicit, jpeg,\n"
+		<< "      jpeg-lossless, jpegls, jpegls-near, j2k, j2k-lossy, rle.\n"
+		<< "  --threads N\n"
+		<< "      Limits worker threads of any mode, default is\n"
+		<< "      the number of processors.\n"
+		<< "Exit code is 0 on success, 1 on error, 2 if some files failed."
+		<< std::endl;
+}
+
+int BatchMode::run(const QStringList & args)
+{
+	if (args.size() < 2)
+	{
+		print_usage();
+		return 1;
+	}
+	const QString mode = args.at(1);
+	const QString threads = option_value(args, QString("--threads"));
+	if (!threads.isEmpty()) ParallelUtils::set_max_threads(threads.toInt());
+	if (mode == QString("--scan") && args.size() >= 3)
+	{
+		QString index_file = option_value(args, QString("--index"));
+		if (index_file.isEmpty()) index_file = ScanIndex::get_default_file();
+		return BrowserWidget2::scan_headless(args.at(2), index_file);
+	}
+	else if (mode == QString("--anonymize") && args.size() >= 4)
+	{
+		return AnonymazerWidget2::run_headless(
+			args.at(2),
+			args.at(3),
+			option_value(args, QString("--profile")));
+	}
+	else if (mode == QString("--convert-ts") && args.size() >= 4)
+	{
+		const QString ts = option_value(args, QString("--ts"));
+		if (!ts.isEmpty())
+		{
+			return Transcoder::run_headless(args.at(2), args.at(3), ts);
+		}
+	}
+	print_usage();
+	return (mode == QString("--batch-help")) ? 0 : 1;
+}
@@ -0,0 +1,18 @@
+#ifndef BATCHMODE___H
+#define BATCHMODE___H
+
+#include <QStringList>
+
+// Command line batch mode without GUI:
+//   --scan DIR [--index FILE]
+//   --anonymize IN OUT [--profile OPTIONS]
+//   --convert-ts IN OUT --ts SYNTAX
+class BatchMode
+{
+public:
+	static bool is_batch(int, char**);
+	static int  run(const QStringList&);
+	static void print_usage();
+};
+
+#endif // BATCHMODE___H
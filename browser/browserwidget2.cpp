@@ -8,6 +8,7 @@
 #include <QSettings>
 #include <QProgressDialog>
 #include <QDate>
+#include <QDateTime>
 #include <QUrl>
 #include <QMimeData>
 #include <QTextCodec>
@@ -19,6 +20,8 @@
 #include <QVector>
 #include <QDir>
 #include <QApplication>
+#include <QInputDialog>
+#include <QElapsedTimer>
 #ifdef USE_WORKSTATION_MODE
 #include <QSqlDatabase>
 #include <QSqlQuery>
@@ -26,8 +29,8 @@
 #include <QSqlError>
 #include "ctkdialog.h"
 #endif
+#include "transcoder.h"
 #include "mdcmReader.h"
-#include "mdcmScanner.h"
 #include "mdcmAttribute.h"
 #include "mdcmMediaStorage.h"
 #include "mdcmExplicitDataElement.h"
@@ -37,6 +40,7 @@
 #include "mdcmParseException.h"
 #include "codecutils.h"
 #include "dicomutils.h"
+#include "parallelutils.h"
 #include <vector>
 #include <string>
 #include <exception>
@@ -62,6 +66,358 @@ const mdcm::Tag tColumns                                    (0x0028,0x0011);
 const mdcm::Tag tBitsAllocated                              (0x0028,0x0100);
 const mdcm::Tag tPixelRepresentation                        (0x0028,0x0103);
 
+class ScanSeriesRow
+{
+public:
+	ScanSeriesRow() :
+		item(NULL), row(-1),
+		is_image(false), is_softcopy(false), done(false) {}
+	~ScanSeriesRow() {}
+	TableWidgetItem * item;
+	int  row;
+	bool is_image;
+	bool is_softcopy;
+	// no more files have to be checked for the icon
+	bool done;
+};
+
+static void read_tags_ds(
+	const mdcm::DataSet & ds,
+	QString & patient_name_,
+	QString & birthdate_,
+	QString & modality_,
+	QString & studydesc_,
+	QString & study_date_,
+	QString & seriesdesc_,
+	QString & series_date_,
+	bool * is_image,
+	bool * is_softcopy)
+{
+	if (ds.IsEmpty()) return;
+	QString charset = QString("");
+	QString sop = QString("");
+	//
+	if(ds.FindDataElement(tSpecificCharacterSet))
+	{
+		const mdcm::DataElement & e = ds.GetDataElement(tSpecificCharacterSet);
+		if (!e.IsEmpty() && !e.IsUndefinedLength() && e.GetByteValue())
+			charset =
+				QString::fromLatin1(e.GetByteValue()->GetPointer(),e.GetByteValue()->GetLength());
+	}
+	//
+	if (ds.FindDataElement(tSOPClassUID))
+	{
+		const mdcm::DataElement & e = ds.GetDataElement(tSOPClassUID);
+		if (!e.IsEmpty() && !e.IsUndefinedLength() && e.GetByteValue())
+		{
+			sop =
+				QString::fromLatin1(e.GetByteValue()->GetPointer(),
+									e.GetByteValue()->GetLength()).trimmed().remove(QChar('\0'));
+		}
+	}
+	//
+	if(ds.FindDataElement(tStudyDate))
+	{
+		const mdcm::DataElement & e = ds.GetDataElement(tStudyDate);
+		if (!e.IsEmpty() && !e.IsUndefinedLength() && e.GetByteValue())
+		{
+			const QString date_s =
+				QString::fromLatin1(e.GetByteValue()->GetPointer(),
+									e.GetByteValue()->GetLength()).trimmed();
+			const QDate qd = QDate::fromString(date_s, QString("yyyyMMdd"));
+			study_date_ = qd.toString(QString("d MMM yyyy")) + QString("\n");
+		}
+	}
+	//
+	if (ds.FindDataElement(tModality))
+	{
+		const mdcm::DataElement & e = ds.GetDataElement(tModality);
+		if (!e.IsEmpty() && !e.IsUndefinedLength() && e.GetByteValue())
+		{
+			modality_ =
+				QString::fromLatin1(e.GetByteValue()->GetPointer(),e.GetByteValue()->GetLength());
+		}
+	}
+	//
+	if(ds.FindDataElement(tStudyDescription))
+	{
+		const mdcm::DataElement & e = ds.GetDataElement(tStudyDescription);
+		if (!e.IsEmpty() && !e.IsUndefinedLength() && e.GetByteValue())
+		{
+			QByteArray ba(e.GetByteValue()->GetPointer(), e.GetByteValue()->GetLength());
+			const QString tmp0 = CodecUtils::toUTF8(&ba, charset.toLatin1().constData());
+			if (!tmp0.isEmpty()) studydesc_ = tmp0.simplified();
+		}
+	}
+	//
+	if(ds.FindDataElement(tSeriesDescription))
+	{
+		const mdcm::DataElement & e = ds.GetDataElement(tSeriesDescription);
+		if (!e.IsEmpty() && !e.IsUndefinedLength() && e.GetByteValue())
+		{
+			QByteArray ba(e.GetByteValue()->GetPointer(), e.GetByteValue()->GetLength());
+			const QString tmp0 = CodecUtils::toUTF8(&ba, charset.toLatin1().constData());
+			if (!tmp0.isEmpty()) seriesdesc_ = tmp0.simplified();
+		}
+	}
+	//
+	if(ds.FindDataElement(tSeriesDate))
+	{
+		const mdcm::DataElement & e = ds.GetDataElement(tSeriesDate);
+		if (!e.IsEmpty() && !e.IsUndefinedLength() && e.GetByteValue())
+		{
+			const QString date_s =
+				QString::fromLatin1(e.GetByteValue()->GetPointer(),
+									e.GetByteValue()->GetLength()).trimmed();
+			const QDate qd = QDate::fromString(date_s, QString("yyyyMMdd"));
+			series_date_ = qd.toString(QString("d MMM yyyy")) + QString("\n");
+		}
+	}
+	//
+	if(ds.FindDataElement(tPatientsName))
+	{
+		const mdcm::DataElement & e = ds.GetDataElement(tPatientsName);
+		if (!e.IsEmpty() && !e.IsUndefinedLength() && e.GetByteValue())
+		{
+			QByteArray ba(e.GetByteValue()->GetPointer(), e.GetByteValue()->GetLength());
+			const QString tmp0 = CodecUtils::toUTF8(&ba, charset.toLatin1().constData());
+			if (!tmp0.isEmpty()) patient_name_ = tmp0;
+		}
+	}
+	//
+	if(ds.FindDataElement(tPatientsBirthDate))
+	{
+		const mdcm::DataElement & e = ds.GetDataElement(tPatientsBirthDate);
+		std::stringstream ss;
+		if (!e.IsEmpty() && !e.IsUndefinedLength() && e.GetByteValue())
+		{
+			const QString birthdate_s =
+				QString::fromLatin1(e.GetByteValue()->GetPointer(),
+									e.GetByteValue()->GetLength()).trimmed();
+			const QDate qd = QDate::fromString(birthdate_s, QString("yyyyMMdd"));
+			birthdate_ = qd.toString(QString("d MMM yyyy")) + QString("\n");
+		}
+	}
+	//
+	bool has_rows         = false;
+	bool has_colums       = false;
+	bool has_bitallocated = false;
+	if(ds.FindDataElement(tRows))
+	{
+		const mdcm::DataElement & e = ds.GetDataElement(tRows);
+		if (!e.IsEmpty()) has_rows = true;
+	}
+	if(ds.FindDataElement(tColumns))
+	{
+		const mdcm::DataElement & e = ds.GetDataElement(tColumns);
+		if (!e.IsEmpty()) has_colums = true;
+	}
+	if(ds.FindDataElement(tBitsAllocated))
+	{
+		const mdcm::DataElement & e = ds.GetDataElement(tBitsAllocated);
+		if (!e.IsEmpty()) has_bitallocated = true;
+	}
+	bool is_image_tmp = has_rows && has_colums && has_bitallocated;
+	//
+	// RTSTRUCT, spectroscopy, meshes
+	if (sop==QString("1.2.840.10008.5.1.4.1.1.481.3") ||
+		sop==QString("1.2.840.10008.5.1.4.1.1.4.2")   ||
+		sop==QString("1.2.840.10008.5.1.4.1.1.68.1")  ||
+		sop==QString("1.2.840.10008.5.1.4.1.1.66.5"))
+		is_image_tmp = true;
+	*is_image = is_image_tmp;
+	// Presentation, SR
+	if (   sop==QString("1.2.840.10008.5.1.4.1.1.11.1")  // Grayscale Softcopy Presentation State Storage
+#if 0
+		|| sop==QString("1.2.840.10008.5.1.4.1.1.11.2")  // Color Softcopy Presentation State Storage
+		|| sop==QString("1.2.840.10008.5.1.4.1.1.11.3")  // Pseudo-Color Softcopy Presentation State Storage
+		|| sop==QString("1.2.840.10008.5.1.4.1.1.11.4")  // Blending Softcopy Presentation State Storage
+		|| sop==QString("1.2.840.10008.5.1.4.1.1.11.5")  // XA/XRF Grayscale Softcopy Presentation State Storage
+		|| sop==QString("1.2.840.10008.5.1.4.1.1.11.6")  // Grayscale Planar MPR Volumetric Presentation State Storage
+		|| sop==QString("1.2.840.10008.5.1.4.1.1.11.7")  // Compositing Planar MPR Volumetric Presentation State Storage
+		|| sop==QString("1.2.840.10008.5.1.4.1.1.11.8")  // Advanced Blending Presentation State Storage
+		|| sop==QString("1.2.840.10008.5.1.4.1.1.11.9")  // Volume Rendering Volumetric Presentation State Storage
+		|| sop==QString("1.2.840.10008.5.1.4.1.1.11.10") // Segmented Volume Rendering Volumetric Presentation State Storage
+		|| sop==QString("1.2.840.10008.5.1.4.1.1.11.11") // Multiple Volume Rendering Volumetric Presentation State Storage
+#endif
+		|| sop==QString("1.2.840.10008.5.1.4.1.1.88.11") // Basic Text SR Storage
+		|| sop==QString("1.2.840.10008.5.1.4.1.1.88.22") // Enhanced SR Storage
+		|| sop==QString("1.2.840.10008.5.1.4.1.1.88.33") // Comprehensive SR Storage
+		|| sop==QString("1.2.840.10008.5.1.4.1.1.88.34") // Comprehensive 3D SR Storage
+		|| sop==QString("1.2.840.10008.5.1.4.1.1.88.35") // Extensible SR Storage
+		|| sop==QString("1.2.840.10008.5.1.4.1.1.88.40") // Procedure Log Storage
+		|| sop==QString("1.2.840.10008.5.1.4.1.1.88.50") // Mammography CAD SR Storage
+		|| sop==QString("1.2.840.10008.5.1.4.1.1.88.59") // Key Object Selection Storage
+		|| sop==QString("1.2.840.10008.5.1.4.1.1.88.65") // Chest CAD SR Storage
+		|| sop==QString("1.2.840.10008.5.1.4.1.1.88.67") // X-Ray Radiation Dose SR Storage
+		|| sop==QString("1.2.840.10008.5.1.4.1.1.88.68") // Radiopharmaceutical Radiation Dose SR Storage
+		|| sop==QString("1.2.840.10008.5.1.4.1.1.88.69") // Colon CAD SR Storage
+		|| sop==QString("1.2.840.10008.5.1.4.1.1.88.70") // Implantation Plan SR Document Storage
+		|| sop==QString("1.2.840.10008.5.1.4.1.1.88.71") // Acquisition Context SR Storage
+		|| sop==QString("1.2.840.10008.5.1.4.1.1.88.72") // Simplified Adult Echo SR Storage
+		|| sop==QString("1.2.840.10008.5.1.4.1.1.88.73") // Patient Radiation Dose SR Storage
+		|| sop==QString("1.2.840.10008.5.1.4.1.1.88.74") // Planned Imaging Agent Administration SR Storage
+		|| sop==QString("1.2.840.10008.5.1.4.1.1.88.75") // Performed Imaging Agent Administration SR Storage
+		)
+		*is_softcopy = true;
+}
+
+static void read_tags_short_ds(
+	const mdcm::DataSet & ds,
+	bool * is_image,
+	bool * is_softcopy)
+{
+	if (ds.IsEmpty()) return;
+	bool has_rows         = false;
+	bool has_colums       = false;
+	bool has_bitallocated = false;
+	bool has_pixelrepres  = false;
+	if(ds.FindDataElement(tRows))
+	{
+		const mdcm::DataElement & e = ds.GetDataElement(tRows);
+		if (!e.IsEmpty()) has_rows = true;
+	}
+	if(ds.FindDataElement(tColumns))
+	{
+		const mdcm::DataElement & e = ds.GetDataElement(tColumns);
+		if (!e.IsEmpty()) has_colums = true;
+	}
+	if(ds.FindDataElement(tBitsAllocated))
+	{
+		const mdcm::DataElement & e = ds.GetDataElement(tBitsAllocated);
+		if (!e.IsEmpty()) has_bitallocated = true;
+	}
+	if(ds.FindDataElement(tPixelRepresentation))
+	{
+		const mdcm::DataElement & e = ds.GetDataElement(tPixelRepresentation);
+		if (!e.IsEmpty()) has_pixelrepres = true;
+	}
+	bool is_image_tmp = has_rows && has_colums && has_bitallocated && has_pixelrepres;
+	if (!is_image_tmp)
+	{
+		if (ds.FindDataElement(tSOPClassUID))
+		{
+			const mdcm::DataElement & e = ds.GetDataElement(tSOPClassUID);
+			if (!e.IsEmpty() && !e.IsUndefinedLength() && e.GetByteValue())
+			{
+				const QString sop =
+					QString::fromLatin1(
+						e.GetByteValue()->GetPointer(),
+						e.GetByteValue()->GetLength()).
+							trimmed().remove(QChar('\0'));
+				// RTSTRUCT
+				if (sop == QString("1.2.840.10008.5.1.4.1.1.481.3")) 
+				{
+					is_image_tmp = true;
+				}
+				// Softcopy
+				else if (
+					sop == QString("1.2.840.10008.5.1.4.1.1.11.1") ||
+					sop == QString("1.2.840.10008.5.1.4.1.1.11.2"))
+					*is_softcopy = true;
+			}
+		}
+	}
+	*is_image = is_image_tmp;
+}
+
+static void init_selected_tags(std::set<mdcm::Tag> & tags)
+{
+	tags.insert(mdcm::Tag(0x0008,0x0005));
+	tags.insert(mdcm::Tag(0x0008,0x0016));
+	tags.insert(mdcm::Tag(0x0008,0x0020));
+	tags.insert(mdcm::Tag(0x0008,0x0021));
+	tags.insert(mdcm::Tag(0x0008,0x0060));
+	tags.insert(mdcm::Tag(0x0008,0x1030));
+	tags.insert(mdcm::Tag(0x0008,0x103e));
+	tags.insert(mdcm::Tag(0x0010,0x0010));
+	tags.insert(mdcm::Tag(0x0010,0x0030));
+	tags.insert(mdcm::Tag(0x0020,0x000e));
+	tags.insert(mdcm::Tag(0x0028,0x0010));
+	tags.insert(mdcm::Tag(0x0028,0x0011));
+	tags.insert(mdcm::Tag(0x0028,0x0100));
+	tags.insert(mdcm::Tag(0x0028,0x0103));
+}
+
+// Reads the header of each file once, up to the last selected tag.
+class ScanTask : public ParallelTask
+{
+public:
+	ScanTask(
+		const QStringList & files_,
+		const std::set<mdcm::Tag> & tags_,
+		const ScanIndex & index_,
+		std::vector<ScanFileInfo> & infos_)
+		:
+		files(files_),
+		tags(tags_),
+		index(index_),
+		infos(infos_)
+	{
+	}
+
+	void process(int i) override
+	{
+		ScanFileInfo & info = infos[i];
+		info.file = files.at(i);
+		{
+			const QFileInfo fi(info.file);
+			info.size = fi.size();
+			info.mtime = fi.lastModified().toMSecsSinceEpoch();
+		}
+		if (index.find(info.file, info.size, info.mtime, info)) return;
+		mdcm::Reader reader;
+#ifdef _WIN32
+#if (defined(_MSC_VER) && defined(MDCM_WIN32_UNC))
+		reader.SetFileName(QDir::toNativeSeparators(info.file).toUtf8().constData());
+#else
+		reader.SetFileName(QDir::toNativeSeparators(info.file).toLocal8Bit().constData());
+#endif
+#else
+		reader.SetFileName(info.file.toLocal8Bit().constData());
+#endif
+		try
+		{
+			if (!reader.ReadSelectedTags(tags)) return;
+		}
+		catch (std::exception &)
+		{
+			return;
+		}
+		const mdcm::DataSet & ds = reader.GetFile().GetDataSet();
+		if (ds.FindDataElement(tSeriesInstanceUID))
+		{
+			info.has_series_uid = true;
+			const mdcm::DataElement & e = ds.GetDataElement(tSeriesInstanceUID);
+			if (!e.IsEmpty() && !e.IsUndefinedLength() && e.GetByteValue())
+			{
+				info.series_uid =
+					QString::fromLatin1(e.GetByteValue()->GetPointer(),
+										e.GetByteValue()->GetLength()).trimmed().remove(QChar('\0'));
+			}
+		}
+		read_tags_ds(
+			ds,
+			info.patient,
+			info.birthdate,
+			info.modality,
+			info.study,
+			info.study_date,
+			info.series,
+			info.series_date,
+			&info.is_image,
+			&info.is_softcopy);
+		read_tags_short_ds(ds, &info.is_image_short, &info.is_softcopy_short);
+		info.ok = true;
+	}
+
+private:
+	const QStringList & files;
+	const std::set<mdcm::Tag> & tags;
+	const ScanIndex & index;
+	std::vector<ScanFileInfo> & infos;
+};
+
 mdcm::VL BrowserWidget2::compute_offset0(const mdcm::DataSet & ds)
 {
 	mdcm::VL len = 0;
@@ -97,6 +453,7 @@ void BrowserWidget2::compute_offsets(const mdcm::SequenceOfItems * sq, mdcm::VL
 BrowserWidget2::BrowserWidget2(float si)
 {
 	once = false;
+	saved_ts_name = QString("jpegls");
 	eye_icon  = QIcon(QString(":/bitmaps/eye.svg"));
 	eye2_icon = QIcon(QString(":/bitmaps/eye2.svg"));
 	setupUi(this);
@@ -107,6 +464,7 @@ BrowserWidget2::BrowserWidget2(float si)
 	reload_pushButton->setIconSize(s);
 	meta_pushButton->setIconSize(s);
 	copy_pushButton->setIconSize(s);
+	convert_pushButton->setIconSize(s);
 	load_pushButton->setIconSize(s);
 	//
 	tableWidget->hideColumn(0);
@@ -115,24 +473,7 @@ BrowserWidget2::BrowserWidget2(float si)
 	tableWidget->setColumnWidth(5, 200);
 	tableWidget->setColumnWidth(7, 200);
 	//
-	selected_tags.insert(mdcm::Tag(0x0008,0x0005));
-	selected_tags.insert(mdcm::Tag(0x0008,0x0016));
-	selected_tags.insert(mdcm::Tag(0x0008,0x0020));
-	selected_tags.insert(mdcm::Tag(0x0008,0x0021));
-	selected_tags.insert(mdcm::Tag(0x0008,0x0060));
-	selected_tags.insert(mdcm::Tag(0x0008,0x1030));
-	selected_tags.insert(mdcm::Tag(0x0008,0x103e));
-	selected_tags.insert(mdcm::Tag(0x0010,0x0010));
-	selected_tags.insert(mdcm::Tag(0x0010,0x0030));
-	selected_tags.insert(mdcm::Tag(0x0028,0x0010));
-	selected_tags.insert(mdcm::Tag(0x0028,0x0011));
-	selected_tags.insert(mdcm::Tag(0x0028,0x0100));
-	selected_tags.insert(mdcm::Tag(0x0028,0x0103));
-	selected_tags_short.insert(mdcm::Tag(0x0008,0x0016));
-	selected_tags_short.insert(mdcm::Tag(0x0028,0x0010));
-	selected_tags_short.insert(mdcm::Tag(0x0028,0x0011));
-	selected_tags_short.insert(mdcm::Tag(0x0028,0x0100));
-	selected_tags_short.insert(mdcm::Tag(0x0028,0x0103));
+	init_selected_tags(selected_tags);
 	//
 	readSettings();
 	//
@@ -140,6 +481,7 @@ BrowserWidget2::BrowserWidget2(float si)
 	connect(dicomdir_pushButton, SIGNAL(clicked()), this, SLOT(open_DICOMDIR()));
 	connect(reload_pushButton,   SIGNAL(clicked()), this, SLOT(reload_dir()));
 	connect(copy_pushButton,     SIGNAL(clicked()), this, SLOT(copy_files()));
+	connect(convert_pushButton,  SIGNAL(clicked()), this, SLOT(convert_files()));
 #ifdef USE_WORKSTATION_MODE
 	connect(ctk_pushButton,      SIGNAL(clicked()), this, SLOT(open_CTK_db()));
 #else
@@ -171,12 +513,15 @@ void BrowserWidget2::read_directory(const QString & p)
 	pd->setWindowFlags(
 		pd->windowFlags()^Qt::WindowContextHelpButtonHint);
 	pd->show();
+	const QString index_file = ScanIndex::get_default_file();
+	if (!scan_index.is_loaded()) scan_index.load(index_file);
+	scan_index.begin_scan();
 	try
 	{
-		const mdcm::Global & g = mdcm::GlobalInstance;
-		const mdcm::Dicts & dicts = g.GetDicts();
-		const mdcm::Dict & dict = dicts.GetPublicDict();
-		process_directory(p, dict, pd);
+		process_directory(p, pd);
+		// only unchanged files are not read again next time
+		if (!pd->wasCanceled()) scan_index.end_scan(p);
+		scan_index.save(index_file);
 	}
 	catch(mdcm::ParseException & pe)
 	{
@@ -194,218 +539,234 @@ void BrowserWidget2::read_directory(const QString & p)
 	delete pd;
 }
 
-void BrowserWidget2::process_directory(const QString & p, const mdcm::Dict & dict, QProgressDialog * pd)
+void BrowserWidget2::process_directory(const QString & p, QProgressDialog * pd)
 {
 	if (p.isEmpty()) return;
-	QDir dir(p);
-	QStringList dlist = dir.entryList(QDir::Dirs|QDir::NoDotAndDotDot);
-	QStringList flist = dir.entryList(QDir::Files|QDir::Readable,QDir::Name);
-	std::vector<std::string> filenames;
-	QStringList filenames_no_series_uid;
-	for (int x = 0; x < flist.size(); ++x)
-	{
-		pd->setValue(-1);
-		qApp->processEvents();
-		if (pd->wasCanceled()) return;
-		const QString tmp0 = dir.absolutePath() + QString("/") + flist.at(x);
+	// One walk over the tree, headers are read in batches
+	// on the shared pool, rows are added as series are found.
+	const int batch_size = qMax(64, 16 * ParallelUtils::get_num_threads());
+	QMap<QString, ScanSeriesRow> rows;
+	QStringList files;
+	QStringList dirs;
+	QStringList stack;
+	stack.push_back(p);
+	while (!stack.empty())
+	{
+		QDir dir(stack.takeLast());
+		const QString dir_path = dir.absolutePath();
+		const QStringList dlist = dir.entryList(QDir::Dirs|QDir::NoDotAndDotDot);
+		const QStringList flist = dir.entryList(QDir::Files|QDir::Readable,QDir::Name);
+		for (int x = dlist.size() - 1; x >= 0; --x)
 		{
-			mdcm::Reader reader;
-#ifdef _WIN32
-#if (defined(_MSC_VER) && defined(MDCM_WIN32_UNC))
-			reader.SetFileName(QDir::toNativeSeparators(tmp0).toUtf8().constData());
-#else
-			reader.SetFileName(QDir::toNativeSeparators(tmp0).toLocal8Bit().constData());
-#endif
-#else
-			reader.SetFileName(tmp0.toLocal8Bit().constData());
-#endif
-			if (reader.ReadUpToTag(tSeriesInstanceUID))
+			stack.push_back(dir_path + QString("/") + dlist.at(x));
+		}
+		for (int x = 0; x < flist.size(); ++x)
+		{
+			files.push_back(dir_path + QString("/") + flist.at(x));
+			dirs.push_back(dir_path);
+			if (files.size() >= batch_size)
 			{
-				const mdcm::DataSet & ds = reader.GetFile().GetDataSet();
-				if (ds.FindDataElement(tSeriesInstanceUID))
-				{
-#ifdef _WIN32
-#if (defined(_MSC_VER) && defined(MDCM_WIN32_UNC))
-					filenames.push_back(std::string(QDir::toNativeSeparators(tmp0).toUtf8().constData()));
-#else
-					filenames.push_back(std::string(QDir::toNativeSeparators(tmp0).toLocal8Bit().constData()));
-#endif
-#else
-					filenames.push_back(std::string(tmp0.toLocal8Bit().constData()));
-#endif
-				}
-				else
-				{
-					filenames_no_series_uid.push_back(tmp0);
-				}
+				scan_files(files, dirs, rows, pd);
+				files.clear();
+				dirs.clear();
+				if (pd->wasCanceled()) return;
 			}
 		}
-	}
-	flist.clear();
-	//
-	{
-		mdcm::SmartPointer<mdcm::Scanner> sp = new mdcm::Scanner;
-		mdcm::Scanner & s0 = *sp;
-		ScannerWatcher sw(&s0);
-		s0.AddTag(tSeriesInstanceUID);
-		s0.Scan(filenames, dict);
 		pd->setValue(-1);
 		qApp->processEvents();
 		if (pd->wasCanceled()) return;
-		mdcm::Scanner::ValuesType v = s0.GetValues();
-		mdcm::Scanner::ValuesType::iterator vi = v.begin();
-		for (; vi!=v.end(); ++vi)
+	}
+	if (!files.empty()) scan_files(files, dirs, rows, pd);
+}
+
+void BrowserWidget2::scan_files(
+	const QStringList & files,
+	const QStringList & dirs,
+	QMap<QString, ScanSeriesRow> & rows,
+	QProgressDialog * pd)
+{
+	std::vector<ScanFileInfo> infos(files.size());
+	{
+		ScanTask t(files, selected_tags, scan_index, infos);
+		ParallelUtils::run(&t, files.size());
+	}
+	for (size_t x = 0; x < infos.size(); ++x)
+	{
+		const ScanFileInfo & info = infos.at(x);
+		scan_index.insert(info);
+		if (!info.ok) continue;
+		if (!info.has_series_uid)
 		{
-			QString modality    = QString("");
-			QString name        = QString("");
-			QString birthdate   = QString("");
-			QString study       = QString("");
-			QString study_date  = QString("");
-			QString series      = QString("");
-			QString series_date = QString("");
-			bool is_image       = false;
-			bool is_softcopy  = false;
-			const int idx = tableWidget->rowCount();
-			QString ids;
-#if QT_VERSION >= QT_VERSION_CHECK(5,14,0)
-			ids = QString::asprintf("%010d", idx);
-#else
-			ids.sprintf("%010d", idx);
-#endif
-			TableWidgetItem * i = new TableWidgetItem(ids);
-			std::vector<std::string> files__(
-				s0.GetAllFilenamesFromTagToValue(
-					tSeriesInstanceUID, (*vi).c_str()));
-			for (unsigned int z = 0; z < files__.size(); ++z)
+			ScanSeriesRow r;
+			add_scan_row(info, r);
+			continue;
+		}
+		// series are grouped per directory
+		const QString key = dirs.at(x) + QString("\n") + info.series_uid;
+		if (!rows.contains(key))
+		{
+			ScanSeriesRow r;
+			add_scan_row(info, r);
+			rows[key] = r;
+			continue;
+		}
+		ScanSeriesRow & r = rows[key];
+		r.item->files.push_back(info.file);
+		tableWidget->item(r.row, 9)->setText(QVariant(r.item->files.size()).toString());
+		if (!r.done)
+		{
+			if (info.is_image_short)
 			{
-
-				const QString tmp_filename =
-#if (defined(_MSC_VER) && defined(MDCM_WIN32_UNC))
-					QString::fromUtf8(files__.at(z).c_str());
-#else
-					QString::fromLocal8Bit(files__.at(z).c_str());
-#endif
-				i->files.push_back(tmp_filename);
+				r.is_image = true;
+				r.done = true;
 			}
-			const unsigned int series_size = i->files.size();
-			if (series_size > 0) read_tags_(
-				i->files.at(0),
-				name,birthdate,
-				modality,
-				study,study_date,
-				series,series_date,
-				&is_image,&is_softcopy);
-			pd->setValue(-1);
-			qApp->processEvents();
-			if (pd->wasCanceled()) return;
-			//
-			if (!is_image && series_size > 1)
+			else
 			{
-				size_t series_idx = 0;
-				do
-				{
-					++series_idx;
-					qApp->processEvents();
-					if (pd->wasCanceled()) return;
-					bool is_image_tmp = false;
-					read_tags_short_(
-						i->files.at(series_idx),
-						&is_image_tmp,&is_softcopy);
-					if (is_image_tmp) { is_image = true; break; }
-					else if (is_softcopy) { break; }
-				}
-				while (series_idx < (series_size - 1));
+				if (info.is_softcopy_short) r.is_softcopy = true;
+				if (r.is_softcopy) r.done = true;
 			}
-			//
-			tableWidget->setRowCount(idx + 1);
-			tableWidget->setItem(idx,0,static_cast<QTableWidgetItem*>(i));
-			if (is_image)
+			if (r.is_image)
 			{
-				tableWidget->setItem(idx,1,new QTableWidgetItem(eye_icon,QString("")));
+				tableWidget->setItem(r.row,1,new QTableWidgetItem(eye_icon,QString("")));
 			}
-			else if (is_softcopy)
+			else if (r.is_softcopy)
 			{
-				tableWidget->setItem(idx,1,new QTableWidgetItem(eye2_icon,QString("")));
+				tableWidget->setItem(r.row,1,new QTableWidgetItem(eye2_icon,QString("")));
 			}
-			tableWidget->setItem(idx,2,new QTableWidgetItem(modality));
-			tableWidget->setItem(idx,3,new QTableWidgetItem(
-				DicomUtils::convert_pn_value(name.remove(QChar('\0')))));
-			tableWidget->setItem(idx,4,new QTableWidgetItem(birthdate));
-			tableWidget->setItem(idx,5,new QTableWidgetItem(study.remove(QChar('\0'))));
-			tableWidget->setItem(idx,6,new QTableWidgetItem(study_date));
-			tableWidget->setItem(idx,7,new QTableWidgetItem(series.remove(QChar('\0'))));
-			tableWidget->setItem(idx,8,new QTableWidgetItem(series_date));
-			tableWidget->setItem(idx,9,new QTableWidgetItem(QVariant(i->files.size()).toString()));
-			//
-			pd->setValue(-1);
-			qApp->processEvents();
-			if (pd->wasCanceled()) return;
 		}
 	}
-	//
-	for (int x = 0; x < filenames_no_series_uid.size(); ++x)
-	{
-		const QString tmp1 = filenames_no_series_uid.at(x);
-		QString modality    = QString("");
-		QString name        = QString("");
-		QString birthdate   = QString("");
-		QString study       = QString("");
-		QString study_date  = QString("");
-		QString series      = QString("");
-		QString series_date = QString("");
-		bool is_image       = false;
-		bool is_softcopy    = false;
-		const int idx = tableWidget->rowCount();
-		QString ids;
-#if QT_VERSION >= QT_VERSION_CHECK(5,14,0)
-		ids = QString::asprintf("%010d", idx);
-#else
-		ids.sprintf("%010d", idx);
-#endif
-		TableWidgetItem * i = new TableWidgetItem(ids);
-		i->files.push_back(tmp1);
-		read_tags_(
-			tmp1,
-			name,birthdate,
-			modality,
-			study,study_date,
-			series,series_date,
-			&is_image,&is_softcopy);
-		tableWidget->setRowCount(idx+1);
-		tableWidget->setItem(idx,0,static_cast<QTableWidgetItem*>(i));
-		if (is_image)
+	pd->setValue(-1);
+	qApp->processEvents();
+}
+
+int BrowserWidget2::scan_headless(const QString & p, const QString & out)
+{
+	const QFileInfo in_fi(p);
+	if (p.isEmpty() || !in_fi.isDir())
+	{
+		std::cout << "Error: input is not a directory" << std::endl;
+		return 1;
+	}
+	const QString in_path = in_fi.absoluteFilePath();
+	const bool csv = out.endsWith(QString(".csv"), Qt::CaseInsensitive);
+	// an existing index is updated, unchanged files are not read again
+	ScanIndex index;
+	if (!csv) index.load(out);
+	index.begin_scan();
+	std::set<mdcm::Tag> tags;
+	init_selected_tags(tags);
+	const int batch_size = qMax(64, 16 * ParallelUtils::get_num_threads());
+	qint64 count_files = 0;
+	qint64 count_dicom = 0;
+	qint64 last_print = 0;
+	QSet<QString> series;
+	QElapsedTimer timer;
+	timer.start();
+	QStringList files;
+	QStringList stack;
+	stack.push_back(in_path);
+	while (!stack.empty() || !files.empty())
+	{
+		if (!stack.empty())
 		{
-			tableWidget->setItem(idx,1,new QTableWidgetItem(eye_icon,QString("")));
+			QDir dir(stack.takeLast());
+			const QString dir_path = dir.absolutePath();
+			const QStringList dlist = dir.entryList(QDir::Dirs|QDir::NoDotAndDotDot);
+			const QStringList flist = dir.entryList(QDir::Files|QDir::Readable,QDir::Name);
+			for (int x = dlist.size() - 1; x >= 0; --x)
+			{
+				stack.push_back(dir_path + QString("/") + dlist.at(x));
+			}
+			for (int x = 0; x < flist.size(); ++x)
+			{
+				files.push_back(dir_path + QString("/") + flist.at(x));
+			}
+			if (files.size() < batch_size && !stack.empty()) continue;
 		}
-		else if (is_softcopy)
+		if (files.empty()) continue;
+		std::vector<ScanFileInfo> infos(files.size());
 		{
-			tableWidget->setItem(idx,1,new QTableWidgetItem(eye2_icon,QString("")));
+			ScanTask t(files, tags, index, infos);
+			ParallelUtils::run(&t, files.size());
+		}
+		for (size_t x = 0; x < infos.size(); ++x)
+		{
+			const ScanFileInfo & info = infos.at(x);
+			index.insert(info);
+			if (!info.ok) continue;
+			++count_dicom;
+			if (info.has_series_uid)
+			{
+				series.insert(QFileInfo(info.file).absolutePath() + QString("\n") + info.series_uid);
+			}
+		}
+		count_files += files.size();
+		files.clear();
+		const qint64 ms = timer.elapsed();
+		if (ms - last_print >= 1000)
+		{
+			std::cout << count_files << " files, "
+				<< (count_files / (ms * 0.001)) << " files/s" << std::endl;
+			last_print = ms;
 		}
-		tableWidget->setItem(idx,2,new QTableWidgetItem(modality));
-		tableWidget->setItem(idx,3,new QTableWidgetItem(
-			DicomUtils::convert_pn_value(name.remove(QChar('\0')))));
-		tableWidget->setItem(idx,4,new QTableWidgetItem(birthdate));
-		tableWidget->setItem(idx,5,new QTableWidgetItem(study.remove(QChar('\0'))));
-		tableWidget->setItem(idx,6,new QTableWidgetItem(study_date));
-		tableWidget->setItem(idx,7,new QTableWidgetItem(series.remove(QChar('\0'))));
-		tableWidget->setItem(idx,8,new QTableWidgetItem(series_date));
-		tableWidget->setItem(idx,9,new QTableWidgetItem(QString("1")));
-		pd->setValue(-1);
-		qApp->processEvents();
-		if (pd->wasCanceled()) return;
 	}
-	filenames.clear();
-	filenames_no_series_uid.clear();
-	//
-	if (!pd->wasCanceled())
+	index.end_scan(in_path);
+	const bool ok = csv ? index.export_csv(out) : index.save(out);
+	const double seconds = timer.elapsed() * 0.001;
+	std::cout << "Scanned " << count_files << " files ("
+		<< count_dicom << " DICOM, " << series.size() << " series) in "
+		<< seconds << " s";
+	if (seconds > 0.0)
+	{
+		std::cout << ", " << (count_files / seconds) << " files/s";
+	}
+	std::cout << std::endl;
+	if (!ok)
 	{
-		for (int j = 0; j < dlist.size(); ++j)
-			process_directory(
-				dir.absolutePath() + QString("/") + dlist.at(j),
-				dict,
-				pd);
+		std::cout << "Error: can not write " << out.toStdString() << std::endl;
+		return 1;
 	}
-	dlist.clear();
+	return 0;
+}
+
+void BrowserWidget2::add_scan_row(const ScanFileInfo & info, ScanSeriesRow & r)
+{
+	const int idx = tableWidget->rowCount();
+	QString ids;
+#if QT_VERSION >= QT_VERSION_CHECK(5,14,0)
+	ids = QString::asprintf("%010d", idx);
+#else
+	ids.sprintf("%010d", idx);
+#endif
+	TableWidgetItem * i = new TableWidgetItem(ids);
+	i->files.push_back(info.file);
+	QString name   = info.patient;
+	QString study  = info.study;
+	QString series = info.series;
+	r.item = i;
+	r.row = idx;
+	r.is_image = info.is_image;
+	r.is_softcopy = info.is_softcopy;
+	r.done = info.is_image;
+	tableWidget->setRowCount(idx + 1);
+	tableWidget->setItem(idx,0,static_cast<QTableWidgetItem*>(i));
+	if (r.is_image)
+	{
+		tableWidget->setItem(idx,1,new QTableWidgetItem(eye_icon,QString("")));
+	}
+	else if (r.is_softcopy)
+	{
+		tableWidget->setItem(idx,1,new QTableWidgetItem(eye2_icon,QString("")));
+	}
+	tableWidget->setItem(idx,2,new QTableWidgetItem(info.modality));
+	tableWidget->setItem(idx,3,new QTableWidgetItem(
+		DicomUtils::convert_pn_value(name.remove(QChar('\0')))));
+	tableWidget->setItem(idx,4,new QTableWidgetItem(info.birthdate));
+	tableWidget->setItem(idx,5,new QTableWidgetItem(study.remove(QChar('\0'))));
+	tableWidget->setItem(idx,6,new QTableWidgetItem(info.study_date));
+	tableWidget->setItem(idx,7,new QTableWidgetItem(series.remove(QChar('\0'))));
+	tableWidget->setItem(idx,8,new QTableWidgetItem(info.series_date));
+	tableWidget->setItem(idx,9,new QTableWidgetItem(QString("1")));
 }
 
 void BrowserWidget2::open_dicom_dir()
@@ -684,6 +1045,108 @@ void BrowserWidget2::copy_files()
 	QApplication::restoreOverrideCursor();
 }
 
+void BrowserWidget2::convert_files()
+{
+	static unsigned long long count3 = 0;
+	std::vector<int> rows;
+	QModelIndexList selection =
+		tableWidget->selectionModel()->selectedRows();
+	for(int x = 0; x < selection.count(); ++x)
+	{
+		const QModelIndex index = selection.at(x);
+		rows.push_back(index.row());
+	}
+	if (rows.empty()) return;
+	const QStringList names = Transcoder::get_transfer_syntax_names();
+	bool ok = false;
+	const QString ts_name = QInputDialog::getItem(
+		this,
+		QString("Convert"),
+		QString("Transfer syntax"),
+		names,
+		qMax(0, names.indexOf(saved_ts_name)),
+		false,
+		&ok);
+	if (!ok || ts_name.isEmpty()) return;
+	const mdcm::TransferSyntax::TSType tst =
+		Transcoder::find_transfer_syntax(ts_name);
+	if (tst == mdcm::TransferSyntax::TS_END) return;
+	saved_ts_name = ts_name;
+	const QString dirname = QFileDialog::getExistingDirectory(
+		this,
+		QString("Select Destination Directory"),
+		saved_copy_dir,
+		(QFileDialog::ShowDirsOnly));
+	if (dirname.isEmpty()) return;
+	saved_copy_dir = dirname;
+	// same layout as copy_files(), a directory per series
+	QStringList in_files;
+	QStringList out_files;
+	for (unsigned int x = 0; x < rows.size(); ++x)
+	{
+		const int row = rows.at(x);
+		if (row < 0) continue;
+		const TableWidgetItem * item =
+			static_cast<TableWidgetItem *>(tableWidget->item(row, 0));
+		if (!item) continue;
+		if ((item->files.empty())) continue;
+		++count3;
+		const QString tmp1 =
+			QDateTime::currentDateTime()
+				.toString(QString("yyyyMMddhhmmsszzz")) +
+			QString("-") +
+			QVariant(count3).toString();
+		QDir d(dirname);
+		if (!d.exists(tmp1)) d.mkdir(tmp1);
+		for (int y = 0; y < item->files.size(); ++y)
+		{
+			const QString f = item->files.at(y);
+			QFileInfo fi(f);
+			if (!fi.exists()) continue;
+			in_files.push_back(f);
+			out_files.push_back(
+				dirname + QString("/") + tmp1 + QString("/") + fi.fileName());
+		}
+	}
+	if (in_files.empty()) return;
+	QProgressDialog * pd =
+		new QProgressDialog(QString("Converting"),QString("Stop"),0,0);
+	pd->setWindowModality(Qt::ApplicationModal);
+	pd->setWindowFlags(
+		pd->windowFlags()^Qt::WindowContextHelpButtonHint);
+	pd->show();
+	TranscodeStats stats;
+	Transcoder::transcode_files(
+		in_files, out_files, mdcm::TransferSyntax(tst), pd, stats);
+	pd->close();
+	qApp->processEvents();
+	delete pd;
+	QString message =
+		QString("Converted ") + QVariant(stats.converted).toString() +
+		QString(", copied ") + QVariant(stats.copied).toString() +
+		QString("\n") + stats.to_string();
+	if (stats.kept_original > 0)
+	{
+		message.append(
+			QString("\n") + QVariant(stats.kept_original).toString() +
+			QString(" file(s) not converted, originals copied"));
+	}
+	if (stats.failed > 0)
+	{
+		message.append(
+			QString("\nWarning: ") + QVariant(stats.failed).toString() +
+			QString(" file(s) failed, missing in output:"));
+		const int n = qMin(stats.failed_files.size(), 10);
+		for (int x = 0; x < n; ++x)
+		{
+			message.append(QString("\n") + stats.failed_files.at(x));
+		}
+		if (stats.failed_files.size() > n)
+			message.append(QString("\n..."));
+	}
+	QMessageBox::information(NULL, QString("Convert"), message);
+}
+
 void BrowserWidget2::open_DICOMDIR()
 {
 	QFileInfo fi(directory_lineEdit->text());
@@ -1233,272 +1696,6 @@ unsigned int BrowserWidget2::add_file(
 	return e.offsetOfTheNextDirectoryRecord;
 }
 
-void BrowserWidget2::read_tags_(
-	const QString & f,
-	QString & patient_name_,
-	QString & birthdate_,
-	QString & modality_,
-	QString & studydesc_,
-	QString & study_date_,
-	QString & seriesdesc_,
-	QString & series_date_,
-	bool * is_image,
-	bool * is_softcopy)
-{
-	mdcm::Reader reader;
-#ifdef _WIN32
-#if (defined(_MSC_VER) && defined(MDCM_WIN32_UNC))
-	reader.SetFileName(QDir::toNativeSeparators(f).toUtf8().constData());
-#else
-	reader.SetFileName(QDir::toNativeSeparators(f).toLocal8Bit().constData());
-#endif
-#else
-	reader.SetFileName(f.toLocal8Bit().constData());
-#endif
-	bool f_ok = reader.ReadSelectedTags(selected_tags);
-	if (!f_ok) return;
-	const mdcm::DataSet & ds = reader.GetFile().GetDataSet();
-	if (ds.IsEmpty()) return;
-	QString charset = QString("");
-	QString sop = QString("");
-	//
-	if(ds.FindDataElement(tSpecificCharacterSet))
-	{
-		const mdcm::DataElement & e = ds.GetDataElement(tSpecificCharacterSet);
-		if (!e.IsEmpty() && !e.IsUndefinedLength() && e.GetByteValue())
-			charset =
-				QString::fromLatin1(e.GetByteValue()->GetPointer(),e.GetByteValue()->GetLength());
-	}
-	//
-	if (ds.FindDataElement(tSOPClassUID))
-	{
-		const mdcm::DataElement & e = ds.GetDataElement(tSOPClassUID);
-		if (!e.IsEmpty() && !e.IsUndefinedLength() && e.GetByteValue())
-		{
-			sop =
-				QString::fromLatin1(e.GetByteValue()->GetPointer(),
-									e.GetByteValue()->GetLength()).trimmed().remove(QChar('\0'));
-		}
-	}
-	//
-	if(ds.FindDataElement(tStudyDate))
-	{
-		const mdcm::DataElement & e = ds.GetDataElement(tStudyDate);
-		if (!e.IsEmpty() && !e.IsUndefinedLength() && e.GetByteValue())
-		{
-			const QString date_s =
-				QString::fromLatin1(e.GetByteValue()->GetPointer(),
-									e.GetByteValue()->GetLength()).trimmed();
-			const QDate qd = QDate::fromString(date_s, QString("yyyyMMdd"));
-			study_date_ = qd.toString(QString("d MMM yyyy")) + QString("\n");
-		}
-	}
-	//
-	if (ds.FindDataElement(tModality))
-	{
-		const mdcm::DataElement & e = ds.GetDataElement(tModality);
-		if (!e.IsEmpty() && !e.IsUndefinedLength() && e.GetByteValue())
-		{
-			modality_ =
-				QString::fromLatin1(e.GetByteValue()->GetPointer(),e.GetByteValue()->GetLength());
-		}
-	}
-	//
-	if(ds.FindDataElement(tStudyDescription))
-	{
-		const mdcm::DataElement & e = ds.GetDataElement(tStudyDescription);
-		if (!e.IsEmpty() && !e.IsUndefinedLength() && e.GetByteValue())
-		{
-			QByteArray ba(e.GetByteValue()->GetPointer(), e.GetByteValue()->GetLength());
-			const QString tmp0 = CodecUtils::toUTF8(&ba, charset.toLatin1().constData());
-			if (!tmp0.isEmpty()) studydesc_ = tmp0.simplified();
-		}
-	}
-	//
-	if(ds.FindDataElement(tSeriesDescription))
-	{
-		const mdcm::DataElement & e = ds.GetDataElement(tSeriesDescription);
-		if (!e.IsEmpty() && !e.IsUndefinedLength() && e.GetByteValue())
-		{
-			QByteArray ba(e.GetByteValue()->GetPointer(), e.GetByteValue()->GetLength());
-			const QString tmp0 = CodecUtils::toUTF8(&ba, charset.toLatin1().constData());
-			if (!tmp0.isEmpty()) seriesdesc_ = tmp0.simplified();
-		}
-	}
-	//
-	if(ds.FindDataElement(tSeriesDate))
-	{
-		const mdcm::DataElement & e = ds.GetDataElement(tSeriesDate);
-		if (!e.IsEmpty() && !e.IsUndefinedLength() && e.GetByteValue())
-		{
-			const QString date_s =
-				QString::fromLatin1(e.GetByteValue()->GetPointer(),
-									e.GetByteValue()->GetLength()).trimmed();
-			const QDate qd = QDate::fromString(date_s, QString("yyyyMMdd"));
-			series_date_ = qd.toString(QString("d MMM yyyy")) + QString("\n");
-		}
-	}
-	//
-	if(ds.FindDataElement(tPatientsName))
-	{
-		const mdcm::DataElement & e = ds.GetDataElement(tPatientsName);
-		if (!e.IsEmpty() && !e.IsUndefinedLength() && e.GetByteValue())
-		{
-			QByteArray ba(e.GetByteValue()->GetPointer(), e.GetByteValue()->GetLength());
-			const QString tmp0 = CodecUtils::toUTF8(&ba, charset.toLatin1().constData());
-			if (!tmp0.isEmpty()) patient_name_ = tmp0;
-		}
-	}
-	//
-	if(ds.FindDataElement(tPatientsBirthDate))
-	{
-		const mdcm::DataElement & e = ds.GetDataElement(tPatientsBirthDate);
-		std::stringstream ss;
-		if (!e.IsEmpty() && !e.IsUndefinedLength() && e.GetByteValue())
-		{
-			const QString birthdate_s =
-				QString::fromLatin1(e.GetByteValue()->GetPointer(),
-									e.GetByteValue()->GetLength()).trimmed();
-			const QDate qd = QDate::fromString(birthdate_s, QString("yyyyMMdd"));
-			birthdate_ = qd.toString(QString("d MMM yyyy")) + QString("\n");
-		}
-	}
-	//
-	bool has_rows         = false;
-	bool has_colums       = false;
-	bool has_bitallocated = false;
-	if(ds.FindDataElement(tRows))
-	{
-		const mdcm::DataElement & e = ds.GetDataElement(tRows);
-		if (!e.IsEmpty()) has_rows = true;
-	}
-	if(ds.FindDataElement(tColumns))
-	{
-		const mdcm::DataElement & e = ds.GetDataElement(tColumns);
-		if (!e.IsEmpty()) has_colums = true;
-	}
-	if(ds.FindDataElement(tBitsAllocated))
-	{
-		const mdcm::DataElement & e = ds.GetDataElement(tBitsAllocated);
-		if (!e.IsEmpty()) has_bitallocated = true;
-	}
-	bool is_image_tmp = has_rows && has_colums && has_bitallocated;
-	//
-	// RTSTRUCT, spectroscopy, meshes
-	if (sop==QString("1.2.840.10008.5.1.4.1.1.481.3") ||
-		sop==QString("1.2.840.10008.5.1.4.1.1.4.2")   ||
-		sop==QString("1.2.840.10008.5.1.4.1.1.68.1")  ||
-		sop==QString("1.2.840.10008.5.1.4.1.1.66.5"))
-		is_image_tmp = true;
-	*is_image = is_image_tmp;
-	// Presentation, SR
-	if (   sop==QString("1.2.840.10008.5.1.4.1.1.11.1")  // Grayscale Softcopy Presentation State Storage
-#if 0
-		|| sop==QString("1.2.840.10008.5.1.4.1.1.11.2")  // Color Softcopy Presentation State Storage
-		|| sop==QString("1.2.840.10008.5.1.4.1.1.11.3")  // Pseudo-Color Softcopy Presentation State Storage
-		|| sop==QString("1.2.840.10008.5.1.4.1.1.11.4")  // Blending Softcopy Presentation State Storage
-		|| sop==QString("1.2.840.10008.5.1.4.1.1.11.5")  // XA/XRF Grayscale Softcopy Presentation State Storage
-		|| sop==QString("1.2.840.10008.5.1.4.1.1.11.6")  // Grayscale Planar MPR Volumetric Presentation State Storage
-		|| sop==QString("1.2.840.10008.5.1.4.1.1.11.7")  // Compositing Planar MPR Volumetric Presentation State Storage
-		|| sop==QString("1.2.840.10008.5.1.4.1.1.11.8")  // Advanced Blending Presentation State Storage
-		|| sop==QString("1.2.840.10008.5.1.4.1.1.11.9")  // Volume Rendering Volumetric Presentation State Storage
-		|| sop==QString("1.2.840.10008.5.1.4.1.1.11.10") // Segmented Volume Rendering Volumetric Presentation State Storage
-		|| sop==QString("1.2.840.10008.5.1.4.1.1.11.11") // Multiple Volume Rendering Volumetric Presentation State Storage
-#endif
-		|| sop==QString("1.2.840.10008.5.1.4.1.1.88.11") // Basic Text SR Storage
-		|| sop==QString("1.2.840.10008.5.1.4.1.1.88.22") // Enhanced SR Storage
-		|| sop==QString("1.2.840.10008.5.1.4.1.1.88.33") // Comprehensive SR Storage
-		|| sop==QString("1.2.840.10008.5.1.4.1.1.88.34") // Comprehensive 3D SR Storage
-		|| sop==QString("1.2.840.10008.5.1.4.1.1.88.35") // Extensible SR Storage
-		|| sop==QString("1.2.840.10008.5.1.4.1.1.88.40") // Procedure Log Storage
-		|| sop==QString("1.2.840.10008.5.1.4.1.1.88.50") // Mammography CAD SR Storage
-		|| sop==QString("1.2.840.10008.5.1.4.1.1.88.59") // Key Object Selection Storage
-		|| sop==QString("1.2.840.10008.5.1.4.1.1.88.65") // Chest CAD SR Storage
-		|| sop==QString("1.2.840.10008.5.1.4.1.1.88.67") // X-Ray Radiation Dose SR Storage
-		|| sop==QString("1.2.840.10008.5.1.4.1.1.88.68") // Radiopharmaceutical Radiation Dose SR Storage
-		|| sop==QString("1.2.840.10008.5.1.4.1.1.88.69") // Colon CAD SR Storage
-		|| sop==QString("1.2.840.10008.5.1.4.1.1.88.70") // Implantation Plan SR Document Storage
-		|| sop==QString("1.2.840.10008.5.1.4.1.1.88.71") // Acquisition Context SR Storage
-		|| sop==QString("1.2.840.10008.5.1.4.1.1.88.72") // Simplified Adult Echo SR Storage
-		|| sop==QString("1.2.840.10008.5.1.4.1.1.88.73") // Patient Radiation Dose SR Storage
-		|| sop==QString("1.2.840.10008.5.1.4.1.1.88.74") // Planned Imaging Agent Administration SR Storage
-		|| sop==QString("1.2.840.10008.5.1.4.1.1.88.75") // Performed Imaging Agent Administration SR Storage
-		)
-		*is_softcopy = true;
-}
-
-void BrowserWidget2::read_tags_short_(
-	const QString & f,
-	bool * is_image,
-	bool * is_softcopy)
-{
-	mdcm::Reader reader;
-#ifdef _WIN32
-#if (defined(_MSC_VER) && defined(MDCM_WIN32_UNC))
-	reader.SetFileName(QDir::toNativeSeparators(f).toUtf8().constData());
-#else
-	reader.SetFileName(QDir::toNativeSeparators(f).toLocal8Bit().constData());
-#endif
-#else
-	reader.SetFileName(f.toLocal8Bit().constData());
-#endif
-	bool f_ok = reader.ReadSelectedTags(selected_tags_short);
-	if (!f_ok) return;
-	const mdcm::DataSet & ds = reader.GetFile().GetDataSet();
-	if (ds.IsEmpty()) return;
-	bool has_rows         = false;
-	bool has_colums       = false;
-	bool has_bitallocated = false;
-	bool has_pixelrepres  = false;
-	if(ds.FindDataElement(tRows))
-	{
-		const mdcm::DataElement & e = ds.GetDataElement(tRows);
-		if (!e.IsEmpty()) has_rows = true;
-	}
-	if(ds.FindDataElement(tColumns))
-	{
-		const mdcm::DataElement & e = ds.GetDataElement(tColumns);
-		if (!e.IsEmpty()) has_colums = true;
-	}
-	if(ds.FindDataElement(tBitsAllocated))
-	{
-		const mdcm::DataElement & e = ds.GetDataElement(tBitsAllocated);
-		if (!e.IsEmpty()) has_bitallocated = true;
-	}
-	if(ds.FindDataElement(tPixelRepresentation))
-	{
-		const mdcm::DataElement & e = ds.GetDataElement(tPixelRepresentation);
-		if (!e.IsEmpty()) has_pixelrepres = true;
-	}
-	bool is_image_tmp = has_rows && has_colums && has_bitallocated && has_pixelrepres;
-	if (!is_image_tmp)
-	{
-		if (ds.FindDataElement(tSOPClassUID))
-		{
-			const mdcm::DataElement & e = ds.GetDataElement(tSOPClassUID);
-			if (!e.IsEmpty() && !e.IsUndefinedLength() && e.GetByteValue())
-			{
-				const QString sop =
-					QString::fromLatin1(
-						e.GetByteValue()->GetPointer(),
-						e.GetByteValue()->GetLength()).
-							trimmed().remove(QChar('\0'));
-				// RTSTRUCT
-				if (sop == QString("1.2.840.10008.5.1.4.1.1.481.3")) 
-				{
-					is_image_tmp = true;
-				}
-				// Softcopy
-				else if (
-					sop == QString("1.2.840.10008.5.1.4.1.1.11.1") ||
-					sop == QString("1.2.840.10008.5.1.4.1.1.11.2"))
-					*is_softcopy = true;
-			}
-		}
-	}
-	*is_image = is_image_tmp;
-}
-
 void BrowserWidget2::writeSettings(QSettings & settings)
 {
 #ifdef USE_WORKSTATION_MODE
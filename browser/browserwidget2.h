@@ -17,29 +17,11 @@
 #include <set>
 #include "mdcmTag.h"
 #include "mdcmVL.h"
-#include "mdcmSimpleSubjectWatcher.h"
-#include "mdcmEvent.h"
 #include "mdcmDataSet.h"
 #include "mdcmDict.h"
+#include "scanindex.h"
 
-class ScannerWatcher : public mdcm::SimpleSubjectWatcher
-{
-public:
-	ScannerWatcher(mdcm::Subject * s, const char * comment = "") : mdcm::SimpleSubjectWatcher(s, comment) {}
-	void StartFilter() override
-	{
-		QApplication::processEvents();
-	}
-	void EndFilter() override
-	{
-		QApplication::processEvents();
-	}
-	void ShowProgress(mdcm::Subject*, const mdcm::Event&) override
-	{
-		QApplication::processEvents();
-	}
-	void ShowFileName(mdcm::Subject*, const mdcm::Event&) override {}
-};
+class ScanSeriesRow;
 
 class EntryDICOMDIR
 {
@@ -99,6 +81,10 @@ public:
 	const QString read_DICOMDIR(const QString&);
 	QStringList   get_files_of_1st();
 	void          writeSettings(QSettings&);
+	// Batch mode, recursive scan of the directory into the index
+	// file (or CSV table if the name ends with ".csv"), progress
+	// is printed to stdout, returns the exit code.
+	static int    scan_headless(const QString&, const QString&);
 
 protected:
 	void closeEvent(QCloseEvent*) override;
@@ -115,6 +101,7 @@ public slots:
 	void reload_dir();
 	void open_dicom_dir();
 	void copy_files();
+	void convert_files();
 	void open_DICOMDIR();
 #ifdef USE_WORKSTATION_MODE
 	void open_CTK_db();
@@ -123,16 +110,23 @@ public slots:
 private:
 	bool once;
 	QString saved_copy_dir;
+	QString saved_ts_name;
 	QIcon eye_icon;
 	QIcon eye2_icon;
 	std::set<mdcm::Tag> selected_tags;
-	std::set<mdcm::Tag> selected_tags_short;
+	ScanIndex scan_index;
 	mdcm::VL compute_offset0(const mdcm::DataSet&);
 	void compute_offsets(
 		const mdcm::SequenceOfItems*,
 		mdcm::VL,
 		std::vector<unsigned int> &);
-	void process_directory(const QString&, const mdcm::Dict&, QProgressDialog*);
+	void process_directory(const QString&, QProgressDialog*);
+	void scan_files(
+		const QStringList&,
+		const QStringList&,
+		QMap<QString, ScanSeriesRow>&,
+		QProgressDialog*);
+	void add_scan_row(const ScanFileInfo&, ScanSeriesRow&);
 	unsigned int add_roots(
 		const QMap<unsigned int, EntryDICOMDIR> &,
 		unsigned int,
@@ -158,12 +152,6 @@ private:
 		const QMap<unsigned int, EntryDICOMDIR> &,
 		unsigned int,
 		SeriesDICOMDIR&);
-	void read_tags_(
-		const QString &,
-		QString&,QString&,QString&,
-		QString&,QString&,QString&,QString&,
-		bool*,bool*);
-	void read_tags_short_(const QString&, bool*, bool*);
 #ifdef USE_WORKSTATION_MODE
 	QString ctk_dir;
 	QString ctk_pname;
@@ -0,0 +1,227 @@
+#include "scanindex.h"
+#include <QApplication>
+#include <QSettings>
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QDataStream>
+#include <QByteArray>
+
+namespace
+{
+
+const quint32 scan_index_magic   = 0x414c5a49;
+const quint32 scan_index_version = 1;
+
+void write_info(QDataStream & out, const ScanFileInfo & i)
+{
+	quint8 flags = 0;
+	if (i.ok)                flags |= 0x01;
+	if (i.has_series_uid)    flags |= 0x02;
+	if (i.is_image)          flags |= 0x04;
+	if (i.is_softcopy)       flags |= 0x08;
+	if (i.is_image_short)    flags |= 0x10;
+	if (i.is_softcopy_short) flags |= 0x20;
+	out << i.file << flags << i.size << i.mtime;
+	if (!i.ok) return;
+	out << i.series_uid
+		<< i.modality
+		<< i.patient
+		<< i.birthdate
+		<< i.study
+		<< i.study_date
+		<< i.series
+		<< i.series_date;
+}
+
+void read_info(QDataStream & in, ScanFileInfo & i)
+{
+	quint8 flags = 0;
+	in >> i.file >> flags >> i.size >> i.mtime;
+	i.ok                = (flags & 0x01);
+	i.has_series_uid    = (flags & 0x02);
+	i.is_image          = (flags & 0x04);
+	i.is_softcopy       = (flags & 0x08);
+	i.is_image_short    = (flags & 0x10);
+	i.is_softcopy_short = (flags & 0x20);
+	if (!i.ok) return;
+	in >> i.series_uid
+		>> i.modality
+		>> i.patient
+		>> i.birthdate
+		>> i.study
+		>> i.study_date
+		>> i.series
+		>> i.series_date;
+}
+
+QByteArray csv_field(const QString & s)
+{
+	QString t(s);
+	t.replace(QString("\""), QString("\"\""));
+	return (QString("\"") + t + QString("\"")).toUtf8();
+}
+
+}
+
+ScanIndex::ScanIndex() : loaded(false), modified(false)
+{
+}
+
+ScanIndex::~ScanIndex()
+{
+}
+
+QString ScanIndex::get_default_file()
+{
+	QSettings settings(
+		QSettings::IniFormat,
+		QSettings::UserScope,
+		QApplication::organizationName(),
+		QApplication::applicationName());
+	const QFileInfo fi(settings.fileName());
+	return fi.absolutePath() +
+		QString("/") +
+		QApplication::applicationName() +
+		QString("_scan.index");
+}
+
+bool ScanIndex::load(const QString & f)
+{
+	loaded = true;
+	entries.clear();
+	modified = false;
+	QFile file(f);
+	if (!file.open(QIODevice::ReadOnly)) return false;
+	QDataStream in(&file);
+	in.setVersion(QDataStream::Qt_4_8);
+	quint32 magic = 0, version = 0, count = 0;
+	in >> magic >> version >> count;
+	if (magic != scan_index_magic || version != scan_index_version)
+	{
+		return false;
+	}
+	entries.reserve(count);
+	for (quint32 x = 0; x < count; ++x)
+	{
+		ScanFileInfo i;
+		read_info(in, i);
+		if (in.status() != QDataStream::Ok)
+		{
+			entries.clear();
+			return false;
+		}
+		entries.insert(i.file, i);
+	}
+	return true;
+}
+
+bool ScanIndex::save(const QString & f)
+{
+	if (!modified) return true;
+	QDir().mkpath(QFileInfo(f).absolutePath());
+	// written to a temporary file first, a failed write
+	// does not leave a broken index
+	const QString tmp = f + QString(".tmp");
+	{
+		QFile file(tmp);
+		if (!file.open(QIODevice::WriteOnly|QIODevice::Truncate)) return false;
+		QDataStream out(&file);
+		out.setVersion(QDataStream::Qt_4_8);
+		out << scan_index_magic << scan_index_version << (quint32)entries.size();
+		QHash<QString, ScanFileInfo>::const_iterator it = entries.constBegin();
+		for (; it != entries.constEnd(); ++it)
+		{
+			write_info(out, it.value());
+		}
+		if (out.status() != QDataStream::Ok)
+		{
+			file.close();
+			QFile::remove(tmp);
+			return false;
+		}
+	}
+	QFile::remove(f);
+	if (!QFile::rename(tmp, f)) return false;
+	modified = false;
+	return true;
+}
+
+bool ScanIndex::export_csv(const QString & f) const
+{
+	QFile file(f);
+	if (!file.open(QIODevice::WriteOnly|QIODevice::Truncate)) return false;
+	file.write(
+		"file,series_uid,modality,patient,birthdate,"
+		"study,study_date,series,series_date\n");
+	QHash<QString, ScanFileInfo>::const_iterator it = entries.constBegin();
+	for (; it != entries.constEnd(); ++it)
+	{
+		const ScanFileInfo & i = it.value();
+		if (!i.ok) continue;
+		QByteArray r;
+		r.append(csv_field(i.file));        r.append(',');
+		r.append(csv_field(i.series_uid));  r.append(',');
+		r.append(csv_field(i.modality));    r.append(',');
+		r.append(csv_field(i.patient));     r.append(',');
+		r.append(csv_field(i.birthdate));   r.append(',');
+		r.append(csv_field(i.study));       r.append(',');
+		r.append(csv_field(i.study_date));  r.append(',');
+		r.append(csv_field(i.series));      r.append(',');
+		r.append(csv_field(i.series_date)); r.append('\n');
+		if (file.write(r) != r.size()) return false;
+	}
+	return true;
+}
+
+bool ScanIndex::is_loaded() const
+{
+	return loaded;
+}
+
+bool ScanIndex::find(const QString & f, qint64 size, qint64 mtime, ScanFileInfo & i) const
+{
+	QHash<QString, ScanFileInfo>::const_iterator it = entries.constFind(f);
+	if (it == entries.constEnd()) return false;
+	if (it.value().size != size || it.value().mtime != mtime) return false;
+	i = it.value();
+	return true;
+}
+
+void ScanIndex::insert(const ScanFileInfo & i)
+{
+	seen.insert(i.file);
+	QHash<QString, ScanFileInfo>::iterator it = entries.find(i.file);
+	if (it != entries.end() &&
+		it.value().size  == i.size &&
+		it.value().mtime == i.mtime)
+	{
+		return;
+	}
+	entries.insert(i.file, i);
+	modified = true;
+}
+
+void ScanIndex::begin_scan()
+{
+	seen.clear();
+}
+
+void ScanIndex::end_scan(const QString & p)
+{
+	const QString d = QDir(p).absolutePath() + QString("/");
+	QHash<QString, ScanFileInfo>::iterator it = entries.begin();
+	while (it != entries.end())
+	{
+		if (it.key().startsWith(d) && !seen.contains(it.key()))
+		{
+			it = entries.erase(it);
+			modified = true;
+		}
+		else
+		{
+			++it;
+		}
+	}
+	seen.clear();
+}
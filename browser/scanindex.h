@@ -0,0 +1,65 @@
+#ifndef SCANINDEX___H
+#define SCANINDEX___H
+
+#include <QtGlobal>
+#include <QString>
+#include <QHash>
+#include <QSet>
+
+class ScanFileInfo
+{
+public:
+	ScanFileInfo() :
+		ok(false), has_series_uid(false),
+		is_image(false), is_softcopy(false),
+		is_image_short(false), is_softcopy_short(false),
+		size(-1), mtime(-1) {}
+	~ScanFileInfo() {}
+	bool    ok;
+	bool    has_series_uid;
+	bool    is_image;
+	bool    is_softcopy;
+	bool    is_image_short;
+	bool    is_softcopy_short;
+	qint64  size;
+	qint64  mtime;
+	QString file;
+	QString series_uid;
+	QString modality;
+	QString patient;
+	QString birthdate;
+	QString study;
+	QString study_date;
+	QString series;
+	QString series_date;
+};
+
+// Results of the directory scan by path, an entry is
+// valid while size and modification time are unchanged.
+// Files which are not DICOM are kept too (ok=false).
+class ScanIndex
+{
+public:
+	ScanIndex();
+	~ScanIndex();
+	static QString get_default_file();
+	bool load(const QString&);
+	bool save(const QString&);
+	// DICOM files only, one row per file, UTF-8.
+	bool export_csv(const QString&) const;
+	bool is_loaded() const;
+	// Read-only, can be called from several threads.
+	bool find(const QString&, qint64, qint64, ScanFileInfo&) const;
+	void insert(const ScanFileInfo&);
+	// Removes entries below the directory not seen since begin_scan().
+	void begin_scan();
+	void end_scan(const QString&);
+
+private:
+	QHash<QString, ScanFileInfo> entries;
+	QSet<QString> seen;
+	bool loaded;
+	bool modified;
+};
+
+#endif // SCANINDEX___H
@@ -0,0 +1,401 @@
+#include "transcoder.h"
+#include <QtGlobal>
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QStringList>
+#include <QSet>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QProgressDialog>
+#include <QApplication>
+#include "mdcmImageReader.h"
+#include "mdcmImageWriter.h"
+#include "mdcmImageChangeTransferSyntax.h"
+#include "mdcmFileExplicitFilter.h"
+#include "mdcmParseException.h"
+#include "parallelutils.h"
+#include <vector>
+#include <iostream>
+#include <exception>
+
+namespace
+{
+
+struct TransferSyntaxName
+{
+	const char * name;
+	mdcm::TransferSyntax::TSType ts;
+};
+
+const TransferSyntaxName ts_names[] =
+{
+	{ "implicit",      mdcm::TransferSyntax::ImplicitVRLittleEndian },
+	{ "explicit",      mdcm::TransferSyntax::ExplicitVRLittleEndian },
+	{ "jpeg",          mdcm::TransferSyntax::JPEGBaselineProcess1 },
+	{ "jpeg-lossless", mdcm::TransferSyntax::JPEGLosslessProcess14_1 },
+	{ "jpegls",        mdcm::TransferSyntax::JPEGLSLossless },
+	{ "jpegls-near",   mdcm::TransferSyntax::JPEGLSNearLossless },
+	{ "j2k",           mdcm::TransferSyntax::JPEG2000Lossless },
+	{ "j2k-lossy",     mdcm::TransferSyntax::JPEG2000 },
+	{ "rle",           mdcm::TransferSyntax::RLELossless },
+	{ NULL,            mdcm::TransferSyntax::TS_END }
+};
+
+Transcoder::Result copy_file(const QString & in_file, const QString & out_file)
+{
+	if (QFile::exists(out_file)) QFile::remove(out_file);
+	return QFile::copy(in_file, out_file)
+		? Transcoder::TRANSCODE_COPIED
+		: Transcoder::TRANSCODE_FAILED;
+}
+
+class TranscodeTask : public ParallelTask
+{
+public:
+	TranscodeTask(
+		const QStringList & in_files_,
+		const QStringList & out_files_,
+		const mdcm::TransferSyntax & ts_,
+		std::vector<int> & results_,
+		std::vector<qint64> & in_sizes_,
+		std::vector<qint64> & out_sizes_,
+		int first_,
+		unsigned int threads_)
+		:
+		in_files(in_files_),
+		out_files(out_files_),
+		ts(ts_),
+		results(results_),
+		in_sizes(in_sizes_),
+		out_sizes(out_sizes_),
+		first(first_),
+		threads(threads_)
+	{
+	}
+	void process(int i) override
+	{
+		const int j = first + i;
+		Transcoder::Result r = Transcoder::TRANSCODE_FAILED;
+		try
+		{
+			r = Transcoder::transcode_file(
+				in_files.at(j), out_files.at(j), ts, threads);
+		}
+		catch(mdcm::ParseException & pe)
+		{
+			std::cout
+				<< "mdcm::ParseException in TranscodeTask\n"
+				<< pe.GetLastElement().GetTag() << std::endl;
+		}
+		catch(std::exception & ex)
+		{
+			std::cout << "Exception in TranscodeTask\n"
+				<< ex.what() << std::endl;
+		}
+		// keep the output complete
+		if (r == Transcoder::TRANSCODE_FAILED &&
+			copy_file(in_files.at(j), out_files.at(j)) == Transcoder::TRANSCODE_COPIED)
+		{
+			r = Transcoder::TRANSCODE_KEPT_ORIGINAL;
+		}
+		results[j] = static_cast<int>(r);
+		in_sizes[j] = QFileInfo(in_files.at(j)).size();
+		out_sizes[j] =
+			(r == Transcoder::TRANSCODE_FAILED) ? 0 : QFileInfo(out_files.at(j)).size();
+	}
+
+private:
+	const QStringList & in_files;
+	const QStringList & out_files;
+	const mdcm::TransferSyntax & ts;
+	std::vector<int> & results;
+	std::vector<qint64> & in_sizes;
+	std::vector<qint64> & out_sizes;
+	const int first;
+	const unsigned int threads;
+};
+
+}
+
+QString TranscodeStats::to_string() const
+{
+	QString s = QString("%1 files").arg(files);
+	if (out_bytes > 0)
+	{
+		s.append(QString(", ratio %1:1")
+			.arg(static_cast<double>(in_bytes) / out_bytes, 0, 'f', 2));
+	}
+	if (seconds > 0.0)
+	{
+		s.append(QString(", %1 MB/s")
+			.arg(in_bytes / (seconds * 1048576.0), 0, 'f', 1));
+	}
+	return s;
+}
+
+mdcm::TransferSyntax::TSType Transcoder::find_transfer_syntax(const QString & s)
+{
+	const QString t = s.trimmed().toLower();
+	for (int x = 0; ts_names[x].name; ++x)
+	{
+		if (t == QString::fromLatin1(ts_names[x].name)) return ts_names[x].ts;
+	}
+	if (t.isEmpty()) return mdcm::TransferSyntax::TS_END;
+	const mdcm::TransferSyntax::TSType r =
+		mdcm::TransferSyntax::GetTSType(t.toLatin1().constData());
+	// only what ImageChangeTransferSyntax can write
+	switch (r)
+	{
+	case mdcm::TransferSyntax::ImplicitVRLittleEndian:
+	case mdcm::TransferSyntax::ExplicitVRLittleEndian:
+	case mdcm::TransferSyntax::JPEGBaselineProcess1:
+	case mdcm::TransferSyntax::JPEGExtendedProcess2_4:
+	case mdcm::TransferSyntax::JPEGLosslessProcess14:
+	case mdcm::TransferSyntax::JPEGLosslessProcess14_1:
+	case mdcm::TransferSyntax::JPEGLSLossless:
+	case mdcm::TransferSyntax::JPEGLSNearLossless:
+	case mdcm::TransferSyntax::JPEG2000Lossless:
+	case mdcm::TransferSyntax::JPEG2000:
+	case mdcm::TransferSyntax::RLELossless:
+		return r;
+	default:
+		break;
+	}
+	return mdcm::TransferSyntax::TS_END;
+}
+
+QStringList Transcoder::get_transfer_syntax_names()
+{
+	QStringList l;
+	for (int x = 0; ts_names[x].name; ++x)
+	{
+		l.push_back(QString::fromLatin1(ts_names[x].name));
+	}
+	return l;
+}
+
+Transcoder::Result Transcoder::transcode_file(
+	const QString & in_file,
+	const QString & out_file,
+	const mdcm::TransferSyntax & ts,
+	unsigned int threads)
+{
+	mdcm::ImageReader reader;
+#ifdef _WIN32
+#if (defined(_MSC_VER) && defined(MDCM_WIN32_UNC))
+	reader.SetFileName(QDir::toNativeSeparators(in_file).toUtf8().constData());
+#else
+	reader.SetFileName(QDir::toNativeSeparators(in_file).toLocal8Bit().constData());
+#endif
+#else
+	reader.SetFileName(in_file.toLocal8Bit().constData());
+#endif
+	// the output is another file
+	reader.SetMemoryMapping(true);
+	mdcm::CodecOptions codec_options;
+	codec_options.NumberOfThreads = threads;
+	reader.SetCodecOptions(codec_options);
+	if (!reader.Read())
+	{
+		// other objects, e.g. SR or presentation state
+		const mdcm::DataSet & ds = reader.GetFile().GetDataSet();
+		if (!ds.IsEmpty() && !ds.FindDataElement(mdcm::Tag(0x7fe0,0x0010)))
+		{
+			return copy_file(in_file, out_file);
+		}
+		return TRANSCODE_FAILED;
+	}
+	if (static_cast<mdcm::TransferSyntax::TSType>(
+			reader.GetFile().GetHeader().GetDataSetTransferSyntax()) ==
+		static_cast<mdcm::TransferSyntax::TSType>(ts))
+	{
+		return copy_file(in_file, out_file);
+	}
+	// VRs of attributes read as implicit
+	if (ts.IsExplicit() &&
+		reader.GetFile().GetHeader().GetDataSetTransferSyntax().IsImplicit())
+	{
+		mdcm::FileExplicitFilter f;
+		f.SetFile(reader.GetFile());
+		if (!f.Change()) return TRANSCODE_FAILED;
+	}
+	mdcm::ImageChangeTransferSyntax change;
+	change.SetTransferSyntax(ts);
+	change.SetNumberOfThreads(threads);
+	change.SetInput(reader.GetImage());
+	if (!change.Change()) return TRANSCODE_FAILED;
+	mdcm::ImageWriter writer;
+#ifdef _WIN32
+#if (defined(_MSC_VER) && defined(MDCM_WIN32_UNC))
+	writer.SetFileName(QDir::toNativeSeparators(out_file).toUtf8().constData());
+#else
+	writer.SetFileName(QDir::toNativeSeparators(out_file).toLocal8Bit().constData());
+#endif
+#else
+	writer.SetFileName(out_file.toLocal8Bit().constData());
+#endif
+	writer.SetFile(reader.GetFile());
+	writer.SetImage(change.GetOutput());
+	return writer.Write() ? TRANSCODE_CONVERTED : TRANSCODE_FAILED;
+}
+
+bool Transcoder::transcode_files(
+	const QStringList & in_files,
+	const QStringList & out_files,
+	const mdcm::TransferSyntax & ts,
+	QProgressDialog * pd,
+	TranscodeStats & stats)
+{
+	stats = TranscodeStats();
+	const int nfiles = qMin(in_files.size(), out_files.size());
+	const int num_threads = ParallelUtils::get_num_threads();
+	const int batch = 4 * num_threads;
+	std::vector<int> results(nfiles, 0);
+	std::vector<qint64> in_sizes(nfiles, 0);
+	std::vector<qint64> out_sizes(nfiles, 0);
+	bool canceled = false;
+	qint64 last_print = 0;
+	QElapsedTimer timer;
+	timer.start();
+	for (int x = 0; x < nfiles; x += batch)
+	{
+		if (pd)
+		{
+			pd->setValue(-1);
+			QApplication::processEvents();
+			if (pd->wasCanceled())
+			{
+				canceled = true;
+				break;
+			}
+		}
+		const int count = qMin(batch, nfiles - x);
+		// files in parallel, remaining threads encode frames
+		const unsigned int threads =
+			static_cast<unsigned int>(qMax(1, num_threads / count));
+		TranscodeTask t(
+			in_files, out_files, ts, results, in_sizes, out_sizes, x, threads);
+		ParallelUtils::run(&t, count);
+		for (int j = x; j < x + count; ++j)
+		{
+			switch (results[j])
+			{
+			case TRANSCODE_CONVERTED:
+				++stats.converted;
+				break;
+			case TRANSCODE_COPIED:
+				++stats.copied;
+				break;
+			case TRANSCODE_KEPT_ORIGINAL:
+				++stats.kept_original;
+				stats.kept_files.push_back(in_files.at(j));
+				break;
+			default:
+				++stats.failed;
+				stats.failed_files.push_back(in_files.at(j));
+				break;
+			}
+			stats.in_bytes  += in_sizes[j];
+			stats.out_bytes += out_sizes[j];
+		}
+		stats.files += count;
+		const qint64 ms = timer.elapsed();
+		stats.seconds = ms * 0.001;
+		const QString s =
+			QString("%1 of %2: ").arg(stats.files).arg(nfiles) + stats.to_string();
+		if (pd)
+		{
+			pd->setLabelText(QString("Converting\n") + s);
+		}
+		else if (ms - last_print >= 1000 || stats.files == nfiles)
+		{
+			std::cout << s.toStdString() << std::endl;
+			last_print = ms;
+		}
+	}
+	stats.seconds = timer.elapsed() * 0.001;
+	return !canceled;
+}
+
+int Transcoder::run_headless(
+	const QString & in,
+	const QString & out,
+	const QString & ts_name)
+{
+	const mdcm::TransferSyntax::TSType tst = find_transfer_syntax(ts_name);
+	if (tst == mdcm::TransferSyntax::TS_END)
+	{
+		std::cout << "Error: unsupported transfer syntax \""
+			<< ts_name.toStdString() << "\"" << std::endl;
+		return 1;
+	}
+	const QFileInfo in_fi(in);
+	if (!in_fi.isDir())
+	{
+		std::cout << "Error: input is not a directory" << std::endl;
+		return 1;
+	}
+	const QString in_path = in_fi.canonicalFilePath();
+	QDir out_dir(out);
+	if (!out_dir.exists() && !out_dir.mkpath(out_dir.absolutePath()))
+	{
+		std::cout << "Error: can not create output directory" << std::endl;
+		return 1;
+	}
+	const QString out_path = QFileInfo(out_dir.absolutePath()).canonicalFilePath();
+	if (out_path == in_path)
+	{
+		std::cout << "Error: input and output are the same directory" << std::endl;
+		return 1;
+	}
+	// the output tree mirrors the input tree
+	const QDir in_dir(in_path);
+	QStringList in_files;
+	QStringList out_files;
+	{
+		QSet<QString> dirs;
+		QDirIterator it(in_path, QDir::Files|QDir::Readable, QDirIterator::Subdirectories);
+		while (it.hasNext())
+		{
+			const QString f = it.next();
+			const QString o = out_path + QString("/") + in_dir.relativeFilePath(f);
+			const QString d = QFileInfo(o).absolutePath();
+			if (!dirs.contains(d))
+			{
+				QDir().mkpath(d);
+				dirs.insert(d);
+			}
+			in_files.push_back(f);
+			out_files.push_back(o);
+		}
+	}
+	const mdcm::TransferSyntax ts(tst);
+	TranscodeStats stats;
+	transcode_files(in_files, out_files, ts, NULL, stats);
+	std::cout << "Converted " << stats.converted << " files to "
+		<< mdcm::TransferSyntax::GetTSString(tst) << ", copied "
+		<< stats.copied << " in " << stats.seconds << " s, "
+		<< stats.to_string().toStdString();
+	if (stats.kept_original > 0)
+	{
+		std::cout << ", " << stats.kept_original
+			<< " file(s) not converted, originals copied";
+	}
+	if (stats.failed > 0)
+	{
+		std::cout << ", " << stats.failed << " file(s) missing in output";
+	}
+	std::cout << std::endl;
+	for (int x = 0; x < stats.kept_files.size(); ++x)
+	{
+		std::cout << "  not converted: "
+			<< stats.kept_files.at(x).toStdString() << std::endl;
+	}
+	for (int x = 0; x < stats.failed_files.size(); ++x)
+	{
+		std::cout << "  missing: "
+			<< stats.failed_files.at(x).toStdString() << std::endl;
+	}
+	return (stats.failed > 0) ? 2 : 0;
+}
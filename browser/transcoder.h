@@ -0,0 +1,73 @@
+#ifndef TRANSCODER___H
+#define TRANSCODER___H
+
+#include <QtGlobal>
+#include <QString>
+#include <QStringList>
+#include "mdcmTransferSyntax.h"
+
+class QProgressDialog;
+
+class TranscodeStats
+{
+public:
+	TranscodeStats() :
+		files(0), converted(0), copied(0), kept_original(0), failed(0),
+		in_bytes(0), out_bytes(0), seconds(0.0) {}
+	~TranscodeStats() {}
+	int    files;
+	int    converted;
+	int    copied;
+	int    kept_original;
+	int    failed;
+	qint64 in_bytes;
+	qint64 out_bytes;
+	double seconds;
+	// Input files of kept_original and failed.
+	QStringList kept_files;
+	QStringList failed_files;
+	// e.g. "10 files, ratio 2.31:1, 85.2 MB/s"
+	QString to_string() const;
+};
+
+class Transcoder
+{
+public:
+	enum Result
+	{
+		TRANSCODE_FAILED = 0,
+		TRANSCODE_CONVERTED,
+		TRANSCODE_COPIED, // not an image or already in target syntax
+		TRANSCODE_KEPT_ORIGINAL // conversion failed, the input is copied
+	};
+	// UID or short name, e.g. "explicit", "jpegls", "j2k", "rle",
+	// TS_END if unknown.
+	static mdcm::TransferSyntax::TSType find_transfer_syntax(const QString&);
+	// Short names, as accepted by find_transfer_syntax().
+	static QStringList get_transfer_syntax_names();
+	// Converts the Pixel Data of one file, other DICOM files
+	// are copied unchanged. Frames of multi-frame objects are
+	// encoded with the given number of threads.
+	static Result transcode_file(
+		const QString&,
+		const QString&,
+		const mdcm::TransferSyntax&,
+		unsigned int = 1);
+	// Files are converted in parallel, in batches, the input is
+	// memory mapped, so only the batch is in memory. If a file can
+	// not be converted (or is not DICOM) the original is copied, so
+	// the output is complete unless a copy fails. Without progress
+	// dialog the progress is printed to stdout. Returns false if
+	// canceled.
+	static bool transcode_files(
+		const QStringList&,
+		const QStringList&,
+		const mdcm::TransferSyntax&,
+		QProgressDialog*,
+		TranscodeStats&);
+	// Batch mode, converts the input directory recursively into
+	// the output directory, returns the exit code.
+	static int run_headless(const QString&, const QString&, const QString&);
+};
+
+#endif // TRANSCODER___H
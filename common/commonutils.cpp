@@ -23,13 +23,12 @@
 #include "itkMapContainer.h"
 #include "itkSpatialOrientation.h"
 #include "itkMinimumMaximumImageCalculator.h"
-#include "itkNearestNeighborInterpolateImageFunction.h"
-#include "itkImageSliceConstIteratorWithIndex.h"
+#include "itkNumericTraits.h"
 #include "itkImageSliceIteratorWithIndex.h"
-#include "itkIdentityTransform.h"
-#include "itkResampleImageFilter.h"
 #include <QSet>
+#include <QAtomicInt>
 #include <QApplication>
+#include <QThread>
 #include <QFileInfo>
 #include <QApplication>
 #include <QDir>
@@ -41,12 +40,16 @@
 #include <iostream>
 #include <list>
 #include <cstdlib>
+#include <cstring>
+#include <cfloat>
 #include <random>
 #include <chrono>
 #include <functional>
 #include "float.h"
 #include "dicomutils.h"
 #include "colorspace/colorspace.h"
+#include "ybrutils.h"
+#include "parallelutils.h"
 
 #ifdef USE_GET_TOTAL_MEM
 #if (defined  __FreeBSD__ || defined __APPLE__)
@@ -72,33 +75,159 @@ static double abs_max(double x, double y, double z)
     return r;
 }
 
-template<typename T> void calculate_min_max(
+// Part 'offset + i' of the wrapped task, to run a large task
+// in slabs.
+class SlabTask : public ParallelTask
+{
+public:
+	SlabTask(ParallelTask * t_) : t(t_), offset(0) {}
+	~SlabTask() {}
+	void process(int i) override { t->process(offset + i); }
+	ParallelTask * t;
+	int offset;
+};
+
+// Runs parts 0..count-1 in slabs of a few parts per thread,
+// between slabs events are processed and the progress (percent)
+// is shown, after that the dialog is busy again.
+static void run_in_slabs(ParallelTask * t, int count, QProgressDialog * pb)
+{
+	const int slab = 4*ParallelUtils::get_num_threads();
+	SlabTask s(t);
+	if (pb)
+	{
+		pb->setRange(0, 100);
+		pb->setValue(0);
+	}
+	while (s.offset < count)
+	{
+		const int n = qMin(slab, count - s.offset);
+		ParallelUtils::run(&s, n);
+		s.offset += n;
+		if (pb) pb->setValue((100*static_cast<qint64>(s.offset))/count);
+		CommonUtils::process_events();
+	}
+	if (pb)
+	{
+		pb->setRange(0, 0);
+		pb->setValue(-1);
+	}
+}
+
+// Min/max of the raw buffer, one part is a range of 256K pixels,
+// NaN is ignored as in MinimumMaximumImageCalculator.
+template<typename T> class MinMaxTask_ : public ParallelTask
+{
+public:
+	typedef typename T::PixelType PixelType;
+	MinMaxTask_(
+		const PixelType * buffer_, size_t n_,
+		std::vector<PixelType> & mins_,
+		std::vector<PixelType> & maxs_)
+		:
+		buffer(buffer_), n(n_),
+		mins(mins_), maxs(maxs_)
+	{
+	}
+
+	~MinMaxTask_()
+	{
+	}
+
+	static int get_part_shift() { return 18; }
+
+	void process(int i) override
+	{
+		const size_t j0 = static_cast<size_t>(i) << get_part_shift();
+		const size_t j1 = qMin(j0 + (static_cast<size_t>(1) << get_part_shift()), n);
+		PixelType vmin = itk::NumericTraits<PixelType>::max();
+		PixelType vmax = itk::NumericTraits<PixelType>::NonpositiveMin();
+		for (size_t j = j0; j < j1; ++j)
+		{
+			const PixelType v = buffer[j];
+			vmin = (v < vmin) ? v : vmin;
+			vmax = (v > vmax) ? v : vmax;
+		}
+		mins[i] = vmin;
+		maxs[i] = vmax;
+	}
+
+private:
+	const PixelType * buffer;
+	const size_t n;
+	std::vector<PixelType> & mins;
+	std::vector<PixelType> & maxs;
+};
+
+template<typename T> bool calculate_min_max_parallel(
 	const typename T::Pointer & image,
-	ImageVariant * iv)
+	QProgressDialog * pb,
+	double * cubemin, double * cubemax)
 {
-	if (image.IsNull()) return;
-	typedef  itk::MinimumMaximumImageCalculator<T> MinMaxCalculator;
-	typename MinMaxCalculator::Pointer min_max_calculator =
-		MinMaxCalculator::New();
-	typename UpdateQtCommand::Pointer update_qt_command =
-		UpdateQtCommand::New();
-	double cubemin = 0.0, cubemax = 0.0;
+	typedef typename T::PixelType PixelType;
+	const typename T::RegionType region = image->GetLargestPossibleRegion();
+	if (image->GetBufferedRegion() != region) return false;
+	const size_t n = region.GetNumberOfPixels();
+	if (n < 1) return false;
+	const int shift = MinMaxTask_<T>::get_part_shift();
+	const size_t parts = ((n - 1) >> shift) + 1;
+	if (parts > static_cast<size_t>(INT_MAX)) return false;
+	std::vector<PixelType> mins;
+	std::vector<PixelType> maxs;
 	try
 	{
-		min_max_calculator->AddObserver(
-			itk::ProgressEvent(), update_qt_command);
-		min_max_calculator->SetImage(image);
-		min_max_calculator->SetRegion(image->GetLargestPossibleRegion());
-		min_max_calculator->Compute();
-		cubemin =
-			static_cast<double>(min_max_calculator->GetMinimum());
-		cubemax =
-			static_cast<double>(min_max_calculator->GetMaximum());
+		mins.resize(parts);
+		maxs.resize(parts);
 	}
-	catch (itk::ExceptionObject & ex)
+	catch (const std::bad_alloc&)
 	{
-		std::cout << ex.GetDescription() << std::endl;
-		return;
+		return false;
+	}
+	MinMaxTask_<T> t(image->GetBufferPointer(), n, mins, maxs);
+	run_in_slabs(&t, static_cast<int>(parts), pb);
+	PixelType vmin = mins[0];
+	PixelType vmax = maxs[0];
+	for (size_t x = 1; x < parts; ++x)
+	{
+		if (mins[x] < vmin) vmin = mins[x];
+		if (maxs[x] > vmax) vmax = maxs[x];
+	}
+	*cubemin = static_cast<double>(vmin);
+	*cubemax = static_cast<double>(vmax);
+	return true;
+}
+
+template<typename T> void calculate_min_max(
+	const typename T::Pointer & image,
+	ImageVariant * iv,
+	QProgressDialog * pb = NULL)
+{
+	if (image.IsNull()) return;
+	double cubemin = 0.0, cubemax = 0.0;
+	if (!calculate_min_max_parallel<T>(image, pb, &cubemin, &cubemax))
+	{
+		typedef  itk::MinimumMaximumImageCalculator<T> MinMaxCalculator;
+		typename MinMaxCalculator::Pointer min_max_calculator =
+			MinMaxCalculator::New();
+		typename UpdateQtCommand::Pointer update_qt_command =
+			UpdateQtCommand::New();
+		try
+		{
+			min_max_calculator->AddObserver(
+				itk::ProgressEvent(), update_qt_command);
+			min_max_calculator->SetImage(image);
+			min_max_calculator->SetRegion(image->GetLargestPossibleRegion());
+			min_max_calculator->Compute();
+			cubemin =
+				static_cast<double>(min_max_calculator->GetMinimum());
+			cubemax =
+				static_cast<double>(min_max_calculator->GetMaximum());
+		}
+		catch (itk::ExceptionObject & ex)
+		{
+			std::cout << ex.GetDescription() << std::endl;
+			return;
+		}
 	}
 	if (iv->di->maxwindow)
 	{
@@ -419,6 +548,225 @@ template<typename T> QString get_orientation(
 	return f;
 }
 
+// One output slice of the slab from 'z0' per part, nearest
+// neighbour downsampling
+// (as ResampleImageFilter with NearestNeighborInterpolateImageFunction)
+// and normalization to 0..1 of the texture format, 'out_max'
+// is 1.0, USHRT_MAX or UCHAR_MAX. Rows with the same size are
+// a plain loop, the compiler vectorizes it.
+template<typename T, typename O> class TexTask_ : public ParallelTask
+{
+public:
+	typedef typename T::PixelType PixelType;
+	TexTask_(
+		const PixelType * in_, const size_t * in_size_,
+		O * out_, const size_t * size_,
+		const std::vector<size_t> & ix_,
+		const std::vector<size_t> & iy_,
+		const std::vector<size_t> & iz_,
+		size_t z0_,
+		double rmin_, double rmax_, double out_max_)
+		:
+		in(in_), in_size(in_size_),
+		out(out_), size(size_),
+		ix(ix_), iy(iy_), iz(iz_),
+		z0(z0_),
+		rmin(rmin_), out_max(out_max_)
+	{
+		const double max_minus_min =
+			(rmax_-rmin_ > 0) ? rmax_-rmin_ : 1e-9;
+		scale = out_max/max_minus_min;
+	}
+
+	~TexTask_()
+	{
+	}
+
+	void process(int z) override
+	{
+		const PixelType * s = in + iz[z0 + z]*in_size[0]*in_size[1];
+		for (size_t y = 0; y < size[1]; ++y)
+		{
+			const PixelType * r = s + iy[y]*in_size[0];
+			O * o = out + (static_cast<size_t>(z)*size[1] + y)*size[0];
+			if (size[0] == in_size[0])
+			{
+				for (size_t x = 0; x < size[0]; ++x)
+				{
+					double f = (static_cast<double>(r[x]) - rmin)*scale;
+					f = (f < 0.0) ? 0.0 : ((f > out_max) ? out_max : f);
+					o[x] = static_cast<O>(f);
+				}
+			}
+			else
+			{
+				for (size_t x = 0; x < size[0]; ++x)
+				{
+					double f = (static_cast<double>(r[ix[x]]) - rmin)*scale;
+					f = (f < 0.0) ? 0.0 : ((f > out_max) ? out_max : f);
+					o[x] = static_cast<O>(f);
+				}
+			}
+		}
+	}
+
+private:
+	const PixelType * in;
+	const size_t * in_size;
+	O * out;
+	const size_t * size;
+	const std::vector<size_t> & ix;
+	const std::vector<size_t> & iy;
+	const std::vector<size_t> & iz;
+	const size_t z0;
+	const double rmin;
+	const double out_max;
+	double scale;
+};
+
+// Min/max of the bricks in a slab of the staging buffer, one
+// column (x, y) of bricks per part, so parts do not share bricks.
+// Bricks crossing slabs are merged with the previous slab.
+template<typename O> class BrickTask_ : public ParallelTask
+{
+public:
+	BrickTask_(
+		const O * buf_, const size_t * size_,
+		size_t z0_, size_t n_,
+		double out_max_,
+		TexBricks * bricks_)
+		:
+		buf(buf_), size(size_),
+		z0(z0_), n(n_),
+		out_max(out_max_),
+		bricks(bricks_)
+	{
+	}
+
+	~BrickTask_()
+	{
+	}
+
+	void process(int i) override
+	{
+		const size_t bs = bricks->size;
+		const size_t bx = i % bricks->dim[0];
+		const size_t by = i / bricks->dim[0];
+		const size_t x0 = bx*bs;
+		const size_t x1 = qMin(x0 + bs, size[0]);
+		const size_t y0 = by*bs;
+		const size_t y1 = qMin(y0 + bs, size[1]);
+		for (size_t z = 0; z < n; ++z)
+		{
+			O vmin = buf[(z*size[1] + y0)*size[0] + x0];
+			O vmax = vmin;
+			for (size_t y = y0; y < y1; ++y)
+			{
+				const O * r = buf + (z*size[1] + y)*size[0];
+				for (size_t x = x0; x < x1; ++x)
+				{
+					if (r[x] < vmin) vmin = r[x];
+					if (r[x] > vmax) vmax = r[x];
+				}
+			}
+			const size_t k =
+				(((z0 + z)/bs)*bricks->dim[1] + by)*bricks->dim[0] + bx;
+			const float fmin = static_cast<float>(vmin/out_max);
+			const float fmax = static_cast<float>(vmax/out_max);
+			if (fmin < bricks->min[k]) bricks->min[k] = fmin;
+			if (fmax > bricks->max[k]) bricks->max[k] = fmax;
+		}
+	}
+
+private:
+	const O * buf;
+	const size_t * size;
+	const size_t z0;
+	const size_t n;
+	const double out_max;
+	TexBricks * bricks;
+};
+
+// Input index of the output index for each axis, 'ratio' is
+// output spacing/input spacing.
+static void get_nearest_indices(
+	std::vector<size_t> & idx,
+	size_t size, size_t in_size, double ratio)
+{
+	idx.resize(size);
+	for (size_t x = 0; x < size; ++x)
+	{
+		const size_t i = (size == in_size)
+			? x
+			: static_cast<size_t>(floor(x*ratio + 0.5));
+		idx[x] = (i < in_size) ? i : in_size - 1;
+	}
+}
+
+// Fills the texture (storage is allocated) in slabs of 'slab'
+// slices, 'buf' is the staging buffer for one slab. Each slab is
+// prepared in parallel, then copied with glTexSubImage3D, the
+// driver may transfer it while the next slab is prepared. Events
+// are processed between slabs, so the context and the binding
+// are set again for each slab. Min/max of the bricks are
+// collected from the staging buffer.
+template<typename T, typename O> void upload_tex3d(
+	const typename T::Pointer & image,
+	GLWidget * gl, GLuint tex, GLint alignment,
+	O * buf, size_t slab, const size_t * size,
+	const std::vector<size_t> & ix,
+	const std::vector<size_t> & iy,
+	const std::vector<size_t> & iz,
+	double rmin, double rmax, double out_max,
+	GLenum type,
+	TexBricks * bricks,
+	QProgressDialog * pb)
+{
+	const typename T::SizeType s = image->GetLargestPossibleRegion().GetSize();
+	const size_t in_size[3] = { s[0], s[1], s[2] };
+	if (pb)
+	{
+		pb->setRange(0, 100);
+		pb->setValue(0);
+	}
+	for (size_t z0 = 0; z0 < size[2]; z0 += slab)
+	{
+		const size_t n = qMin(slab, size[2] - z0);
+		TexTask_<T, O> t(
+			image->GetBufferPointer(), in_size,
+			buf, size, ix, iy, iz, z0,
+			rmin, rmax, out_max);
+		ParallelUtils::run(&t, static_cast<int>(n));
+		BrickTask_<O> bt(buf, size, z0, n, out_max, bricks);
+		ParallelUtils::run(&bt, bricks->dim[0]*bricks->dim[1]);
+		gl->makeCurrent();
+#if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
+		gl->glBindTexture(GL_TEXTURE_3D, tex);
+		gl->glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+		gl->glTexSubImage3D(
+			GL_TEXTURE_3D, 0,
+			0, 0, z0,
+			size[0], size[1], n,
+			GL_RED, type, buf);
+#else
+		glBindTexture(GL_TEXTURE_3D, tex);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+		glTexSubImage3D(
+			GL_TEXTURE_3D, 0,
+			0, 0, z0,
+			size[0], size[1], n,
+			GL_RED, type, buf);
+#endif
+		if (pb) pb->setValue(static_cast<int>((100*(z0 + n))/size[2]));
+		CommonUtils::process_events();
+	}
+	if (pb)
+	{
+		pb->setRange(0, 0);
+		pb->setValue(-1);
+	}
+}
+
 template<typename T> int generate_tex3d(
 	ImageVariant * ivariant,
 	const typename T::Pointer & image,
@@ -432,10 +780,6 @@ template<typename T> int generate_tex3d(
 		std::cout << "(size[0] < 1||size[1] < 1)" << std::endl;
 		return 1;
 	}
-	typedef itk::NearestNeighborInterpolateImageFunction<T,double> InterpolatorType;
-	typedef itk::IdentityTransform<double,3> IdentityTransformType;
-	typedef itk::ResampleImageFilter<T,T> ScaleFilter;
-	typedef itk::ImageSliceConstIteratorWithIndex<T> SliceConstIteratorType;
 	std::string tt;
 	int error__ = 0;
 	GLuint glerror__ = 0;
@@ -443,15 +787,20 @@ template<typename T> int generate_tex3d(
 	float * float_buf = NULL;
 	unsigned short * short_buf = NULL;
 	GLubyte * ub_buf = NULL;
-	typename T::Pointer out_image;
-	bool scale = true;
 	short texture_type = -1;
 	const typename T::RegionType r__ =
 			image->GetLargestPossibleRegion();
 	const typename T::SizeType original_size = r__.GetSize();
-	calculate_min_max<T>(image, ivariant);
-	rmin = ivariant->di->rmin;
-	rmax = ivariant->di->rmax;
+	const typename T::SpacingType original_spacing = image->GetSpacing();
+	// the buffer is read directly
+	if (image->GetBufferedRegion() != r__ ||
+		size[0] > original_size[0] ||
+		size[1] > original_size[1] ||
+		size[2] > original_size[2])
+	{
+		std::cout << "generate_tex3d: unexpected region" << std::endl;
+		return 1;
+	}
 	switch(ivariant->image_type)
 	{
 		case 0:
@@ -503,149 +852,104 @@ template<typename T> int generate_tex3d(
 		pb->setLabelText(QString("Generating OpenGL texture"));
 		pb->setValue(-1);
 	}
-	qApp->processEvents();
+	CommonUtils::process_events();
 	//
+	calculate_min_max<T>(image, ivariant, pb);
+	rmin = ivariant->di->rmin;
+	rmax = ivariant->di->rmax;
+	//
+	// Downsampling is done while normalizing, the spacing is
+	// as of ResampleImageFilter's output.
 	if (
 		size[0]==original_size[0] &&
 		size[1]==original_size[1] &&
-		size[2]==original_size[2]) scale = false;
-	//
-	if (scale)
-	{
-		typename ScaleFilter::Pointer scaleFilter = ScaleFilter::New();
-		typename T::SizeType size_;
-		size_[0] = size[0];
-		size_[1] = size[1];
-		size_[2] = size[2];
-		typename T::SpacingType spacing_;
-		spacing_[0] = spacing[0];
-		spacing_[1] = spacing[1];
-		spacing_[2] = spacing[2];
-		try
-		{
-			scaleFilter->SetInput(image);
-			scaleFilter->SetSize(size_);
-			scaleFilter->SetOutputSpacing(spacing_);
-			scaleFilter->SetOutputOrigin(image->GetOrigin());
-			scaleFilter->SetOutputDirection(image->GetDirection());
-			scaleFilter->SetInterpolator(InterpolatorType::New());
-			scaleFilter->SetTransform(IdentityTransformType::New());
-			scaleFilter->UpdateLargestPossibleRegion();
-			out_image = scaleFilter->GetOutput();
-		}
-		catch (itk::ExceptionObject & ex)
-		{
-			std::cout << ex << std::endl;
-			return 1;
-		}
-		if (out_image.IsNotNull()) out_image->DisconnectPipeline();
-	}
-	else { out_image = image; }
-	//
-	if (out_image.IsNotNull())
+		size[2]==original_size[2])
 	{
-		const typename T::SpacingType final_spacing = out_image->GetSpacing();
-		ivariant->di->x_spacing = final_spacing[0];
-		ivariant->di->y_spacing = final_spacing[1];
-		ivariant->di->dimx = size[0];
-		ivariant->di->dimy = size[1];
+		ivariant->di->x_spacing = original_spacing[0];
+		ivariant->di->y_spacing = original_spacing[1];
 	}
 	else
 	{
-		std::cout << "out_image.IsNull()" << std::endl;
-		return 1;
+		ivariant->di->x_spacing = spacing[0];
+		ivariant->di->y_spacing = spacing[1];
+	}
+	ivariant->di->dimx = size[0];
+	ivariant->di->dimy = size[1];
+	std::vector<size_t> ix, iy, iz;
+	try
+	{
+		get_nearest_indices(ix, size[0], original_size[0], spacing[0]/original_spacing[0]);
+		get_nearest_indices(iy, size[1], original_size[1], spacing[1]/original_spacing[1]);
+		get_nearest_indices(iz, size[2], original_size[2], spacing[2]/original_spacing[2]);
+	}
+	catch (const std::bad_alloc&)
+	{
+		return 2;
 	}
 	//
-	if (pb) pb->setValue(-1);
-	qApp->processEvents();
-	//
-	// array maximum size 0x7fffffff
+	// Staging for a slab of slices, at least one slice,
+	// array maximum size 0x7fffffff.
+	const size_t staging_size = 64*1024*1024;
+	const size_t slice_size = size[0]*size[1];
+	size_t bytes = 0;
 	switch(texture_type)
 	{
 	case 0:
-		{
-			if ((size[0]*size[1]*size[2])>= 0x7fffffff/sizeof(float))
-				return 2;
-			try	{ float_buf=new float[(size[0]*size[1]*size[2])]; }
-			catch (const std::bad_alloc&) { float_buf = NULL; }
-			if (!float_buf) return 2;
-			tt = " GL_R16F";
-		}
+		bytes = sizeof(float);
+		tt = " GL_R16F";
 		break;
 	case 1:
-		{
-			if ((size[0]*size[1]*size[2]) >= 0x7fffffff/sizeof(unsigned short))
-				return 2;
-			try	{ short_buf=new unsigned short[(size[0]*size[1]*size[2])]; }
-			catch (const std::bad_alloc&) { short_buf=NULL; }
-			if (!short_buf) return 2;
-			tt = " GL_R16";
-		}
+		bytes = sizeof(unsigned short);
+		tt = " GL_R16";
 		break;
 	case 2:
-		{
-			if ((size[0]*size[1]*size[2]) >= 0x7fffffff/sizeof(GLubyte))
-				return 2;
-			try	{ ub_buf=new GLubyte[(size[0]*size[1]*size[2])]; }
-			catch (const std::bad_alloc&) { ub_buf = NULL; }
-			if (!ub_buf) return 2;
-			tt = " GL_R8";
-		}
+		bytes = sizeof(GLubyte);
+		tt = " GL_R8";
 		break;
 	default: return 1;
 	}
-	//
-	if (pb) pb->setValue(-1);
-	qApp->processEvents();
-	//
+	if (slice_size >= 0x7fffffff/bytes) return 2;
+	size_t slab = staging_size/(slice_size*bytes);
+	if (slab < 1) slab = 1;
+	if (slab > size[2]) slab = size[2];
+	// bricks of 32^3 voxels, min/max are set while uploading
+	{
+		TexBricks & b = ivariant->di->bricks;
+		b.clear();
+		b.size = 32;
+		for (int k = 0; k < 3; ++k)
+		{
+			b.tex[k] = static_cast<int>(size[k]);
+			b.dim[k] = static_cast<int>((size[k] + b.size - 1)/b.size);
+		}
+		const size_t count = static_cast<size_t>(b.dim[0])*b.dim[1]*b.dim[2];
+		try
+		{
+			b.min.assign(count, FLT_MAX);
+			b.max.assign(count, -FLT_MAX);
+		}
+		catch (const std::bad_alloc&)
+		{
+			b.clear();
+			return 2;
+		}
+	}
 	try
 	{
-		SliceConstIteratorType inIterator(
-			out_image,
-			out_image->GetLargestPossibleRegion());
-		inIterator.SetFirstDirection(0);  // X axis
-		inIterator.SetSecondDirection(1); // Y axis
-		inIterator.GoToBegin();
-		size_t j = 0;
-		const double max_minus_min =
-			(rmax-rmin > 0) ? rmax-rmin : 1e-9;
-		while(!inIterator.IsAtEnd())
+		switch(texture_type)
 		{
-			while (!inIterator.IsAtEndOfSlice())
-			{
-				while (!inIterator.IsAtEndOfLine())
-				{
-					const typename T::PixelType v = inIterator.Get();
-					const double f = static_cast<const double>(v);
-					// GL_R16F
-					if (texture_type == 0)
-						float_buf[j] = static_cast<float>((f+(-rmin))/max_minus_min);
-					// GL_R16
-					else if(texture_type == 1)
-						short_buf[j] = static_cast<unsigned short>(
-							(double)USHRT_MAX*((f+(-rmin))/max_minus_min));
-					// GL_R8
-					else if(texture_type == 2)
-						ub_buf[j] = static_cast<GLubyte>(
-							(double)UCHAR_MAX*((f+(-rmin))/max_minus_min));
-					++j;
-					++inIterator;
-				}
-				inIterator.NextLine();
-			}
-			inIterator.NextSlice();
+		case 0: float_buf = new float[slab*slice_size]; break;
+		case 1: short_buf = new unsigned short[slab*slice_size]; break;
+		case 2: ub_buf    = new GLubyte[slab*slice_size]; break;
+		default: break;
 		}
 	}
-	catch(itk::ExceptionObject & ex)
+	catch (const std::bad_alloc&)
 	{
-		std::cout << ex.GetDescription() << std::endl;
-		error__ = 4;
-		goto quit__;
+		ivariant->di->bricks.clear();
+		return 2;
 	}
 	//
-	if (pb) pb->setValue(-1);
-	qApp->processEvents();
-	//
 	gl->makeCurrent();
 #if 0
 	if (!gl->isValid())
@@ -677,11 +981,10 @@ template<typename T> int generate_tex3d(
 			gl->glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 		}
 		break;
-	case 2: // trilinear
+	case 2: // trilinear, mipmaps after upload
 		{
 			gl->glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
 			gl->glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-			gl->glGenerateMipmap(GL_TEXTURE_3D);
 		}
 		break;
 	default: // no
@@ -705,11 +1008,10 @@ template<typename T> int generate_tex3d(
 			glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 		}
 		break;
-	case 2: // trilinear
+	case 2: // trilinear, mipmaps after upload
 		{
 			glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
 			glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-			glGenerateMipmap(GL_TEXTURE_3D);
 		}
 		break;
 	default: // no
@@ -730,6 +1032,7 @@ template<typename T> int generate_tex3d(
     // 4 word-alignment
     // 8 rows start on double-word boundaries
     //  
+	// Storage only, data is uploaded in slabs.
 	switch (texture_type)
 	{
 	case 0:
@@ -740,13 +1043,13 @@ template<typename T> int generate_tex3d(
 			gl->glTexImage3D(
 				GL_TEXTURE_3D, 0, GL_R16F,
 				size[0], size[1], size[2],
-				0, GL_RED, GL_FLOAT, float_buf);
+				0, GL_RED, GL_FLOAT, NULL);
 #else
 			glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
 			glTexImage3D(
 				GL_TEXTURE_3D, 0, GL_R16F,
 				size[0], size[1], size[2],
-				0, GL_RED, GL_FLOAT, float_buf);
+				0, GL_RED, GL_FLOAT, NULL);
 #endif
 		}
 		break;
@@ -758,13 +1061,13 @@ template<typename T> int generate_tex3d(
 			gl->glTexImage3D(
 				GL_TEXTURE_3D, 0, GL_R16,
 				size[0], size[1], size[2],
-				0, GL_RED, GL_UNSIGNED_SHORT, short_buf);
+				0, GL_RED, GL_UNSIGNED_SHORT, NULL);
 #else
 			glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
 			glTexImage3D(
 				GL_TEXTURE_3D, 0, GL_R16,
 				size[0], size[1], size[2],
-				0, GL_RED, GL_UNSIGNED_SHORT, short_buf);
+				0, GL_RED, GL_UNSIGNED_SHORT, NULL);
 #endif
 		}
 		break;
@@ -777,14 +1080,14 @@ template<typename T> int generate_tex3d(
 			gl->glTexImage3D(
 				GL_TEXTURE_3D, 0, GL_R8,
 				size[0], size[1], size[2],
-				0, GL_RED, GL_UNSIGNED_BYTE, ub_buf);
+				0, GL_RED, GL_UNSIGNED_BYTE, NULL);
 #else
 			glPixelStorei(
 				GL_UNPACK_ALIGNMENT, 1);
 			glTexImage3D(
 				GL_TEXTURE_3D, 0, GL_R8,
 				size[0], size[1], size[2],
-				0, GL_RED, GL_UNSIGNED_BYTE, ub_buf);
+				0, GL_RED, GL_UNSIGNED_BYTE, NULL);
 #endif
 		}
 		break;
@@ -803,6 +1106,57 @@ template<typename T> int generate_tex3d(
 			<< "error : OpenGL error 0x505\n"
 			<< glerror__ << std::endl;
 #endif
+#if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
+		gl->glBindTexture(GL_TEXTURE_3D, 0);
+		gl->glDeleteTextures(1, &(ivariant->di->cube_3dtex));
+#else
+		glBindTexture(GL_TEXTURE_3D, 0);
+		glDeleteTextures(1, &(ivariant->di->cube_3dtex));
+#endif
+		ivariant->di->cube_3dtex = 0;
+		ivariant->di->tex_info = -1;
+		error__=3;
+		goto quit__;
+	}
+	//
+	switch (texture_type)
+	{
+	case 0:
+		upload_tex3d<T, float>(
+			image, gl, ivariant->di->cube_3dtex, 2,
+			float_buf, slab, size, ix, iy, iz,
+			rmin, rmax, 1.0, GL_FLOAT, &(ivariant->di->bricks), pb);
+		break;
+	case 1:
+		upload_tex3d<T, unsigned short>(
+			image, gl, ivariant->di->cube_3dtex, 2,
+			short_buf, slab, size, ix, iy, iz,
+			rmin, rmax, (double)USHRT_MAX, GL_UNSIGNED_SHORT, &(ivariant->di->bricks), pb);
+		break;
+	case 2:
+		upload_tex3d<T, GLubyte>(
+			image, gl, ivariant->di->cube_3dtex, 1,
+			ub_buf, slab, size, ix, iy, iz,
+			rmin, rmax, (double)UCHAR_MAX, GL_UNSIGNED_BYTE, &(ivariant->di->bricks), pb);
+		break;
+	default: break;
+	}
+	gl->makeCurrent();
+#if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
+	gl->glBindTexture(GL_TEXTURE_3D, ivariant->di->cube_3dtex);
+	if (ivariant->di->filtering == 2) gl->glGenerateMipmap(GL_TEXTURE_3D);
+#else
+	glBindTexture(GL_TEXTURE_3D, ivariant->di->cube_3dtex);
+	if (ivariant->di->filtering == 2) glGenerateMipmap(GL_TEXTURE_3D);
+#endif
+	//
+#if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
+	glerror__ = gl->glGetError();
+#else
+	glerror__ = glGetError();
+#endif
+	if (glerror__ == 0x505)
+	{
 #if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
 		gl->glBindTexture(GL_TEXTURE_3D, 0);
 		gl->glDeleteTextures(1, &(ivariant->di->cube_3dtex));
@@ -823,9 +1177,10 @@ template<typename T> int generate_tex3d(
 	}
 	//
 	if (pb) pb->setValue(-1);
-	qApp->processEvents();
+	CommonUtils::process_events();
 	//
 quit__:
+	if (error__ != 0) ivariant->di->bricks.clear();
 	if (float_buf) delete [] float_buf;
 	if (short_buf) delete [] short_buf;
 	if (ub_buf)    delete [] ub_buf; 
@@ -1222,14 +1577,13 @@ template<typename T> QString process_dicom_monochrome_image1(
 	typename T::IndexType start;
 	typename T::PointType origin;
 	typename T::SpacingType spacing;
-	typedef itk::ImageSliceIteratorWithIndex<T> SliceIterator;
 	typename UpdateQtCommand::Pointer update_qt_command;
 	if (pb)
 	{
 		pb->setLabelText(QString("Loading data... please wait"));
 		pb->setValue(-1);
 	}
-	qApp->processEvents();
+	CommonUtils::process_events();
 	start.Fill(0);
 	size[0] = dimx;
 	size[1] = dimy;
@@ -1253,11 +1607,18 @@ template<typename T> QString process_dicom_monochrome_image1(
 		direction[1][2]>-0.000001 && direction[1][2]<0.000001 &&
 		direction[2][2]>-0.000001 && direction[2][2]<0.000001)
 			? true : false;
+	// the buffer may be the image, see alloc_monochrome_image()
+	const bool decoded_in_image =
+		image.IsNotNull() &&
+		(reinterpret_cast<char*>(image->GetBufferPointer()) == buffer);
 	try
 	{
-		image = T::New();
-		image->SetRegions(region);
-		image->Allocate();
+		if (!decoded_in_image)
+		{
+			image = T::New();
+			image->SetRegions(region);
+			image->Allocate();
+		}
 		image->SetOrigin(origin);
 		image->SetSpacing(spacing);
 		if (*bad_direction == false) image->SetDirection(direction);
@@ -1269,37 +1630,54 @@ template<typename T> QString process_dicom_monochrome_image1(
 	}
 	//
 	ivariant->image_type = image_type;
-	const typename T::PixelType * p__ =
-		reinterpret_cast<typename T::PixelType*>(buffer);
-	//
+	if (decoded_in_image) return QString("");
+	// same layout, x fastest
+	typename T::PixelType * p__ = image->GetBufferPointer();
+	if (!p__)
+	{
+		*ok = false;
+		return QString(
+			"process_dicom_monochrome_image1 : image buffer==NULL");
+	}
+	memcpy(p__, buffer, dimx * dimy * dimz * sizeof(typename T::PixelType));
+	return QString("");
+}
+
+template<typename T> char * alloc_monochrome_image_(
+	typename T::Pointer & image,
+	const size_t dimx, const size_t dimy, const size_t dimz,
+	const unsigned long long bytes)
+{
+	if (bytes != dimx * dimy * dimz * sizeof(typename T::PixelType))
+	{
+		return NULL;
+	}
+	typename T::RegionType region;
+	typename T::SizeType size;
+	typename T::IndexType start;
+	start.Fill(0);
+	size[0] = dimx;
+	size[1] = dimy;
+	size[2] = dimz;
+	region.SetIndex(start);
+	region.SetSize(size);
 	try
 	{
-		SliceIterator it(image, image->GetLargestPossibleRegion());
-		it.SetFirstDirection(0);
-		it.SetSecondDirection(1);
-		it.GoToBegin();
-		size_t j = 0;	
-		while(!it.IsAtEnd())
-		{
-			while (!it.IsAtEndOfSlice())
-			{
-				while (!it.IsAtEndOfLine())
-				{
-					it.Set(p__[j]);
-					++j;
-					++it;
-				}
-				it.NextLine();
-			}
-			it.NextSlice();
-		}
+		image = T::New();
+		image->SetRegions(region);
+		image->Allocate();
 	}
-	catch (itk::ExceptionObject & ex)
+	catch (const itk::ExceptionObject &)
 	{
-		*ok = false;
-		return QString(ex.GetDescription());
+		image = NULL;
+		return NULL;
 	}
-	return QString("");
+	catch (const std::bad_alloc &)
+	{
+		image = NULL;
+		return NULL;
+	}
+	return reinterpret_cast<char*>(image->GetBufferPointer());
 }
 
 template<typename T> QString process_dicom_monochrome_image2(
@@ -1365,13 +1743,12 @@ template<typename T> QString process_dicom_rgb_image1(
 	typename T::IndexType start;
 	typename T::PointType origin;
 	typename T::SpacingType spacing;
-	typedef itk::ImageSliceIteratorWithIndex<T> SliceIterator;
 	if (pb)
 	{
 		pb->setLabelText(QString("Loading data... please wait"));
 		pb->setValue(-1);
 	}
-	qApp->processEvents();
+	CommonUtils::process_events();
 	start.Fill(0);
 	size[0] = dimx;
 	size[1] = dimy;
@@ -1410,56 +1787,25 @@ template<typename T> QString process_dicom_rgb_image1(
 		return QString(ex.GetDescription());
 	}
 	//
-	const typename T::PixelType::ValueType * p__ =
-		reinterpret_cast<typename T::PixelType::ValueType*>(buffer);
+	typedef typename T::PixelType::ValueType ValueType;
+	const ValueType * p__ = reinterpret_cast<const ValueType*>(buffer);
 	ivariant->image_type = image_type;
-	//
-	try
+	// The buffer of the image is x-fastest interleaved RGB,
+	// same layout as the DICOM buffer.
+	ValueType * out = reinterpret_cast<ValueType*>(image->GetBufferPointer());
+	if (!out)
 	{
-		SliceIterator it(image, image->GetLargestPossibleRegion());
-		it.SetFirstDirection(0);
-		it.SetSecondDirection(1);
-		it.GoToBegin();
-		size_t j = 0;
-		while(!it.IsAtEnd())
-		{
-			while (!it.IsAtEndOfSlice())
-			{
-				while (!it.IsAtEndOfLine())
-				{
-					typename T::PixelType p;
-					if (ybr)
-					{
-						const double Y  = p__[j  ];
-						const double Cb = p__[j+1];
-						const double Cr = p__[j+2];
-						const int hscale = 1 << (bitsstored - 1);
-						const int R = static_cast<int>(Y + 1.402*(Cr-hscale));
-						const int G = static_cast<int>(Y - (0.114*1.772*(Cb-hscale) + 0.299*1.402*(Cr-hscale))/0.587);
-						const int B = static_cast<int>(Y + 1.772*(Cb-hscale));
-						p[0]=static_cast<typename T::PixelType::ValueType>(R < 0 ? 0 : R);
-						p[1]=static_cast<typename T::PixelType::ValueType>(G < 0 ? 0 : G);
-						p[2]=static_cast<typename T::PixelType::ValueType>(B < 0 ? 0 : B);
-					}
-					else
-					{
-						p[0]=static_cast<typename T::PixelType::ValueType>(p__[j  ]);
-						p[1]=static_cast<typename T::PixelType::ValueType>(p__[j+1]);
-						p[2]=static_cast<typename T::PixelType::ValueType>(p__[j+2]);
-					}
-					it.Set(p);
-					j+=3;
-					++it;
-				}
-				it.NextLine();
-			}
-			it.NextSlice();
-		}
+		*ok = false;
+		return QString("process_dicom_rgb_image1 : image buffer==NULL");
 	}
-	catch(itk::ExceptionObject & ex)
+	const size_t n = dimx * dimy * dimz;
+	if (ybr)
 	{
-		*ok = false;
-		return QString(ex.GetDescription());
+		YBRUtils::ybr_to_rgb(p__, out, n, bitsstored);
+	}
+	else
+	{
+		memcpy(out, p__, 3 * n * sizeof(ValueType));
 	}
 	return QString("");
 }
@@ -1520,7 +1866,7 @@ template<typename T> QString process_dicom_rgba_image1(
 		pb->setLabelText(QString("Loading data... please wait"));
 		pb->setValue(-1);
 	}
-	qApp->processEvents();
+	CommonUtils::process_events();
 	start.Fill(0);
 	size[0] = dimx;
 	size[1] = dimy;
@@ -1752,16 +2098,15 @@ QString apply_per_slice_rescale_(
 
 int CommonUtils::get_next_id()
 {
-	static int id___ = 0;
-	++id___;
-	return id___;
+	// series may be decoded concurrently
+	static QAtomicInt id___(0);
+	return id___.fetchAndAddOrdered(1) + 1;
 }
 
 int CommonUtils::get_next_group_id()
 {
-	static int group_id___ = 0;
-	++group_id___;
-	return group_id___;
+	static QAtomicInt group_id___(0);
+	return group_id___.fetchAndAddOrdered(1) + 1;
 }
 
 double CommonUtils::random_range(
@@ -3151,6 +3496,52 @@ QString CommonUtils::get_orientation1(
 	return orient;
 }
 
+char * CommonUtils::alloc_monochrome_image(
+	ImageVariant * ivariant,
+	const mdcm::PixelFormat & pixelformat,
+	unsigned int dimx, unsigned int dimy, unsigned int dimz,
+	unsigned long long bytes)
+{
+	if (!ivariant || pixelformat.GetSamplesPerPixel() != 1) return NULL;
+	switch (pixelformat)
+	{
+	case mdcm::PixelFormat::INT12:
+	case mdcm::PixelFormat::INT16:
+		return alloc_monochrome_image_<ImageTypeSS>(
+			ivariant->pSS, dimx, dimy, dimz, bytes);
+	case mdcm::PixelFormat::UINT12:
+	case mdcm::PixelFormat::UINT16:
+		return alloc_monochrome_image_<ImageTypeUS>(
+			ivariant->pUS, dimx, dimy, dimz, bytes);
+	case mdcm::PixelFormat::INT32:
+		return alloc_monochrome_image_<ImageTypeSI>(
+			ivariant->pSI, dimx, dimy, dimz, bytes);
+	case mdcm::PixelFormat::UINT32:
+		return alloc_monochrome_image_<ImageTypeUI>(
+			ivariant->pUI, dimx, dimy, dimz, bytes);
+	case mdcm::PixelFormat::INT64:
+		return alloc_monochrome_image_<ImageTypeSLL>(
+			ivariant->pSLL, dimx, dimy, dimz, bytes);
+	case mdcm::PixelFormat::UINT64:
+		return alloc_monochrome_image_<ImageTypeULL>(
+			ivariant->pULL, dimx, dimy, dimz, bytes);
+	case mdcm::PixelFormat::INT8:
+	case mdcm::PixelFormat::UINT8:
+	case mdcm::PixelFormat::SINGLEBIT:
+		return alloc_monochrome_image_<ImageTypeUC>(
+			ivariant->pUC, dimx, dimy, dimz, bytes);
+	case mdcm::PixelFormat::FLOAT32:
+		return alloc_monochrome_image_<ImageTypeF>(
+			ivariant->pF, dimx, dimy, dimz, bytes);
+	case mdcm::PixelFormat::FLOAT64:
+		return alloc_monochrome_image_<ImageTypeD>(
+			ivariant->pD, dimx, dimy, dimz, bytes);
+	default:
+		break;
+	}
+	return NULL;
+}
+
 QString CommonUtils::gen_itk_image(bool * ok,
 	std::vector<char*> & data,
 	bool delete_data,
@@ -4568,6 +4959,16 @@ double CommonUtils::get_total_memory_saved()
 	return saved_total_memory;
 }
 
+bool CommonUtils::is_gui_thread()
+{
+	return (QThread::currentThread() == QCoreApplication::instance()->thread());
+}
+
+void CommonUtils::process_events()
+{
+	if (is_gui_thread()) QApplication::processEvents();
+}
+
 double CommonUtils::get_total_memory()
 {
 #ifdef USE_GET_TOTAL_MEM
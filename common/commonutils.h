@@ -80,6 +80,14 @@ public:
 	static void get_dimensions_(ImageVariant*);
 	static QString get_orientation1(
 		const ImageVariant*, unsigned int*);
+	// Allocates the ITK image gen_itk_image() will use for
+	// a monochrome volume of the given size in bytes, so it
+	// can be decoded in place. Returns its buffer or NULL.
+	static char * alloc_monochrome_image(
+		ImageVariant*,
+		const mdcm::PixelFormat&,
+		unsigned int, unsigned int, unsigned int,
+		unsigned long long);
 	static QString gen_itk_image(
 		bool*,
 		std::vector<char*> &, bool,
@@ -100,6 +108,10 @@ public:
 	static void save_total_memory();
 	static double get_total_memory_saved();
 	static double get_total_memory();
+	// Images may be read on the pool, pixmaps and
+	// QApplication::processEvents() on the GUI thread only.
+	static bool is_gui_thread();
+	static void process_events();
 	static void set_screenshot_dir(const QString&);
 	static QString get_screenshot_name(const QString&);
 	static QString get_screenshot_name2();
@@ -0,0 +1,73 @@
+#include "fileprefetch.h"
+#include <QtGlobal>
+#include <QThread>
+#include <QRunnable>
+#include <QFile>
+#include <vector>
+
+namespace
+{
+
+class PrefetchRunnable : public QRunnable
+{
+public:
+	PrefetchRunnable(const QString & f_, const QAtomicInt * c_)
+		: f(f_), canceled(c_)
+	{
+		setAutoDelete(true);
+	}
+	void run() override
+	{
+#if QT_VERSION >= QT_VERSION_CHECK(5,14,0)
+		if (canceled->loadRelaxed()) return;
+#else
+		if (canceled->load()) return;
+#endif
+		QFile file(f);
+		if (!file.open(QIODevice::ReadOnly)) return;
+		std::vector<char> buffer(1048576);
+		while (true)
+		{
+#if QT_VERSION >= QT_VERSION_CHECK(5,14,0)
+			if (canceled->loadRelaxed()) break;
+#else
+			if (canceled->load()) break;
+#endif
+			const qint64 r = file.read(&buffer[0], buffer.size());
+			if (r <= 0) break;
+		}
+		file.close();
+	}
+private:
+	const QString f;
+	const QAtomicInt * canceled;
+};
+
+}
+
+FilePrefetch::FilePrefetch(int threads) : canceled(0)
+{
+	const int n = QThread::idealThreadCount();
+	// I/O bound, few threads are enough
+	pool.setMaxThreadCount(qMax(1, qMin(threads, (n > 0) ? n : 1)));
+}
+
+FilePrefetch::~FilePrefetch()
+{
+	cancel();
+}
+
+void FilePrefetch::add(const QStringList & l)
+{
+	for (int x = 0; x < l.size(); ++x)
+	{
+		pool.start(new PrefetchRunnable(l.at(x), &canceled));
+	}
+}
+
+void FilePrefetch::cancel()
+{
+	canceled.fetchAndStoreOrdered(1);
+	pool.waitForDone();
+	canceled.fetchAndStoreOrdered(0);
+}
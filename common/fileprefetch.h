@@ -0,0 +1,24 @@
+#ifndef FILEPREFETCH__H_
+#define FILEPREFETCH__H_
+
+#include <QThreadPool>
+#include <QAtomicInt>
+#include <QStringList>
+
+// Reads files on a small background pool, so they are in
+// the system cache when decoded later on the GUI thread.
+// Files are read in the order they are added.
+class FilePrefetch
+{
+public:
+	FilePrefetch(int = 2);
+	~FilePrefetch();
+	void add(const QStringList&);
+	// Skips queued and stops running reads, waits for them.
+	void cancel();
+private:
+	QThreadPool pool;
+	QAtomicInt canceled;
+};
+
+#endif // FILEPREFETCH__H_
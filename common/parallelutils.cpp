@@ -0,0 +1,125 @@
+#include "parallelutils.h"
+#include <QtGlobal>
+#include <QThread>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QSemaphore>
+#include <QAtomicInt>
+
+namespace
+{
+
+class ParallelPool : public QThreadPool
+{
+public:
+	ParallelPool()
+	{
+		const int n = QThread::idealThreadCount();
+		setMaxThreadCount((n > 0) ? n : 1);
+		// keep threads alive, no re-creation per frame
+		setExpiryTimeout(-1);
+	}
+};
+
+Q_GLOBAL_STATIC(ParallelPool, parallel_pool)
+
+// Shared between the caller and the workers, the last one
+// releasing its reference deletes it, a worker may start
+// after the caller already returned.
+class ParallelState
+{
+public:
+	ParallelState(ParallelTask * t_, int count_, int refs_)
+		: task(t_), count(count_), next(0), refs(refs_)
+	{
+	}
+	void work()
+	{
+		while (true)
+		{
+			const int i = next.fetchAndAddOrdered(1);
+			if (i >= count) break;
+			task->process(i);
+			done.release(1);
+		}
+	}
+	void unref()
+	{
+		if (!refs.deref()) delete this;
+	}
+	ParallelTask * task;
+	const int count;
+	QAtomicInt next;
+	QAtomicInt refs;
+	QSemaphore done;
+};
+
+class ParallelRunnable : public QRunnable
+{
+public:
+	ParallelRunnable(ParallelState * s_) : s(s_)
+	{
+		setAutoDelete(true);
+	}
+	void run() override
+	{
+		s->work();
+		s->unref();
+	}
+private:
+	ParallelState * s;
+};
+
+}
+
+ParallelUtils::ParallelUtils()
+{
+}
+
+ParallelUtils::~ParallelUtils()
+{
+}
+
+QThreadPool * ParallelUtils::get_pool()
+{
+	return static_cast<QThreadPool*>(parallel_pool());
+}
+
+int ParallelUtils::get_num_threads()
+{
+	QThreadPool * pool = get_pool();
+	if (!pool) return 1;
+	return pool->maxThreadCount();
+}
+
+void ParallelUtils::set_max_threads(int x)
+{
+	QThreadPool * pool = get_pool();
+	if (!pool) return;
+	const int n = QThread::idealThreadCount();
+	const int max_threads = (n > 0) ? n : 1;
+	pool->setMaxThreadCount((x > 0) ? qMin(x, max_threads) : max_threads);
+}
+
+void ParallelUtils::run(ParallelTask * t, int count)
+{
+	if (!t || count < 1) return;
+	QThreadPool * pool = get_pool();
+	const int num_threads = get_num_threads();
+	if (!pool || count == 1 || num_threads < 2)
+	{
+		for (int i = 0; i < count; ++i) t->process(i);
+		return;
+	}
+	const int workers = qMin(num_threads, count) - 1;
+	ParallelState * s = new ParallelState(t, count, workers + 1);
+	for (int i = 0; i < workers; ++i)
+	{
+		pool->start(new ParallelRunnable(s));
+	}
+	s->work();
+	// Wait for parts, not for workers, a worker still queued
+	// (e.g. nested call from a busy pool) finds nothing to do.
+	s->done.acquire(count);
+	s->unref();
+}
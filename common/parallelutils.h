@@ -0,0 +1,33 @@
+#ifndef PARALLELUTILS__H_
+#define PARALLELUTILS__H_
+
+class QThreadPool;
+
+// Work to be split in 'count' independent parts,
+// process() is called concurrently with different indices.
+class ParallelTask
+{
+public:
+	ParallelTask() {}
+	virtual ~ParallelTask() {}
+	virtual void process(int) = 0;
+};
+
+class ParallelUtils
+{
+public:
+	ParallelUtils();
+	~ParallelUtils();
+	static QThreadPool * get_pool();
+	static int get_num_threads();
+	// Caps the threads of the pool (and of codecs using
+	// get_num_threads()), 0 - number of processors.
+	static void set_max_threads(int);
+	// Runs parts 0..count-1 on the shared pool, the calling
+	// thread takes parts too. Idle workers take the next free
+	// part, so uneven parts are balanced. Returns after all
+	// parts are processed.
+	static void run(ParallelTask*, int);
+};
+
+#endif // PARALLELUTILS__H_
@@ -15,6 +15,66 @@
 #include "commonutils.h"
 #include <climits>
 
+TexBricks::TexBricks()
+{
+	clear();
+}
+
+TexBricks::~TexBricks()
+{
+}
+
+void TexBricks::clear()
+{
+	size = 0;
+	for (int x = 0; x < 3; ++x) { dim[x] = tex[x] = 0; }
+	min.clear();
+	max.clear();
+}
+
+bool TexBricks::is_empty() const
+{
+	return (size < 1 || min.empty() ||
+		min.size() != (size_t)dim[0]*dim[1]*dim[2] ||
+		max.size() != min.size());
+}
+
+bool TexBricks::get_box(float low, float high, float * box) const
+{
+	if (is_empty()) return false;
+	int b[6] = { INT_MAX, -1, INT_MAX, -1, INT_MAX, -1 };
+	size_t j = 0;
+	for (int z = 0; z < dim[2]; ++z)
+	{
+		for (int y = 0; y < dim[1]; ++y)
+		{
+			for (int x = 0; x < dim[0]; ++x)
+			{
+				if (max[j] >= low && min[j] <= high)
+				{
+					if (x < b[0]) b[0] = x;
+					if (x > b[1]) b[1] = x;
+					if (y < b[2]) b[2] = y;
+					if (y > b[3]) b[3] = y;
+					if (z < b[4]) b[4] = z;
+					if (z > b[5]) b[5] = z;
+				}
+				++j;
+			}
+		}
+	}
+	if (b[1] < 0) return false;
+	// one voxel margin, linear filtering reads neighbours
+	for (int k = 0; k < 3; ++k)
+	{
+		const int v0 = b[2*k]*size - 1;
+		const int v1 = (b[2*k + 1] + 1)*size + 1;
+		box[2*k]     = (v0 > 0) ? (float)v0/tex[k] : 0.0f;
+		box[2*k + 1] = (v1 < tex[k]) ? (float)v1/tex[k] : 1.0f;
+	}
+	return true;
+}
+
 DisplayInterface::DisplayInterface(
 	const int id_,
 	const bool opengl_ok_,
@@ -107,6 +167,7 @@ void DisplayInterface::close(bool clear_geometry)
 		cube_3dtex =  0;
 	}
 	tex_info = -1;
+	bricks.clear();
 	x_spacing = y_spacing = 0.0;
 	dimx = dimy = 0;
 	TriMeshes::iterator mi;
@@ -366,6 +427,8 @@ ImageVariant2D::~ImageVariant2D()
 	if(pUC_rgba.IsNotNull()){pUC_rgba->DisconnectPipeline();};pUC_rgba=NULL;
 	if(pF_rgba.IsNotNull()) {pF_rgba->DisconnectPipeline(); };pF_rgba =NULL;
 	if(pD_rgba.IsNotNull()) {pD_rgba->DisconnectPipeline(); };pD_rgba =NULL;
+	slice_source = NULL;
+	slice_buffer = NULL;
 }
 
 void ProcessImageThread_::run()
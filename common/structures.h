@@ -733,6 +733,27 @@ struct FrameLevel
 };
 typedef QMap<int, FrameLevel> FrameLevels;
 
+// Layout of the 3D texture in bricks of 'size' voxels per side,
+// min/max of each brick in normalized texture values (0 - 1),
+// s. generate_tex3d(). The last bricks of each axis may be smaller.
+class TexBricks
+{
+public:
+	TexBricks();
+	~TexBricks();
+	void clear();
+	bool is_empty() const;
+	// Bounding box of bricks with values in [low, high] in
+	// texture coordinates, x0, x1, y0, y1, z0, z1,
+	// false if empty or no brick has such values.
+	bool get_box(float, float, float*) const;
+	int size;
+	int dim[3];
+	int tex[3];
+	std::vector<float> min;
+	std::vector<float> max;
+};
+
 class DisplayInterface
 {
 public:
@@ -787,6 +808,7 @@ public:
 	int selected_y_slice;
 	int selected_z_slice;
 	double bb_x_min, bb_x_max, bb_y_min, bb_y_max;
+	TexBricks bricks;
 	unsigned short bits_allocated, bits_stored, high_bit;
 	double shift_tmp, scale_tmp;
 	float R, G, B;
@@ -956,6 +978,10 @@ public:
 	RGBAImage2DTypeF ::Pointer pF_rgba; //25
 	RGBAImage2DTypeD ::Pointer pD_rgba; //26
 	//
+	// Volume of a slice sharing its buffer and the buffer
+	// of the last strided slice, s. GUI/sliceview.hxx
+	itk::DataObject::Pointer slice_source;
+	itk::DataObject::Pointer slice_buffer;
 };
 
 class ImageContainer
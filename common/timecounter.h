@@ -0,0 +1,49 @@
+#ifndef TIMECOUNTER__H_
+#define TIMECOUNTER__H_
+
+#include <QtGlobal>
+#include <QString>
+
+// Timing counter, e.g. for the 2D LUT pass.
+class TimeCounter
+{
+public:
+	TimeCounter() : frames(0), total_ns(0), last_ns(0), max_ns(0) {}
+	void add(qint64 ns)
+	{
+		++frames;
+		total_ns += ns;
+		last_ns = ns;
+		if (ns > max_ns) max_ns = ns;
+	}
+	void reset()
+	{
+		frames = 0;
+		total_ns = 0;
+		last_ns = 0;
+		max_ns = 0;
+	}
+	qint64 get_frames() const { return frames; }
+	double get_last_ms() const { return last_ns * 1e-6; }
+	double get_max_ms() const { return max_ns * 1e-6; }
+	double get_average_ms() const
+	{
+		if (frames < 1) return 0.0;
+		return (total_ns / static_cast<double>(frames)) * 1e-6;
+	}
+	QString to_string() const
+	{
+		return
+			QString("last ") + QString::number(get_last_ms(), 'f', 3) +
+			QString(" ms, average ") + QString::number(get_average_ms(), 'f', 3) +
+			QString(" ms, max ") + QString::number(get_max_ms(), 'f', 3) +
+			QString(" ms, ") + QString::number(frames) + QString(" frames");
+	}
+private:
+	qint64 frames;
+	qint64 total_ns;
+	qint64 last_ns;
+	qint64 max_ns;
+};
+
+#endif // TIMECOUNTER__H_
@@ -0,0 +1,233 @@
+#include "ybrutils.h"
+#include "parallelutils.h"
+#include <limits>
+
+namespace
+{
+
+// Fixed-point, 16 fractional bits, 'int' is enough for
+// 8 bit samples, 16 bit samples need 'long long'.
+const int fraction_bits = 16;
+const long long one = 1LL << fraction_bits;
+const long long k_r  = static_cast<long long>(1.402 * one + 0.5);
+const long long k_b  = static_cast<long long>(1.772 * one + 0.5);
+const long long k_gb = static_cast<long long>(0.114 * 1.772 / 0.587 * one + 0.5);
+const long long k_gr = static_cast<long long>(0.299 * 1.402 / 0.587 * one + 0.5);
+const size_t min_part_size = 65536;
+
+template<typename T> int get_half(int bits_stored)
+{
+	const int bits = static_cast<int>(sizeof(T)) * 8;
+	const int b = (bits_stored > 0 && bits_stored <= bits) ? bits_stored : bits;
+	return 1 << (b - 1);
+}
+
+template<typename T> int get_max(int bits_stored)
+{
+	const int bits = static_cast<int>(sizeof(T)) * 8;
+	const int b = (bits_stored > 0 && bits_stored <= bits) ? bits_stored : bits;
+	const int m = (1 << b) - 1;
+	const int t = static_cast<int>(std::numeric_limits<T>::max());
+	return (m < t) ? m : t;
+}
+
+template<typename A> inline A clamp_fixed(A v, A max)
+{
+	if (v < 0) return 0;
+	v >>= fraction_bits;
+	return (v > max) ? max : v;
+}
+
+template<typename T> struct Accumulator
+{
+	typedef long long Type;
+};
+
+template<> struct Accumulator<unsigned char>
+{
+	typedef int Type;
+};
+
+template<typename T> void convert_integer(
+	const T * in, T * out, size_t n, int half_, int max_)
+{
+	typedef typename Accumulator<T>::Type A;
+	const A half = static_cast<A>(half_);
+	const A max  = static_cast<A>(max_);
+	const A o    = static_cast<A>(one);
+	const A r    = static_cast<A>(k_r);
+	const A b    = static_cast<A>(k_b);
+	const A gb   = static_cast<A>(k_gb);
+	const A gr   = static_cast<A>(k_gr);
+	for (size_t j = 0; j < 3 * n; j += 3)
+	{
+		const A y  = static_cast<A>(in[j]) * o;
+		const A cb = static_cast<A>(in[j + 1]) - half;
+		const A cr = static_cast<A>(in[j + 2]) - half;
+		out[j]     = static_cast<T>(clamp_fixed<A>(y + r * cr, max));
+		out[j + 1] = static_cast<T>(clamp_fixed<A>(y - gb * cb - gr * cr, max));
+		out[j + 2] = static_cast<T>(clamp_fixed<A>(y + b * cb, max));
+	}
+}
+
+// 8 bit samples, contributions of chroma values and clamping
+// as tables, same results as convert_integer().
+struct Table8
+{
+	Table8(int half, int max)
+	{
+		for (int x = 0; x < 256; ++x)
+		{
+			const int c = x - half;
+			r[x]  = static_cast<int>((k_r * c) >> fraction_bits);
+			b[x]  = static_cast<int>((k_b * c) >> fraction_bits);
+			gb[x] = static_cast<int>(-k_gb * c);
+			gr[x] = static_cast<int>(-k_gr * c);
+		}
+		for (int x = 0; x < clip_size; ++x)
+		{
+			const int v = x - clip_offset;
+			clip[x] = static_cast<unsigned char>((v < 0) ? 0 : ((v > max) ? max : v));
+		}
+	}
+	// covers Y + chroma contributions of 8 bit values
+	static const int clip_offset = 512;
+	static const int clip_size = 1536;
+	int r[256];
+	int b[256];
+	int gb[256];
+	int gr[256];
+	unsigned char clip[clip_size];
+};
+
+void convert_table(const unsigned char * in, unsigned char * out, size_t n, const Table8 * t)
+{
+	const unsigned char * c = t->clip + Table8::clip_offset;
+	for (size_t j = 0; j < 3 * n; j += 3)
+	{
+		const int y  = in[j];
+		const int cb = in[j + 1];
+		const int cr = in[j + 2];
+		out[j]     = c[y + t->r[cr]];
+		out[j + 1] = c[(y * static_cast<int>(one) + t->gb[cb] + t->gr[cr]) >> fraction_bits];
+		out[j + 2] = c[y + t->b[cb]];
+	}
+}
+
+// Same as the former per-pixel conversion, not clamped above.
+void convert_float(const float * in, float * out, size_t n, int half)
+{
+	for (size_t j = 0; j < 3 * n; j += 3)
+	{
+		const double Y  = in[j];
+		const double Cb = in[j + 1];
+		const double Cr = in[j + 2];
+		const int R = static_cast<int>(Y + 1.402 * (Cr - half));
+		const int G = static_cast<int>(Y - (0.114 * 1.772 * (Cb - half) + 0.299 * 1.402 * (Cr - half)) / 0.587);
+		const int B = static_cast<int>(Y + 1.772 * (Cb - half));
+		out[j]     = static_cast<float>(R < 0 ? 0 : R);
+		out[j + 1] = static_cast<float>(G < 0 ? 0 : G);
+		out[j + 2] = static_cast<float>(B < 0 ? 0 : B);
+	}
+}
+
+template<typename T> class YBRTask : public ParallelTask
+{
+public:
+	YBRTask(const T * in_, T * out_, size_t n_, size_t part_size_, int half_, int max_)
+		:
+		in(in_), out(out_), n(n_), part_size(part_size_), half(half_), max(max_), table(NULL)
+	{
+	}
+	~YBRTask()
+	{
+		delete table;
+	}
+	void process(int i) override
+	{
+		const size_t first = static_cast<size_t>(i) * part_size;
+		if (first >= n) return;
+		const size_t count = (n - first < part_size) ? n - first : part_size;
+		convert(in + 3 * first, out + 3 * first, count);
+	}
+	void convert(const T * in_, T * out_, size_t count)
+	{
+		convert_integer<T>(in_, out_, count, half, max);
+	}
+
+private:
+	const T * in;
+	T * out;
+	const size_t n;
+	const size_t part_size;
+	const int half;
+	const int max;
+	const Table8 * table;
+};
+
+template<> YBRTask<unsigned char>::YBRTask(
+	const unsigned char * in_, unsigned char * out_, size_t n_, size_t part_size_, int half_, int max_)
+	:
+	in(in_), out(out_), n(n_), part_size(part_size_), half(half_), max(max_),
+	table(new Table8(half_, max_))
+{
+}
+
+template<> void YBRTask<unsigned char>::convert(const unsigned char * in_, unsigned char * out_, size_t count)
+{
+	convert_table(in_, out_, count, table);
+}
+
+template<> void YBRTask<float>::convert(const float * in_, float * out_, size_t count)
+{
+	convert_float(in_, out_, count, half);
+}
+
+template<typename T> void run(const T * in, T * out, size_t n, int half, int max)
+{
+	if (!in || !out || n < 1) return;
+	const size_t threads = static_cast<size_t>(ParallelUtils::get_num_threads());
+	// a few parts per thread for balancing, not too small
+	size_t part_size = (n + 4 * threads - 1) / (4 * threads);
+	if (part_size < min_part_size) part_size = min_part_size;
+	const size_t count = (n + part_size - 1) / part_size;
+	if (count > static_cast<size_t>(std::numeric_limits<int>::max())) return;
+	YBRTask<T> t(in, out, n, part_size, half, max);
+	if (count == 1)
+	{
+		t.process(0);
+		return;
+	}
+	ParallelUtils::run(&t, static_cast<int>(count));
+}
+
+}
+
+YBRUtils::YBRUtils()
+{
+}
+
+YBRUtils::~YBRUtils()
+{
+}
+
+void YBRUtils::ybr_to_rgb(const unsigned char * in, unsigned char * out, size_t n, int bits_stored)
+{
+	run<unsigned char>(in, out, n, get_half<unsigned char>(bits_stored), get_max<unsigned char>(bits_stored));
+}
+
+void YBRUtils::ybr_to_rgb(const unsigned short * in, unsigned short * out, size_t n, int bits_stored)
+{
+	run<unsigned short>(in, out, n, get_half<unsigned short>(bits_stored), get_max<unsigned short>(bits_stored));
+}
+
+void YBRUtils::ybr_to_rgb(const signed short * in, signed short * out, size_t n, int bits_stored)
+{
+	run<signed short>(in, out, n, get_half<unsigned short>(bits_stored), get_max<signed short>(bits_stored));
+}
+
+void YBRUtils::ybr_to_rgb(const float * in, float * out, size_t n, int bits_stored)
+{
+	const int half = (bits_stored > 0 && bits_stored <= 16) ? 1 << (bits_stored - 1) : 1 << 15;
+	run<float>(in, out, n, half, 0);
+}
@@ -0,0 +1,23 @@
+#ifndef YBRUTILS__H_
+#define YBRUTILS__H_
+
+#include <cstddef>
+
+// YBR_FULL (and upsampled YBR_FULL_422) to RGB for interleaved
+// buffers of 'n' pixels, chroma is centered at 1 << (bits_stored - 1).
+// Integer types are converted with fixed-point arithmetic (tables
+// for 8 bit) and clamped to [0, 2^bits_stored - 1], the work is
+// split into parts on the ParallelUtils pool. 'in' and 'out' may
+// be the same buffer.
+class YBRUtils
+{
+public:
+	YBRUtils();
+	~YBRUtils();
+	static void ybr_to_rgb(const unsigned char*,  unsigned char*,  size_t, int);
+	static void ybr_to_rgb(const unsigned short*, unsigned short*, size_t, int);
+	static void ybr_to_rgb(const signed short*,   signed short*,   size_t, int);
+	static void ybr_to_rgb(const float*,          float*,          size_t, int);
+};
+
+#endif // YBRUTILS__H_
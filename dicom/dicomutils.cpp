@@ -17,6 +17,7 @@
 #endif
 #include "dicomutils.h"
 #include "commonutils.h"
+#include "parallelutils.h"
 #include "codecutils.h"
 #include "contourutils.h"
 #include "prconfigutils.h"
@@ -56,6 +57,7 @@
 #include "mdcmVM.h"
 #include "mdcmVR.h"
 #include "mdcmUIDs.h"
+#include "mdcmJPEG2000Codec.h"
 #include "splituihgridfilter.h"
 #include <QSet>
 #include <QTextCodec>
@@ -74,6 +76,8 @@
 #include "updateqtcommand.h"
 #include "findrefdialog.h"
 #include "srwidget.h"
+#include "frameviewer.h"
+#include "regionviewer.h"
 #include <iostream>
 #include <vector>
 #include <list>
@@ -2296,7 +2300,7 @@ bool DicomUtils::read_slices(
 		pb->setLabelText(info_);
 		pb->setValue(-1);
 	}
-	QApplication::processEvents();
+	CommonUtils::process_events();
 	for (unsigned int i = 0; i < size_z; ++i)
 	{
 		QString
@@ -2385,7 +2389,7 @@ bool DicomUtils::read_slices(
 #endif
 	}
 	if (pb) pb->setValue(-1);
-	QApplication::processEvents();
+	CommonUtils::process_events();
 	if (failed) goto quit_;
 	ok = generate_geometry(
 			ivariant->di->image_slices,
@@ -2753,7 +2757,7 @@ bool DicomUtils::read_slices_rtdose(
 	if (!ivariant) return false;
 	//
 	if (pb) pb->setValue(-1);
-	QApplication::processEvents();
+	CommonUtils::process_events();
 	//
 	bool ok = false;
 	std::vector<double*> values;
@@ -2796,7 +2800,7 @@ bool DicomUtils::read_slices_rtdose(
 		values.push_back(p);
 	}
 	if (pb) pb->setValue(-1);
-	QApplication::processEvents();
+	CommonUtils::process_events();
 	ok = generate_geometry(
 			ivariant->di->image_slices,
 			ivariant->di->spectroscopy_slices,
@@ -4326,7 +4330,7 @@ bool DicomUtils::generate_geometry(
 					mbox.setIcon(QMessageBox::Warning);
 					mbox.setText(z_inv_string);
 					mbox.exec();
-					QApplication::processEvents();
+					CommonUtils::process_events();
 #endif
 			}
 		}
@@ -5300,15 +5304,14 @@ QString DicomUtils::read_enhanced(
 	int max_3d_tex_size, GLWidget * gl, bool ok3d,
 	bool min_load,
 	bool enh_original_frames,
-	const QWidget * settings, QProgressDialog * pb,
+	const SettingsValues * settings, QProgressDialog * pb,
 	float tolerance,
 	bool apply_rescale)
 {
 	*ok = false;
 	QString message_;
 	if (!settings) return QString("settings==NULL");
-	const SettingsWidget * wsettings =
-		static_cast<const SettingsWidget*>(settings);
+	const SettingsValues * wsettings = settings;
 	std::vector<char*> data;
 	DimIndexSq sq;
 	DimIndexValues idx_values;
@@ -5347,7 +5350,7 @@ QString DicomUtils::read_enhanced(
 			return QString("ds.IsEmpty()");
 		}
 		if (pb) pb->setValue(-1);
-		QApplication::processEvents();
+		CommonUtils::process_events();
 		const mdcm::Tag tRows(0x0028,0x0010);
 		const mdcm::Tag tColumns(0x0028,0x0011);
 		rows_ok = get_us_value(ds, tRows, &rows_);
@@ -5414,7 +5417,7 @@ QString DicomUtils::read_enhanced(
 	}
 	//
 	if (pb) pb->setValue(-1);
-	QApplication::processEvents();
+	CommonUtils::process_events();
 	double dircos_read[] = {0.0,0.0,0.0,0.0,0.0,0.0};
 	unsigned int dimx_read, dimy_read, dimz_read;
 	double origin_x_read,  origin_y_read,  origin_z_read;
@@ -5473,7 +5476,7 @@ QString DicomUtils::read_enhanced(
 		return QString("dimz_read!=data.size()");
 	}
 	if (pb) pb->setValue(-1);
-	QApplication::processEvents();
+	CommonUtils::process_events();
 	//
 	//
 	//
@@ -5621,14 +5624,13 @@ QString DicomUtils::read_enhanced_supp_palette(
 	int max_3d_tex_size, GLWidget * gl, bool ok3d,
 	bool min_load,
 	bool enh_original_frames,
-	const QWidget * settings, QProgressDialog * pb,
+	const SettingsValues * settings, QProgressDialog * pb,
 	float tolerance)
 {
 	*ok = false;
 	QString message_;
 	if (!settings) return QString("settings==NULL");
-	const SettingsWidget * wsettings =
-		static_cast<const SettingsWidget*>(settings);
+	const SettingsValues * wsettings = settings;
 	std::vector<char*> data;
 	DimIndexSq sq;
 	DimIndexValues idx_values;
@@ -5674,7 +5676,7 @@ QString DicomUtils::read_enhanced_supp_palette(
 			return QString("No Supplemental LUT");
 		}
 		if (pb) pb->setValue(-1);
-		QApplication::processEvents();
+		CommonUtils::process_events();
 		const mdcm::Tag tRows(0x0028,0x0010);
 		const mdcm::Tag tColumns(0x0028,0x0011);
 		rows_ok = get_us_value(ds,tRows,&rows_);
@@ -5738,7 +5740,7 @@ QString DicomUtils::read_enhanced_supp_palette(
 	enhanced_process_values(values, shared_values);
 	//
 	if (pb) pb->setValue(-1);
-	QApplication::processEvents();
+	CommonUtils::process_events();
 	double dircos_read[] = {0.0,0.0,0.0,0.0,0.0,0.0};
 	unsigned int dimx_read = 0, dimy_read = 0, dimz_read = 0;
 	double origin_x_read = 0, origin_y_read = 0, origin_z_read = 0;
@@ -5797,7 +5799,7 @@ QString DicomUtils::read_enhanced_supp_palette(
 		return QString("dimz_read!=data.size()");
 	}
 	if (pb) pb->setValue(-1);
-	QApplication::processEvents();
+	CommonUtils::process_events();
 	//
 	//
 	//
@@ -5945,7 +5947,7 @@ QString DicomUtils::read_enhanced_supp_palette(
 QString DicomUtils::read_ultrasound(
 	bool * ok, ImageVariant * ivariant,
 	const QStringList & images_ipp,
-	const QWidget * settings, QProgressDialog * pb)
+	const SettingsValues * settings, QProgressDialog * pb)
 {
 	if (!ok) return QString("read_ultrasound : error (1)");
 	*ok = false;
@@ -5954,9 +5956,8 @@ QString DicomUtils::read_ultrasound(
 	if (!settings) return QString("settings==NULL");
 	if (images_ipp.size() != 1) return QString("read_ultrasound reads 1 image");
 	if (pb) pb->setValue(-1);
-	QApplication::processEvents();
-	const SettingsWidget * wsettings =
-		static_cast<const SettingsWidget *>(settings);
+	CommonUtils::process_events();
+	const SettingsValues * wsettings = settings;
 	unsigned int dimx = 0, dimy = 0, dimz = 0;
 	double origin_x  = 0.0, origin_y  = 0.0, origin_z  = 0.0;
 	double spacing_x = 0.0, spacing_y = 0.0, spacing_z = 0.0;
@@ -5975,9 +5976,10 @@ QString DicomUtils::read_ultrasound(
 	int number_of_frames = 0;
 	double tmp_c = -999999.0, tmp_w = -999999.0;
 	short tmp_lut_function = 0;
-	//
+	// parsed once, the same file is used for the pixel data
+	mdcm::Reader reader;
+	reader.SetMemoryMapping(true);
 	{
-		mdcm::Reader reader;
 #ifdef _WIN32
 #if (defined(_MSC_VER) && defined(MDCM_WIN32_UNC))
 		reader.SetFileName(QDir::toNativeSeparators(images_ipp.at(0)).toUtf8().constData());
@@ -6129,7 +6131,8 @@ QString DicomUtils::read_ultrasound(
 		cornell_bug,
 		NULL,
 		NULL,
-		pb);
+		pb,
+		&reader.GetFile());
 	if (*ok==false) return buff_error;
 	//
 	if (!overwrite_mdcm_spacing)
@@ -6170,7 +6173,7 @@ QString DicomUtils::read_ultrasound(
 	direction[2][2] = nrm_dircos_z;
 	//
 	if (pb) pb->setValue(-1);
-	QApplication::processEvents();
+	CommonUtils::process_events();
 	//
 	QString error = CommonUtils::gen_itk_image(ok,
 		data, true,
@@ -6197,7 +6200,7 @@ QString DicomUtils::read_ultrasound(
 	data.clear();
 	if (*ok)
 	{
-		IconUtils::icon(ivariant);
+		if (CommonUtils::is_gui_thread()) IconUtils::icon(ivariant);
 	}
 	else
 	{
@@ -6214,6 +6217,252 @@ QString DicomUtils::read_ultrasound(
 	return QString("");
 }
 
+// Slices 1..n-1 of a multi-file series, read and decoded
+// in parallel into the volume allocated after the first slice.
+struct SeriesSlice
+{
+	SeriesSlice()
+		:
+		ok(false),
+		dimx(0), dimy(0), dimz(0),
+		level(-999999.0), window(-999999.0), lut_function(0),
+		has_shutter(false)
+	{
+	}
+	bool ok;
+	QString error;
+	mdcm::PixelFormat pixelformat;
+	unsigned int dimx;
+	unsigned int dimy;
+	unsigned int dimz;
+	double level;
+	double window;
+	short lut_function;
+	bool has_shutter;
+	PRDisplayShutter shutter;
+	ImageOverlays overlays;
+	AnatomyMap anatomy;
+};
+
+class ReadSeriesSliceTask : public ParallelTask
+{
+public:
+	ReadSeriesSliceTask(
+		const QStringList & images_ipp_,
+		std::vector<SeriesSlice> & slices_,
+		char * volume_, const unsigned long long slice_size_,
+		const bool headers_, const bool shutters_, const bool windows_,
+		const bool overlays_,
+		const bool rescale_, const bool force_double_pf_,
+		const bool clean_unused_bits_, const bool pred6_bug_, const bool cornell_bug_)
+		:
+		images_ipp(images_ipp_),
+		slices(slices_),
+		volume(volume_), slice_size(slice_size_),
+		headers(headers_), shutters(shutters_), windows(windows_),
+		overlays(overlays_),
+		rescale(rescale_), force_double_pf(force_double_pf_),
+		clean_unused_bits(clean_unused_bits_), pred6_bug(pred6_bug_), cornell_bug(cornell_bug_)
+	{
+	}
+
+	void process(int i) override
+	{
+		const int j = i + 1;
+		SeriesSlice & s = slices[i];
+		const QString & f = images_ipp.at(j);
+		mdcm::Reader reader;
+		reader.SetMemoryMapping(true);
+#ifdef _WIN32
+#if (defined(_MSC_VER) && defined(MDCM_WIN32_UNC))
+		reader.SetFileName(QDir::toNativeSeparators(f).toUtf8().constData());
+#else
+		reader.SetFileName(QDir::toNativeSeparators(f).toLocal8Bit().constData());
+#endif
+#else
+		reader.SetFileName(f.toLocal8Bit().constData());
+#endif
+		if (!reader.Read())
+		{
+			s.error = QString("can not read file ") + f;
+			return;
+		}
+		if (headers)
+		{
+			const mdcm::DataSet & ds = reader.GetFile().GetDataSet();
+			if (shutters) s.has_shutter = DicomUtils::read_shutter(ds, s.shutter);
+			if (windows) DicomUtils::read_window(ds, &s.level, &s.window, &s.lut_function);
+		}
+		std::vector<char*> unused;
+		mdcm::PhotometricInterpretation pi;
+		double origin_x = 0.0, origin_y = 0.0, origin_z = 0.0;
+		double spacing_x = 0.0, spacing_y = 0.0, spacing_z = 0.0;
+		double dircos[] = {0.0,0.0,0.0,0.0,0.0,0.0};
+		double shift_tmp = 0.0, scale_tmp = 1.0;
+		s.error = DicomUtils::read_buffer(
+			&s.ok,
+			unused,
+			s.overlays,
+			(overlays ? j : -2),
+			s.anatomy,
+			j,
+			f,
+			rescale,
+			s.pixelformat, force_double_pf,
+			pi,
+			&s.dimx, &s.dimy, &s.dimz,
+			&origin_x, &origin_y, &origin_z,
+			&spacing_x, &spacing_y, &spacing_z,
+			dircos,
+			&shift_tmp, &scale_tmp,
+			clean_unused_bits,
+			false, false, false,
+			false,
+			pred6_bug,
+			cornell_bug,
+			NULL,
+			NULL,
+			NULL,
+			&reader.GetFile(),
+			&volume[j*slice_size],
+			slice_size);
+	}
+
+private:
+	const QStringList & images_ipp;
+	std::vector<SeriesSlice> & slices;
+	char * volume;
+	const unsigned long long slice_size;
+	const bool headers;
+	const bool shutters;
+	const bool windows;
+	const bool overlays;
+	const bool rescale;
+	const bool force_double_pf;
+	const bool clean_unused_bits;
+	const bool pred6_bug;
+	const bool cornell_bug;
+};
+
+// 'data' holds the first slice, replaced with the volume.
+// A monochrome volume is the buffer of the ITK image, then
+// 'in_image' is set and data[0] is not owned by 'data'.
+static QString read_series_slices(
+	bool * in_image,
+	std::vector<char*> & data,
+	const unsigned long long slice_size,
+	const QStringList & images_ipp,
+	ImageVariant * ivariant,
+	std::vector<double> & levels_,
+	std::vector<double> & windows_,
+	std::vector<short> & luts_,
+	const mdcm::PixelFormat & pixelformat,
+	const unsigned int dimx, const unsigned int dimy,
+	const bool headers,
+	const bool shutters,
+	const bool windows,
+	const bool overlays_enabled,
+	const bool rescale,
+	const bool force_double_pf,
+	const bool clean_unused_bits,
+	const bool pred6_bug,
+	const bool cornell_bug)
+{
+	*in_image = false;
+	const int count = images_ipp.size();
+	if (data.size() != 1 || !data.at(0) || slice_size < 1)
+	{
+		return QString("Buffer read failed");
+	}
+	char * volume = CommonUtils::alloc_monochrome_image(
+		ivariant, pixelformat, dimx, dimy, count, slice_size * count);
+	if (volume)
+	{
+		*in_image = true;
+	}
+	else
+	{
+		try
+		{
+			volume = new char[slice_size * count];
+		}
+		catch (const std::bad_alloc&)
+		{
+			return QString("Buffer allocation error");
+		}
+		if (!volume)
+		{
+			return QString("Buffer allocation error");
+		}
+	}
+	memcpy(volume, data[0], slice_size);
+	delete [] data[0];
+	data[0] = volume;
+	std::vector<SeriesSlice> slices(count - 1);
+	{
+		ReadSeriesSliceTask t(
+			images_ipp,
+			slices,
+			volume, slice_size,
+			headers, shutters, windows,
+			overlays_enabled,
+			rescale, force_double_pf,
+			clean_unused_bits, pred6_bug, cornell_bug);
+		ParallelUtils::run(&t, count - 1);
+	}
+	for (int x = 0; x < count - 1; ++x)
+	{
+		const int j = x + 1;
+		const SeriesSlice & s = slices.at(x);
+		if (!s.ok)
+		{
+			return (s.error.isEmpty() ? QString("Buffer read failed") : s.error);
+		}
+		if (s.dimz > 1 || s.dimx != dimx || s.dimy != dimy)
+		{
+			return QString("Buffer read failed");
+		}
+		if ((s.pixelformat.GetBitsAllocated() != pixelformat.GetBitsAllocated()) ||
+			(s.pixelformat.GetScalarType() != pixelformat.GetScalarType()) ||
+			(s.pixelformat.GetSamplesPerPixel() != pixelformat.GetSamplesPerPixel()))
+		{
+			return QString("previous_pixelformat!=pixelformat");
+		}
+		if (s.has_shutter)
+		{
+			ivariant->pr_display_shutters.insert(j, s.shutter);
+		}
+		if (headers)
+		{
+			levels_.push_back(s.level);
+			windows_.push_back(s.window);
+			luts_.push_back(s.lut_function);
+		}
+		if (s.anatomy.contains(j))
+		{
+			ivariant->anatomy[j] = s.anatomy.value(j);
+		}
+		const QList<int> keys = s.overlays.all_overlays.keys();
+		for (int k = 0; k < keys.size(); ++k)
+		{
+			const int idx = keys.at(k);
+			const SliceOverlays & l2 = s.overlays.all_overlays.value(idx);
+			if (!ivariant->image_overlays.all_overlays.contains(idx))
+			{
+				ivariant->image_overlays.all_overlays[idx] = l2;
+			}
+			else
+			{
+				for (int y = 0; y < l2.size(); ++y)
+				{
+					ivariant->image_overlays.all_overlays[idx].push_back(l2.at(y));
+				}
+			}
+		}
+	}
+	return QString("");
+}
+
 QString DicomUtils::read_series(
 	bool * ok,
 	const bool min_load,
@@ -6223,7 +6472,7 @@ QString DicomUtils::read_series(
 	ImageVariant * ivariant,
 	const QStringList & images_ipp,
 	int max_3d_tex_size, GLWidget * gl, bool ok3d,
-	const QWidget * settings, QProgressDialog * pb,
+	const SettingsValues * settings, QProgressDialog * pb,
 	float tolerance,
 	bool apply_rescale)
 {
@@ -6231,9 +6480,8 @@ QString DicomUtils::read_series(
 	if (!ivariant) return QString("ivariant is NULL");
 	if (!settings) return QString("settings is NULL");
 	if (pb) pb->setValue(-1);
-	QApplication::processEvents();
-	const SettingsWidget * wsettings =
-		static_cast<const SettingsWidget *>(settings);
+	CommonUtils::process_events();
+	const SettingsValues * wsettings = settings;
 	unsigned int dimx = 0, dimy = 0, dimz = 0;
 	double origin_x  = 0.0, origin_y  = 0.0, origin_z  = 0.0;
 	double spacing_x = 0.0, spacing_y = 0.0, spacing_z = 0.0;
@@ -6258,12 +6506,18 @@ QString DicomUtils::read_series(
 	bool skip_ram_warning = false;
 #endif
 	unsigned long long count_buffers_size = 0;
-	for (int j = 0; j < images_ipp.size(); ++j)
-	{
-		//
+	// Multi-file series: the first slice is read here, others are
+	// read and decoded in parallel into one contiguous volume below.
+	const bool parallel_slices = (images_ipp.size() > 1) && !elscint;
+	unsigned long long slice_size = 0;
+	const int serial_count = parallel_slices ? 1 : images_ipp.size();
+	for (int j = 0; j < serial_count; ++j)
+	{
+		// parsed once, the same file is used for the pixel data
+		mdcm::Reader reader;
+		reader.SetMemoryMapping(true);
 		{
 			int number_of_frames = 0;
-			mdcm::Reader reader;
 #ifdef _WIN32
 #if (defined(_MSC_VER) && defined(MDCM_WIN32_UNC))
 			reader.SetFileName(QDir::toNativeSeparators(images_ipp.at(j)).toUtf8().constData());
@@ -6483,7 +6737,8 @@ QString DicomUtils::read_series(
 				cornell_bug,
 				NULL,
 				&buffers_size,
-				pb);
+				pb,
+				(elscint ? NULL : &reader.GetFile()));
 			if (dimz_ > 1)
 			{
 				*ok = false;
@@ -6507,9 +6762,12 @@ QString DicomUtils::read_series(
 				return QString("Buffer read failed");
 			}
 			data.push_back(&data_[0][0]);
-			count_buffers_size += buffers_size;
+			slice_size = buffers_size;
+			// the first slice stands for the whole series
+			count_buffers_size +=
+				parallel_slices ? buffers_size * images_ipp.size() : buffers_size;
 #ifdef WARN_RAM_SIZE
-			if (!skip_ram_warning && total_ram > 0.0)
+			if (!skip_ram_warning && total_ram > 0.0 && CommonUtils::is_gui_thread())
 			{
 				const double count_buffers_gb = count_buffers_size / 1073741824.0;
 				if ((count_buffers_gb * 3) >= total_ram)
@@ -6532,7 +6790,7 @@ QString DicomUtils::read_series(
 							"\"Settings/3D\" may reduce memory\n"
 							"pressure sometimes.\n"
 							"Proceed?"));
-					qApp->processEvents();
+					CommonUtils::process_events();
 					if (mbox.exec() == QMessageBox::Yes)
 					{
 						skip_ram_warning = true;
@@ -6548,7 +6806,7 @@ QString DicomUtils::read_series(
 						return QString("");
 					}
 					if (pb) pb->show();
-					qApp->processEvents();
+					CommonUtils::process_events();
 				}
 			}
 #endif
@@ -6578,7 +6836,8 @@ QString DicomUtils::read_series(
 				cornell_bug,
 				NULL,
 				NULL,
-				pb);
+				pb,
+				(elscint ? NULL : &reader.GetFile()));
 		}
 		if (*ok == false)
 		{
@@ -6855,7 +7114,43 @@ QString DicomUtils::read_series(
 		previous_pixelformat = pixelformat;
 	}
 	//
-	if ((images_ipp.size() > 1) && (data.size() != dimz))
+	bool volume_in_image = false;
+	if (parallel_slices)
+	{
+		if (pb) pb->setValue(-1);
+		CommonUtils::process_events();
+		const QString error =
+			read_series_slices(
+				&volume_in_image,
+				data, slice_size,
+				images_ipp,
+				ivariant,
+				levels_, windows_, luts_,
+				pixelformat,
+				dimx, dimy,
+				!min_load,
+				(!min_load && !mosaic && !uihgrid),
+				(wsettings->get_level_for_PET() || !(
+					(ivariant->sop == QString("1.2.840.10008.5.1.4.1.1.128")) ||
+					(ivariant->sop == QString("1.2.840.10008.5.1.4.1.1.130")) ||
+					(ivariant->sop == QString("1.2.840.10008.5.1.4.1.1.128.1")))),
+				overlays_enabled,
+				((!apply_rescale) ? false : wsettings->get_rescale()),
+				(ivariant->sop == QString("1.2.840.10008.5.1.4.1.1.128")),
+				clean_unused_bits, pred6_bug, cornell_bug);
+		if (!error.isEmpty())
+		{
+			*ok = false;
+			if (volume_in_image) data[0] = NULL;
+			for (unsigned int x = 0; x < data.size(); ++x)
+			{
+				if (data.at(x)) delete [] data[x];
+			}
+			data.clear();
+			return error;
+		}
+	}
+	else if ((images_ipp.size() > 1) && (data.size() != dimz))
 	{
 		*ok = false;
 		for (unsigned int x = 0; x < data.size(); ++x)
@@ -6866,7 +7161,7 @@ QString DicomUtils::read_series(
 		return QString("data.size() != dimz");
 	}
 	if (pb) pb->setValue(-1);
-	QApplication::processEvents();
+	CommonUtils::process_events();
 	//
 	{
 		const size_t levels_size = levels_.size();
@@ -6915,7 +7210,7 @@ QString DicomUtils::read_series(
 		? wsettings->get_rescale()
 		: true;
 	QString error = CommonUtils::gen_itk_image(ok,
-		data, true,
+		data, !volume_in_image,
 		pixelformat, pi,
 		ivariant, 
 		direction,
@@ -6929,6 +7224,7 @@ QString DicomUtils::read_series(
 		no_warn_rescale,
 		max_3d_tex_size, gl, pb,
 		false);
+	if (volume_in_image) data[0] = NULL;
 	for (unsigned int x = 0; x < data.size(); ++x)
 	{
 		if (data.at(x))
@@ -6938,7 +7234,7 @@ QString DicomUtils::read_series(
 		}
 	}
 	data.clear();
-	if (*ok == true) IconUtils::icon(ivariant);
+	if (*ok == true && CommonUtils::is_gui_thread()) IconUtils::icon(ivariant);
 	if (*ok == false)
 	{
 		ivariant->anatomy.clear();
@@ -7475,16 +7771,20 @@ QString DicomUtils::read_buffer(
 	const bool cornell_bug,
 	int * red_subscript,
 	unsigned long long * buffers_size,
-	QProgressDialog * pb)
+	QProgressDialog * pb,
+	mdcm::File * parsed_file, // already read, not for ELSCINT
+	char * dest, // single slice, may run in a worker thread, no GUI
+	const unsigned long long dest_size)
 {
 	*ok = false;
-	if (rescale)     mdcm::ImageHelper::SetForceRescaleInterceptSlope(true);
-	else             mdcm::ImageHelper::SetForceRescaleInterceptSlope(false);
-	if (pred6_bug)   mdcm::ImageHelper::SetWorkaroundPredictorBug(true);
-	else             mdcm::ImageHelper::SetWorkaroundPredictorBug(false);
-	if (cornell_bug) mdcm::ImageHelper::SetWorkaroundCornellBug(true);
-	else             mdcm::ImageHelper::SetWorkaroundCornellBug(false);
-	mdcm::ImageHelper::SetCleanUnusedBits(clean_unused_bits);
+	mdcm::CodecOptions codec_options;
+	codec_options.ForceRescaleInterceptSlope = rescale;
+	codec_options.WorkaroundPredictorBug = pred6_bug;
+	codec_options.WorkaroundCornellBug = cornell_bug;
+	codec_options.CleanUnusedBits = clean_unused_bits;
+	// frames of multi-frame objects, slices of series
+	// are already decoded in parallel
+	codec_options.NumberOfThreads = dest ? 1 : ParallelUtils::get_num_threads();
 	//
 	bool rescale_ = false;
 	unsigned long long rescaled_buffer_size = 0;
@@ -7535,8 +7835,14 @@ QString DicomUtils::read_buffer(
 				return QString("Can not convert ELSCINT file");
 			}
 		}
+		else if (parsed_file)
+		{
+			image_reader.SetFile(*parsed_file);
+			image_reader.SetApplySupplementalLUT(supp_palette_color);
+		}
 		else
 		{
+			image_reader.SetMemoryMapping(true);
 #ifdef _WIN32
 #if (defined(_MSC_VER) && defined(MDCM_WIN32_UNC))
 			image_reader.SetFileName(QDir::toNativeSeparators(f).toUtf8().constData());
@@ -7549,7 +7855,10 @@ QString DicomUtils::read_buffer(
 			image_reader.SetApplySupplementalLUT(supp_palette_color);
 		}
 		if (overlay_idx == -2) image_reader.SetProcessOverlays(false);
-		const bool i_ok = image_reader.Read();
+		image_reader.SetCodecOptions(codec_options);
+		const bool i_ok = (parsed_file && !elscint)
+			? image_reader.ReadFromFile()
+			: image_reader.Read();
 		if (!i_ok)
 		{
 			if (elscint && !elscf.isEmpty()) QFile::remove(elscf);
@@ -7560,7 +7869,7 @@ QString DicomUtils::read_buffer(
 			const unsigned long long buffer_size_tmp = image.GetBufferLength();
 #ifdef WARN_RAM_SIZE
 			const double total_ram = CommonUtils::get_total_memory_saved();
-			if (total_ram > 0.0)
+			if (!dest && total_ram > 0.0 && CommonUtils::is_gui_thread())
 			{
 				const double buffer_gb = buffer_size_tmp / 1073741824.0;
 				if ((buffer_gb * 3) >= total_ram)
@@ -7583,13 +7892,13 @@ QString DicomUtils::read_buffer(
 							"\"Settings/3D\" may reduce memory\n"
 							"pressure sometimes.\n"
 							"Proceed?"));
-					qApp->processEvents();
+					CommonUtils::process_events();
 					if (mbox.exec() != QMessageBox::Yes)
 					{
 						return QString("");
 					}
 					if (pb) pb->show();
-					qApp->processEvents();
+					CommonUtils::process_events();
 				}
 			}
 #endif
@@ -7800,7 +8109,7 @@ QString DicomUtils::read_buffer(
 		}
 		//
 		if (pb) pb->setValue(-1);
-		qApp->processEvents();
+		if (!dest) CommonUtils::process_events();
 		//
 		if (anatomy_idx > -1)
 		{
@@ -7871,10 +8180,6 @@ QString DicomUtils::read_buffer(
 		//
 		image_pixelformat = image.GetPixelFormat();
 		image_buffer_length = image.GetBufferLength();
-		if (buffers_size)
-		{
-			*buffers_size = image_buffer_length;
-		}
 		//
 		//
 		//
@@ -8138,10 +8443,25 @@ QString DicomUtils::read_buffer(
 	}
 	//
 	if (pb) pb->setValue(-1);
-	qApp->processEvents();
+	if (!dest) CommonUtils::process_events();
 	//
+	if (buffers_size)
+	{
+		*buffers_size = buffer_size;
+	}
+	if (dest)
+	{
+		if (buffer_size != dest_size)
+		{
+			if (not_rescaled_buffer)  delete [] not_rescaled_buffer;
+			if (rescaled_buffer)      delete [] rescaled_buffer;
+			if (singlebit_buffer)     delete [] singlebit_buffer;
+			return QString("Buffer size wrong");
+		}
+		memcpy(dest, buffer, buffer_size);
+	}
 	const size_t xy = buffer_size / dimz;
-	for (unsigned long long j = 0; j < dimz; ++j)
+	for (unsigned long long j = 0; !dest && j < dimz; ++j)
 	{
 		char * p__;
 		bool badalloc = false;
@@ -8199,7 +8519,7 @@ QString DicomUtils::read_enhanced_common(
 	const int max_3d_tex_size,
 	GLWidget * gl,
 	const bool min_load,
-	const QWidget * settings,
+	const SettingsValues * settings,
 	double * dircos_read,
 	const int red_subscript,
 	const double spacing_x_read,
@@ -8219,8 +8539,7 @@ QString DicomUtils::read_enhanced_common(
 #endif
 	QString message("");
 	bool error = false;
-	const SettingsWidget * wsettings =
-		static_cast<const SettingsWidget *>(settings);
+	const SettingsValues * wsettings = settings;
 	//
 	for (unsigned int x = 0; x < tmp0.size(); ++x)
 	{
@@ -9013,7 +9332,7 @@ QString DicomUtils::read_enhanced_common(
 					ivariant->instance_number = instance_number;
 				}
 				CommonUtils::reset_bb(ivariant);
-				IconUtils::icon(ivariant);
+				if (CommonUtils::is_gui_thread()) IconUtils::icon(ivariant);
 				ivariant->filenames = QStringList(efilename);
 				ivariants.push_back(ivariant);
 			}
@@ -9208,7 +9527,7 @@ QString DicomUtils::read_enhanced_3d_6d(
 	const DimIndexValues & idx_values, const FrameGroupValues & values,
 	const bool ok3d, const int max_3d_tex_size, GLWidget * gl,
 	const bool min_load,
-	const QWidget * settings,
+	const SettingsValues * settings,
 	double * dircos_read,
 	const int red_subscript,
 	const double spacing_x_read, const double spacing_y_read, const double spacing_z_read,
@@ -9220,7 +9539,7 @@ QString DicomUtils::read_enhanced_3d_6d(
 {
 	QString message_ ;
 	std::vector< std::map< unsigned int,unsigned int,std::less<unsigned int> > > tmp0;
-	const SettingsWidget * wsettings = static_cast<const SettingsWidget*>(settings);
+	const SettingsValues * wsettings = settings;
 	const bool sort_ippiop = wsettings->get_sort_frames();
 	*ok = enhanced_process_indices(
 		tmp0, idx_values, values,
@@ -9558,7 +9877,7 @@ void DicomUtils::scan_files_for_rtstruct_image(
 	std::vector<std::string> filenames;
 	for (int x = 0; x < flist.size(); ++x)
 	{
-		QApplication::processEvents();
+		CommonUtils::process_events();
 		const QString tmp0 =
 			dir.absolutePath() + QString("/") + flist.at(x);
 #ifdef _WIN32
@@ -9586,7 +9905,7 @@ void DicomUtils::scan_files_for_rtstruct_image(
 		mdcm::Scanner::ValuesType::iterator vi0 = v0.begin();
 		for (; vi0!=v0.end(); ++vi0)
 		{
-			QApplication::processEvents();
+			CommonUtils::process_events();
 			std::vector<std::string> files__ =
 				s0.GetAllFilenamesFromTagToValue(t0, (*vi0).c_str());
 			for (unsigned int j = 0; j < files__.size(); ++j)
@@ -9618,7 +9937,7 @@ void DicomUtils::scan_files_for_rtstruct_image(
 		mdcm::Scanner::ValuesType::iterator vi1 = v1.begin();
 		for (; vi1!=v1.end(); ++vi1)
 		{
-			QApplication::processEvents();
+			CommonUtils::process_events();
 			std::vector<std::string> files__ =
 				s1.GetAllFilenamesFromTagToValue(t1, (*vi1).c_str());
 			QStringList t1_tmp;
@@ -9640,7 +9959,7 @@ void DicomUtils::scan_files_for_rtstruct_image(
 		}
 	}
 	//
-	QApplication::processEvents();
+	CommonUtils::process_events();
 }
 
 bool DicomUtils::process_contrours_ref(
@@ -9649,7 +9968,7 @@ bool DicomUtils::process_contrours_ref(
 	std::vector<ImageVariant*> & tmp_ivariants,
 	int max_3d_tex_size, GLWidget * gl, bool ok3d,
 	bool enh_original_frames,
-	const QWidget * settings,
+	const SettingsValues * settings,
 	QProgressDialog * pb)
 {
 	unsigned short count_ = 0;
@@ -9658,7 +9977,7 @@ bool DicomUtils::process_contrours_ref(
 		pb->setLabelText(QString("Searching ."));
 		pb->setValue(-1);
 	}
-	QApplication::processEvents();
+	CommonUtils::process_events();
 	mdcm::Reader reader;
 #ifdef _WIN32
 #if (defined(_MSC_VER) && defined(MDCM_WIN32_UNC))
@@ -9670,7 +9989,7 @@ bool DicomUtils::process_contrours_ref(
 	reader.SetFileName(f.toLocal8Bit().constData());
 #endif
 	if (!reader.Read()) return false;
-	QApplication::processEvents();
+	CommonUtils::process_events();
 	const mdcm::File & file = reader.GetFile();
 	const mdcm::DataSet & ds = file.GetDataSet();
 	if (ds.IsEmpty()) return false;
@@ -9713,7 +10032,7 @@ bool DicomUtils::process_contrours_ref(
 				pb->setLabelText(QString("Searching .."));
 				pb->setValue(-1);
 			}
-			QApplication::processEvents();
+			CommonUtils::process_events();
 			QString sop_instance_uid("");
 			std::set<mdcm::Tag> tags;
 			mdcm::Tag tsopinstance(0x0008,0x0018);
@@ -9763,7 +10082,7 @@ bool DicomUtils::process_contrours_ref(
 						{
 							pb->setLabelText(QString("Searching ..."));
 							pb->setValue(-1);
-							QApplication::processEvents();
+							CommonUtils::process_events();
 						}
 						const Contour * c = it.value();
 						for (int j = 0;
@@ -9789,7 +10108,7 @@ bool DicomUtils::process_contrours_ref(
 				{
 					pb->setLabelText(QString("Searching ...."));
 					pb->setValue(-1);
-					QApplication::processEvents();
+					CommonUtils::process_events();
 				}
 				std::vector<ImageVariant*> ivariants;
 				QStringList detected_files_tmp = detected_files.at(z);
@@ -9823,7 +10142,7 @@ bool DicomUtils::process_contrours_ref(
 						{
 							pb->setLabelText(QString("Searching ...."));
 							pb->setValue(-1);
-							QApplication::processEvents();
+							CommonUtils::process_events();
 						}
 						ROI roi;
 						roi.id = tmp_ivariant->di->rois.at(i).id;
@@ -9858,7 +10177,7 @@ QString DicomUtils::find_file_from_uid(
 		ok = scan_files_for_instance_uid(it.next(), uid, f, pb);
 		if (ok) break;
 	}
-	QApplication::processEvents();
+	CommonUtils::process_events();
 	return f;
 }
 
@@ -9876,11 +10195,11 @@ bool DicomUtils::scan_files_for_instance_uid(
 	QDir dir(p);
 	QStringList flist =
 		dir.entryList(QDir::Files|QDir::Readable,QDir::Name);
-	QApplication::processEvents();
+	CommonUtils::process_events();
 	for (int x = 0; x < flist.size(); ++x)
 	{
 		if (pb) pb->setValue(-1);
-		QApplication::processEvents();
+		CommonUtils::process_events();
 		const QString tmp0 =
 			dir.absolutePath() + QString("/") + flist.at(x);
 		mdcm::Reader reader;
@@ -9946,7 +10265,7 @@ void DicomUtils::read_pr_ref(
 		x < sqReferencedSeriesSequence->GetNumberOfItems();
 		++x)
 	{
-		QApplication::processEvents();
+		CommonUtils::process_events();
 		const mdcm::Item & item0 =
 			sqReferencedSeriesSequence->GetItem(x+1);
 		const mdcm::DataSet & nds0 =
@@ -9974,7 +10293,7 @@ void DicomUtils::read_pr_ref(
 			y < sqReferencedImageSequence->GetNumberOfItems();
 			++y)
 		{
-			QApplication::processEvents();
+			CommonUtils::process_events();
 			const mdcm::Item & item1 =
 				sqReferencedImageSequence->GetItem(y+1);
 			const mdcm::DataSet & nds1 =
@@ -10126,7 +10445,7 @@ template <typename T> QString supp_palette_grey_to_rgbUC_(
 		return QString(ex.GetDescription());
 	}
 	//
-	QApplication::processEvents();
+	CommonUtils::process_events();
 	//
 	unsigned long long tmp37 = 0;
 	const double wmin  = v->di->us_window_center - v->di->us_window_width*0.5;
@@ -10144,7 +10463,7 @@ template <typename T> QString supp_palette_grey_to_rgbUC_(
 		while (!(it1.IsAtEnd()||it0.IsAtEnd()||it2.IsAtEnd()))
 		{
 			//
-			if (tmp37%9999 == 0) QApplication::processEvents();
+			if (tmp37%9999 == 0) CommonUtils::process_events();
 			//
 			const RGBPixelUC & pixel = it2.Get();
 			if (pixel.GetRed() > 0 || pixel.GetGreen() > 0 || pixel.GetBlue() > 0)
@@ -10773,6 +11092,180 @@ typedef struct
 	QString file;
 } MixedDicomSeriesInfo;
 
+// Cine multi-frame objects too large for the volume, they are
+// shown by FrameViewer, decoded on demand.
+static bool is_large_multiframe(const QString & f)
+{
+	mdcm::Reader reader;
+#ifdef _WIN32
+#if (defined(_MSC_VER) && defined(MDCM_WIN32_UNC))
+	reader.SetFileName(QDir::toNativeSeparators(f).toUtf8().constData());
+#else
+	reader.SetFileName(QDir::toNativeSeparators(f).toLocal8Bit().constData());
+#endif
+#else
+	reader.SetFileName(f.toLocal8Bit().constData());
+#endif
+	if (!reader.ReadUpToTag(mdcm::Tag(0x7fe0,0x0000))) return false;
+	const mdcm::DataSet & ds = reader.GetFile().GetDataSet();
+	QString sop;
+	if (!DicomUtils::get_string_value(ds, mdcm::Tag(0x0008,0x0016), sop))
+		return false;
+	sop.remove(QChar('\0'));
+	if (!(
+		sop==QString("1.2.840.10008.5.1.4.1.1.12.1")    || // X-Ray Angiographic
+		sop==QString("1.2.840.10008.5.1.4.1.1.12.1.1")  || // Enhanced XA
+		sop==QString("1.2.840.10008.5.1.4.1.1.12.2")    || // X-Ray RF
+		sop==QString("1.2.840.10008.5.1.4.1.1.12.2.1")  || // Enhanced XRF
+		sop==QString("1.2.840.10008.5.1.4.1.1.3.1")     || // US Multi-frame
+		sop==QString("1.2.840.10008.5.1.4.1.1.13.1.3")     // Breast Tomosynthesis
+		)) return false;
+	unsigned short rows_ = 0, columns_ = 0;
+	unsigned short ba_ = 0, bs_ = 0, hb_ = 0;
+	short pr_ = -1;
+	bool localizer_ = false;
+	if (!DicomUtils::is_image(
+			ds,
+			&rows_, &columns_,
+			&ba_, &bs_, &hb_,
+			&pr_,
+			&localizer_)) return false;
+	unsigned short spp = 1;
+	if (!DicomUtils::get_us_value(ds, mdcm::Tag(0x0028,0x0002), &spp) || spp < 1)
+		spp = 1;
+	int frames = 1;
+	if (!DicomUtils::get_is_value(ds, mdcm::Tag(0x0028,0x0008), &frames) ||
+		frames < 2)
+	{
+		return false;
+	}
+	const unsigned long long bytes =
+		(unsigned long long)rows_ * columns_ * spp * ((ba_ + 7) / 8) * frames;
+	if (bytes > 0xffffffff) return true;
+	const double total_ram = CommonUtils::get_total_memory_saved();
+	return (total_ram > 0.0 && (bytes / 1073741824.0) * 3 >= total_ram);
+}
+
+// Single-frame JPEG 2000 images of 64M pixels or more, they are
+// shown by RegionViewer, areas are decoded at the resolution of
+// the view.
+static bool is_large_jpeg2000(const QString & f)
+{
+	mdcm::Reader reader;
+#ifdef _WIN32
+#if (defined(_MSC_VER) && defined(MDCM_WIN32_UNC))
+	reader.SetFileName(QDir::toNativeSeparators(f).toUtf8().constData());
+#else
+	reader.SetFileName(QDir::toNativeSeparators(f).toLocal8Bit().constData());
+#endif
+#else
+	reader.SetFileName(f.toLocal8Bit().constData());
+#endif
+	if (!reader.ReadUpToTag(mdcm::Tag(0x7fe0,0x0000))) return false;
+	mdcm::JPEG2000Codec codec;
+	if (!codec.CanDecode(
+			reader.GetFile().GetHeader().GetDataSetTransferSyntax()))
+	{
+		return false;
+	}
+	const mdcm::DataSet & ds = reader.GetFile().GetDataSet();
+	unsigned short rows_ = 0, columns_ = 0;
+	unsigned short ba_ = 0, bs_ = 0, hb_ = 0;
+	short pr_ = -1;
+	bool localizer_ = false;
+	if (!DicomUtils::is_image(
+			ds,
+			&rows_, &columns_,
+			&ba_, &bs_, &hb_,
+			&pr_,
+			&localizer_)) return false;
+	int frames = 1;
+	if (DicomUtils::get_is_value(ds, mdcm::Tag(0x0028,0x0008), &frames) &&
+		frames > 1)
+	{
+		return false;
+	}
+	return ((unsigned long long)rows_ * columns_ >= 67108864ULL);
+}
+
+bool DicomUtils::is_plain_series(
+	const QStringList & filenames,
+	unsigned long long * bytes)
+{
+	*bytes = 0;
+	if (filenames.empty()) return false;
+	const mdcm::Tag tSOPClassUID(0x0008,0x0016);
+	for (int x = 0; x < filenames.size(); ++x)
+	{
+		mdcm::Reader reader;
+#ifdef _WIN32
+#if (defined(_MSC_VER) && defined(MDCM_WIN32_UNC))
+		reader.SetFileName(QDir::toNativeSeparators(filenames.at(x)).toUtf8().constData());
+#else
+		reader.SetFileName(QDir::toNativeSeparators(filenames.at(x)).toLocal8Bit().constData());
+#endif
+#else
+		reader.SetFileName(filenames.at(x).toLocal8Bit().constData());
+#endif
+		if (!reader.ReadUpToTag(mdcm::Tag(0x7fe0,0x0000))) return false;
+		const mdcm::DataSet & ds = reader.GetFile().GetDataSet();
+		QString sop;
+		if (!get_string_value(ds, tSOPClassUID, sop)) return false;
+		sop.remove(QChar('\0'));
+		if (!(
+			sop==QString("1.2.840.10008.5.1.4.1.1.2")       || // CT
+			sop==QString("1.2.840.10008.5.1.4.1.1.2.1")     || // Enhanced CT
+			sop==QString("1.2.840.10008.5.1.4.1.1.2.2")     || // Legacy Converted Enhanced CT
+			sop==QString("1.2.840.10008.5.1.4.1.1.4")       || // MR
+			sop==QString("1.2.840.10008.5.1.4.1.1.4.1")     || // Enhanced MR
+			sop==QString("1.2.840.10008.5.1.4.1.1.4.4")     || // Legacy Converted Enhanced MR
+			sop==QString("1.2.840.10008.5.1.4.1.1.128")     || // PET
+			sop==QString("1.2.840.10008.5.1.4.1.1.128.1")   || // Legacy Converted Enhanced PET
+			sop==QString("1.2.840.10008.5.1.4.1.1.130")     || // Enhanced PET
+			sop==QString("1.2.840.10008.5.1.4.1.1.20")      || // Nuclear Medicine
+			sop==QString("1.2.840.10008.5.1.4.1.1.1")       || // Computed Radiography
+			sop==QString("1.2.840.10008.5.1.4.1.1.1.1")     || // Digital X-Ray - For Presentation
+			sop==QString("1.2.840.10008.5.1.4.1.1.1.1.1")   || // Digital X-Ray - For Processing
+			sop==QString("1.2.840.10008.5.1.4.1.1.1.2")     || // Digital Mammography X-Ray - For Presentation
+			sop==QString("1.2.840.10008.5.1.4.1.1.1.2.1")   || // Digital Mammography X-Ray - For Processing
+			sop==QString("1.2.840.10008.5.1.4.1.1.7")       || // SC
+			sop==QString("1.2.840.10008.5.1.4.1.1.12.1")    || // X-Ray Angiographic
+			sop==QString("1.2.840.10008.5.1.4.1.1.12.2")       // X-Ray RF
+			)) return false;
+		unsigned short rows_ = 0, columns_ = 0;
+		unsigned short ba_ = 0, bs_ = 0, hb_ = 0;
+		short pr_ = -1;
+		bool localizer_ = false;
+		if (!is_image(
+				ds,
+				&rows_, &columns_,
+				&ba_, &bs_, &hb_,
+				&pr_,
+				&localizer_)) return false;
+		// questions, info boxes or temporary files
+		if (has_modality_lut_sq(ds)) return false;
+		if (force_suppllut == 0 && has_supp_palette(ds)) return false;
+		if (is_elscint(ds)) return false;
+		unsigned short spp = 1;
+		if (!get_us_value(ds, mdcm::Tag(0x0028,0x0002), &spp) || spp < 1)
+			spp = 1;
+		int frames = 1;
+		if (!get_is_value(ds, mdcm::Tag(0x0028,0x0008), &frames) || frames < 1)
+			frames = 1;
+		*bytes +=
+			(unsigned long long)rows_ * columns_ * spp *
+			((ba_ + 7) / 8) * frames;
+	}
+	// shown in own windows, s. read_dicom()
+	if (filenames.size() == 1 &&
+		(is_large_multiframe(filenames.at(0)) ||
+			is_large_jpeg2000(filenames.at(0))))
+	{
+		return false;
+	}
+	return true;
+}
+
 // load_type
 // 0 - default
 // 1 - PR reference
@@ -10786,7 +11279,7 @@ QString DicomUtils::read_dicom(
 	GLWidget * gl,
 	ShaderObj * mesh_shader,
 	bool ok3d,
-	const QWidget * settings,
+	const SettingsValues * settings,
 	QProgressDialog * pb,
 	short load_type,
 	bool enh_original_frames)
@@ -10831,8 +11324,7 @@ QString DicomUtils::read_dicom(
 	bool  localizer_tmp0 = false, localizer_tmp1 = false;
 	QString sop_tmp0, sop_tmp1;
 	QString photometric_tmp0, photometric_tmp1;
-	const SettingsWidget * wsettings =
-		static_cast<const SettingsWidget*>(settings);
+	const SettingsValues * wsettings = settings;
 	std::map<unsigned int,SliceInstance> slice_pos_map;
 	std::list<long long> slice_pos_list;
 	bool asked_about_supp_palette = false;
@@ -10856,7 +11348,7 @@ QString DicomUtils::read_dicom(
 			pb->show();
 			pb->setValue(-1);
 		}
-		QApplication::processEvents();
+		CommonUtils::process_events();
 		QString sop;
 		QString photometric;
 		unsigned short columns_ = 0, rows_ = 0;
@@ -10874,7 +11366,8 @@ QString DicomUtils::read_dicom(
 #else
 		reader.SetFileName(filenames.at(x).toLocal8Bit().constData());
 #endif
-		if (!reader.Read()) continue;
+		// headers only, Pixel Data is read later when the series is loaded
+		if (!reader.ReadUpToTag(mdcm::Tag(0x7fe0,0x0000))) continue;
 		const mdcm::File & file = reader.GetFile();
 		const mdcm::FileMetaInformation & header = file.GetHeader();
 		const mdcm::TransferSyntax & ts =
@@ -10920,7 +11413,7 @@ QString DicomUtils::read_dicom(
 					"is currently not supported"));
 				mbox.exec();
 				if (pb) pb->show();
-				QApplication::processEvents();
+				CommonUtils::process_events();
 			}
 			continue;
 		}
@@ -10935,7 +11428,7 @@ QString DicomUtils::read_dicom(
 				if (!load_image_ref_contour)
 				{
 					if (pb) pb->setValue(-1);
-					QApplication::processEvents();
+					CommonUtils::process_events();
 					ImageVariant * ivariant =
 						new ImageVariant(
 							CommonUtils::get_next_id(),
@@ -11028,7 +11521,7 @@ QString DicomUtils::read_dicom(
 					mbox.exec();
 					if (pb) pb->show();
 				}
-				QApplication::processEvents();
+				CommonUtils::process_events();
 			}
 			continue;
 		}
@@ -11230,13 +11723,13 @@ QString DicomUtils::read_dicom(
 								mbox.setIcon(QMessageBox::Question);
 								mbox.setText(QString(
 									"Apply Supplemental Palette?"));
-								qApp->processEvents();
+								CommonUtils::process_events();
 								if (mbox.exec() == QMessageBox::Yes)
 								{
 									supp_palette = true;
 								}
 								if (pb) pb->show();
-								qApp->processEvents();
+								CommonUtils::process_events();
 								asked_about_supp_palette = true;
 							}
 						}
@@ -11326,7 +11819,7 @@ QString DicomUtils::read_dicom(
 				if (has_modality_lut_sq(ds))
 				{
 					if (pb) pb->hide();
-					QApplication::processEvents();
+					CommonUtils::process_events();
 					QMessageBox mbox;
 					mbox.setIcon(QMessageBox::Information);
 					mbox.setText(QString(
@@ -11553,13 +12046,54 @@ QString DicomUtils::read_dicom(
 		}
 	}
 	//
+	if (load_type == 0 &&
+		multiframe &&
+		images.size() == 1 &&
+		CommonUtils::is_gui_thread() &&
+		is_large_multiframe(images.at(0)))
+	{
+		FrameViewer * v = new FrameViewer();
+		if (v->open(images.at(0)))
+		{
+			if (pb) pb->hide();
+			v->show();
+			v->activateWindow();
+			v->raise();
+			images.clear();
+		}
+		else
+		{
+			delete v;
+		}
+	}
+	else if (
+		load_type == 0 &&
+		images.size() == 1 &&
+		CommonUtils::is_gui_thread() &&
+		is_large_jpeg2000(images.at(0)))
+	{
+		RegionViewer * v = new RegionViewer();
+		if (v->open(images.at(0)))
+		{
+			if (pb) pb->hide();
+			v->show();
+			v->activateWindow();
+			v->raise();
+			images.clear();
+		}
+		else
+		{
+			delete v;
+		}
+	}
+	//
 	if (ultrasound && (load_type == 0 || load_type == 3))
 	{
 		// TODO PR for ultrasound
 		for (int x = 0; x < images.size(); ++x)
 		{
 			if (pb) pb->setValue(-1);
-			QApplication::processEvents();
+			CommonUtils::process_events();
 			QStringList images_tmp;
 			images_tmp << images.at(x);
 			ImageVariant * ivariant = new ImageVariant(
@@ -11590,7 +12124,7 @@ QString DicomUtils::read_dicom(
 		for (int x = 0; x < images.size(); ++x)
 		{
 			if (pb) pb->setValue(-1);
-			QApplication::processEvents();
+			CommonUtils::process_events();
 			QStringList images_tmp;
 			images_tmp << images.at(x);
 			{
@@ -11634,7 +12168,7 @@ QString DicomUtils::read_dicom(
 		for (int k = 0; k < extracted_images.size(); ++k)
 		{
 			if (pb) pb->setValue(-1);
-			QApplication::processEvents();
+			CommonUtils::process_events();
 			std::vector<QString> images__;
 			std::vector<QString> images_ipp;
 			for (int j = 0; j < extracted_images.at(k).size(); ++j)
@@ -11694,7 +12228,7 @@ QString DicomUtils::read_dicom(
 		for (int x = 0; x < images.size(); ++x)
 		{
 			if (pb) pb->setValue(-1);
-			QApplication::processEvents();
+			CommonUtils::process_events();
 			if (load_type == 0||load_type == 2)
 			{
 				bool supp_palette_failed = false;
@@ -11850,7 +12384,7 @@ QString DicomUtils::read_dicom(
 									v->di->filtering = 0;
 								}
 								CommonUtils::reset_bb(v);
-								IconUtils::icon(v);
+								if (CommonUtils::is_gui_thread()) IconUtils::icon(v);
 								v->filenames = QStringList(supp_color_images.at(jjj)->filenames);
 								ivariants.push_back(v);
 								delete supp_grey_images[jjj];
@@ -11899,7 +12433,7 @@ QString DicomUtils::read_dicom(
 		for (int x = 0; x < images.size(); ++x)
 		{
 			if (pb) pb->setValue(-1);
-			QApplication::processEvents();
+			CommonUtils::process_events();
 			QStringList images_tmp;
 			images_tmp << images.at(x);
 			ImageVariant * ivariant = new ImageVariant(
@@ -11941,7 +12475,7 @@ QString DicomUtils::read_dicom(
 		for (int x = 0; x < images.size(); ++x)
 		{
 			if (pb) pb->setValue(-1);
-			QApplication::processEvents();
+			CommonUtils::process_events();
 			QStringList images_tmp;
 			images_tmp << images.at(x);
 			ImageVariant * ivariant = new ImageVariant(
@@ -11982,7 +12516,7 @@ QString DicomUtils::read_dicom(
 		for (int x = 0; x < images.size(); ++x)
 		{
 			if (pb) pb->setValue(-1);
-			QApplication::processEvents();
+			CommonUtils::process_events();
 			QStringList images_tmp;
 			images_tmp << images.at(x);
 			if (load_type == 0||load_type == 2)
@@ -12154,7 +12688,7 @@ QString DicomUtils::read_dicom(
 		for (int x = 0; x < fff.size(); ++x)
 		{
 			if (pb) pb->setValue(-1);
-			QApplication::processEvents();
+			CommonUtils::process_events();
 			std::vector<QString> images__;
 			std::vector<QString> images_ipp;
 			for (int k = 0; k < fff.at(x).size(); ++k)
@@ -12249,7 +12783,7 @@ QString DicomUtils::read_dicom(
 		if (!images.empty())
 		{
 			if (pb) pb->setValue(-1);
-			QApplication::processEvents();
+			CommonUtils::process_events();
 			std::vector<QString> images__;
 			std::vector<QString> images_ipp;
 			for (int k = 0; k < images.size(); ++k)
@@ -12480,7 +13014,7 @@ QString DicomUtils::read_dicom(
 					}
 					delete d;
 					if (pb) pb->show();
-					QApplication::processEvents();
+					CommonUtils::process_events();
 					if (ok22)
 					{
 						ref2_ok = process_contrours_ref(
@@ -12533,7 +13067,7 @@ QString DicomUtils::read_dicom(
 			}
 		}
 		if (pb) pb->setValue(-1);
-		QApplication::processEvents();
+		CommonUtils::process_events();
 	}
 	//
 	// init contours
@@ -12596,10 +13130,10 @@ QString DicomUtils::read_dicom(
 				CommonUtils::set_save_dir(pfi.absolutePath());
 				write_encapsulated(pdf_files.at(x), pdff);
 			}
-			QApplication::processEvents();
+			CommonUtils::process_events();
 		}
 		if (pb) { pb->show(); pb->setValue(-1); }
-		QApplication::processEvents();
+		CommonUtils::process_events();
 	}
 	//
 	if (!stl_files.empty())
@@ -12624,10 +13158,10 @@ QString DicomUtils::read_dicom(
 				CommonUtils::set_save_dir(sfi.absolutePath());
 				write_encapsulated(stl_files.at(x), stlf);
 			}
-			QApplication::processEvents();
+			CommonUtils::process_events();
 		}
 		if (pb) { pb->show(); pb->setValue(-1); }
-		QApplication::processEvents();
+		CommonUtils::process_events();
 	}
 	//
 	if (!video_files.empty())
@@ -12656,10 +13190,10 @@ QString DicomUtils::read_dicom(
 				CommonUtils::set_save_dir(vfi.absolutePath());
 				write_mpeg(tmp943, video_file_name);
 			}
-			QApplication::processEvents();
+			CommonUtils::process_events();
 		}
 		if (pb) { pb->show(); pb->setValue(-1); }
-		QApplication::processEvents();
+		CommonUtils::process_events();
 	}
 	//
 	if (!grey_softcopy_pr_files.empty())
@@ -12687,10 +13221,10 @@ QString DicomUtils::read_dicom(
 					QString("Searching referenced files"));
 				pb->setValue(-1);
 			}
-			QApplication::processEvents();
+			CommonUtils::process_events();
 			QList<PrRefSeries> refs;
 			read_pr_ref(p, grey_softcopy_pr_files.at(x), refs, pb);
-			QApplication::processEvents();
+			CommonUtils::process_events();
 			for (int y = 0; y < refs.size(); ++y)
 			{
 				if (pb)
@@ -12698,7 +13232,7 @@ QString DicomUtils::read_dicom(
 					pb->setLabelText(QString("Loading ... "));
 					pb->setValue(-1);
 				}
-				QApplication::processEvents();
+				CommonUtils::process_events();
 				QStringList ref_files;
 				for (int z = 0; z < refs.at(y).images.size(); ++z)
 					ref_files.push_back(refs.at(y).images.at(z).file);
@@ -12721,7 +13255,7 @@ QString DicomUtils::read_dicom(
 				for (unsigned int z = 0; z < ref_ivariants.size(); ++z)
 				{
 					if (pb) pb->setValue(-1);
-					QApplication::processEvents();
+					CommonUtils::process_events();
 					++count;
 					bool spatial_transform = false;
 					ImageVariant * pr_image =
@@ -12764,7 +13298,7 @@ QString DicomUtils::read_dicom(
 							pr_image->di->filtering = 0;
 						}
 						bool pr_load_ok = false;
-						if (pb) { pb->setValue(-1); QApplication::processEvents(); }
+						if (pb) { pb->setValue(-1); CommonUtils::process_events(); }
 						if (
 							pr_image->image_type >=  0 &&
 							pr_image->image_type <  10)
@@ -12797,7 +13331,7 @@ QString DicomUtils::read_dicom(
 								pr_image->di->filtering = 0;
 							}
 							CommonUtils::reset_bb(pr_image);
-							IconUtils::icon(pr_image);
+							if (CommonUtils::is_gui_thread()) IconUtils::icon(pr_image);
 							ivariants.push_back(pr_image);
 						}
 						else
@@ -12833,7 +13367,7 @@ QString DicomUtils::read_dicom(
 				"</p>"
 				"</body></html>");
 			if (pb) pb->hide();
-			QApplication::processEvents();
+			CommonUtils::process_events();
 			FindRefDialog * d =
 				new FindRefDialog(wsettings->get_scale_icons());
 			d->set_text(s);
@@ -12857,10 +13391,10 @@ QString DicomUtils::read_dicom(
 					pb->setLabelText(QString("Searching referenced files"));
 					pb->setValue(-1);
 				}
-				QApplication::processEvents();
+				CommonUtils::process_events();
 				QList<PrRefSeries> refs;
 				read_pr_ref(p, grey_softcopy_pr_files.at(x), refs, pb);
-				QApplication::processEvents();
+				CommonUtils::process_events();
 				for (int y = 0; y < refs.size(); ++y)
 				{
 					if (pb)
@@ -12868,7 +13402,7 @@ QString DicomUtils::read_dicom(
 						pb->setLabelText(QString("Loading ... "));
 						pb->setValue(-1);
 					}
-					QApplication::processEvents();
+					CommonUtils::process_events();
 					QStringList ref_files;
 					for (int z = 0; z < refs.at(y).images.size(); ++z)
 						ref_files.push_back(refs.at(y).images.at(z).file);
@@ -12890,7 +13424,7 @@ QString DicomUtils::read_dicom(
 					for (unsigned int z = 0; z < ref_ivariants.size(); ++z)
 					{
 						if (pb) pb->setValue(-1);
-						QApplication::processEvents();
+						CommonUtils::process_events();
 						++count;
 						bool spatial_transform = false;
 						ImageVariant * pr_image =
@@ -12931,7 +13465,7 @@ QString DicomUtils::read_dicom(
 								pr_image->di->filtering = 0;
 							}
 							bool pr_load_ok = false;
-							if (pb) { pb->setValue(-1); QApplication::processEvents(); }
+							if (pb) { pb->setValue(-1); CommonUtils::process_events(); }
 							if (
 								pr_image->image_type >=  0 &&
 								pr_image->image_type <  10)
@@ -12964,7 +13498,7 @@ QString DicomUtils::read_dicom(
 									pr_image->di->filtering = 0;
 								}
 								CommonUtils::reset_bb(pr_image);
-								IconUtils::icon(pr_image);
+								if (CommonUtils::is_gui_thread()) IconUtils::icon(pr_image);
 								ivariants.push_back(pr_image);
 							}
 							else
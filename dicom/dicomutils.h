@@ -9,11 +9,13 @@
 #include <mdcmTag.h>
 #include <mdcmPrivateTag.h>
 #include <mdcmDataSet.h>
+#include <mdcmFile.h>
 #include <mdcmPixelFormat.h>
 #include <mdcmPhotometricInterpretation.h>
 
 class GLWidget;
 class ShaderObj;
+class SettingsValues;
 
 class DicomUtils
 {
@@ -202,7 +204,7 @@ public:
 		int, GLWidget*, bool,
 		bool, // min. load
 		bool, // skip dimensions organization for enh, orig. frames
-		const QWidget*, QProgressDialog*,
+		const SettingsValues*, QProgressDialog*,
 		float,
 		bool);
 	static QString read_enhanced_supp_palette(
@@ -210,13 +212,13 @@ public:
 		int, GLWidget*, bool,
 		bool, // min. load
 		bool, // skip dimensions organization for enh, orig. frames
-		const QWidget*, QProgressDialog*,
+		const SettingsValues*, QProgressDialog*,
 		float);
 	static QString read_ultrasound(
 		bool*,
 		ImageVariant*,
 		const QStringList&,
-		const QWidget*,
+		const SettingsValues*,
 		QProgressDialog*);
 	static QString read_series(
 		bool*,
@@ -226,7 +228,7 @@ public:
 		const bool,
 		ImageVariant*, const QStringList&,
 		int, GLWidget*, bool,
-		const QWidget*, QProgressDialog*,
+		const SettingsValues*, QProgressDialog*,
 		float,
 		bool);
 	static bool convert_elscint(
@@ -253,7 +255,9 @@ public:
 		const bool,
 		int*,
 		unsigned long long*,
-		QProgressDialog*);
+		QProgressDialog*,
+		mdcm::File* = NULL,
+		char* = NULL, const unsigned long long = 0);
 	static QString read_enhanced_common(
 		bool*,
 		std::vector<ImageVariant*> &,
@@ -278,7 +282,7 @@ public:
 		const int,
 		GLWidget*,
 		const bool,
-		const QWidget*,
+		const SettingsValues*,
 		double*,
 		const int,
 		const double, const double, const double,
@@ -314,7 +318,7 @@ public:
 		const FrameGroupValues&,
 		const bool, const int, GLWidget*,
 		const bool,
-		const QWidget*,
+		const SettingsValues*,
 		double*,
 		const int,
 		const double, const double, const double,
@@ -341,7 +345,7 @@ public:
 		std::vector<ImageVariant*> &,
 		int, GLWidget*, bool,
 		bool,
-		const QWidget*,
+		const SettingsValues*,
 		QProgressDialog*);
 	static QString find_file_from_uid(
 		const QString&,
@@ -364,6 +368,12 @@ public:
 		const mdcm::DataSet&);
 	static void global_force_suppllut(
 		short);
+	// Series of plain images, read_dicom() for them shows no
+	// dialogs and may run off the GUI thread (without GL),
+	// 'bytes' - approx. size of decoded Pixel Data.
+	static bool is_plain_series(
+		const QStringList&,
+		unsigned long long*);
 	//
 	// Type of object processing
 	//
@@ -376,7 +386,7 @@ public:
 		const QStringList&,
 		int, GLWidget*,
 		ShaderObj*, bool,
-		const QWidget*,
+		const SettingsValues*,
 		QProgressDialog*,
 		short=0, // type of object processing
 		bool=false); // skip dimensions organization for enh, orig. frames
@@ -0,0 +1,294 @@
+#include "framecache.h"
+#include <QRunnable>
+#include <QThreadPool>
+#include <QMutexLocker>
+#include <QDir>
+#include "parallelutils.h"
+#include "mdcmImageReader.h"
+#include "mdcmImage.h"
+#include "mdcmRLECodec.h"
+#include <climits>
+#include <new>
+
+class FrameCache::Runnable : public QRunnable
+{
+public:
+	Runnable(FrameCache * c_, unsigned int frame_)
+		: c(c_), frame(frame_)
+	{
+		setAutoDelete(true);
+	}
+	void run() override
+	{
+		QByteArray b;
+#if QT_VERSION >= QT_VERSION_CHECK(5,14,0)
+		if (!c->canceled.loadRelaxed()) b = c->decode(frame);
+#else
+		if (!c->canceled.load()) b = c->decode(frame);
+#endif
+		c->finish(frame, b);
+	}
+private:
+	FrameCache * c;
+	const unsigned int frame;
+};
+
+FrameCache::FrameCache()
+	:
+	reader(NULL),
+	canceled(0),
+	frame_size(0),
+	frames(0),
+	last(0),
+	direction(1),
+	ahead(0),
+	running(0),
+	planar(false),
+	rgb(false),
+	ybr(false)
+{
+}
+
+FrameCache::~FrameCache()
+{
+	close();
+}
+
+bool FrameCache::open(
+	const QString & f,
+	unsigned long long max_bytes,
+	int ahead_)
+{
+	close();
+	mdcm::ImageReader * r = new mdcm::ImageReader;
+	r->SetMemoryMapping(true);
+	// frames are decoded in parallel on the pool
+	mdcm::CodecOptions codec_options;
+	codec_options.NumberOfThreads = 1;
+	r->SetCodecOptions(codec_options);
+#ifdef _WIN32
+#if (defined(_MSC_VER) && defined(MDCM_WIN32_UNC))
+	r->SetFileName(QDir::toNativeSeparators(f).toUtf8().constData());
+#else
+	r->SetFileName(QDir::toNativeSeparators(f).toLocal8Bit().constData());
+#endif
+#else
+	r->SetFileName(f.toLocal8Bit().constData());
+#endif
+	if (!r->Read())
+	{
+		delete r;
+		return false;
+	}
+	const mdcm::Image & image = r->GetImage();
+	const mdcm::PixelFormat & pf = image.GetPixelFormat();
+	const mdcm::PhotometricInterpretation & pi =
+		image.GetPhotometricInterpretation();
+	const mdcm::TransferSyntax & ts = image.GetTransferSyntax();
+	const unsigned long long s = image.GetFrameBufferLength();
+	bool ok = false;
+	bool rgb_ = false, ybr_ = false, planar_ = false;
+	if (pf.GetSamplesPerPixel() == 1 &&
+		(pf.GetBitsAllocated() == 8 || pf.GetBitsAllocated() == 16) &&
+		(pi == mdcm::PhotometricInterpretation::MONOCHROME1 ||
+		 pi == mdcm::PhotometricInterpretation::MONOCHROME2))
+	{
+		ok = true;
+	}
+	else if (pf.GetSamplesPerPixel() == 3 && pf.GetBitsAllocated() == 8)
+	{
+		// JPEG keeps YBR, native YBR_FULL_422 is upsampled to YBR_FULL,
+		// OpenJPEG applies the inverse component transform
+		if (pi == mdcm::PhotometricInterpretation::RGB ||
+			pi == mdcm::PhotometricInterpretation::YBR_ICT ||
+			pi == mdcm::PhotometricInterpretation::YBR_RCT)
+		{
+			rgb_ = true;
+			ok = true;
+		}
+		else if (
+			pi == mdcm::PhotometricInterpretation::YBR_FULL ||
+			pi == mdcm::PhotometricInterpretation::YBR_FULL_422)
+		{
+			ybr_ = true;
+			ok = true;
+		}
+		mdcm::RLECodec rle;
+		planar_ =
+			(image.GetPlanarConfiguration() == 1 &&
+				(!ts.IsEncapsulated() || rle.CanDecode(ts)));
+	}
+	if (!ok ||
+		image.GetNumberOfFrames() < 1 ||
+		s == 0 ||
+		s > (unsigned long long)INT_MAX)
+	{
+		delete r;
+		return false;
+	}
+	// the frame shown and the frames ahead fit
+	const unsigned long long frame_kb = (s + 1023) / 1024;
+	unsigned long long max_kb = max_bytes / 1024;
+	if (max_kb > (unsigned long long)INT_MAX) max_kb = INT_MAX;
+	if (max_kb < 3 * frame_kb) max_kb = 3 * frame_kb;
+	QMutexLocker locker(&mutex);
+	reader = r;
+	frame_size = s;
+	frames = image.GetNumberOfFrames();
+	last = 0;
+	direction = 1;
+	ahead = qBound(0, ahead_, (int)(max_kb / frame_kb) - 2);
+	planar = planar_;
+	rgb = rgb_;
+	ybr = ybr_;
+	cache.setMaxCost((int)max_kb);
+	return true;
+}
+
+void FrameCache::close()
+{
+	canceled.fetchAndStoreOrdered(1);
+	{
+		QMutexLocker locker(&mutex);
+		while (running > 0) finished.wait(&mutex);
+		cache.clear();
+		pending.clear();
+		delete reader;
+		reader = NULL;
+		frame_size = 0;
+		frames = 0;
+	}
+	canceled.fetchAndStoreOrdered(0);
+}
+
+unsigned int FrameCache::get_number_of_frames() const
+{
+	return frames;
+}
+
+unsigned int FrameCache::get_dimx() const
+{
+	return reader ? reader->GetImage().GetDimension(0) : 0;
+}
+
+unsigned int FrameCache::get_dimy() const
+{
+	return reader ? reader->GetImage().GetDimension(1) : 0;
+}
+
+unsigned long long FrameCache::get_frame_size() const
+{
+	return frame_size;
+}
+
+const mdcm::Image * FrameCache::get_image() const
+{
+	return reader ? &(reader->GetImage()) : NULL;
+}
+
+const mdcm::DataSet * FrameCache::get_dataset() const
+{
+	return reader ? &(reader->GetFile().GetDataSet()) : NULL;
+}
+
+bool FrameCache::is_rgb() const
+{
+	return rgb;
+}
+
+bool FrameCache::is_ybr() const
+{
+	return ybr;
+}
+
+bool FrameCache::is_planar() const
+{
+	return planar;
+}
+
+QByteArray FrameCache::get_frame(unsigned int frame)
+{
+	{
+		QMutexLocker locker(&mutex);
+		if (!reader || frame >= frames) return QByteArray();
+		if (frame != last)
+		{
+			// cine loops
+			if (last + 1 == frames && frame == 0)
+				direction = 1;
+			else if (last == 0 && frame + 1 == frames)
+				direction = -1;
+			else
+				direction = (frame > last) ? 1 : -1;
+			last = frame;
+		}
+		while (pending.contains(frame)) finished.wait(&mutex);
+		const QByteArray * b = cache.object(frame);
+		if (b)
+		{
+			const QByteArray tmp0 = *b;
+			prefetch(frame);
+			return tmp0;
+		}
+		pending.insert(frame);
+		++running;
+	}
+	const QByteArray b = decode(frame);
+	finish(frame, b);
+	QMutexLocker locker(&mutex);
+	prefetch(frame);
+	return b;
+}
+
+QByteArray FrameCache::decode(unsigned int frame) const
+{
+	QByteArray b;
+	try
+	{
+		b.resize((int)frame_size);
+	}
+	catch (const std::bad_alloc&)
+	{
+		return QByteArray();
+	}
+	if (!reader->GetImage().GetFrameBuffer(b.data(), frame))
+	{
+		return QByteArray();
+	}
+	return b;
+}
+
+void FrameCache::finish(unsigned int frame, const QByteArray & b)
+{
+	QMutexLocker locker(&mutex);
+	pending.remove(frame);
+#if QT_VERSION >= QT_VERSION_CHECK(5,14,0)
+	if (!b.isEmpty() && !canceled.loadRelaxed())
+#else
+	if (!b.isEmpty() && !canceled.load())
+#endif
+	{
+		cache.insert(
+			frame,
+			new QByteArray(b),
+			(int)((frame_size + 1023) / 1024));
+	}
+	--running;
+	finished.wakeAll();
+}
+
+// The mutex is locked.
+void FrameCache::prefetch(unsigned int frame)
+{
+	for (int x = 1; x <= ahead; ++x)
+	{
+		const long long j =
+			((long long)frame + direction * x + frames) % frames;
+		const unsigned int i = (unsigned int)j;
+		if (i == frame) break;
+		if (cache.contains(i) || pending.contains(i)) continue;
+		pending.insert(i);
+		++running;
+		ParallelUtils::get_pool()->start(new Runnable(this, i));
+	}
+}
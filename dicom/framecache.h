@@ -0,0 +1,72 @@
+#ifndef FRAMECACHE__H_
+#define FRAMECACHE__H_
+
+#include <QtGlobal>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QAtomicInt>
+#include <QCache>
+#include <QSet>
+#include <QByteArray>
+#include <QString>
+
+namespace mdcm
+{
+class ImageReader;
+class Image;
+class DataSet;
+}
+
+// Frames of a multi-frame object, decoded on demand. The file is
+// memory mapped and Pixel Data stays encoded, decoded frames are
+// kept in a LRU cache of bounded size, so memory does not depend
+// on the number of frames. Frames ahead in the direction of the
+// previous requests are decoded on the shared pool.
+class FrameCache
+{
+public:
+	FrameCache();
+	~FrameCache();
+	// Reads the object without decoding, 'max_bytes' - max. size
+	// of cached frames, 'ahead' - number of frames decoded ahead.
+	bool open(const QString&, unsigned long long, int);
+	void close();
+	unsigned int get_number_of_frames() const;
+	unsigned int get_dimx() const;
+	unsigned int get_dimy() const;
+	unsigned long long get_frame_size() const;
+	// NULL if not open
+	const mdcm::Image * get_image() const;
+	const mdcm::DataSet * get_dataset() const;
+	// Decoded frames are RGB or YBR_FULL (else monochrome),
+	// 3 samples may be planar.
+	bool is_rgb() const;
+	bool is_ybr() const;
+	bool is_planar() const;
+	// Decoded frame, decoded on the calling thread if not cached
+	// or pending, empty on error. Schedules the next frames.
+	QByteArray get_frame(unsigned int);
+
+private:
+	class Runnable;
+	QByteArray decode(unsigned int) const;
+	void finish(unsigned int, const QByteArray&);
+	void prefetch(unsigned int);
+	mdcm::ImageReader * reader;
+	mutable QMutex mutex;
+	QWaitCondition finished;
+	QCache<unsigned int, QByteArray> cache;
+	QSet<unsigned int> pending;
+	QAtomicInt canceled;
+	unsigned long long frame_size;
+	unsigned int frames;
+	unsigned int last;
+	int direction;
+	int ahead;
+	int running;
+	bool planar;
+	bool rgb;
+	bool ybr;
+};
+
+#endif // FRAMECACHE__H_
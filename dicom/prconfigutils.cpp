@@ -3470,7 +3470,7 @@ void PrConfigUtils::read_pr(
 ImageVariant * PrConfigUtils::make_pr_monochrome(
 	const ImageVariant * ivariant,
 	const PrRefSeries & ref,
-	const SettingsWidget * w,
+	const SettingsValues * w,
 	GLWidget * gl,
 	bool ok3d,
 	bool * spatial_transform)
@@ -4471,7 +4471,7 @@ ImageVariant * PrConfigUtils::make_pr_monochrome(
 ImageVariant * PrConfigUtils::make_pr_rgb(
 	const ImageVariant * ivariant,
 	const PrRefSeries & ref,
-	const SettingsWidget * w)
+	const SettingsValues * w)
 {
 	// TODO
 	return NULL;
@@ -4480,7 +4480,7 @@ ImageVariant * PrConfigUtils::make_pr_rgb(
 ImageVariant * PrConfigUtils::make_levels_monochrome(
 	const ImageVariant * ivariant,
 	const PrRefSeries & ref,
-	const SettingsWidget * w,
+	const SettingsValues * w,
 	GLWidget * gl,
 	bool ok3d)
 {
@@ -7,7 +7,7 @@
 class PrRefSeries;
 class ImageVariant;
 class PrConfig;
-class SettingsWidget;
+class SettingsValues;
 class GLWidget;
 class PrConfigUtils
 {
@@ -33,18 +33,18 @@ public:
 	static ImageVariant * make_pr_monochrome(
 		const ImageVariant*,
 		const PrRefSeries &,
-		const SettingsWidget*,
+		const SettingsValues*,
 		GLWidget*,
 		bool,
 		bool*);
 	static ImageVariant * make_pr_rgb(
 		const ImageVariant*,
 		const PrRefSeries &,
-		const SettingsWidget*);
+		const SettingsValues*);
 	static ImageVariant * make_levels_monochrome(
 		const ImageVariant*,
 		const PrRefSeries &,
-		const SettingsWidget*,
+		const SettingsValues*,
 		GLWidget*,
 		bool);
 };
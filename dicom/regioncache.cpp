@@ -0,0 +1,350 @@
+#include "regioncache.h"
+#include <QRunnable>
+#include <QThreadPool>
+#include <QMutexLocker>
+#include <QMetaObject>
+#include <QDir>
+#include "parallelutils.h"
+#include "mdcmImageReader.h"
+#include "mdcmImage.h"
+#include "mdcmJPEG2000Codec.h"
+#include <climits>
+#include <new>
+
+class RegionCache::Runnable : public QRunnable
+{
+public:
+	Runnable(RegionCache * c_, int level_, int tx_, int ty_)
+		: c(c_), level(level_), tx(tx_), ty(ty_)
+	{
+		setAutoDelete(true);
+	}
+	void run() override
+	{
+		const quint64 key = RegionCache::get_key(level, tx, ty);
+		Tile t;
+		t.w = 0;
+		t.h = 0;
+		if (c->is_wanted(key)) c->decode(level, tx, ty, t);
+		c->finish(key, t);
+	}
+private:
+	RegionCache * c;
+	const int level;
+	const int tx;
+	const int ty;
+};
+
+RegionCache::RegionCache()
+	:
+	reader(NULL),
+	canceled(0),
+	dimx(0),
+	dimy(0),
+	pixel_size(0),
+	max_level(0),
+	running(0),
+	rgb(false),
+	ybr(false)
+{
+}
+
+RegionCache::~RegionCache()
+{
+	close();
+}
+
+int RegionCache::get_tile_size()
+{
+	return 512;
+}
+
+bool RegionCache::open(
+	const QString & f,
+	unsigned long long max_bytes,
+	QObject * receiver_)
+{
+	close();
+	mdcm::ImageReader * r = new mdcm::ImageReader;
+	r->SetMemoryMapping(true);
+	// tiles are decoded in parallel on the pool
+	mdcm::CodecOptions codec_options;
+	codec_options.NumberOfThreads = 1;
+	r->SetCodecOptions(codec_options);
+#ifdef _WIN32
+#if (defined(_MSC_VER) && defined(MDCM_WIN32_UNC))
+	r->SetFileName(QDir::toNativeSeparators(f).toUtf8().constData());
+#else
+	r->SetFileName(QDir::toNativeSeparators(f).toLocal8Bit().constData());
+#endif
+#else
+	r->SetFileName(f.toLocal8Bit().constData());
+#endif
+	if (!r->Read())
+	{
+		delete r;
+		return false;
+	}
+	const mdcm::Image & image = r->GetImage();
+	const mdcm::PixelFormat & pf = image.GetPixelFormat();
+	const mdcm::PhotometricInterpretation & pi =
+		image.GetPhotometricInterpretation();
+	bool ok = false;
+	bool rgb_ = false, ybr_ = false;
+	if (pf.GetSamplesPerPixel() == 1 &&
+		(pf.GetBitsAllocated() == 8 || pf.GetBitsAllocated() == 16) &&
+		(pi == mdcm::PhotometricInterpretation::MONOCHROME1 ||
+		 pi == mdcm::PhotometricInterpretation::MONOCHROME2))
+	{
+		ok = true;
+	}
+	else if (pf.GetSamplesPerPixel() == 3 && pf.GetBitsAllocated() == 8)
+	{
+		// OpenJPEG applies the inverse component transform
+		if (pi == mdcm::PhotometricInterpretation::RGB ||
+			pi == mdcm::PhotometricInterpretation::YBR_ICT ||
+			pi == mdcm::PhotometricInterpretation::YBR_RCT)
+		{
+			rgb_ = true;
+			ok = true;
+		}
+		else if (pi == mdcm::PhotometricInterpretation::YBR_FULL)
+		{
+			ybr_ = true;
+			ok = true;
+		}
+	}
+	mdcm::JPEG2000Codec codec;
+	if (!ok ||
+		!codec.CanDecode(image.GetTransferSyntax()) ||
+		image.GetNumberOfFrames() != 1 ||
+		image.GetDimension(0) < 1 ||
+		image.GetDimension(1) < 1)
+	{
+		delete r;
+		return false;
+	}
+	// a pixel at the highest level gives the number of levels
+	const unsigned int ps = pf.GetPixelSize();
+	char tmp0[16];
+	unsigned int reduce = 31, w = 0, h = 0;
+	if (!image.GetFrameRegion(tmp0, ps, 0, 0, 0, 1, 1, reduce, w, h))
+	{
+		delete r;
+		return false;
+	}
+	// at least a tile fits
+	const unsigned long long tile_kb =
+		((unsigned long long)get_tile_size() * get_tile_size() * ps + 1023) / 1024;
+	unsigned long long max_kb = max_bytes / 1024;
+	if (max_kb > (unsigned long long)INT_MAX) max_kb = INT_MAX;
+	if (max_kb < 4 * tile_kb) max_kb = 4 * tile_kb;
+	QMutexLocker locker(&mutex);
+	reader = r;
+	receiver = receiver_;
+	dimx = image.GetDimension(0);
+	dimy = image.GetDimension(1);
+	pixel_size = ps;
+	max_level = (int)reduce;
+	rgb = rgb_;
+	ybr = ybr_;
+	cache.setMaxCost((int)max_kb);
+	return true;
+}
+
+void RegionCache::close()
+{
+	canceled.fetchAndStoreOrdered(1);
+	{
+		QMutexLocker locker(&mutex);
+		while (running > 0) finished.wait(&mutex);
+		cache.clear();
+		pending.clear();
+		wanted.clear();
+		delete reader;
+		reader = NULL;
+		receiver = NULL;
+		dimx = 0;
+		dimy = 0;
+		max_level = 0;
+	}
+	canceled.fetchAndStoreOrdered(0);
+}
+
+unsigned int RegionCache::get_dimx() const
+{
+	return dimx;
+}
+
+unsigned int RegionCache::get_dimy() const
+{
+	return dimy;
+}
+
+int RegionCache::get_max_level() const
+{
+	return max_level;
+}
+
+const mdcm::Image * RegionCache::get_image() const
+{
+	return reader ? &(reader->GetImage()) : NULL;
+}
+
+const mdcm::DataSet * RegionCache::get_dataset() const
+{
+	return reader ? &(reader->GetFile().GetDataSet()) : NULL;
+}
+
+bool RegionCache::is_rgb() const
+{
+	return rgb;
+}
+
+bool RegionCache::is_ybr() const
+{
+	return ybr;
+}
+
+QByteArray RegionCache::get_image_at(int * level, int * w, int * h) const
+{
+	if (!reader) return QByteArray();
+	const int l = qBound(0, *level, max_level);
+	const unsigned long long s =
+		(unsigned long long)((dimx + (1u << l) - 1) >> l) *
+		((dimy + (1u << l) - 1) >> l) * pixel_size;
+	if (s > (unsigned long long)INT_MAX) return QByteArray();
+	QByteArray b;
+	try
+	{
+		b.resize((int)s);
+	}
+	catch (const std::bad_alloc&)
+	{
+		return QByteArray();
+	}
+	unsigned int reduce = (unsigned int)l, w_ = 0, h_ = 0;
+	if (!reader->GetImage().GetFrameRegion(
+			b.data(), b.size(), 0, 0, 0, dimx, dimy, reduce, w_, h_) ||
+		reduce != (unsigned int)l)
+	{
+		return QByteArray();
+	}
+	*level = l;
+	*w = (int)w_;
+	*h = (int)h_;
+	return b;
+}
+
+void RegionCache::clear_wanted()
+{
+	QMutexLocker locker(&mutex);
+	wanted.clear();
+}
+
+bool RegionCache::get_tile(
+	int level,
+	int tx,
+	int ty,
+	QByteArray & b,
+	int * w,
+	int * h)
+{
+	if (level < 0 || tx < 0 || ty < 0) return false;
+	const quint64 key = get_key(level, tx, ty);
+	QMutexLocker locker(&mutex);
+	if (!reader || level > max_level) return false;
+	const Tile * t = cache.object(key);
+	if (t)
+	{
+		b = t->data;
+		*w = t->w;
+		*h = t->h;
+		return true;
+	}
+	wanted.insert(key);
+	if (!pending.contains(key))
+	{
+		pending.insert(key);
+		++running;
+		ParallelUtils::get_pool()->start(new Runnable(this, level, tx, ty));
+	}
+	return false;
+}
+
+quint64 RegionCache::get_key(int level, int tx, int ty)
+{
+	return
+		((quint64)level << 56) |
+		((quint64)(unsigned int)tx << 28) |
+		(quint64)(unsigned int)ty;
+}
+
+bool RegionCache::decode(int level, int tx, int ty, Tile & t) const
+{
+	const unsigned long long span =
+		(unsigned long long)get_tile_size() << level;
+	const unsigned long long x0 = tx * span;
+	const unsigned long long y0 = ty * span;
+	if (x0 >= dimx || y0 >= dimy) return false;
+	const unsigned int x1 = (unsigned int)qMin((unsigned long long)dimx, x0 + span);
+	const unsigned int y1 = (unsigned int)qMin((unsigned long long)dimy, y0 + span);
+	const int s = get_tile_size() * get_tile_size() * (int)pixel_size;
+	try
+	{
+		t.data.resize(s);
+	}
+	catch (const std::bad_alloc&)
+	{
+		return false;
+	}
+	unsigned int reduce = (unsigned int)level, w = 0, h = 0;
+	if (!reader->GetImage().GetFrameRegion(
+			t.data.data(), t.data.size(), 0,
+			(unsigned int)x0, (unsigned int)y0, x1, y1,
+			reduce, w, h) ||
+		reduce != (unsigned int)level)
+	{
+		t.data.clear();
+		return false;
+	}
+	t.data.resize((int)(w * h * pixel_size));
+	t.w = (int)w;
+	t.h = (int)h;
+	return true;
+}
+
+bool RegionCache::is_wanted(quint64 key)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5,14,0)
+	if (canceled.loadRelaxed()) return false;
+#else
+	if (canceled.load()) return false;
+#endif
+	QMutexLocker locker(&mutex);
+	return wanted.contains(key);
+}
+
+void RegionCache::finish(quint64 key, const Tile & t)
+{
+	QMutexLocker locker(&mutex);
+	pending.remove(key);
+#if QT_VERSION >= QT_VERSION_CHECK(5,14,0)
+	if (!t.data.isEmpty() && !canceled.loadRelaxed())
+#else
+	if (!t.data.isEmpty() && !canceled.load())
+#endif
+	{
+		cache.insert(
+			key,
+			new Tile(t),
+			(t.data.size() + 1023) / 1024);
+		if (receiver)
+		{
+			QMetaObject::invokeMethod(
+				receiver, "update", Qt::QueuedConnection);
+		}
+	}
+	--running;
+	finished.wakeAll();
+}
@@ -0,0 +1,88 @@
+#ifndef REGIONCACHE__H_
+#define REGIONCACHE__H_
+
+#include <QtGlobal>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QAtomicInt>
+#include <QCache>
+#include <QSet>
+#include <QByteArray>
+#include <QString>
+#include <QObject>
+
+namespace mdcm
+{
+class ImageReader;
+class Image;
+class DataSet;
+}
+
+// Tiles of a large single-frame JPEG 2000 image, decoded on demand.
+// The file is memory mapped and Pixel Data stays encoded. A tile at
+// 'level' has get_tile_size() pixels per side and covers
+// get_tile_size() << level image pixels, only code-blocks of its area
+// and resolution level are decoded (mdcm::Bitmap::GetFrameRegion).
+// Tiles are decoded on the shared pool and kept in a LRU cache of
+// bounded size, a finished tile calls update() of the receiver.
+class RegionCache
+{
+public:
+	RegionCache();
+	~RegionCache();
+	static int get_tile_size();
+	// Reads the object without decoding, 'max_bytes' - max. size
+	// of cached tiles.
+	bool open(const QString&, unsigned long long, QObject*);
+	void close();
+	unsigned int get_dimx() const;
+	unsigned int get_dimy() const;
+	// Max. resolution level of the codestream
+	int get_max_level() const;
+	// NULL if not open
+	const mdcm::Image * get_image() const;
+	const mdcm::DataSet * get_dataset() const;
+	// Decoded tiles are RGB or YBR_FULL (else monochrome)
+	bool is_rgb() const;
+	bool is_ybr() const;
+	// The whole image at 'level', decoded on the calling thread,
+	// the level and the size decoded are returned.
+	QByteArray get_image_at(int*, int*, int*) const;
+	// Tiles requested after clear_wanted() are decoded,
+	// others waiting on the pool are skipped.
+	void clear_wanted();
+	// Decoded tile (level, column, row) with its size, else false
+	// and the tile is scheduled.
+	bool get_tile(int, int, int, QByteArray&, int*, int*);
+
+private:
+	class Runnable;
+	class Tile
+	{
+	public:
+		QByteArray data;
+		int w;
+		int h;
+	};
+	static quint64 get_key(int, int, int);
+	bool decode(int, int, int, Tile&) const;
+	bool is_wanted(quint64);
+	void finish(quint64, const Tile&);
+	mdcm::ImageReader * reader;
+	QObject * receiver;
+	mutable QMutex mutex;
+	QWaitCondition finished;
+	QCache<quint64, Tile> cache;
+	QSet<quint64> pending;
+	QSet<quint64> wanted;
+	QAtomicInt canceled;
+	unsigned int dimx;
+	unsigned int dimy;
+	unsigned int pixel_size;
+	int max_level;
+	int running;
+	bool rgb;
+	bool ybr;
+};
+
+#endif // REGIONCACHE__H_
@@ -93,92 +93,13 @@ template<typename T> SRImage li3(
 	catch (const std::bad_alloc&) { p = NULL; }
 	if (!p) return SRImage();
 	//
-	std::vector<QThread*> threadsLUT_;
-	const int num_threads = QThread::idealThreadCount();
-	const int tmp99 = size[1]%num_threads;
 	const double center = ivariant->di->us_window_center;
 	const double width  = ivariant->di->us_window_width;
-	if (tmp99==0)
-	{
-		int j=0;
-		for (int i = 0; i < num_threads; ++i)
-		{
-			const int size_0 = size[0];
-			const int size_1 = size[1]/num_threads;
-			const int index_0 = 0;
-			const int index_1 = i*size_1;
-			ProcessImageThreadLUT_<T> * t__ = new ProcessImageThreadLUT_<T>(image,
-						p,
-						size_0,  size_1,
-						index_0, index_1, j,
-						center, width,
-						lut, false,lut_function);
-			j += 3*(size_0*size_1);
-			threadsLUT_.push_back(static_cast<QThread*>(t__));
-			t__->start();
-		}
-	}
-	else
-	{
-		int j=0;
-		unsigned int block = 64;
-		if (static_cast<float>(size[1])/static_cast<float>(block)>16.0f) block=128;
-		const int tmp100 = size[1]%block;
-		const int incr = (int)floor(size[1]/(double)block);
-		if (size[1] > block)
-		{
-			for (int i = 0; i < incr; ++i)
-			{
-				const int size_0 = size[0];
-				const int index_0 = 0;
-				const int index_1 = i*block;
-				ProcessImageThreadLUT_<T> * t__ = new ProcessImageThreadLUT_<T>(image,
-							p,
-							size_0,  block,
-							index_0, index_1, j,
-							center, width,
-							lut, false,lut_function);
-				j += 3*(size_0*block);
-				threadsLUT_.push_back(static_cast<QThread*>(t__));
-				t__->start();
-			}
-			ProcessImageThreadLUT_<T> * lt__ = new ProcessImageThreadLUT_<T>(image,
-						p,
-						size[0],  tmp100,
-						0, incr*block, j,
-						ivariant->di->us_window_center, ivariant->di->us_window_width,
-						lut, false,lut_function);
-			threadsLUT_.push_back(static_cast<QThread*>(lt__));
-			lt__->start();
-		}
-		else
-		{
-			ProcessImageThreadLUT_<T> * lt__ = new ProcessImageThreadLUT_<T>(image,
-						p,
-						size[0],  size[1],
-						0, 0, 0,
-						center, width,
-						lut, false,lut_function);
-			threadsLUT_.push_back(static_cast<QThread*>(lt__));
-			lt__->start();
-		}
-	}
-	//
-	const unsigned short threadsLUT_size = threadsLUT_.size();
-	while (true)
-	{
-		unsigned short b__ = 0;
-		for (int i = 0; i < threadsLUT_size; ++i)
-		{
-			if (threadsLUT_.at(i)->isFinished()) { ++b__; }
-		}
-		if (b__==threadsLUT_size) break;
-	}
-	for (int i=0; i < threadsLUT_size; ++i)
-	{
-		delete threadsLUT_[i];
-	}
-	threadsLUT_.clear();
+	process_image_lut<T>(
+		image, p,
+		size[0], size[1],
+		center, width,
+		lut, false, lut_function);
 	//
 	SRImage sr;
 	sr.sx = spacing[0];
@@ -301,7 +222,7 @@ void SRUtils::read_IMAGE(
 	QTextBrowser * textBrowser,
 	const std::vector<SRGraphic> & grobjects,
 	bool info,
-	const QWidget * wsettings,
+	const SettingsValues * wsettings,
 	QProgressDialog * pb)
 {
 	QString tmpfile("");
@@ -310,8 +231,7 @@ void SRUtils::read_IMAGE(
 	mdcm::SmartPointer<mdcm::SequenceOfItems> sq8 =
 		e8.GetValueAsSQ();
 	if (!sq8) return;
-	const SettingsWidget * settings =
-		static_cast<const SettingsWidget*>(wsettings);
+	const SettingsValues * settings = wsettings;
 	const bool skip_images = settings->get_sr_skip_images();
 	const unsigned int nitems8 = sq8->GetNumberOfItems();
 	for(unsigned int i8 = 0; i8 < nitems8; ++i8)
@@ -880,11 +800,10 @@ bool SRUtils::read_SCOORD(
 	std::vector<SRImage> & srimages,
 	QTextBrowser * textBrowser,
 	bool info,
-	const QWidget * wsettings,
+	const SettingsValues * wsettings,
 	QProgressDialog * pb)
 {
-	const SettingsWidget * settings =
-		static_cast<const SettingsWidget*>(wsettings);
+	const SettingsValues * settings = wsettings;
 	const bool skip_images = settings->get_sr_skip_images();
 	QString GraphicType;
 	if (DicomUtils::get_string_value(
@@ -1688,7 +1607,7 @@ QString SRUtils::read_sr_content_sq(
 	const mdcm::DataSet & ds,
 	const QString & charset,
 	const QString & path,
-	const QWidget * wsettings,
+	const SettingsValues * wsettings,
 	QTextBrowser * textBrowser,
 	QProgressDialog * pb,
 	QStringList & tmpfiles,
@@ -1708,8 +1627,7 @@ QString SRUtils::read_sr_content_sq(
 	QString s("");
 	if (title) s += read_sr_title2(ds, charset);
 	QString tmp_chapter("");
-	const SettingsWidget * settings =
-		static_cast<const SettingsWidget*>(wsettings);
+	const SettingsValues * settings = wsettings;
 	const bool print_chapters = settings->get_sr_chapters();
 	const unsigned int nitems = sq->GetNumberOfItems();
 	for(unsigned int i = 0; i < nitems; ++i)
@@ -10,6 +10,7 @@
 #include <vector>
 
 class SRImage;
+class SettingsValues;
 
 class SRGraphic
 {
@@ -38,7 +39,7 @@ public:
 		QTextBrowser*,
 		const std::vector<SRGraphic>&,
 		bool,
-		const QWidget*,
+		const SettingsValues*,
 		QProgressDialog*);
 	static bool read_SCOORD(
 		const mdcm::DataSet&,
@@ -49,7 +50,7 @@ public:
 		std::vector<SRImage>&,
 		QTextBrowser*,
 		bool,
-		const QWidget*,
+		const SettingsValues*,
 		QProgressDialog*);
 	static void    read_PNAME(const mdcm::DataSet&,const QString&,QString&);
 	static void    read_TEXT (const mdcm::DataSet&,const QString&,QString&);
@@ -71,7 +72,7 @@ public:
 		const mdcm::DataSet&,
 		const QString&,
 		const QString&,
-		const QWidget*,
+		const SettingsValues*,
 		QTextBrowser*,
 		QProgressDialog*,
 		QStringList&,
@@ -25,6 +25,7 @@
 #endif
 #include "GUI/mainwindow.h"
 #include <QApplication>
+#include <QCoreApplication>
 #include <QSettings>
 #include <QStyle>
 #include <QPalette>
@@ -35,6 +36,8 @@
 #include <cstdlib>
 #include <iostream>
 #include "browser/sqtree.h"
+#include "browser/batchmode.h"
+#include "common/parallelutils.h"
 
 #if (defined LOG_STDOUT_TO_FILE && LOG_STDOUT_TO_FILE==1)
 #if (QT_VERSION >= QT_VERSION_CHECK(5,0,0))
@@ -100,6 +103,15 @@ void redirect_qdebug(
 
 int main(int argc, char *argv[])
 {
+	// batch mode, no GUI and no OpenGL
+	if (BatchMode::is_batch(argc, argv))
+	{
+		QCoreApplication app(argc, argv);
+		app.setOrganizationName(QString("Aliza"));
+		app.setOrganizationDomain(QString("aliza-dicom-viewer.com"));
+		app.setApplicationName(QString("AlizaMS"));
+		return BatchMode::run(app.arguments());
+	}
 #ifdef FORCE_PLATFORM_XCB
 #ifndef _WIN32
 #ifndef __APPLE__
@@ -293,8 +305,11 @@ int main(int argc, char *argv[])
 			settings.value(QString("enable_gl_3D"), 1).toInt();
 		const int hide_zoom_ =
 			settings.value(QString("hide_zoom"), 1).toInt();
+		const int max_threads =
+			settings.value(QString("max_threads"), 0).toInt();
 		settings.endGroup();
 		hide_zoom = (hide_zoom_==1) ? true : false;
+		ParallelUtils::set_max_threads(max_threads);
 		QFont f = QApplication::font();
 		if (app_font_pt <= 0.0)
 		{
@@ -0,0 +1,21 @@
+/*********************************************************
+ *
+ * MDCM
+ *
+ * Modifications github.com/issakomi
+ *
+ *********************************************************/
+
+// Runs mdcm::Rescaler::Benchmark, vectorized kernels against
+// the scalar reference. Build with MDCM_BUILD_RESCALER_BENCHMARK
+// (and CMAKE_BUILD_TYPE=Release for meaningful timings),
+// returns 1 if results differ.
+
+#include "mdcmRescaler.h"
+#include <iostream>
+
+int
+main()
+{
+  return mdcm::Rescaler::Benchmark(std::cout) ? 0 : 1;
+}
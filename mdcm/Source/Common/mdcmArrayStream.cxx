@@ -0,0 +1,130 @@
+/*********************************************************
+ *
+ * MDCM
+ *
+ * github.com/issakomi
+ *
+ *********************************************************/
+
+#include "mdcmArrayStream.h"
+#include <limits>
+
+namespace mdcm
+{
+
+ArrayStreamBuf::ArrayStreamBuf() {}
+
+ArrayStreamBuf::~ArrayStreamBuf() {}
+
+void
+ArrayStreamBuf::SetInput(const char * p, size_t n)
+{
+  char * b = const_cast<char *>(p);
+  setg(b, b, b + n);
+}
+
+void
+ArrayStreamBuf::SetOutput(char * p, size_t n)
+{
+  setp(p, p + n);
+}
+
+const char *
+ArrayStreamBuf::Reference(size_t n)
+{
+  if ((size_t)(egptr() - gptr()) < n)
+    return NULL;
+  const char * p = gptr();
+  setg(eback(), gptr() + n, egptr());
+  return p;
+}
+
+size_t
+ArrayStreamBuf::GetNumberOfWrittenBytes() const
+{
+  return (size_t)(pptr() - pbase());
+}
+
+ArrayStreamBuf::pos_type
+ArrayStreamBuf::seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which)
+{
+  const bool in = (which & std::ios_base::in);
+  if (in == (bool)(which & std::ios_base::out))
+    return pos_type(off_type(-1));
+  char * b = in ? eback() : pbase();
+  char * c = in ? gptr() : pptr();
+  char * e = in ? egptr() : epptr();
+  off_type p;
+  switch (dir)
+  {
+    case std::ios_base::beg:
+      p = off;
+      break;
+    case std::ios_base::cur:
+      p = (c - b) + off;
+      break;
+    case std::ios_base::end:
+      p = (e - b) + off;
+      break;
+    default:
+      return pos_type(off_type(-1));
+  }
+  if (p < 0 || p > (e - b))
+    return pos_type(off_type(-1));
+  if (in)
+  {
+    setg(b, b + p, e);
+  }
+  else
+  {
+    // pbump takes int
+    setp(b, e);
+    off_type r = p;
+    while (r > 0)
+    {
+      const int s = (r > std::numeric_limits<int>::max()) ? std::numeric_limits<int>::max() : (int)r;
+      pbump(s);
+      r -= s;
+    }
+  }
+  return pos_type(p);
+}
+
+ArrayStreamBuf::pos_type
+ArrayStreamBuf::seekpos(pos_type pos, std::ios_base::openmode which)
+{
+  return seekoff(off_type(pos), std::ios_base::beg, which);
+}
+
+std::streamsize
+ArrayStreamBuf::showmanyc()
+{
+  const std::streamsize n = egptr() - gptr();
+  return (n > 0) ? n : -1;
+}
+
+IArrayStream::IArrayStream(const char * p, size_t n)
+  : std::istream(NULL)
+{
+  Buffer.SetInput(p, n);
+  rdbuf(&Buffer);
+}
+
+IArrayStream::~IArrayStream() {}
+
+OArrayStream::OArrayStream(char * p, size_t n)
+  : std::ostream(NULL)
+{
+  Buffer.SetOutput(p, n);
+  rdbuf(&Buffer);
+}
+
+OArrayStream::~OArrayStream() {}
+
+size_t
+OArrayStream::GetNumberOfWrittenBytes() const
+{
+  return Buffer.GetNumberOfWrittenBytes();
+}
+
+} // end namespace mdcm
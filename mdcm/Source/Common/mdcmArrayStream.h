@@ -0,0 +1,79 @@
+/*********************************************************
+ *
+ * MDCM
+ *
+ * github.com/issakomi
+ *
+ *********************************************************/
+
+#ifndef MDCMARRAYSTREAM_H
+#define MDCMARRAYSTREAM_H
+
+#include "mdcmTypes.h"
+#include <istream>
+#include <ostream>
+#include <streambuf>
+
+namespace mdcm
+{
+
+/**
+ * Non-owning stream buffer over memory of fixed size, input
+ * and/or output. Nothing is copied or allocated, writing
+ * beyond the end fails.
+ */
+class MDCM_EXPORT ArrayStreamBuf : public std::streambuf
+{
+public:
+  ArrayStreamBuf();
+  ~ArrayStreamBuf();
+  void
+  SetInput(const char *, size_t);
+  void
+  SetOutput(char *, size_t);
+  // Returns the current position and skips 'n' bytes,
+  // NULL if less than 'n' bytes are left.
+  const char *
+  Reference(size_t);
+  size_t
+  GetNumberOfWrittenBytes() const;
+
+protected:
+  pos_type
+  seekoff(off_type, std::ios_base::seekdir, std::ios_base::openmode = std::ios_base::in) override;
+  pos_type
+  seekpos(pos_type, std::ios_base::openmode = std::ios_base::in) override;
+  std::streamsize
+  showmanyc() override;
+
+private:
+  ArrayStreamBuf(const ArrayStreamBuf &);
+  void
+  operator=(const ArrayStreamBuf &);
+};
+
+class MDCM_EXPORT IArrayStream : public std::istream
+{
+public:
+  IArrayStream(const char *, size_t);
+  ~IArrayStream();
+
+private:
+  ArrayStreamBuf Buffer;
+};
+
+class MDCM_EXPORT OArrayStream : public std::ostream
+{
+public:
+  OArrayStream(char *, size_t);
+  ~OArrayStream();
+  size_t
+  GetNumberOfWrittenBytes() const;
+
+private:
+  ArrayStreamBuf Buffer;
+};
+
+} // end namespace mdcm
+
+#endif // MDCMARRAYSTREAM_H
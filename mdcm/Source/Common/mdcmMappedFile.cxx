@@ -0,0 +1,161 @@
+/*********************************************************
+ *
+ * MDCM
+ *
+ * github.com/issakomi
+ *
+ *********************************************************/
+
+#include "mdcmMappedFile.h"
+#include "mdcmSystem.h"
+#include <limits>
+#ifdef _WIN32
+#  include <windows.h>
+#else
+#  include <sys/types.h>
+#  include <sys/stat.h>
+#  include <sys/mman.h>
+#  include <fcntl.h>
+#  include <unistd.h>
+#endif
+
+namespace mdcm
+{
+
+MappedFile::MappedFile()
+  : Data(NULL)
+  , Size(0)
+#ifdef _WIN32
+  , FileHandle(NULL)
+  , MappingHandle(NULL)
+#endif
+{}
+
+MappedFile::~MappedFile()
+{
+  Close();
+}
+
+bool
+MappedFile::Open(const char * p)
+{
+  Close();
+  if (!(p && *p))
+    return false;
+#ifdef _WIN32
+#  if (defined(_MSC_VER) && defined(MDCM_WIN32_UNC))
+  const std::wstring uncpath = System::ConvertToUtf16(p);
+  HANDLE f = CreateFileW(
+    uncpath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+#  else
+  HANDLE f =
+    CreateFileA(p, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+#  endif
+  if (f == INVALID_HANDLE_VALUE)
+    return false;
+  LARGE_INTEGER s;
+  if (!GetFileSizeEx(f, &s) || s.QuadPart <= 0 ||
+      (unsigned long long)s.QuadPart > (unsigned long long)std::numeric_limits<size_t>::max())
+  {
+    CloseHandle(f);
+    return false;
+  }
+  HANDLE m = CreateFileMappingA(f, NULL, PAGE_READONLY, 0, 0, NULL);
+  if (!m)
+  {
+    CloseHandle(f);
+    return false;
+  }
+  const void * d = MapViewOfFile(m, FILE_MAP_READ, 0, 0, 0);
+  if (!d)
+  {
+    CloseHandle(m);
+    CloseHandle(f);
+    return false;
+  }
+  FileHandle = f;
+  MappingHandle = m;
+  Data = static_cast<const char *>(d);
+  Size = (size_t)s.QuadPart;
+#else
+  const int f = open(p, O_RDONLY);
+  if (f < 0)
+    return false;
+  struct stat s;
+  if (fstat(f, &s) != 0 || s.st_size <= 0 ||
+      (unsigned long long)s.st_size > (unsigned long long)std::numeric_limits<size_t>::max())
+  {
+    close(f);
+    return false;
+  }
+  void * d = mmap(NULL, (size_t)s.st_size, PROT_READ, MAP_PRIVATE, f, 0);
+  // the mapping stays valid after close
+  close(f);
+  if (d == MAP_FAILED)
+    return false;
+#  ifdef MADV_SEQUENTIAL
+  // more aggressive read-ahead for cold files
+  madvise(d, (size_t)s.st_size, MADV_SEQUENTIAL);
+#  endif
+  Data = static_cast<const char *>(d);
+  Size = (size_t)s.st_size;
+#endif
+  return true;
+}
+
+void
+MappedFile::Close()
+{
+#ifdef _WIN32
+  if (Data)
+    UnmapViewOfFile(Data);
+  if (MappingHandle)
+    CloseHandle(MappingHandle);
+  if (FileHandle)
+    CloseHandle(FileHandle);
+  MappingHandle = NULL;
+  FileHandle = NULL;
+#else
+  if (Data)
+    munmap(const_cast<char *>(Data), Size);
+#endif
+  Data = NULL;
+  Size = 0;
+}
+
+const char *
+MappedFile::GetPointer() const
+{
+  return Data;
+}
+
+size_t
+MappedFile::GetSize() const
+{
+  return Size;
+}
+
+MappedStreamBuf::MappedStreamBuf(MappedFile * f)
+  : File(f)
+{
+  SetInput(f->GetPointer(), f->GetSize());
+}
+
+MappedStreamBuf::~MappedStreamBuf() {}
+
+MappedFile *
+MappedStreamBuf::GetMappedFile() const
+{
+  return File;
+}
+
+MappedStream::MappedStream(MappedFile * f)
+  : std::istream(NULL)
+  , Buffer(f)
+{
+  rdbuf(&Buffer);
+}
+
+MappedStream::~MappedStream() {}
+
+} // end namespace mdcm
@@ -0,0 +1,82 @@
+/*********************************************************
+ *
+ * MDCM
+ *
+ * github.com/issakomi
+ *
+ *********************************************************/
+
+#ifndef MDCMMAPPEDFILE_H
+#define MDCMMAPPEDFILE_H
+
+#include "mdcmObject.h"
+#include "mdcmSmartPointer.h"
+#include "mdcmArrayStream.h"
+#include <istream>
+
+namespace mdcm
+{
+
+/**
+ * Read-only memory mapping of a whole file. Values referencing
+ * the mapping keep it alive, the file must not be truncated
+ * or rewritten while they exist.
+ */
+class MDCM_EXPORT MappedFile : public Object
+{
+public:
+  MappedFile();
+  ~MappedFile();
+  bool
+  Open(const char *);
+  void
+  Close();
+  const char *
+  GetPointer() const;
+  size_t
+  GetSize() const;
+
+private:
+  MappedFile(const MappedFile &);
+  void
+  operator=(const MappedFile &);
+  const char * Data;
+  size_t       Size;
+#ifdef _WIN32
+  void * FileHandle;
+  void * MappingHandle;
+#endif
+};
+
+/**
+ * Stream buffer over a mapped file, the whole file is the get area,
+ * so reads are plain copies and seeks are pointer arithmetic.
+ */
+class MDCM_EXPORT MappedStreamBuf : public ArrayStreamBuf
+{
+public:
+  MappedStreamBuf(MappedFile *);
+  ~MappedStreamBuf();
+  MappedFile *
+  GetMappedFile() const;
+
+private:
+  MappedStreamBuf(const MappedStreamBuf &);
+  void
+  operator=(const MappedStreamBuf &);
+  SmartPointer<MappedFile> File;
+};
+
+class MDCM_EXPORT MappedStream : public std::istream
+{
+public:
+  MappedStream(MappedFile *);
+  ~MappedStream();
+
+private:
+  MappedStreamBuf Buffer;
+};
+
+} // end namespace mdcm
+
+#endif // MDCMMAPPEDFILE_H
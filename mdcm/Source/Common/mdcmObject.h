@@ -26,6 +26,7 @@
 #include "mdcmTypes.h"
 #include "mdcmTrace.h"
 #include <iostream>
+#include <atomic>
 
 namespace mdcm
 {
@@ -67,10 +68,10 @@ protected:
   UnRegister()
   {
     assert(ReferenceCount > 0);
-    --ReferenceCount;
-    if (ReferenceCount <= 0)
+    const long long c = --ReferenceCount;
+    if (c <= 0)
     {
-      assert(ReferenceCount == 0);
+      assert(c == 0);
       delete this;
     }
   }
@@ -81,7 +82,8 @@ public:
   {}
 
 private:
-  long long ReferenceCount;
+  // atomic, values may be shared by threads decoding frames
+  std::atomic<long long> ReferenceCount;
 };
 
 // Define in the base class the operator and use the member function
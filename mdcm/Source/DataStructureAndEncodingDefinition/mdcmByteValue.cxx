@@ -29,9 +29,15 @@
 namespace mdcm
 {
 
+// Values from this size are allocated when they are read
+// or written, or reference the file, if it is mapped.
+static const size_t LargeValueSize = 65536;
+
 ByteValue::ByteValue(const char * array, const VL & vl)
   : Internal(array, array + vl)
   , Length(vl)
+  , Pending(0)
+  , External(NULL)
 {
   if (vl.IsOdd())
   {
@@ -44,6 +50,8 @@ ByteValue::ByteValue(const char * array, const VL & vl)
 ByteValue::ByteValue(std::vector<char> & v)
   : Internal(v)
   , Length((uint32_t)v.size())
+  , Pending(0)
+  , External(NULL)
 {}
 
 ByteValue::~ByteValue()
@@ -54,19 +62,19 @@ ByteValue::~ByteValue()
 void
 ByteValue::PrintASCII(std::ostream & os, VL maxlength) const
 {
-  VL length = std::min(maxlength, Length);
+  VL           length = std::min(maxlength, Length);
+  const char * p = GetPointer();
   // Special case for VR::UI, do not print the trailing \0
   if (length && length == Length)
   {
-    if (Internal[length - 1] == 0)
+    if (p[length - 1] == 0)
     {
       length = length - 1;
     }
   }
-  std::vector<char>::const_iterator it = Internal.cbegin();
-  for (; it != Internal.cbegin() + length; ++it)
+  for (VL i = 0; i < length; ++i)
   {
-    const char & c = *it;
+    const char & c = p[i];
     if (!(isprint((unsigned char)c) || isspace((unsigned char)c)))
       os << ".";
     else
@@ -79,13 +87,13 @@ ByteValue::PrintHex(std::ostream & os, VL maxlength) const
 {
   std::ios oldState(NULL);
   oldState.copyfmt(os);
-  VL                                length = std::min(maxlength, Length);
-  std::vector<char>::const_iterator it = Internal.begin();
+  VL           length = std::min(maxlength, Length);
+  const char * p = GetPointer();
   os << std::hex;
-  for (; it != Internal.begin() + length; ++it)
+  for (VL i = 0; i < length; ++i)
   {
-    uint8_t v = *it;
-    if (it != Internal.begin())
+    uint8_t v = p[i];
+    if (i != 0)
       os << "\\";
     os << std::setw(2) << std::setfill('0') << (uint16_t)v;
   }
@@ -139,13 +147,24 @@ ByteValue::SetLength(VL vl)
   // Can not use reserve for now, need to implement:
   // STL - vector<> and istream
   // http://groups.google.com/group/comp.lang.c++/msg/37ec052ed8283e74
-  try
+  Detach();
+  if (Internal.empty() && l >= LargeValueSize)
   {
-    Internal.resize(l);
+    // Allocated on first access, not at all if the value
+    // is referenced in a mapped file
+    Pending = l;
   }
-  catch (...)
+  else
   {
-    throw std::logic_error("Can not resize Internal, exception");
+    Pending = 0;
+    try
+    {
+      Internal.resize(l);
+    }
+    catch (...)
+    {
+      throw std::logic_error("Can not resize Internal, exception");
+    }
   }
   Length = vl;
 }
@@ -153,7 +172,14 @@ ByteValue::SetLength(VL vl)
 void
 ByteValue::Append(ByteValue const & bv)
 {
-  Internal.insert(Internal.end(), bv.Internal.begin(), bv.Internal.end());
+  Detach();
+  Allocate();
+  const size_t size = bv.GetStorageSize();
+  if (size)
+  {
+    const char * p = bv.GetPointer();
+    Internal.insert(Internal.end(), p, p + size);
+  }
   Length += bv.Length;
   assert(Internal.size() % 2 == 0 && Internal.size() == Length);
 }
@@ -162,11 +188,17 @@ void
 ByteValue::Clear()
 {
   Internal.clear();
+  Pending = 0;
+  External = NULL;
+  ExternalFile = NULL;
 }
 
 const char *
 ByteValue::GetPointer() const
 {
+  if (External)
+    return External;
+  assert(!Pending);
   if (!Internal.empty())
     return &Internal[0];
   return NULL;
@@ -175,14 +207,14 @@ ByteValue::GetPointer() const
 const void *
 ByteValue::GetVoidPointer() const
 {
-  if (!Internal.empty())
-    return &Internal[0];
-  return NULL;
+  return GetPointer();
 }
 
 void *
 ByteValue::GetVoidPointer()
 {
+  Detach();
+  Allocate();
   if (!Internal.empty())
     return &Internal[0];
   return NULL;
@@ -191,6 +223,8 @@ ByteValue::GetVoidPointer()
 void
 ByteValue::Fill(char c)
 {
+  Detach();
+  Allocate();
   std::vector<char>::iterator it = Internal.begin();
   for (; it != Internal.end(); ++it)
     *it = c;
@@ -199,10 +233,10 @@ ByteValue::Fill(char c)
 bool
 ByteValue::GetBuffer(char * buffer, unsigned long long length) const
 {
-  if (length <= Internal.size())
+  if (length <= GetStorageSize())
   {
-    if (!Internal.empty())
-      memcpy(buffer, &Internal[0], length);
+    if (length)
+      memcpy(buffer, GetPointer(), length);
     return true;
   }
   mdcmAlwaysWarnMacro("Could not handle length = " << length);
@@ -214,8 +248,9 @@ ByteValue::WriteBuffer(std::ostream & os) const
 {
   if (Length)
   {
-    assert(!(Internal.size() % 2));
-    os.write(&Internal[0], Internal.size());
+    const size_t size = GetStorageSize();
+    assert(!(size % 2));
+    os.write(GetPointer(), size);
   }
   return true;
 }
@@ -226,4 +261,75 @@ ByteValue::SetLengthOnly(VL vl)
   Length = vl;
 }
 
+bool
+ByteValue::ReadMapped(std::istream & is, bool any_size)
+{
+  if ((!any_size && Length < LargeValueSize) || Length.IsOdd())
+    return false;
+  MappedStreamBuf * buf = dynamic_cast<MappedStreamBuf *>(is.rdbuf());
+  if (!buf)
+    return false;
+  const char * p = buf->Reference(Length);
+  if (!p)
+    return false;
+  std::vector<char>().swap(Internal);
+  Pending = 0;
+  External = p;
+  ExternalFile = buf->GetMappedFile();
+  return true;
+}
+
+void
+ByteValue::Allocate()
+{
+  if (!Pending)
+    return;
+  try
+  {
+    Internal.resize(Pending);
+  }
+  catch (...)
+  {
+    throw std::logic_error("Can not resize Internal, exception");
+  }
+  Pending = 0;
+}
+
+// Copy on write, the mapping is read-only
+void
+ByteValue::Detach()
+{
+  if (!External)
+    return;
+  try
+  {
+    Internal.assign(External, External + Length);
+  }
+  catch (...)
+  {
+    throw std::logic_error("Can not resize Internal, exception");
+  }
+  External = NULL;
+  ExternalFile = NULL;
+}
+
+size_t
+ByteValue::GetStorageSize() const
+{
+  if (External)
+    return Length;
+  return Internal.size();
+}
+
+bool
+ByteValue::IsEqual(const ByteValue & bv) const
+{
+  const size_t size = GetStorageSize();
+  if (size != bv.GetStorageSize())
+    return false;
+  if (size == 0)
+    return true;
+  return memcmp(GetPointer(), bv.GetPointer(), size) == 0;
+}
+
 } // end namespace mdcm
@@ -25,8 +25,12 @@
 #include "mdcmValue.h"
 #include "mdcmTrace.h"
 #include "mdcmVL.h"
+#include "mdcmSwapper.h"
+#include "mdcmMappedFile.h"
 #include <vector>
 #include <iostream>
+#include <cstring>
+#include <type_traits>
 
 namespace mdcm
 {
@@ -42,13 +46,14 @@ public:
   ByteValue(std::vector<char> &);
   ~ByteValue();
 
-  operator const std::vector<char> &() const { return Internal; }
-
   ByteValue &
   operator=(const ByteValue & val)
   {
     Internal = val.Internal;
     Length = val.Length;
+    Pending = val.Pending;
+    External = val.External;
+    ExternalFile = val.ExternalFile;
     return *this;
   }
 
@@ -57,16 +62,14 @@ public:
   {
     if (Length != val.Length)
       return false;
-    if (Internal == val.Internal)
-      return true;
-    return false;
+    return IsEqual(val);
   }
 
   bool
   operator==(const Value & val) const override
   {
     const ByteValue & bv = dynamic_cast<const ByteValue &>(val);
-    return Length == bv.Length && Internal == bv.Internal;
+    return Length == bv.Length && IsEqual(bv);
   }
 
   template <typename TSwap, typename TType>
@@ -81,6 +84,13 @@ public:
     {
       if (readvalues)
       {
+        // Large values from a mapped file are not copied,
+        // if they don't need swapping
+        if ((sizeof(TType) == 1 || std::is_same<TSwap, SwapperNoOp>::value) && ReadMapped(is))
+        {
+          return is;
+        }
+        Allocate();
         is.read(&Internal[0], Length);
         assert(Internal.size() == Length || Internal.size() == Length + 1);
         TSwap::SwapArray((TType *)GetVoidPointer(), Internal.size() / sizeof(TType));
@@ -100,16 +110,44 @@ public:
     return Read<TSwap, uint8_t>(is);
   }
 
+  // Pixel Data fragment, from a mapped file it is referenced
+  // whatever the size
+  template <typename TSwap>
+  std::istream &
+  ReadFragment(std::istream & is)
+  {
+    if (Length && ReadMapped(is, true))
+    {
+      return is;
+    }
+    return Read<TSwap, uint8_t>(is);
+  }
+
   template <typename TSwap, typename TType>
   std::ostream const &
   Write(std::ostream & os) const
   {
-    assert(!(Internal.size() % 2));
-    if (!Internal.empty())
+    const size_t size = GetStorageSize();
+    assert(!(size % 2));
+    if (size)
     {
-      std::vector<char> copy = Internal;
-      TSwap::SwapArray((TType *)(void *)&copy[0], Internal.size() / sizeof(TType));
-      os.write(&copy[0], copy.size());
+      const char * p = GetPointer();
+      if (sizeof(TType) == 1 || std::is_same<TSwap, SwapperNoOp>::value)
+      {
+        os.write(p, size);
+        return os;
+      }
+      // Swap through a bounded buffer, the value may be large
+      // or reference a mapped file
+      const size_t      chunk = 65536;
+      std::vector<char> copy((size < chunk) ? size : chunk);
+      for (size_t i = 0; i < size && os; i += copy.size())
+      {
+        const size_t n = (size - i < copy.size()) ? size - i : copy.size();
+        memcpy(&copy[0], p + i, n);
+        TSwap::SwapArray((TType *)(void *)&copy[0], n / sizeof(TType));
+        os.write(&copy[0], n);
+      }
     }
     return os;
   }
@@ -155,9 +193,26 @@ protected:
   void SetLengthOnly(VL) override;
 
 private:
+  bool
+  ReadMapped(std::istream &, bool = false);
+  void
+  Allocate();
+  void
+  Detach();
+  size_t
+  GetStorageSize() const;
+  bool
+  IsEqual(const ByteValue &) const;
   std::vector<char> Internal;
   // WARNING Length is not Internal.size()
   VL Length;
+  // Size of Internal not allocated yet, see SetLength,
+  // resolved by Read or a non-const access, never by
+  // const access, values may be shared between threads
+  size_t Pending;
+  // Value is in a mapped file, Internal is not used
+  const char *             External;
+  SmartPointer<MappedFile> ExternalFile;
 };
 
 } // end namespace mdcm
@@ -92,7 +92,14 @@ DataSet::ReadUpToTag(std::istream & is, const Tag & t, const std::set<Tag> & ski
     {
       assert(is.good());
       if (de.GetTag() != t)
-        is.seekg(de.GetVL(), std::ios::cur);
+      {
+        // Undefined length (encapsulated Pixel Data, sequences)
+        // can not be seeked over, the value is parsed, not kept
+        if (de.GetVL().IsUndefined())
+          static_cast<TDE &>(de).template ReadValue<TSwap>(is, false);
+        else
+          is.seekg(de.GetVL(), std::ios::cur);
+      }
     }
     // tag was found, we can exit the loop
     if (t <= de.GetTag())
@@ -121,7 +128,14 @@ DataSet::ReadUpToTagWithLength(std::istream & is, const Tag & t, std::set<Tag> c
     {
       assert(is.good());
       if (de.GetTag() != t)
-        is.seekg(de.GetVL(), std::ios::cur);
+      {
+        // Undefined length (encapsulated Pixel Data, sequences)
+        // can not be seeked over, the value is parsed, not kept
+        if (de.GetVL().IsUndefined())
+          static_cast<TDE &>(de).template ReadValue<TSwap>(is, false);
+        else
+          is.seekg(de.GetVL(), std::ios::cur);
+      }
     }
     // tag was found, we can exit the loop.
     if (t <= de.GetTag())
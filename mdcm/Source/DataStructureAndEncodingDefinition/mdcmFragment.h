@@ -89,7 +89,7 @@ public:
     const Tag               seqDelItem(0xfffe, 0xe0dd);
     SmartPointer<ByteValue> bv = new ByteValue;
     bv->SetLength(ValueLengthField);
-    if (!bv->Read<TSwap>(is))
+    if (!bv->ReadFragment<TSwap>(is))
     {
       // Fragment is incomplete, but is a itemStart, let's try to push it anyway
       mdcmWarningMacro("Fragment could not be read");
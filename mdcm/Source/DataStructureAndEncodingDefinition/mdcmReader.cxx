@@ -45,6 +45,8 @@ Reader::Reader()
 {
   Stream = NULL;
   Ifstream = NULL;
+  Mstream = NULL;
+  MemoryMapping = false;
 }
 
 Reader::~Reader()
@@ -56,6 +58,12 @@ Reader::~Reader()
     Ifstream = NULL;
     Stream = NULL;
   }
+  if (Mstream)
+  {
+    delete Mstream;
+    Mstream = NULL;
+    Stream = NULL;
+  }
 }
 
 bool
@@ -791,6 +799,22 @@ Reader::SetFileName(const char * p)
 {
   if (Ifstream)
     delete Ifstream;
+  Ifstream = NULL;
+  if (Mstream)
+    delete Mstream;
+  Mstream = NULL;
+  Stream = NULL;
+  if (MemoryMapping)
+  {
+    SmartPointer<MappedFile> m = new MappedFile;
+    if (m->Open(p))
+    {
+      Mstream = new MappedStream(m);
+      Stream = Mstream;
+      return;
+    }
+    // empty file or mapping failed, use ifstream
+  }
   Ifstream = new std::ifstream();
   if (p && *p)
   {
@@ -23,6 +23,7 @@
 #define MDCMREADER_H
 
 #include "mdcmFile.h"
+#include "mdcmMappedFile.h"
 #include <fstream>
 
 namespace mdcm
@@ -50,6 +51,14 @@ public:
   Read();
   void
   SetFileName(const char *);
+  // Memory-map the file set with SetFileName (call it before),
+  // large values reference the mapping instead of being copied.
+  // The file must not be modified while the values exist.
+  void
+  SetMemoryMapping(bool b)
+  {
+    MemoryMapping = b;
+  }
   void
   SetStream(std::istream & input_stream)
   {
@@ -101,6 +110,8 @@ private:
                   GuessTransferSyntax();
   std::istream *  Stream;
   std::ifstream * Ifstream;
+  MappedStream *  Mstream;
+  bool            MemoryMapping;
 };
 
 } // end namespace mdcm
@@ -151,11 +151,23 @@ public:
 
   template <typename TSwap>
   std::istream &
-  ReadValue(std::istream & is, bool /*readvalues*/)
+  ReadValue(std::istream & is, bool readvalues)
   {
     const Tag seqDelItem(0xfffe, 0xe0dd);
     // not used
     Fragment frag;
+    if (!readvalues)
+    {
+      // Skip fragments, nothing is allocated
+      while (frag.ReadPreValue<TSwap>(is) && frag.GetTag() != seqDelItem)
+      {
+        if (frag.GetVL().IsUndefined() || !is.seekg(frag.GetVL(), std::ios::cur))
+        {
+          throw std::logic_error("Seq. of frag. : can not skip fragment");
+        }
+      }
+      return is;
+    }
     try
     {
       while (frag.Read<TSwap>(is) && frag.GetTag() != seqDelItem)
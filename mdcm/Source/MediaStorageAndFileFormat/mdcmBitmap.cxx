@@ -28,8 +28,8 @@
 #include "mdcmJPEGLSCodec.h"
 #include "mdcmJPEG2000Codec.h"
 #include "mdcmRLECodec.h"
-#include "mdcmImageHelper.h"
 #include <cstring>
+#include <vector>
 
 namespace mdcm
 {
@@ -45,10 +45,23 @@ Bitmap::Bitmap()
   , LUT(new LookupTable)
   , NeedByteSwap(false)
   , LossyFlag(false)
+  , Options()
 {}
 
 Bitmap::~Bitmap() {}
 
+void
+Bitmap::SetCodecOptions(CodecOptions const & o)
+{
+  Options = o;
+}
+
+const CodecOptions &
+Bitmap::GetCodecOptions() const
+{
+  return Options;
+}
+
 unsigned int
 Bitmap::GetNumberOfDimensions() const
 {
@@ -247,6 +260,397 @@ Bitmap::GetBuffer(char * buffer) const
   return GetBufferInternal(buffer, dummy);
 }
 
+namespace
+{
+
+// Single frame of a Bitmap, keeps the overlay
+// and unused bits state of the source
+class FrameBitmap : public Bitmap
+{
+public:
+  FrameBitmap(const Bitmap & b, const DataElement & de)
+    : Overlays(b.AreOverlaysInPixelData())
+    , UnusedBits(b.UnusedBitsPresentInPixelData())
+  {
+    SetNumberOfDimensions(2);
+    SetDimension(0, b.GetDimension(0));
+    SetDimension(1, b.GetDimension(1));
+    PlanarConfiguration = b.GetPlanarConfiguration();
+    TS = b.GetTransferSyntax();
+    PF = b.GetPixelFormat();
+    PI = b.GetPhotometricInterpretation();
+    NeedByteSwap = b.GetNeedByteSwap();
+    Options = b.GetCodecOptions();
+    SetLUT(b.GetLUT());
+    PixelData = de;
+  }
+  bool
+  AreOverlaysInPixelData() const override
+  {
+    return Overlays;
+  }
+  bool
+  UnusedBitsPresentInPixelData() const override
+  {
+    return UnusedBits;
+  }
+
+private:
+  bool Overlays;
+  bool UnusedBits;
+};
+
+// Bytes of a native frame as stored, YBR_FULL_422 has 2 samples
+// per pixel (Y0 Y1 Cb Cr), decoded it has 3.
+unsigned long long
+NativeFrameLength(const Bitmap & b)
+{
+  const PixelFormat &      pf = b.GetPixelFormat();
+  const unsigned long long len =
+    (unsigned long long)b.GetDimension(0) * b.GetDimension(1) * (pf.GetBitsAllocated() / 8);
+  if (b.GetPhotometricInterpretation() == PhotometricInterpretation::YBR_FULL_422)
+    return len * 2;
+  return len * pf.GetSamplesPerPixel();
+}
+
+bool
+IsCodestreamStart(const ByteValue * bv)
+{
+  if (!bv || bv->GetLength() < 8)
+    return false;
+  const unsigned char * p = reinterpret_cast<const unsigned char *>(bv->GetPointer());
+  // JPEG, JPEG-LS SOI
+  if (p[0] == 0xff && p[1] == 0xd8 && p[2] == 0xff)
+    return true;
+  // J2K SOC, SIZ
+  if (p[0] == 0xff && p[1] == 0x4f && p[2] == 0xff && p[3] == 0x51)
+    return true;
+  // JP2 signature box
+  if (p[0] == 0x00 && p[1] == 0x00 && p[2] == 0x00 && p[3] == 0x0c && p[4] == 0x6a && p[5] == 0x50)
+    return true;
+  return false;
+}
+
+// Codec set up for one frame of the image
+void
+SetFrameCodec(const Bitmap & b, ImageCodec & codec)
+{
+  const CodecOptions & o = b.GetCodecOptions();
+  const unsigned int   dims[3] = { b.GetDimension(0), b.GetDimension(1), 1 };
+  codec.SetCodecOptions(o);
+  codec.SetNumberOfDimensions(2);
+  codec.SetDimensions(dims);
+  codec.SetPlanarConfiguration(b.GetPlanarConfiguration());
+  codec.SetPhotometricInterpretation(b.GetPhotometricInterpretation());
+  codec.SetNeedOverlayCleanup(b.AreOverlaysInPixelData() || (o.CleanUnusedBits && b.UnusedBitsPresentInPixelData()));
+  codec.SetPixelFormat(b.GetPixelFormat());
+}
+
+// Decodes a frame from its bytes straight to the buffer,
+// false if the codec can not, see ImageCodec::DecodeFrame
+bool
+DecodeFrameBytes(const Bitmap & b, ImageCodec & codec, const char * in, size_t inlen, char * out, size_t outlen)
+{
+  SetFrameCodec(b, codec);
+  return codec.DecodeFrame(in, inlen, out, outlen);
+}
+
+bool
+DecodeFrameBytes(const Bitmap & b, const char * in, size_t inlen, char * out, size_t outlen)
+{
+  const TransferSyntax & ts = b.GetTransferSyntax();
+  if (!ts.IsEncapsulated())
+  {
+    RAWCodec codec;
+    if (!codec.CanDecode(ts))
+      return false;
+    codec.SetNeedByteSwap(b.GetNeedByteSwap());
+    return DecodeFrameBytes(b, codec, in, inlen, out, outlen);
+  }
+  {
+    RLECodec codec;
+    if (codec.CanDecode(ts))
+      return DecodeFrameBytes(b, codec, in, inlen, out, outlen);
+  }
+  {
+    JPEGLSCodec codec;
+    if (codec.CanDecode(ts))
+      return DecodeFrameBytes(b, codec, in, inlen, out, outlen);
+  }
+  {
+    JPEG2000Codec codec;
+    if (codec.CanDecode(ts))
+      return DecodeFrameBytes(b, codec, in, inlen, out, outlen);
+  }
+  {
+    JPEGCodec codec;
+    if (codec.CanDecode(ts))
+      return DecodeFrameBytes(b, codec, in, inlen, out, outlen);
+  }
+  return false;
+}
+
+class FramesTask : public ImageCodec::FrameTask
+{
+public:
+  FramesTask(const Bitmap & b, char * buffer, unsigned long long size)
+    : Image(b)
+    , Buffer(buffer)
+    , FrameSize(size)
+  {}
+  bool
+  Process(unsigned int z) override
+  {
+    return Image.GetFrameBuffer(Buffer + z * FrameSize, z);
+  }
+
+private:
+  const Bitmap &           Image;
+  char *                   Buffer;
+  const unsigned long long FrameSize;
+};
+
+} // end namespace
+
+unsigned int
+Bitmap::GetNumberOfFrames() const
+{
+  if (NumberOfDimensions > 2 && Dimensions.size() > 2)
+    return Dimensions[2];
+  return 1;
+}
+
+unsigned long long
+Bitmap::GetFrameBufferLength() const
+{
+  const unsigned int n = GetNumberOfFrames();
+  if (n == 0)
+    return 0;
+  return GetBufferLength() / n;
+}
+
+// Range of fragments [b, e) for the frame
+bool
+Bitmap::GetFrameFragments(unsigned int frame, size_t & b, size_t & e) const
+{
+  const SequenceOfFragments * sf = PixelData.GetSequenceOfFragments();
+  if (!sf)
+    return false;
+  const size_t nframes = GetNumberOfFrames();
+  const size_t nfrags = sf->GetNumberOfFragments();
+  if (frame >= nframes || nfrags < nframes)
+    return false;
+  if (nfrags == nframes)
+  {
+    b = frame;
+    e = frame + 1;
+    return true;
+  }
+  // Basic Offset Table, offsets from the first fragment item
+  const ByteValue * table = sf->GetTable().GetByteValue();
+  if (table && table->GetLength() == 4 * nframes)
+  {
+    const unsigned char * p = reinterpret_cast<const unsigned char *>(table->GetPointer());
+    std::vector<unsigned long long> offsets(nframes + 1);
+    for (size_t x = 0; x < nframes; ++x)
+    {
+      const unsigned char * q = p + 4 * x;
+      offsets[x] = (unsigned long long)q[0] | ((unsigned long long)q[1] << 8) | ((unsigned long long)q[2] << 16) |
+                   ((unsigned long long)q[3] << 24);
+    }
+    offsets[nframes] = 0xffffffffffffffffULL;
+    bool               valid = (offsets[0] == 0);
+    unsigned long long pos = 0;
+    size_t             next = 0;
+    for (size_t x = 0; valid && x < nfrags; ++x)
+    {
+      if (pos == offsets[next])
+      {
+        if (next == frame)
+          b = x;
+        else if (next == frame + 1)
+          e = x;
+        ++next;
+      }
+      else if (pos > offsets[next])
+      {
+        valid = false;
+      }
+      pos += 8 + sf->GetFragment(x).GetVL();
+    }
+    if (valid && next == nframes)
+    {
+      if (frame + 1 == nframes)
+        e = nfrags;
+      return true;
+    }
+  }
+  // Fragment scan, a frame starts with a codestream header
+  size_t count = 0;
+  for (size_t x = 0; x < nfrags; ++x)
+  {
+    if (IsCodestreamStart(sf->GetFragment(x).GetByteValue()))
+    {
+      if (count == frame)
+        b = x;
+      else if (count == frame + 1)
+        e = x;
+      ++count;
+    }
+    else if (x == 0)
+    {
+      return false;
+    }
+  }
+  if (count != nframes)
+    return false;
+  if (frame + 1 == nframes)
+    e = nfrags;
+  return true;
+}
+
+// Encoded bytes of an encapsulated frame, fragments of the frame
+// are joined into 'tmp', else it points to the fragment.
+bool
+Bitmap::GetFrameBytes(unsigned int frame, const char *& p, size_t & len, std::vector<char> & tmp) const
+{
+  const SequenceOfFragments * sf = PixelData.GetSequenceOfFragments();
+  size_t                      b = 0, e = 0;
+  if (!sf || !GetFrameFragments(frame, b, e))
+    return false;
+  if (e == b + 1)
+  {
+    const ByteValue * bv = sf->GetFragment(b).GetByteValue();
+    if (!(bv && bv->GetPointer()))
+      return false;
+    p = bv->GetPointer();
+    len = bv->GetLength();
+    return true;
+  }
+  for (size_t x = b; x < e; ++x)
+  {
+    const ByteValue * bv = sf->GetFragment(x).GetByteValue();
+    if (!(bv && bv->GetPointer()))
+      return false;
+    tmp.insert(tmp.end(), bv->GetPointer(), bv->GetPointer() + bv->GetLength());
+  }
+  if (tmp.empty())
+    return false;
+  p = &tmp[0];
+  len = tmp.size();
+  return true;
+}
+
+// The frame's bytes are decoded in place, fragments
+// of a frame are joined first.
+bool
+Bitmap::GetFrameBufferDirect(char * buffer, unsigned int frame) const
+{
+  if (!buffer || frame >= GetNumberOfFrames() || PF.GetBitsAllocated() % 8 != 0)
+    return false;
+  const size_t len = (size_t)Dimensions[0] * Dimensions[1] * PF.GetPixelSize();
+  if (GetTransferSyntax().IsEncapsulated())
+  {
+    const char *      p = NULL;
+    size_t            plen = 0;
+    std::vector<char> tmp;
+    return (GetFrameBytes(frame, p, plen, tmp) && DecodeFrameBytes(*this, p, plen, buffer, len));
+  }
+  // stored and decoded sizes differ (YBR_FULL_422), s. GetFrameBuffer
+  if (NativeFrameLength(*this) != len)
+    return false;
+  const ByteValue * bv = PixelData.GetByteValue();
+  if (!(bv && bv->GetPointer()) || (unsigned long long)bv->GetLength() < (frame + 1ULL) * len)
+    return false;
+  return DecodeFrameBytes(*this, bv->GetPointer() + (size_t)frame * len, len, buffer, len);
+}
+
+bool
+Bitmap::GetFrameBuffer(char * buffer, unsigned int frame) const
+{
+  if (!buffer || frame >= GetNumberOfFrames())
+    return false;
+  if (GetFrameBufferDirect(buffer, frame))
+    return true;
+  DataElement de = PixelData;
+  if (GetTransferSyntax().IsEncapsulated())
+  {
+    const SequenceOfFragments * sf = PixelData.GetSequenceOfFragments();
+    size_t                      b = 0, e = 0;
+    if (!GetFrameFragments(frame, b, e))
+      return false;
+    SmartPointer<SequenceOfFragments> sq = new SequenceOfFragments;
+    for (size_t x = b; x < e; ++x)
+    {
+      sq->AddFragment(sf->GetFragment(x));
+    }
+    de.SetValue(*sq);
+  }
+  else
+  {
+    const ByteValue * bv = PixelData.GetByteValue();
+    if (!bv || PF.GetBitsAllocated() % 8 != 0)
+      return false;
+    const unsigned long long len = NativeFrameLength(*this);
+    if (len == 0 || len >= 0xffffffff || (unsigned long long)bv->GetLength() < (frame + 1ULL) * len)
+      return false;
+    de.SetByteValue(bv->GetPointer() + frame * len, (uint32_t)len);
+  }
+  FrameBitmap f(*this, de);
+  return f.GetBuffer(buffer);
+}
+
+bool
+Bitmap::GetFrameRegion(char *         buffer,
+                       size_t         len,
+                       unsigned int   frame,
+                       unsigned int   x0,
+                       unsigned int   y0,
+                       unsigned int   x1,
+                       unsigned int   y1,
+                       unsigned int & reduce,
+                       unsigned int & w,
+                       unsigned int & h) const
+{
+  if (!buffer || frame >= GetNumberOfFrames() || PF.GetBitsAllocated() % 8 != 0)
+    return false;
+  JPEG2000Codec codec;
+  if (!codec.CanDecode(GetTransferSyntax()))
+    return false;
+  const char *      p = NULL;
+  size_t            plen = 0;
+  std::vector<char> tmp;
+  if (!GetFrameBytes(frame, p, plen, tmp))
+    return false;
+  SetFrameCodec(*this, codec);
+  return codec.DecodeFrameRegion(p, plen, buffer, len, x0, y0, x1, y1, reduce, w, h);
+}
+
+// Frames of encapsulated objects are independent, they are
+// decoded directly to their offsets, JPEG, JPEG-LS and RLE
+// in parallel with ImageCodec::RunFrames. JPEG 2000 uses
+// threads of OpenJPEG.
+bool
+Bitmap::GetFramesBuffer(char * buffer) const
+{
+  const TransferSyntax & ts = GetTransferSyntax();
+  const unsigned int     frames = GetNumberOfFrames();
+  if (frames < 2 || !ts.IsEncapsulated() || PF.GetBitsAllocated() % 8 != 0)
+    return false;
+  const unsigned long long size = GetFrameBufferLength();
+  if (size == 0 || size * frames != GetBufferLength())
+    return false;
+  CodecOptions o = Options;
+  if (JPEG2000Codec().CanDecode(ts))
+    o.NumberOfThreads = 1;
+  else if (!JPEGCodec().CanDecode(ts) && !JPEGLSCodec().CanDecode(ts) && !RLECodec().CanDecode(ts))
+    return false;
+  FramesTask task(*this, buffer, size);
+  ImageCodec runner;
+  runner.SetCodecOptions(o);
+  return runner.RunFrames(task, frames);
+}
+
 bool
 Bitmap::AreOverlaysInPixelData() const
 {
@@ -420,6 +824,7 @@ bool
 Bitmap::TryRAWCodec(char * buffer, bool & lossyflag) const
 {
   RAWCodec               codec;
+  codec.SetCodecOptions(Options);
   const TransferSyntax & ts = GetTransferSyntax();
   if (!buffer)
   {
@@ -445,7 +850,7 @@ Bitmap::TryRAWCodec(char * buffer, bool & lossyflag) const
     codec.SetPixelFormat(GetPixelFormat());
     codec.SetNeedByteSwap(GetNeedByteSwap());
     codec.SetNeedOverlayCleanup(AreOverlaysInPixelData() ||
-                                (ImageHelper::GetCleanUnusedBits() && UnusedBitsPresentInPixelData()));
+                                (Options.CleanUnusedBits && UnusedBitsPresentInPixelData()));
     DataElement out;
     const bool  r = codec.DecodeBytes(bv->GetPointer(), bv->GetLength(), buffer, len);
     if (!r)
@@ -470,6 +875,7 @@ bool
 Bitmap::TryJPEGCodec(char * buffer, bool & lossyflag) const
 {
   JPEGCodec              codec;
+  codec.SetCodecOptions(Options);
   const TransferSyntax & ts = GetTransferSyntax();
   if (!buffer)
   {
@@ -544,7 +950,7 @@ Bitmap::TryJPEGCodec(char * buffer, bool & lossyflag) const
     codec.SetPhotometricInterpretation(GetPhotometricInterpretation());
     codec.SetPixelFormat(GetPixelFormat());
     codec.SetNeedOverlayCleanup(AreOverlaysInPixelData() ||
-                                (ImageHelper::GetCleanUnusedBits() && UnusedBitsPresentInPixelData()));
+                                (Options.CleanUnusedBits && UnusedBitsPresentInPixelData()));
     DataElement out;
     if (!codec.Decode(PixelData, out))
     {
@@ -621,6 +1027,7 @@ Bitmap::TryJPEGCodec2(std::ostream & os) const
 {
   const TransferSyntax & ts = GetTransferSyntax();
   JPEGCodec              codec;
+  codec.SetCodecOptions(Options);
   if (codec.CanCode(ts))
   {
     codec.SetDimensions(GetDimensions());
@@ -628,7 +1035,7 @@ Bitmap::TryJPEGCodec2(std::ostream & os) const
     codec.SetPhotometricInterpretation(GetPhotometricInterpretation());
     codec.SetPixelFormat(GetPixelFormat());
     codec.SetNeedOverlayCleanup(AreOverlaysInPixelData() ||
-                                (ImageHelper::GetCleanUnusedBits() && UnusedBitsPresentInPixelData()));
+                                (Options.CleanUnusedBits && UnusedBitsPresentInPixelData()));
     DataElement out;
     const bool  r = codec.Code(PixelData, out);
     if (!r)
@@ -646,6 +1053,7 @@ bool
 Bitmap::TryJPEGCodec3(char * buffer, bool & lossyflag) const
 {
   JPEGCodec              codec;
+  codec.SetCodecOptions(Options);
   const TransferSyntax & ts = GetTransferSyntax();
   if (!buffer)
   {
@@ -715,7 +1123,7 @@ Bitmap::TryJPEGCodec3(char * buffer, bool & lossyflag) const
     codec.SetPhotometricInterpretation(GetPhotometricInterpretation());
     codec.SetPixelFormat(GetPixelFormat());
     codec.SetNeedOverlayCleanup(AreOverlaysInPixelData() ||
-                                (ImageHelper::GetCleanUnusedBits() && UnusedBitsPresentInPixelData()));
+                                (Options.CleanUnusedBits && UnusedBitsPresentInPixelData()));
     std::stringstream os;
     if (!codec.Decode2(PixelData, os))
     {
@@ -782,13 +1190,14 @@ Bitmap::TryPVRGCodec(char * buffer, bool & lossyflag) const
   }
   const TransferSyntax & ts = GetTransferSyntax();
   PVRGCodec              codec;
+  codec.SetCodecOptions(Options);
   if (codec.CanDecode(ts))
   {
     codec.SetPixelFormat(GetPixelFormat());
     codec.SetPlanarConfiguration(GetPlanarConfiguration());
     codec.SetPhotometricInterpretation(GetPhotometricInterpretation());
     codec.SetNeedOverlayCleanup(AreOverlaysInPixelData() ||
-                                (ImageHelper::GetCleanUnusedBits() && UnusedBitsPresentInPixelData()));
+                                (Options.CleanUnusedBits && UnusedBitsPresentInPixelData()));
     codec.SetDimensions(GetDimensions());
     DataElement out;
     bool        r = codec.Decode(PixelData, out);
@@ -817,6 +1226,7 @@ bool
 Bitmap::TryJPEGLSCodec(char * buffer, bool & lossyflag) const
 {
   JPEGLSCodec            codec;
+  codec.SetCodecOptions(Options);
   const TransferSyntax & ts = GetTransferSyntax();
   if (!buffer)
   {
@@ -852,7 +1262,7 @@ Bitmap::TryJPEGLSCodec(char * buffer, bool & lossyflag) const
     codec.SetPlanarConfiguration(GetPlanarConfiguration());
     codec.SetPhotometricInterpretation(GetPhotometricInterpretation());
     codec.SetNeedOverlayCleanup(AreOverlaysInPixelData() ||
-                                (ImageHelper::GetCleanUnusedBits() && UnusedBitsPresentInPixelData()));
+                                (Options.CleanUnusedBits && UnusedBitsPresentInPixelData()));
     codec.SetDimensions(GetDimensions());
     DataElement out;
     const bool  r = codec.Decode(PixelData, out);
@@ -878,6 +1288,7 @@ bool
 Bitmap::TryJPEGLSCodec2(char * buffer, bool & lossyflag) const
 {
   JPEGLSCodec            codec;
+  codec.SetCodecOptions(Options);
   const TransferSyntax & ts = GetTransferSyntax();
   if (!buffer)
   {
@@ -908,7 +1319,7 @@ Bitmap::TryJPEGLSCodec2(char * buffer, bool & lossyflag) const
     codec.SetPlanarConfiguration(GetPlanarConfiguration());
     codec.SetPhotometricInterpretation(GetPhotometricInterpretation());
     codec.SetNeedOverlayCleanup(AreOverlaysInPixelData() ||
-                                (ImageHelper::GetCleanUnusedBits() && UnusedBitsPresentInPixelData()));
+                                (Options.CleanUnusedBits && UnusedBitsPresentInPixelData()));
     codec.SetDimensions(GetDimensions());
     const bool r = codec.Decode2(PixelData, buffer, len);
     if (!r)
@@ -927,6 +1338,7 @@ bool
 Bitmap::TryJPEG2000Codec(char * buffer, bool & lossyflag) const
 {
   JPEG2000Codec          codec;
+  codec.SetCodecOptions(Options);
   const TransferSyntax & ts = GetTransferSyntax();
   if (!buffer)
   {
@@ -982,7 +1394,7 @@ Bitmap::TryJPEG2000Codec(char * buffer, bool & lossyflag) const
     codec.SetPlanarConfiguration(GetPlanarConfiguration());
     codec.SetPhotometricInterpretation(GetPhotometricInterpretation());
     codec.SetNeedOverlayCleanup(AreOverlaysInPixelData() ||
-                                (ImageHelper::GetCleanUnusedBits() && UnusedBitsPresentInPixelData()));
+                                (Options.CleanUnusedBits && UnusedBitsPresentInPixelData()));
     codec.SetDimensions(GetDimensions());
     DataElement out;
     bool        r = codec.Decode(PixelData, out);
@@ -1028,6 +1440,7 @@ Bitmap::TryJPEG2000Codec2(std::ostream & os) const
 {
   const TransferSyntax & ts = GetTransferSyntax();
   JPEG2000Codec          codec;
+  codec.SetCodecOptions(Options);
   if (codec.CanCode(ts))
   {
     codec.SetDimensions(GetDimensions());
@@ -1036,7 +1449,7 @@ Bitmap::TryJPEG2000Codec2(std::ostream & os) const
     codec.SetPlanarConfiguration(GetPlanarConfiguration());
     codec.SetPhotometricInterpretation(GetPhotometricInterpretation());
     codec.SetNeedOverlayCleanup(AreOverlaysInPixelData() ||
-                                (ImageHelper::GetCleanUnusedBits() && UnusedBitsPresentInPixelData()));
+                                (Options.CleanUnusedBits && UnusedBitsPresentInPixelData()));
     DataElement out;
     const bool  r = codec.Code(PixelData, out);
     if (!r)
@@ -1054,6 +1467,7 @@ bool
 Bitmap::TryJPEG2000Codec3(char * buffer, bool & lossyflag) const
 {
   JPEG2000Codec          codec;
+  codec.SetCodecOptions(Options);
   const TransferSyntax & ts = GetTransferSyntax();
   if (!buffer)
   {
@@ -1104,7 +1518,7 @@ Bitmap::TryJPEG2000Codec3(char * buffer, bool & lossyflag) const
     codec.SetPlanarConfiguration(GetPlanarConfiguration());
     codec.SetPhotometricInterpretation(GetPhotometricInterpretation());
     codec.SetNeedOverlayCleanup(AreOverlaysInPixelData() ||
-                                (ImageHelper::GetCleanUnusedBits() && UnusedBitsPresentInPixelData()));
+                                (Options.CleanUnusedBits && UnusedBitsPresentInPixelData()));
     codec.SetDimensions(GetDimensions());
     const bool r = codec.Decode2(PixelData, buffer, len);
     if (!r)
@@ -1150,6 +1564,7 @@ Bitmap::TryRLECodec(char * buffer, bool & lossyflag) const
   }
   const TransferSyntax & ts = GetTransferSyntax();
   RLECodec               codec;
+  codec.SetCodecOptions(Options);
   if (codec.CanDecode(ts))
   {
     codec.SetDimensions(GetDimensions());
@@ -1159,7 +1574,7 @@ Bitmap::TryRLECodec(char * buffer, bool & lossyflag) const
     codec.SetPixelFormat(GetPixelFormat());
     codec.SetLUT(GetLUT());
     codec.SetNeedOverlayCleanup(AreOverlaysInPixelData() ||
-                                (ImageHelper::GetCleanUnusedBits() && UnusedBitsPresentInPixelData()));
+                                (Options.CleanUnusedBits && UnusedBitsPresentInPixelData()));
     codec.SetBufferLength(len);
     DataElement out;
     const bool  r = codec.Decode(PixelData, out);
@@ -1179,6 +1594,12 @@ Bitmap::TryRLECodec(char * buffer, bool & lossyflag) const
 bool
 Bitmap::GetBufferInternal(char * buffer, bool & lossyflag) const
 {
+  // multi-frame only, single frames need the fix-ups of the Try*Codec
+  if (buffer && GetNumberOfFrames() > 1 && GetFramesBuffer(buffer))
+  {
+    lossyflag = GetTransferSyntax().IsLossy();
+    return true;
+  }
   bool success = TryRAWCodec(buffer, lossyflag);
   if (!success)
 #ifdef DATA_MORE_THAN_4GB
@@ -31,6 +31,7 @@
 #include "mdcmPixelFormat.h"
 #include "mdcmSmartPointer.h"
 #include "mdcmTransferSyntax.h"
+#include "mdcmCodecOptions.h"
 #include <vector>
 
 namespace mdcm
@@ -83,6 +84,31 @@ public:
   GetBufferLength() const;
   bool
   GetBuffer(char *) const;
+  unsigned int
+  GetNumberOfFrames() const;
+  unsigned long long
+  GetFrameBufferLength() const;
+  // Decodes one frame, without decoding the whole image.
+  // Encapsulated frames are found with Basic Offset Table
+  // or fragment scan. Can be called from several threads.
+  bool
+  GetFrameBuffer(char *, unsigned int) const;
+  // Decodes the area [x0, x1) x [y0, y1) of a JPEG 2000 frame at
+  // resolution level 'reduce' (size / 2^reduce), s.
+  // JPEG2000Codec::DecodeFrameRegion, false for other transfer
+  // syntaxes. The level and the size decoded are returned, the
+  // buffer's length is the 2nd argument.
+  bool
+  GetFrameRegion(char *,
+                 size_t,
+                 unsigned int,
+                 unsigned int,
+                 unsigned int,
+                 unsigned int,
+                 unsigned int,
+                 unsigned int &,
+                 unsigned int &,
+                 unsigned int &) const;
   virtual bool
   AreOverlaysInPixelData() const;
   virtual bool
@@ -124,6 +150,10 @@ public:
   void
   SetPixelFormat(PixelFormat const &);
   void
+  SetCodecOptions(CodecOptions const &);
+  const CodecOptions &
+  GetCodecOptions() const;
+  void
   Print(std::ostream &) const;
 
 protected:
@@ -162,10 +192,19 @@ protected:
   LUTPtr                            LUT;
   bool                              NeedByteSwap;
   bool                              LossyFlag;
+  CodecOptions                      Options;
 
 private:
   bool
   GetBufferInternal(char *, bool &) const;
+  bool
+  GetFrameFragments(unsigned int, size_t &, size_t &) const;
+  bool
+  GetFrameBytes(unsigned int, const char *&, size_t &, std::vector<char> &) const;
+  bool
+  GetFrameBufferDirect(char *, unsigned int) const;
+  bool
+  GetFramesBuffer(char *) const;
 };
 
 } // end namespace mdcm
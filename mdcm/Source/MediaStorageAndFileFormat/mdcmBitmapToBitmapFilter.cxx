@@ -51,6 +51,10 @@ BitmapToBitmapFilter::SetInput(const Bitmap & image)
   {
     Output = NULL;
   }
+  if (Output)
+  {
+    Output->SetCodecOptions(image.GetCodecOptions());
+  }
 }
 
 const Bitmap &
@@ -0,0 +1,42 @@
+/*********************************************************
+ *
+ * MDCM
+ *
+ * github.com/issakomi
+ *
+ *********************************************************/
+
+#ifndef MDCMCODECOPTIONS_H
+#define MDCMCODECOPTIONS_H
+
+namespace mdcm
+{
+
+/**
+ * CodecOptions
+ *
+ * Decoding switches, carried by the reader, the image and
+ * the codecs, decodes with different options may run
+ * concurrently.
+ */
+struct CodecOptions
+{
+  CodecOptions()
+    : ForceRescaleInterceptSlope(false)
+    , CleanUnusedBits(false)
+    , WorkaroundCornellBug(false)
+    , WorkaroundPredictorBug(false)
+    , NumberOfThreads(0)
+  {}
+  bool ForceRescaleInterceptSlope;
+  bool CleanUnusedBits;
+  bool WorkaroundCornellBug;
+  bool WorkaroundPredictorBug;
+  // Threads for decoding and encoding frames of multi-frame
+  // objects, 0 - number of processors
+  unsigned int NumberOfThreads;
+};
+
+} // end namespace mdcm
+
+#endif // MDCMCODECOPTIONS_H
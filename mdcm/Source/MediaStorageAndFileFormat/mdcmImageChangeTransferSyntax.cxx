@@ -80,6 +80,20 @@ ImageChangeTransferSyntax::SetForceYBRFull(bool t)
   ForceYBRFull = t;
 }
 
+void
+ImageChangeTransferSyntax::SetNumberOfThreads(unsigned int n)
+{
+  NumberOfThreads = n;
+}
+
+void
+ImageChangeTransferSyntax::SetCodecThreads(ImageCodec * codec) const
+{
+  CodecOptions o = codec->GetCodecOptions();
+  o.NumberOfThreads = NumberOfThreads;
+  codec->SetCodecOptions(o);
+}
+
 bool
 ImageChangeTransferSyntax::Change()
 {
@@ -120,7 +134,7 @@ ImageChangeTransferSyntax::Change()
     DataElement pixeldata(Tag(0x7fe0, 0x0010));
     ByteValue * bv0 = new ByteValue();
     bv0->SetLength((uint32_t)len0);
-    const bool b = Input->GetBuffer((char *)bv0->GetPointer());
+    const bool b = Input->GetBuffer((char *)bv0->GetVoidPointer());
     if (!b)
     {
       mdcmErrorMacro("Error in getting buffer from input image.");
@@ -161,7 +175,7 @@ ImageChangeTransferSyntax::Change()
         }
         ByteValue * bv = new ByteValue();
         bv->SetLength((uint32_t)len);
-        const bool bb = pixmap->GetIconImage().GetBuffer((char *)bv->GetPointer());
+        const bool bb = pixmap->GetIconImage().GetBuffer((char *)bv->GetVoidPointer());
         if (!bb)
         {
           return false;
@@ -278,6 +292,7 @@ ImageChangeTransferSyntax::TryRLECodec(const DataElement & pixelde, Bitmap const
     codec.SetPhotometricInterpretation(input.GetPhotometricInterpretation());
     codec.SetPixelFormat(input.GetPixelFormat());
     codec.SetNeedOverlayCleanup(input.AreOverlaysInPixelData() || input.UnusedBitsPresentInPixelData());
+    SetCodecThreads(&codec);
     DataElement out;
     if (!codec.Code(pixelde, out))
       return false;
@@ -319,6 +334,7 @@ ImageChangeTransferSyntax::TryJPEGCodec(const DataElement & pixelde, Bitmap cons
     codec->SetPhotometricInterpretation(input.GetPhotometricInterpretation());
     codec->SetPixelFormat(input.GetPixelFormat());
     codec->SetNeedOverlayCleanup(input.AreOverlaysInPixelData() || input.UnusedBitsPresentInPixelData());
+    SetCodecThreads(codec);
     if (!input.GetPixelFormat().IsCompatible(ts))
     {
       mdcmAlwaysWarnMacro("Pixel Format incompatible with TS");
@@ -373,6 +389,7 @@ ImageChangeTransferSyntax::TryJPEGLSCodec(const DataElement & pixelde, Bitmap co
     codec->SetPlanarConfiguration(input.GetPlanarConfiguration());
     codec->SetPhotometricInterpretation(input.GetPhotometricInterpretation());
     codec->SetNeedOverlayCleanup(input.AreOverlaysInPixelData() || input.UnusedBitsPresentInPixelData());
+    SetCodecThreads(codec);
     DataElement out;
     bool        r;
     if (input.AreOverlaysInPixelData() || input.UnusedBitsPresentInPixelData())
@@ -426,6 +443,7 @@ ImageChangeTransferSyntax::TryJPEG2000Codec(const DataElement & pixelde, Bitmap
     codec->SetPlanarConfiguration(input.GetPlanarConfiguration());
     codec->SetPhotometricInterpretation(input.GetPhotometricInterpretation());
     codec->SetNeedOverlayCleanup(input.AreOverlaysInPixelData() || input.UnusedBitsPresentInPixelData());
+    SetCodecThreads(codec);
     DataElement out;
     const bool  r = codec->Code(pixelde, out);
     output.SetPlanarConfiguration(0);
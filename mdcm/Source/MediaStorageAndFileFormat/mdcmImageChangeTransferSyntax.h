@@ -54,6 +54,7 @@ public:
     , CompressIconImage(false)
     , ForceYBRFull(false)
     , UserCodec(NULL)
+    , NumberOfThreads(0)
   {}
   ~ImageChangeTransferSyntax() {}
   void
@@ -68,6 +69,9 @@ public:
   SetUserCodec(ImageCodec *);
   void
   SetForceYBRFull(bool);
+  // Threads for encoding, 0 - number of processors
+  void
+  SetNumberOfThreads(unsigned int);
   bool
   Change();
 
@@ -82,6 +86,8 @@ protected:
   TryJPEGLSCodec(const DataElement &, Bitmap const &, Bitmap &);
   bool
   TryJPEG2000Codec(const DataElement &, Bitmap const &, Bitmap &);
+  void
+  SetCodecThreads(ImageCodec *) const;
 
 private:
   TransferSyntax TS;
@@ -89,6 +95,7 @@ private:
   bool           CompressIconImage;
   bool           ForceYBRFull;
   ImageCodec *   UserCodec;
+  unsigned int   NumberOfThreads;
 };
 
 } // end namespace mdcm
@@ -29,10 +29,47 @@
 #include <iterator>
 #include <cstring>
 #include <limits.h>
+#include <atomic>
+#include <new>
+#include <thread>
+#include <vector>
 
 namespace mdcm
 {
 
+namespace
+{
+
+struct FrameTaskJob
+{
+  ImageCodec::FrameTask *   Task;
+  unsigned int              Frames;
+  std::atomic<unsigned int> Next;
+  std::atomic<bool>         Ok;
+};
+
+void
+ProcessFrames(FrameTaskJob * job)
+{
+  while (job->Ok)
+  {
+    const unsigned int z = job->Next++;
+    if (z >= job->Frames)
+      break;
+    try
+    {
+      if (!job->Task->Process(z))
+        job->Ok = false;
+    }
+    catch (const std::bad_alloc &)
+    {
+      job->Ok = false;
+    }
+  }
+}
+
+} // end namespace
+
 ImageCodec::ImageCodec()
 {
   PlanarConfiguration = 0;
@@ -49,6 +86,18 @@ ImageCodec::ImageCodec()
 
 ImageCodec::~ImageCodec() {}
 
+void
+ImageCodec::SetCodecOptions(CodecOptions const & o)
+{
+  Options = o;
+}
+
+const CodecOptions &
+ImageCodec::GetCodecOptions() const
+{
+  return Options;
+}
+
 bool
 ImageCodec::CanDecode(TransferSyntax const &) const
 {
@@ -61,6 +110,12 @@ ImageCodec::Decode(DataElement const &, DataElement &)
   return false;
 }
 
+bool
+ImageCodec::DecodeFrame(const char *, size_t, char *, size_t)
+{
+  return false;
+}
+
 bool
 ImageCodec::CanCode(TransferSyntax const &) const
 {
@@ -402,6 +457,56 @@ ImageCodec::DecodeByStreams(std::istream & is, std::ostream & os)
   return true;
 }
 
+// In-place equivalent of DecodeByStreams for decoded data
+// which need no re-ordering, returns false otherwise.
+bool
+ImageCodec::PostProcess(char * data, size_t len)
+{
+  assert(PlanarConfiguration == 0 || PlanarConfiguration == 1);
+  if (RequestPaddedCompositePixelCode || RequestPlanarConfiguration)
+    return false;
+  switch (PI)
+  {
+    case PhotometricInterpretation::MONOCHROME2:
+    case PhotometricInterpretation::RGB:
+    case PhotometricInterpretation::ARGB:
+    case PhotometricInterpretation::YBR_ICT:
+    case PhotometricInterpretation::YBR_RCT:
+    case PhotometricInterpretation::MONOCHROME1:
+    case PhotometricInterpretation::PALETTE_COLOR:
+    case PhotometricInterpretation::YBR_FULL:
+      break;
+    case PhotometricInterpretation::YBR_FULL_422:
+    case PhotometricInterpretation::YBR_PARTIAL_422:
+    case PhotometricInterpretation::YBR_PARTIAL_420:
+    {
+      const JPEGCodec * c = dynamic_cast<const JPEGCodec *>(this);
+      if (!c)
+        return false;
+    }
+    break;
+    default:
+      return false;
+  }
+  const bool cleanup =
+    NeedOverlayCleanup && PF.GetBitsAllocated() != PF.GetBitsStored() && PF.GetBitsAllocated() != 8;
+  if (cleanup && PF.GetBitsAllocated() != 16)
+    return false;
+  if (NeedByteSwap && PF.GetBitsAllocated() == 16)
+  {
+    if (len % 2)
+      return false;
+#ifdef MDCM_WORDS_BIGENDIAN
+    ByteSwap<uint16_t>::SwapRangeFromSwapCodeIntoSystem((uint16_t *)data, SwapCode::LittleEndian, len / 2);
+#else
+    ByteSwap<uint16_t>::SwapRangeFromSwapCodeIntoSystem((uint16_t *)data, SwapCode::BigEndian, len / 2);
+#endif
+  }
+  if (cleanup)
+    return CleanupUnusedBits(data, len);
+  return true;
+}
+
 bool
 ImageCodec::DoByteSwap(std::istream & is, std::ostream & os)
 {
@@ -737,4 +842,34 @@ ImageCodec::DoOverlayCleanup(std::istream & is, std::ostream & os)
   return true;
 }
 
+// Frames are encoded independently, Options.NumberOfThreads
+// threads (0 - number of processors) take the next frame.
+bool
+ImageCodec::RunFrames(FrameTask & task, unsigned int frames) const
+{
+  unsigned int threads = Options.NumberOfThreads;
+  if (threads == 0)
+    threads = std::thread::hardware_concurrency();
+  if (threads > frames)
+    threads = frames;
+  if (threads == 0)
+    threads = 1;
+  FrameTaskJob job;
+  job.Task = &task;
+  job.Frames = frames;
+  job.Next = 0;
+  job.Ok = true;
+  std::vector<std::thread> pool;
+  for (unsigned int x = 1; x < threads; ++x)
+  {
+    pool.push_back(std::thread(ProcessFrames, &job));
+  }
+  ProcessFrames(&job);
+  for (size_t x = 0; x < pool.size(); ++x)
+  {
+    pool[x].join();
+  }
+  return job.Ok;
+}
+
 } // end namespace mdcm
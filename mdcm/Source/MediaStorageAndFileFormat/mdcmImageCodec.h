@@ -28,6 +28,7 @@
 #include "mdcmPhotometricInterpretation.h"
 #include "mdcmLookupTable.h"
 #include "mdcmPixelFormat.h"
+#include "mdcmCodecOptions.h"
 
 namespace mdcm
 {
@@ -38,14 +39,30 @@ namespace mdcm
 class MDCM_EXPORT ImageCodec
 {
   friend class FileChangeTransferSyntax;
+  friend class Bitmap;
 
 public:
+  // Work on the frames of a multi-frame object, Process()
+  // is called concurrently with different frame indices.
+  class FrameTask
+  {
+  public:
+    virtual ~FrameTask() {}
+    virtual bool
+    Process(unsigned int) = 0;
+  };
   ImageCodec();
   virtual ~ImageCodec();
   virtual bool
   CanDecode(TransferSyntax const &) const;
   virtual bool
   Decode(DataElement const &, DataElement &);
+  // Decodes one frame from the compressed bytes into the buffer,
+  // the length of the buffer is the length of the frame.
+  // Returns false if not supported or failed, then Decode
+  // can be used.
+  virtual bool
+  DecodeFrame(const char *, size_t, char *, size_t);
   virtual bool
   CanCode(TransferSyntax const &) const;
   virtual bool
@@ -94,6 +111,10 @@ public:
   GetNumberOfDimensions() const;
   bool
   CleanupUnusedBits(char *, size_t);
+  virtual void
+  SetCodecOptions(CodecOptions const &);
+  const CodecOptions &
+  GetCodecOptions() const;
 
 protected:
   virtual bool
@@ -126,6 +147,10 @@ protected:
   DoInvertMonochrome(std::istream &, std::ostream &);
   bool
                                     DoOverlayCleanup(std::istream &, std::ostream &);
+  bool
+                                    PostProcess(char *, size_t);
+  bool
+                                    RunFrames(FrameTask &, unsigned int) const;
   bool                              RequestPlanarConfiguration;
   bool                              RequestPaddedCompositePixelCode;
   unsigned int                      PlanarConfiguration;
@@ -138,6 +163,7 @@ protected:
   unsigned int                      Dimensions[3];
   unsigned int                      NumberOfDimensions;
   bool                              LossyFlag;
+  CodecOptions                      Options;
 };
 
 } // end namespace mdcm
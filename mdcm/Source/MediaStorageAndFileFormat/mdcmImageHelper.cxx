@@ -42,12 +42,8 @@
 namespace mdcm
 {
 
-bool ImageHelper::ForceRescaleInterceptSlope = false;
 bool ImageHelper::PMSRescaleInterceptSlope = true;
 bool ImageHelper::ForcePixelSpacing = false;
-bool ImageHelper::CleanUnusedBits = false;
-bool ImageHelper::WorkaroundCornellBug = false;
-bool ImageHelper::WorkaroundPredictorBug = false;
 
 static double
 SetNDigits(double x, int n)
@@ -515,18 +511,6 @@ ImageHelper::GetDirectionCosinesValue(File const & f)
   return dircos;
 }
 
-void
-ImageHelper::SetForceRescaleInterceptSlope(bool b)
-{
-  ForceRescaleInterceptSlope = b;
-}
-
-bool
-ImageHelper::GetForceRescaleInterceptSlope()
-{
-  return ForceRescaleInterceptSlope;
-}
-
 void
 ImageHelper::SetPMSRescaleInterceptSlope(bool b)
 {
@@ -551,42 +535,6 @@ ImageHelper::GetForcePixelSpacing()
   return ForcePixelSpacing;
 }
 
-bool
-ImageHelper::GetCleanUnusedBits()
-{
-  return CleanUnusedBits;
-}
-
-void
-ImageHelper::SetCleanUnusedBits(bool b)
-{
-  CleanUnusedBits = b;
-}
-
-void
-ImageHelper::SetWorkaroundCornellBug(bool b)
-{
-  WorkaroundCornellBug = b;
-}
-
-bool
-ImageHelper::GetWorkaroundCornellBug()
-{
-  return WorkaroundCornellBug;
-}
-
-void
-ImageHelper::SetWorkaroundPredictorBug(bool b)
-{
-  WorkaroundPredictorBug = b;
-}
-
-bool
-ImageHelper::GetWorkaroundPredictorBug()
-{
-  return WorkaroundPredictorBug;
-}
-
 bool
 GetRescaleInterceptSlopeValueFromDataSet(const DataSet & ds, std::vector<double> & interceptslope)
 {
@@ -778,7 +726,7 @@ ImageHelper::SetDimensionsValue(File & f, const Pixmap & img)
 }
 
 std::vector<double>
-ImageHelper::GetRescaleInterceptSlopeValue(File const & f)
+ImageHelper::GetRescaleInterceptSlopeValue(File const & f, bool force)
 {
   std::vector<double> interceptslope;
   MediaStorage        ms;
@@ -810,7 +758,7 @@ ImageHelper::GetRescaleInterceptSlopeValue(File const & f)
       ms == MediaStorage::PETImageStorage || ms == MediaStorage::SecondaryCaptureImageStorage ||
       ms == MediaStorage::MultiframeGrayscaleWordSecondaryCaptureImageStorage ||
       ms == MediaStorage::MultiframeGrayscaleByteSecondaryCaptureImageStorage ||
-      ms == MediaStorage::DCMTKUnknownStorage || ForceRescaleInterceptSlope)
+      ms == MediaStorage::DCMTKUnknownStorage || force)
   {
     bool b = GetRescaleInterceptSlopeValueFromDataSet(ds, interceptslope);
     if (!b)
@@ -2391,7 +2339,7 @@ ImageHelper::SetRescaleInterceptSlopeValue(File & f, const Image & img)
     ds.Remove(Tag(0x28,0x1054));
 #else
     {
-      if (ForceRescaleInterceptSlope)
+      if (img.GetCodecOptions().ForceRescaleInterceptSlope)
       {
         mdcmDebugMacro("Forcing MR Image Storage / Modality LUT: [" << img.GetIntercept() << "," << img.GetSlope());
         Attribute<0x0028, 0x1052> at1;
@@ -55,10 +55,6 @@ struct RealWorldValueMappingContent
 class MDCM_EXPORT ImageHelper
 {
 public:
-  static void
-  SetForceRescaleInterceptSlope(bool);
-  static bool
-  GetForceRescaleInterceptSlope();
   static void
   SetPMSRescaleInterceptSlope(bool);
   static bool
@@ -67,18 +63,6 @@ public:
   SetForcePixelSpacing(bool);
   static bool
   GetForcePixelSpacing();
-  static bool
-  GetCleanUnusedBits();
-  static void
-  SetCleanUnusedBits(bool);
-  static void
-  SetWorkaroundCornellBug(bool);
-  static bool
-  GetWorkaroundCornellBug();
-  static void
-  SetWorkaroundPredictorBug(bool);
-  static bool
-  GetWorkaroundPredictorBug();
   static std::vector<unsigned int>
   GetDimensionsValue(const File &);
   static void
@@ -86,7 +70,7 @@ public:
   static PixelFormat
   GetPixelFormatValue(const File &);
   static std::vector<double>
-  GetRescaleInterceptSlopeValue(File const &);
+  GetRescaleInterceptSlopeValue(File const &, bool = false);
   static void
   SetRescaleInterceptSlopeValue(File &, const Image &);
   static void
@@ -130,12 +114,8 @@ protected:
   GetZSpacingTagFromMediaStorage(MediaStorage const &);
 
 private:
-  static bool ForceRescaleInterceptSlope;
   static bool PMSRescaleInterceptSlope;
   static bool ForcePixelSpacing;
-  static bool CleanUnusedBits;
-  static bool WorkaroundCornellBug;
-  static bool WorkaroundPredictorBug;
 };
 
 } // end namespace mdcm
@@ -92,7 +92,7 @@ ImageReader::ReadImage(const MediaStorage & ms)
   {
     pixeldata.SetDirectionCosines(&dircos[0]);
   }
-  std::vector<double> is = ImageHelper::GetRescaleInterceptSlopeValue(*F);
+  std::vector<double> is = ImageHelper::GetRescaleInterceptSlopeValue(*F, m_CodecOptions.ForceRescaleInterceptSlope);
   pixeldata.SetIntercept(is[0]);
   pixeldata.SetSlope(is[1]);
   return true;
@@ -138,7 +138,7 @@ ImageReader::ReadACRNEMAImage()
     at.SetFromDataElement(de);
     pixeldata.SetDirectionCosines(at.GetValues());
   }
-  std::vector<double> is = ImageHelper::GetRescaleInterceptSlopeValue(*F);
+  std::vector<double> is = ImageHelper::GetRescaleInterceptSlopeValue(*F, m_CodecOptions.ForceRescaleInterceptSlope);
   pixeldata.SetIntercept(is[0]);
   pixeldata.SetSlope(is[1]);
   return true;
@@ -261,7 +261,7 @@ ImageWriter::Write()
     }
     else if (ms == MediaStorage::MRImageStorage && (pixeldata.GetIntercept() != 0 || pixeldata.GetSlope() != 1.0))
     {
-      if (!mdcm::ImageHelper::GetForceRescaleInterceptSlope())
+      if (!pixeldata.GetCodecOptions().ForceRescaleInterceptSlope)
         return false;
     }
   }
@@ -29,6 +29,9 @@
 #include <cstring>
 #include <cstdio>
 #include <numeric>
+#include <string>
+#include <thread>
+#include <vector>
 #ifdef _WIN32
 #  define snprintf _snprintf
 #endif
@@ -395,17 +398,29 @@ int_ceildivpow2(int a, int b)
   return ((a + (1 << b) - 1) >> b);
 }
 
+// Threads of OpenJPEG for decoding, the processors (0 if one),
+// at most Options.NumberOfThreads if set
+inline int
+DecompressionThreads(int cpus, unsigned int max_threads)
+{
+  if (cpus < 2 || max_threads == 0 || (int)max_threads >= cpus)
+    return cpus;
+  return (max_threads > 1) ? (int)max_threads : 0;
+}
+
 class JPEG2000Internals
 {
 public:
   JPEG2000Internals()
     : nNumberOfThreadsForDecompression(0)
+    , nNumberOfThreadsForCompression(0)
   {
     memset(&coder_param, 0, sizeof(coder_param));
     opj_set_default_encoder_parameters(&coder_param);
   }
   opj_cparameters coder_param;
   int             nNumberOfThreadsForDecompression;
+  int             nNumberOfThreadsForCompression;
 };
 
 template <typename T>
@@ -1033,7 +1048,83 @@ JPEG2000Codec::Decode2(DataElement const & in, char * out_buffer, size_t len)
   return false;
 }
 
+// Decode one frame from its codestream into the caller's buffer
+bool
+JPEG2000Codec::DecodeFrame(const char * in, size_t inlen, char * out, size_t outlen)
+{
+  const std::pair<char *, size_t> raw_len = this->DecodeByStreamsCommon(in, inlen, out, outlen);
+  return (raw_len.first == out && raw_len.second == outlen);
+}
+
+bool
+JPEG2000Codec::DecodeFrameRegion(const char *   in,
+                                 size_t         inlen,
+                                 char *         out,
+                                 size_t         outlen,
+                                 unsigned int   x0,
+                                 unsigned int   y0,
+                                 unsigned int   x1,
+                                 unsigned int   y1,
+                                 unsigned int & reduce,
+                                 unsigned int & w,
+                                 unsigned int & h)
+{
+  if (!out || x0 >= x1 || y0 >= y1 || x1 > Dimensions[0] || y1 > Dimensions[1])
+    return false;
+  Region r;
+  r.X0 = x0;
+  r.Y0 = y0;
+  r.X1 = x1;
+  r.Y1 = y1;
+  r.Reduce = reduce;
+  r.Width = 0;
+  r.Height = 0;
+  const std::pair<char *, size_t> raw_len = this->DecodeByStreamsCommon(in, inlen, out, outlen, &r);
+  if (raw_len.first != out)
+    return false;
+  reduce = r.Reduce;
+  w = r.Width;
+  h = r.Height;
+  return true;
+}
+
+class JPEG2000FrameTask : public ImageCodec::FrameTask
+{
+public:
+  JPEG2000FrameTask(JPEG2000Codec * c, const char * in, size_t len, size_t outlen, std::vector<std::string> & r)
+    : Codec(c)
+    , Input(in)
+    , FrameLength(len)
+    , OutputLength(outlen)
+    , Results(r)
+  {}
+  bool
+  Process(unsigned int dim) override
+  {
+    std::vector<char> rgbyteCompressed;
+    rgbyteCompressed.resize(OutputLength);
+    size_t     cbyteCompressed;
+    const bool b = Codec->CodeFrameIntoBuffer(
+      &rgbyteCompressed[0], rgbyteCompressed.size(), cbyteCompressed, Input + dim * FrameLength, FrameLength);
+    if (!b)
+      return false;
+    assert(cbyteCompressed <= rgbyteCompressed.size()); // default alloc would be bogus
+    Results[dim].assign(&rgbyteCompressed[0], cbyteCompressed);
+    return true;
+  }
+
+private:
+  JPEG2000Codec *            Codec;
+  const char *               Input;
+  const size_t               FrameLength;
+  const size_t               OutputLength;
+  std::vector<std::string> & Results;
+};
+
 // Compress into JPEG
+// Multi-frame objects are encoded frame-parallel, single-threaded
+// OpenJPEG per frame, a single frame uses encoder threads of
+// OpenJPEG (if supported).
 bool
 JPEG2000Codec::Code(DataElement const & in, DataElement & out)
 {
@@ -1049,21 +1140,24 @@ JPEG2000Codec::Code(DataElement const & in, DataElement & out)
   const char * input = bv->GetPointer();
   const size_t len = bv->GetLength();
   const size_t image_len = len / dims[2];
-  const size_t inputlength = image_len;
+  Internals->nNumberOfThreadsForCompression = 0;
+  if (dims[2] == 1)
+  {
+    unsigned int x = Options.NumberOfThreads;
+    if (x == 0)
+      x = std::thread::hardware_concurrency();
+    Internals->nNumberOfThreadsForCompression = (x > 1) ? (int)x : 0;
+  }
+  std::vector<std::string> frames(dims[2]);
+  JPEG2000FrameTask        task(this, input, image_len, (size_t)image_width * (size_t)image_height * 4, frames);
+  if (!RunFrames(task, dims[2]))
+    return false;
   for (unsigned int dim = 0; dim < dims[2]; ++dim)
   {
-    const char *      inputdata = input + dim * image_len;
-    std::vector<char> rgbyteCompressed;
-    rgbyteCompressed.resize(image_width * image_height * 4);
-    size_t     cbyteCompressed;
-    const bool b = this->CodeFrameIntoBuffer(
-      (char *)&rgbyteCompressed[0], rgbyteCompressed.size(), cbyteCompressed, inputdata, inputlength);
-    if (!b)
-      return false;
     Fragment frag;
-    assert(cbyteCompressed <= rgbyteCompressed.size()); // default alloc would be bogus
-    frag.SetByteValue(&rgbyteCompressed[0], (uint32_t)cbyteCompressed);
+    frag.SetByteValue(frames[dim].data(), (uint32_t)frames[dim].size());
     sq->AddFragment(frag);
+    std::string().swap(frames[dim]);
   }
   assert(sq->GetNumberOfFragments() == dims[2]);
   out.SetValue(*sq);
@@ -1390,7 +1484,11 @@ JPEG2000Codec::StopEncode(std::ostream &)
 }
 
 std::pair<char *, size_t>
-JPEG2000Codec::DecodeByStreamsCommon(char * dummy_buffer, size_t buf_size)
+JPEG2000Codec::DecodeByStreamsCommon(const char * dummy_buffer,
+                                     size_t       buf_size,
+                                     char *       out_buffer,
+                                     size_t       out_len,
+                                     Region *     region)
 {
   if (!dummy_buffer)
     return std::make_pair((char *)NULL, 0);
@@ -1454,7 +1552,8 @@ JPEG2000Codec::DecodeByStreamsCommon(char * dummy_buffer, size_t buf_size)
 #if (OPJ_VERSION_MAJOR == 2 && OPJ_VERSION_MINOR >= 3)
   if (opj_has_thread_support())
   {
-    opj_codec_set_threads(dinfo, Internals->nNumberOfThreadsForDecompression);
+    opj_codec_set_threads(dinfo,
+                          DecompressionThreads(Internals->nNumberOfThreadsForDecompression, Options.NumberOfThreads));
   }
 #endif
   myfile   mysrc;
@@ -1488,11 +1587,41 @@ JPEG2000Codec::DecodeByStreamsCommon(char * dummy_buffer, size_t buf_size)
     mdcmErrorMacro("opj_setup_decoder failure");
     return std::make_pair<char *, size_t>(0, 0);
   }
-#if 0
-  /* Optional if you want decode the entire image */
-  opj_set_decode_area(dinfo, image, (OPJ_INT32)parameters.DA_x0,
-     (OPJ_INT32)parameters.DA_y0, (OPJ_INT32)parameters.DA_x1, (OPJ_INT32)parameters.DA_y1);
-#endif
+  if (region)
+  {
+    // Code-blocks out of the area and levels above 'Reduce'
+    // are not decoded, the area is in the reference grid.
+    opj_codestream_info_v2_t * cstr_info = opj_get_cstr_info(dinfo);
+    if (cstr_info && cstr_info->m_default_tile_info.tccp_info)
+    {
+      for (OPJ_UINT32 compno = 0; compno < cstr_info->nbcomps; ++compno)
+      {
+        const OPJ_UINT32 numresolutions = cstr_info->m_default_tile_info.tccp_info[compno].numresolutions;
+        if (numresolutions > 0 && region->Reduce >= numresolutions)
+          region->Reduce = numresolutions - 1;
+      }
+    }
+    else
+    {
+      region->Reduce = 0;
+    }
+    if (cstr_info)
+      opj_destroy_cstr_info(&cstr_info);
+    if (!opj_set_decoded_resolution_factor(dinfo, region->Reduce) ||
+        !opj_set_decode_area(dinfo,
+                             image,
+                             (OPJ_INT32)(image->x0 + region->X0),
+                             (OPJ_INT32)(image->y0 + region->Y0),
+                             (OPJ_INT32)(image->x0 + region->X1),
+                             (OPJ_INT32)(image->y0 + region->Y1)))
+    {
+      opj_destroy_codec(dinfo);
+      opj_stream_destroy(cio);
+      opj_image_destroy(image);
+      mdcmErrorMacro("opj_set_decode_area failure");
+      return std::make_pair<char *, size_t>(0, 0);
+    }
+  }
   bResult = opj_decode(dinfo, cio, image);
   if (!bResult)
   {
@@ -1553,22 +1682,56 @@ JPEG2000Codec::DecodeByStreamsCommon(char * dummy_buffer, size_t buf_size)
 #endif
   /* close the byte stream */
   opj_stream_destroy(cio);
-  const size_t len = (size_t)Dimensions[0] * (size_t)Dimensions[1] * (PF.GetBitsAllocated() / 8) * image->numcomps;
+  size_t len = (size_t)Dimensions[0] * (size_t)Dimensions[1] * (PF.GetBitsAllocated() / 8) * image->numcomps;
+  if (region)
+  {
+    // components are not subsampled
+    region->Width = image->comps[0].w;
+    region->Height = image->comps[0].h;
+    len = (size_t)region->Width * region->Height * (PF.GetBitsAllocated() / 8) * image->numcomps;
+  }
   char *                   raw;
-  try
+  if (out_buffer)
   {
-    raw = new char[len];
+    // Decoded to the caller's buffer, only if the size
+    // of samples is not changed below.
+    bool valid = (region ? len <= out_len : len == out_len);
+    for (unsigned int compno = 0; region && valid && compno < (unsigned int)image->numcomps; ++compno)
+    {
+      valid = (image->comps[compno].w == region->Width && image->comps[compno].h == region->Height);
+    }
+    for (unsigned int compno = 0; valid && compno < (unsigned int)image->numcomps; ++compno)
+    {
+      const OPJ_UINT32 prec = image->comps[compno].prec;
+      valid = (prec <= 8 ? 8 : (prec <= 16 ? 16 : 32)) == PF.GetBitsAllocated();
+    }
+    if (!valid)
+    {
+      opj_destroy_codec(dinfo);
+      opj_image_destroy(image);
+      return std::make_pair((char *)NULL, 0);
+    }
+    raw = out_buffer;
   }
-  catch (const std::bad_alloc &)
+  else
   {
-    return std::make_pair((char *)NULL, 0);
+    try
+    {
+      raw = new char[len];
+    }
+    catch (const std::bad_alloc &)
+    {
+      return std::make_pair((char *)NULL, 0);
+    }
   }
   for (unsigned int compno = 0; compno < (unsigned int)image->numcomps; ++compno)
   {
     opj_image_comp_t * comp = &image->comps[compno];
     int                w = image->comps[compno].w;
-    int                wr = int_ceildivpow2(image->comps[compno].w, image->comps[compno].factor);
-    int                hr = int_ceildivpow2(image->comps[compno].h, image->comps[compno].factor);
+    // the size of a region is already at its level
+    int                wr = region ? w : int_ceildivpow2(image->comps[compno].w, image->comps[compno].factor);
+    int                hr = region ? (int)image->comps[compno].h
+                                   : int_ceildivpow2(image->comps[compno].h, image->comps[compno].factor);
     // ELSCINT1_JP2vsJ2K.dcm
     // -> prec = 12, bpp = 0, sgnd = 0
     if (comp->sgnd != PF.GetPixelRepresentation())
@@ -1729,6 +1892,13 @@ JPEG2000Codec::CodeFrameIntoBuffer(char *       outdata,
   cinfo = opj_create_compress(CODEC_J2K);
   /* setup the encoder parameters using the current image and using user parameters */
   opj_setup_encoder(cinfo, &parameters, image);
+  // encoder threads, OpenJPEG >= 2.5
+#if (OPJ_VERSION_MAJOR > 2 || (OPJ_VERSION_MAJOR == 2 && OPJ_VERSION_MINOR >= 5))
+  if (Internals->nNumberOfThreadsForCompression > 0 && opj_has_thread_support())
+  {
+    opj_codec_set_threads(cinfo, Internals->nNumberOfThreadsForCompression);
+  }
+#endif
   myfile   mysrc;
   myfile * fsrc = &mysrc;
   char *   buffer_j2k; // overallocated
@@ -1833,7 +2003,8 @@ JPEG2000Codec::GetHeaderInfo(const char * dummy_buffer, size_t buf_size, Transfe
 #if (OPJ_VERSION_MAJOR == 2 && OPJ_VERSION_MINOR >= 3)
   if (opj_has_thread_support())
   {
-    opj_codec_set_threads(dinfo, Internals->nNumberOfThreadsForDecompression);
+    opj_codec_set_threads(dinfo,
+                          DecompressionThreads(Internals->nNumberOfThreadsForDecompression, Options.NumberOfThreads));
   }
 #endif
   myfile   mysrc;
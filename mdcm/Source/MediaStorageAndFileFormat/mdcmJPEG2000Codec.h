@@ -28,6 +28,7 @@ namespace mdcm
 {
 
 class JPEG2000Internals;
+class JPEG2000FrameTask;
 /*
  * the class will produce JPC (JPEG 2000 codestream), since some private implementor
  * are using full jp2 file the decoder tolerate jp2 input
@@ -36,6 +37,7 @@ class JPEG2000Internals;
 class MDCM_EXPORT JPEG2000Codec : public ImageCodec
 {
   friend class Bitmap;
+  friend class JPEG2000FrameTask;
 
 public:
   JPEG2000Codec();
@@ -49,6 +51,24 @@ public:
   bool
   Decode2(DataElement const &, char *, size_t);
   bool
+  DecodeFrame(const char *, size_t, char *, size_t) override;
+  // Decodes the area [x0, x1) x [y0, y1) of a frame's codestream at
+  // resolution level 'reduce' (each level halves the size), the level
+  // is lowered if the codestream has less resolutions. The level and
+  // the size decoded are returned, samples are interleaved.
+  bool
+  DecodeFrameRegion(const char *,
+                    size_t,
+                    char *,
+                    size_t,
+                    unsigned int,
+                    unsigned int,
+                    unsigned int,
+                    unsigned int,
+                    unsigned int &,
+                    unsigned int &,
+                    unsigned int &);
+  bool
   Code(DataElement const &, DataElement &) override;
   bool
   GetHeaderInfo(std::istream &, TransferSyntax &) override;
@@ -95,8 +115,18 @@ protected:
   StopEncode(std::ostream &) override;
 
 private:
+  struct Region
+  {
+    unsigned int X0;
+    unsigned int Y0;
+    unsigned int X1;
+    unsigned int Y1;
+    unsigned int Reduce;
+    unsigned int Width;
+    unsigned int Height;
+  };
   std::pair<char *, size_t>
-  DecodeByStreamsCommon(char *, size_t);
+  DecodeByStreamsCommon(const char *, size_t, char * = NULL, size_t = 0, Region * = NULL);
   bool
   CodeFrameIntoBuffer(char *, size_t, size_t &, const char *, size_t);
   bool
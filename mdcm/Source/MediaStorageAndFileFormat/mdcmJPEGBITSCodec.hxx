@@ -21,7 +21,6 @@
 =========================================================================*/
 #include "mdcmTrace.h"
 #include "mdcmTransferSyntax.h"
-#include "mdcmImageHelper.h"
 /*
  * jdatasrc.c
  *
@@ -332,9 +331,9 @@ JPEGBITSCodec::GetHeaderInfo(std::istream & is, TransferSyntax & ts)
     // Initialize the JPEG decompression object.
     jpeg_create_decompress(&cinfo);
     int workaround = 0;
-    if (ImageHelper::GetWorkaroundPredictorBug())
+    if (Options.WorkaroundPredictorBug)
       workaround |= WORKAROUND_PREDICTOR6OVERFLOW;
-    if (ImageHelper::GetWorkaroundCornellBug())
+    if (Options.WorkaroundCornellBug)
       workaround |= WORKAROUND_BUGGY_CORNELL_16BIT_JPEG_ENCODER;
     if (workaround != 0)
       cinfo.workaround_options = workaround;
@@ -576,9 +575,9 @@ JPEGBITSCodec::DecodeByStreams(std::istream & is, std::ostream & os)
     // Initialize the JPEG decompression object.
     jpeg_create_decompress(&cinfo);
     int workaround = 0;
-    if (ImageHelper::GetWorkaroundPredictorBug())
+    if (Options.WorkaroundPredictorBug)
       workaround |= WORKAROUND_PREDICTOR6OVERFLOW;
-    if (ImageHelper::GetWorkaroundCornellBug())
+    if (Options.WorkaroundCornellBug)
       workaround |= WORKAROUND_BUGGY_CORNELL_16BIT_JPEG_ENCODER;
     if (workaround != 0)
       cinfo.workaround_options = workaround;
@@ -25,11 +25,14 @@
 #include "mdcmDataElement.h"
 #include "mdcmSequenceOfFragments.h"
 #include "mdcmSwapper.h"
+#include "mdcmArrayStream.h"
 #include "mdcmJPEG8Codec.h"
 #include "mdcmJPEG12Codec.h"
 #include "mdcmJPEG16Codec.h"
 #include <numeric>
 #include <cstring>
+#include <string>
+#include <vector>
 
 namespace mdcm
 {
@@ -379,6 +382,79 @@ JPEGCodec::Decode2(DataElement const & in, std::stringstream & os)
   return true;
 }
 
+// Same as DecodeByStreams, but the compressed frame and
+// the output buffer are used as streams, without copies.
+bool
+JPEGCodec::DecodeFrame(const char * in, size_t inlen, char * out, size_t outlen)
+{
+  if (!Internal)
+    return false;
+  IArrayStream is(in, inlen);
+  OArrayStream os(out, outlen);
+  if (!Internal->DecodeByStreams(is, os))
+  {
+    if (this->BitSample == Internal->BitSample)
+      return false;
+    is.clear();
+    is.seekg(0, std::ios::beg);
+    os.clear();
+    os.seekp(0, std::ios::beg);
+    SetupJPEGBitCodec(Internal->BitSample);
+    if (!Internal)
+      return false;
+    Internal->SetDimensions(this->GetDimensions());
+    Internal->SetPlanarConfiguration(this->GetPlanarConfiguration());
+    Internal->SetPhotometricInterpretation(this->GetPhotometricInterpretation());
+    if (!Internal->DecodeByStreams(is, os))
+      return false;
+  }
+  else
+  {
+    if (this->PlanarConfiguration != Internal->PlanarConfiguration)
+    {
+      mdcmAlwaysWarnMacro("JPEGCodec: possible PlanarConfiguration issue");
+      this->PlanarConfiguration = Internal->PlanarConfiguration;
+    }
+    if (this->PI != Internal->PI)
+    {
+      mdcmAlwaysWarnMacro("JPEGCodec: possible PhotometricInterpretation issue");
+      this->PI = Internal->PI;
+    }
+  }
+  if (!os || os.GetNumberOfWrittenBytes() != outlen)
+    return false;
+  return PostProcess(out, outlen);
+}
+
+class JPEGFrameTask : public ImageCodec::FrameTask
+{
+public:
+  JPEGFrameTask(JPEGCodec * c, const char * in, size_t len, std::vector<std::string> & r)
+    : Codec(c)
+    , Input(in)
+    , FrameLength(len)
+    , Results(r)
+  {}
+  bool
+  Process(unsigned int dim) override
+  {
+    std::stringstream os;
+    if (!Codec->InternalCode(Input + dim * FrameLength, FrameLength, os))
+      return false;
+    Results[dim] = os.str();
+    assert(Results[dim].size());
+    return true;
+  }
+
+private:
+  JPEGCodec *                Codec;
+  const char *               Input;
+  const size_t               FrameLength;
+  std::vector<std::string> & Results;
+};
+
+// Frames are encoded in parallel, each with its own
+// compression object, fragments are added in order.
 bool
 JPEGCodec::Code(DataElement const & in, DataElement & out)
 {
@@ -395,19 +471,17 @@ JPEGCodec::Code(DataElement const & in, DataElement & out)
     return false;
   Internal->SetLossless(this->GetLossless());
   Internal->SetQuality(this->GetQuality());
+  std::vector<std::string> frames(dims[2]);
+  JPEGFrameTask            task(Internal, input, image_len, frames);
+  if (!RunFrames(task, dims[2]))
+    return false;
   for (unsigned int dim = 0; dim < dims[2]; ++dim)
   {
-    std::stringstream os;
-    const char *      p = input + dim * image_len;
-    const bool        r = Internal->InternalCode(p, image_len, os);
-    if (!r)
-      return false;
-    std::string str = os.str();
-    assert(str.size());
     Fragment frag;
-    VL::Type strSize = (VL::Type)str.size();
-    frag.SetByteValue(&str[0], strSize);
+    VL::Type strSize = (VL::Type)frames[dim].size();
+    frag.SetByteValue(frames[dim].data(), strSize);
     sq->AddFragment(frag);
+    std::string().swap(frames[dim]);
   }
   assert(sq->GetNumberOfFragments() == dims[2]);
   out.SetValue(*sq);
@@ -828,6 +902,16 @@ JPEGCodec::SetupJPEGBitCodec(int b)
   {
     mdcmAlwaysWarnMacro("JPEGCodec: SetupJPEGBitCodec(" << b << ") failed");
   }
+  if (Internal)
+    Internal->SetCodecOptions(Options);
+}
+
+void
+JPEGCodec::SetCodecOptions(CodecOptions const & o)
+{
+  ImageCodec::SetCodecOptions(o);
+  if (Internal)
+    Internal->SetCodecOptions(o);
 }
 
 } // end namespace mdcm
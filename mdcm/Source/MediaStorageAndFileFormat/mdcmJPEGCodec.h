@@ -36,9 +36,12 @@ namespace mdcm
 
 class PixelFormat;
 class TransferSyntax;
+class JPEGFrameTask;
 
 class MDCM_EXPORT JPEGCodec : public ImageCodec
 {
+  friend class JPEGFrameTask;
+
 public:
   JPEGCodec();
   virtual ~JPEGCodec() override;
@@ -51,10 +54,14 @@ public:
   bool
   Decode2(DataElement const &, std::stringstream &);
   bool
+  DecodeFrame(const char *, size_t, char *, size_t) override;
+  bool
   Code(DataElement const &, DataElement &) override;
   void
   SetPixelFormat(PixelFormat const &) override;
   void
+  SetCodecOptions(CodecOptions const &) override;
+  void
   ComputeOffsetTable(bool);
   virtual bool
   GetHeaderInfo(std::istream &, TransferSyntax &) override;
@@ -26,6 +26,8 @@
 #include "mdcmSwapper.h"
 #include <numeric>
 #include <cstring>
+#include <string>
+#include <vector>
 #include "mdcm_charls.h"
 
 #if defined(__GNUC__) && GCC_VERSION < 50101
@@ -266,6 +268,69 @@ JPEGLSCodec::Decode2(DataElement const & in, char * out_buffer, size_t len)
   return false;
 }
 
+bool
+JPEGLSCodec::DecodeFrame(const char * in, size_t inlen, char * out, size_t outlen)
+{
+  using namespace charls;
+  const unsigned char * pbyteCompressed = (const unsigned char *)in;
+  // trailing padding of (joined) fragments, as in Decode
+  while (inlen > 0 && pbyteCompressed[inlen - 1] != 0xd9)
+  {
+    inlen--;
+  }
+  if (inlen == 0)
+    return false;
+  JlsParameters         params = {};
+  if (JpegLsReadHeader(pbyteCompressed, inlen, &params, NULL) != ApiResult::OK)
+  {
+    mdcmDebugMacro("Could not parse JPEG-LS header");
+    return false;
+  }
+  // allowedlossyerror == 0 => Lossless
+  LossyFlag = params.allowedLossyError != 0;
+  const size_t len =
+    (size_t)params.height * (size_t)params.width * ((params.bitsPerSample + 7) / 8) * params.components;
+  if (len != outlen)
+    return false;
+  return (JpegLsDecode(out, outlen, pbyteCompressed, inlen, &params, NULL) == ApiResult::OK);
+}
+
+class JPEGLSFrameTask : public ImageCodec::FrameTask
+{
+public:
+  JPEGLSFrameTask(JPEGLSCodec * c, const char * in, size_t len, size_t outlen, std::vector<std::string> & r)
+    : Codec(c)
+    , Input(in)
+    , FrameLength(len)
+    , OutputLength(outlen)
+    , Results(r)
+  {}
+  bool
+  Process(unsigned int dim) override
+  {
+    std::vector<unsigned char> rgbyteCompressed;
+    rgbyteCompressed.resize(OutputLength); // overallocate
+    size_t     cbyteCompressed;
+    const bool b = Codec->CodeFrameIntoBuffer((char *)&rgbyteCompressed[0],
+                                              rgbyteCompressed.size(),
+                                              cbyteCompressed,
+                                              Input + dim * FrameLength,
+                                              FrameLength);
+    if (!b)
+      return false;
+    Results[dim].assign((const char *)&rgbyteCompressed[0], cbyteCompressed);
+    return true;
+  }
+
+private:
+  JPEGLSCodec *              Codec;
+  const char *               Input;
+  const size_t               FrameLength;
+  const size_t               OutputLength;
+  std::vector<std::string> & Results;
+};
+
+// Frames are encoded in parallel, fragments are added in order.
 bool
 JPEGLSCodec::Code(DataElement const & in, DataElement & out)
 {
@@ -275,23 +340,21 @@ JPEGLSCodec::Code(DataElement const & in, DataElement & out)
   const int                         image_width = dims[0];
   const int                         image_height = dims[1];
   const ByteValue *                 bv = in.GetByteValue();
-  const char *                      input = bv->GetPointer();
-  const size_t                      len = bv->GetLength();
-  const size_t                      image_len = len / dims[2];
-  const size_t                      inputlength = image_len;
+  if (!bv)
+    return false;
+  const char *             input = bv->GetPointer();
+  const size_t             len = bv->GetLength();
+  const size_t             image_len = len / dims[2];
+  std::vector<std::string> frames(dims[2]);
+  JPEGLSFrameTask          task(this, input, image_len, (size_t)image_width * (size_t)image_height * 4 * 2, frames);
+  if (!RunFrames(task, dims[2]))
+    return false;
   for (unsigned int dim = 0; dim < dims[2]; ++dim)
   {
-    const char *               inputdata = input + dim * image_len;
-    std::vector<unsigned char> rgbyteCompressed;
-    rgbyteCompressed.resize((size_t)image_width * (size_t)image_height * 4 * 2); // overallocate
-    size_t     cbyteCompressed;
-    const bool b = this->CodeFrameIntoBuffer(
-      (char *)&rgbyteCompressed[0], rgbyteCompressed.size(), cbyteCompressed, inputdata, inputlength);
-    if (!b)
-      return false;
     Fragment frag;
-    frag.SetByteValue((char *)&rgbyteCompressed[0], (uint32_t)cbyteCompressed);
+    frag.SetByteValue(frames[dim].data(), (uint32_t)frames[dim].size());
     sq->AddFragment(frag);
+    std::string().swap(frames[dim]);
   }
   assert(sq->GetNumberOfFragments() == dims[2]);
   out.SetValue(*sq);
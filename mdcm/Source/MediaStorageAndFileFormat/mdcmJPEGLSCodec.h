@@ -28,6 +28,7 @@ namespace mdcm
 {
 
 class JPEGLSInternals;
+class JPEGLSFrameTask;
 
 /**
  * JPEG-LS
@@ -35,6 +36,8 @@ class JPEGLSInternals;
  */
 class MDCM_EXPORT JPEGLSCodec : public ImageCodec
 {
+  friend class JPEGLSFrameTask;
+
 public:
   JPEGLSCodec();
   ~JPEGLSCodec() override;
@@ -47,6 +50,8 @@ public:
   bool
   Decode2(DataElement const &, char *, size_t);
   bool
+  DecodeFrame(const char *, size_t, char *, size_t) override;
+  bool
   Code(DataElement const &, DataElement &) override;
   unsigned long long
   GetBufferLength() const;
@@ -44,6 +44,7 @@ PixmapReader::PixmapReader()
   , m_ProcessOverlays(true)
   , m_ProcessIcons(false)
   , m_ProcessCurves(false)
+  , m_CodecOptions()
 {}
 
 PixmapReader::~PixmapReader() {}
@@ -96,6 +97,18 @@ PixmapReader::GetProcessCurves() const
   return m_ProcessCurves;
 }
 
+void
+PixmapReader::SetCodecOptions(CodecOptions const & o)
+{
+  m_CodecOptions = o;
+}
+
+const CodecOptions &
+PixmapReader::GetCodecOptions() const
+{
+  return m_CodecOptions;
+}
+
 // Valid only after a call to Read
 const Pixmap &
 PixmapReader::GetPixmap() const
@@ -117,6 +130,13 @@ PixmapReader::Read()
   {
     return false;
   }
+  return ReadFromFile();
+}
+
+bool
+PixmapReader::ReadFromFile()
+{
+  PixelData->SetCodecOptions(m_CodecOptions);
   const FileMetaInformation & header = F->GetHeader();
   const DataSet &             ds = F->GetDataSet();
   const TransferSyntax &      ts = header.GetDataSetTransferSyntax();
@@ -24,6 +24,7 @@
 
 #include "mdcmReader.h"
 #include "mdcmPixmap.h"
+#include "mdcmCodecOptions.h"
 
 namespace mdcm
 {
@@ -61,12 +62,20 @@ public:
   SetProcessCurves(bool);
   bool
   GetProcessCurves() const;
+  void
+  SetCodecOptions(CodecOptions const &);
+  const CodecOptions &
+  GetCodecOptions() const;
   const Pixmap &
   GetPixmap() const;
   Pixmap &
   GetPixmap();
   virtual bool
   Read() override;
+  // Interprets the File set with SetFile(), e.g. already
+  // parsed by a Reader, the stream is not read again.
+  bool
+  ReadFromFile();
 
 protected:
   bool
@@ -80,6 +89,7 @@ protected:
   bool                 m_ProcessOverlays;
   bool                 m_ProcessIcons;
   bool                 m_ProcessCurves;
+  CodecOptions         m_CodecOptions;
 };
 
 } // end namespace mdcm
@@ -180,6 +180,15 @@ RAWCodec::GetHeaderInfo(std::istream &, TransferSyntax & ts)
   return true;
 }
 
+bool
+RAWCodec::DecodeFrame(const char * in, size_t inlen, char * out, size_t outlen)
+{
+  if (inlen < outlen || GetPixelFormat().GetBitsAllocated() == 12)
+    return false;
+  memcpy(out, in, outlen);
+  return PostProcess(out, outlen);
+}
+
 bool
 RAWCodec::DecodeBytes(const char * inBytes, size_t inBufferLength, char * outBytes, size_t inOutBufferLength)
 {
@@ -43,6 +43,8 @@ public:
   bool
   Decode(DataElement const &, DataElement &) override;
   bool
+  DecodeFrame(const char *, size_t, char *, size_t) override;
+  bool
   GetHeaderInfo(std::istream &, TransferSyntax &) override;
   bool
   DecodeBytes(const char *, size_t, char *, size_t);
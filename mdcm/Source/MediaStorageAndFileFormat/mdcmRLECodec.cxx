@@ -31,6 +31,8 @@
 #include <algorithm>
 #include <stddef.h> // ptrdiff_t
 #include <cstring>
+#include <new>
+#include <string>
 #include <mdcmrle/rle.h>
 
 namespace mdcm
@@ -210,6 +212,56 @@ rle_encode(char * output, size_t outputlength, const char * input, size_t inputl
   return pout - output;
 }
 
+// Decodes a segment to 'outputlength' bytes, written
+// every 'stride' bytes (G.3.2)
+bool
+rle_decode(char * output, size_t outputlength, size_t stride, const char * input, size_t inputlength)
+{
+  size_t in = 0;
+  size_t out = 0;
+  while (out < outputlength)
+  {
+    if (in >= inputlength)
+      return false;
+    const signed char n = (signed char)input[in++];
+    if (n >= 0)
+    {
+      const size_t count = n + 1;
+      if (in + count > inputlength || out + count > outputlength)
+        return false;
+      if (stride == 1)
+      {
+        memcpy(output + out, input + in, count);
+      }
+      else
+      {
+        for (size_t x = 0; x < count; ++x)
+          output[(out + x) * stride] = input[in + x];
+      }
+      in += count;
+      out += count;
+    }
+    else if (n != -128)
+    {
+      const size_t count = 1 - n;
+      if (in >= inputlength || out + count > outputlength)
+        return false;
+      const char c = input[in++];
+      if (stride == 1)
+      {
+        memset(output + out, c, count);
+      }
+      else
+      {
+        for (size_t x = 0; x < count; ++x)
+          output[(out + x) * stride] = c;
+      }
+      out += count;
+    }
+  }
+  return true;
+}
+
 template <typename T>
 bool
 DoInvertPlanarConfiguration(T * output, const T * input, uint32_t inputlength)
@@ -440,6 +492,92 @@ RLECodec::Decode(DataElement const & in, DataElement & out)
   return false;
 }
 
+// Segments are decoded straight to their final positions,
+// most significant byte first (G.2), samples interleaved
+// if Planar Configuration is 0.
+bool
+RLECodec::DecodeFrame(const char * in, size_t inlen, char * out, size_t outlen)
+{
+  const size_t bytes = PF.GetBitsAllocated() / 8;
+  const size_t samples = PF.GetSamplesPerPixel();
+  if (PF.GetBitsAllocated() % 8 != 0 || (bytes != 1 && bytes != 2 && bytes != 4) ||
+      (samples != 1 && samples != 3) || (samples == 3 && bytes != 1))
+  {
+    return false;
+  }
+  if (NeedByteSwap && bytes != 1)
+    return false;
+  const size_t npixels = (size_t)Dimensions[0] * Dimensions[1];
+  if (npixels * bytes * samples != outlen || inlen < 64)
+    return false;
+  uint32_t header[16];
+  for (unsigned int x = 0; x < 16; ++x)
+  {
+    const unsigned char * p = reinterpret_cast<const unsigned char *>(in) + 4 * x;
+    header[x] = (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+  }
+  const size_t nsegments = header[0];
+  if (nsegments != bytes * samples || header[1] != 64)
+    return false;
+  for (size_t x = 0; x < nsegments; ++x)
+  {
+    const size_t offset = header[x + 1];
+    if (offset >= inlen)
+      return false;
+    const size_t sample = x / bytes;
+#ifdef MDCM_WORDS_BIGENDIAN
+    const size_t b = x % bytes;
+#else
+    const size_t b = bytes - 1 - x % bytes;
+#endif
+    char * dst;
+    size_t stride;
+    if (samples == 1)
+    {
+      dst = out + b;
+      stride = bytes;
+    }
+    else if (PlanarConfiguration == 0)
+    {
+      dst = out + sample;
+      stride = 3;
+    }
+    else
+    {
+      dst = out + sample * npixels;
+      stride = 1;
+    }
+    if (!rle_decode(dst, npixels, stride, in + offset, inlen - offset))
+      return false;
+  }
+  return PostProcess(out, outlen);
+}
+
+class RLEFrameTask : public ImageCodec::FrameTask
+{
+public:
+  RLEFrameTask(const RLECodec * c, const char * in, size_t len, unsigned int segments, std::vector<std::string> & r)
+    : Codec(c)
+    , Input(in)
+    , FrameLength(len)
+    , NumSegments(segments)
+    , Results(r)
+  {}
+  bool
+  Process(unsigned int dim) override
+  {
+    return Codec->CodeFrame(Input + dim * FrameLength, FrameLength, NumSegments, Results[dim]);
+  }
+
+private:
+  const RLECodec *           Codec;
+  const char *               Input;
+  const size_t               FrameLength;
+  const unsigned int         NumSegments;
+  std::vector<std::string> & Results;
+};
+
+// Frames are encoded in parallel, fragments are added in order.
 bool
 RLECodec::Code(DataElement const & in, DataElement & out)
 {
@@ -452,48 +590,14 @@ RLECodec::Code(DataElement const & in, DataElement & out)
     return false;
   }
   const unsigned int * dims = this->GetDimensions();
-  const size_t         n = 256 * 256;
-  char *               outbuf;
-  // At most we are encoding a single row at a time, so we would be very unlucky
-  // if the row *after* compression would not fit in 256*256 bytes
-  char small_buffer[n];
-  outbuf = small_buffer;
   // Create a Sequence Of Fragments
   SmartPointer<SequenceOfFragments> sq = new SequenceOfFragments;
-  const Tag                         itemStart(0xfffe, 0xe000);
   const ByteValue *                 bv = in.GetByteValue();
   if (!bv)
     return false;
   const char * input = bv->GetPointer();
   const size_t bvl = bv->GetLength();
   const size_t image_len = bvl / dims[2];
-  // If > 8 bits, need to do the padded composite
-  char * buffer = NULL;
-  // if 3 comp. need to the planar configuration
-  char * bufferrgb = NULL;
-  if (GetPixelFormat().GetBitsAllocated() > 8)
-  {
-    try
-    {
-      buffer = new char[image_len];
-    }
-    catch (const std::bad_alloc &)
-    {
-      return false;
-    }
-  }
-  if (GetPhotometricInterpretation() == PhotometricInterpretation::RGB ||
-      GetPhotometricInterpretation() == PhotometricInterpretation::YBR_FULL)
-  {
-    try
-    {
-      bufferrgb = new char[image_len];
-    }
-    catch (const std::bad_alloc &)
-    {
-      return false;
-    }
-  }
   unsigned int MaxNumSegments = 1;
   if (GetPixelFormat().GetBitsAllocated() == 8)
   {
@@ -509,10 +613,6 @@ RLECodec::Code(DataElement const & in, DataElement & out)
   }
   else
   {
-    if (buffer)
-      delete[] buffer;
-    if (bufferrgb)
-      delete[] bufferrgb;
     return false;
   }
   if (GetPhotometricInterpretation() == PhotometricInterpretation::RGB ||
@@ -524,161 +624,192 @@ RLECodec::Code(DataElement const & in, DataElement & out)
   {
     assert(MaxNumSegments % 3 == 0);
   }
-  RLEHeader header = { static_cast<uint32_t>(MaxNumSegments), { 64 } };
   // Create a RLE Frame for each frame
+  std::vector<std::string> frames(dims[2]);
+  RLEFrameTask             task(this, input, image_len, MaxNumSegments, frames);
+  if (!RunFrames(task, dims[2]))
+    return false;
   for (unsigned int dim = 0; dim < dims[2]; ++dim)
   {
-    // Within each frame, create the RLE Segments:
-    // lets' try a simple scheme where each Segments is given an equal portion
-    // of the input image.
-    const char * ptr_img = input + dim * image_len;
-    if (GetPlanarConfiguration() == 0 && GetPixelFormat().GetSamplesPerPixel() == 3)
+    Fragment     frag;
+    const size_t str_size = frames[dim].size();
+    if (str_size > 0xffffffff)
     {
-      if (GetPixelFormat().GetBitsAllocated() == 8)
-      {
-        DoInvertPlanarConfiguration<char>(bufferrgb, ptr_img, (uint32_t)(image_len / sizeof(char)));
-      }
-      else /* (GetPixelFormat().GetBitsAllocated() == 16) */
-      {
-        assert(GetPixelFormat().GetBitsAllocated() == 16);
-        // should not happen right?
-        DoInvertPlanarConfiguration<short>(
-          (short *)bufferrgb, (const short *)(const void *)ptr_img, (uint32_t)(image_len / sizeof(short)));
-      }
-      ptr_img = bufferrgb;
+      return false;
+    }
+    frag.SetByteValue(frames[dim].data(), (VL::Type)str_size);
+    sq->AddFragment(frag);
+    std::string().swap(frames[dim]);
+  }
+  out.SetValue(*sq);
+  return true;
+}
+
+// One frame with its own buffers and header, may be
+// called concurrently.
+bool
+RLECodec::CodeFrame(const char * input, size_t image_len, unsigned int MaxNumSegments, std::string & str) const
+{
+  const unsigned int * dims = this->GetDimensions();
+  const size_t         n = 256 * 256;
+  // At most we are encoding a single row at a time, so we would be very unlucky
+  // if the row *after* compression would not fit in 256*256 bytes
+  std::vector<char> small_buffer(n);
+  char *            outbuf = &small_buffer[0];
+  // If > 8 bits, need to do the padded composite
+  std::vector<char> buffer;
+  // if 3 comp. need to the planar configuration
+  std::vector<char> bufferrgb;
+  try
+  {
+    if (GetPixelFormat().GetBitsAllocated() > 8)
+    {
+      buffer.resize(image_len);
+    }
+    if (GetPhotometricInterpretation() == PhotometricInterpretation::RGB ||
+        GetPhotometricInterpretation() == PhotometricInterpretation::YBR_FULL)
+    {
+      bufferrgb.resize(image_len);
+    }
+  }
+  catch (const std::bad_alloc &)
+  {
+    return false;
+  }
+  RLEHeader header = { static_cast<uint32_t>(MaxNumSegments), { 64 } };
+  // Within each frame, create the RLE Segments:
+  // lets' try a simple scheme where each Segments is given an equal portion
+  // of the input image.
+  const char * ptr_img = input;
+  if (GetPlanarConfiguration() == 0 && GetPixelFormat().GetSamplesPerPixel() == 3)
+  {
+    if (GetPixelFormat().GetBitsAllocated() == 8)
+    {
+      DoInvertPlanarConfiguration<char>(&bufferrgb[0], ptr_img, (uint32_t)(image_len / sizeof(char)));
     }
-    if (GetPixelFormat().GetBitsAllocated() == 32)
+    else /* (GetPixelFormat().GetBitsAllocated() == 16) */
     {
-      assert(!(image_len % 4));
-      unsigned int div = GetPixelFormat().GetSamplesPerPixel();
-      for (unsigned int j = 0; j < div; ++j)
+      assert(GetPixelFormat().GetBitsAllocated() == 16);
+      // should not happen right?
+      DoInvertPlanarConfiguration<short>(
+        (short *)(void *)&bufferrgb[0], (const short *)(const void *)ptr_img, (uint32_t)(image_len / sizeof(short)));
+    }
+    ptr_img = &bufferrgb[0];
+  }
+  if (GetPixelFormat().GetBitsAllocated() == 32)
+  {
+    assert(!(image_len % 4));
+    unsigned int div = GetPixelFormat().GetSamplesPerPixel();
+    for (unsigned int j = 0; j < div; ++j)
+    {
+      size_t       iimage_len = image_len / div;
+      char *       ibuffer = &buffer[0] + j * iimage_len;
+      const char * iptr_img = ptr_img + j * iimage_len;
+      assert(iimage_len % 4 == 0);
+      for (size_t i = 0; i < iimage_len / 4; ++i)
       {
-        size_t       iimage_len = image_len / div;
-        char *       ibuffer = buffer + j * iimage_len;
-        const char * iptr_img = ptr_img + j * iimage_len;
-        assert(iimage_len % 4 == 0);
-        for (size_t i = 0; i < iimage_len / 4; ++i)
-        {
 #ifdef MDCM_WORDS_BIGENDIAN
-          ibuffer[i] = iptr_img[4 * i + 0];
+        ibuffer[i] = iptr_img[4 * i + 0];
 #else
-          ibuffer[i] = iptr_img[4 * i + 3];
+        ibuffer[i] = iptr_img[4 * i + 3];
 #endif
-        }
-        for (size_t i = 0; i < iimage_len / 4; ++i)
-        {
+      }
+      for (size_t i = 0; i < iimage_len / 4; ++i)
+      {
 #ifdef MDCM_WORDS_BIGENDIAN
-          ibuffer[i + iimage_len / 4] = iptr_img[4 * i + 1];
+        ibuffer[i + iimage_len / 4] = iptr_img[4 * i + 1];
 #else
-          ibuffer[i + iimage_len / 4] = iptr_img[4 * i + 2];
+        ibuffer[i + iimage_len / 4] = iptr_img[4 * i + 2];
 #endif
-        }
-        for (size_t i = 0; i < iimage_len / 4; ++i)
-        {
+      }
+      for (size_t i = 0; i < iimage_len / 4; ++i)
+      {
 #ifdef MDCM_WORDS_BIGENDIAN
-          ibuffer[i + 2 * iimage_len / 4] = iptr_img[4 * i + 2];
+        ibuffer[i + 2 * iimage_len / 4] = iptr_img[4 * i + 2];
 #else
-          ibuffer[i + 2 * iimage_len / 4] = iptr_img[4 * i + 1];
+        ibuffer[i + 2 * iimage_len / 4] = iptr_img[4 * i + 1];
 #endif
-        }
-        for (size_t i = 0; i < iimage_len / 4; ++i)
-        {
+      }
+      for (size_t i = 0; i < iimage_len / 4; ++i)
+      {
 #ifdef MDCM_WORDS_BIGENDIAN
-          ibuffer[i + 3 * iimage_len / 4] = iptr_img[4 * i + 3];
+        ibuffer[i + 3 * iimage_len / 4] = iptr_img[4 * i + 3];
 #else
-          ibuffer[i + 3 * iimage_len / 4] = iptr_img[4 * i + 0];
+        ibuffer[i + 3 * iimage_len / 4] = iptr_img[4 * i + 0];
 #endif
-        }
       }
-      ptr_img = buffer;
     }
-    else if (GetPixelFormat().GetBitsAllocated() == 16)
+    ptr_img = &buffer[0];
+  }
+  else if (GetPixelFormat().GetBitsAllocated() == 16)
+  {
+    assert(!(image_len % 2));
+    unsigned int div = GetPixelFormat().GetSamplesPerPixel();
+    for (unsigned int j = 0; j < div; ++j)
     {
-      assert(!(image_len % 2));
-      unsigned int div = GetPixelFormat().GetSamplesPerPixel();
-      for (unsigned int j = 0; j < div; ++j)
+      size_t       iimage_len = image_len / div;
+      char *       ibuffer = &buffer[0] + j * iimage_len;
+      const char * iptr_img = ptr_img + j * iimage_len;
+      assert(iimage_len % 2 == 0);
+      for (size_t i = 0; i < iimage_len / 2; ++i)
       {
-        size_t       iimage_len = image_len / div;
-        char *       ibuffer = buffer + j * iimage_len;
-        const char * iptr_img = ptr_img + j * iimage_len;
-        assert(iimage_len % 2 == 0);
-        for (size_t i = 0; i < iimage_len / 2; ++i)
-        {
 #ifdef MDCM_WORDS_BIGENDIAN
-          ibuffer[i] = iptr_img[2 * i];
+        ibuffer[i] = iptr_img[2 * i];
 #else
-          ibuffer[i] = iptr_img[2 * i + 1];
+        ibuffer[i] = iptr_img[2 * i + 1];
 #endif
-        }
-        for (size_t i = 0; i < iimage_len / 2; ++i)
-        {
+      }
+      for (size_t i = 0; i < iimage_len / 2; ++i)
+      {
 #ifdef MDCM_WORDS_BIGENDIAN
-          ibuffer[i + iimage_len / 2] = iptr_img[2 * i + 1];
+        ibuffer[i + iimage_len / 2] = iptr_img[2 * i + 1];
 #else
-          ibuffer[i + iimage_len / 2] = iptr_img[2 * i];
+        ibuffer[i + iimage_len / 2] = iptr_img[2 * i];
 #endif
-        }
       }
-      ptr_img = buffer;
     }
-    assert(image_len % MaxNumSegments == 0);
-    const size_t input_seg_length = image_len / MaxNumSegments;
-    std::string  datastr;
-    for (unsigned int seg = 0; seg < MaxNumSegments; ++seg)
+    ptr_img = &buffer[0];
+  }
+  assert(image_len % MaxNumSegments == 0);
+  const size_t input_seg_length = image_len / MaxNumSegments;
+  std::string  datastr;
+  for (unsigned int seg = 0; seg < MaxNumSegments; ++seg)
+  {
+    size_t       partition = input_seg_length;
+    const char * ptr = ptr_img + seg * input_seg_length;
+    assert(ptr < ptr_img + image_len);
+    if (seg == MaxNumSegments - 1)
     {
-      size_t       partition = input_seg_length;
-      const char * ptr = ptr_img + seg * input_seg_length;
-      assert(ptr < ptr_img + image_len);
-      if (seg == MaxNumSegments - 1)
-      {
-        partition += image_len % MaxNumSegments;
-        assert((MaxNumSegments - 1) * input_seg_length + partition == (size_t)image_len);
-      }
-      assert(partition == input_seg_length);
-      std::stringstream data;
-      assert(partition % dims[1] == 0);
-      size_t length = 0;
-      // do not cross row boundary
-      for (unsigned int y = 0; y < dims[1]; ++y)
-      {
-        ptrdiff_t llength = rle_encode(outbuf, n, ptr + y * dims[0], partition / dims[1]);
-        if (llength < 0)
-        {
-          mdcmErrorMacro("RLE compressor error");
-          if (buffer)
-            delete[] buffer;
-          if (bufferrgb)
-            delete[] bufferrgb;
-          return false;
-        }
-        assert(llength);
-        data.write((char *)outbuf, llength);
-        length += llength;
-      }
-      // update header
-      header.Offset[1 + seg] = (uint32_t)(header.Offset[seg] + length);
-      assert(data.str().size() == length);
-      datastr += data.str();
+      partition += image_len % MaxNumSegments;
+      assert((MaxNumSegments - 1) * input_seg_length + partition == (size_t)image_len);
     }
-    header.Offset[MaxNumSegments] = 0;
-    std::stringstream os;
-    os.write((char *)&header, sizeof(header));
-    std::string str = os.str() + datastr;
-    assert(str.size());
-    Fragment frag;
-    const size_t str_size = str.size();
-    if (str_size > 0xffffffff)
+    assert(partition == input_seg_length);
+    std::stringstream data;
+    assert(partition % dims[1] == 0);
+    size_t length = 0;
+    // do not cross row boundary
+    for (unsigned int y = 0; y < dims[1]; ++y)
     {
-      return false;
+      ptrdiff_t llength = rle_encode(outbuf, n, ptr + y * dims[0], partition / dims[1]);
+      if (llength < 0)
+      {
+        mdcmErrorMacro("RLE compressor error");
+        return false;
+      }
+      assert(llength);
+      data.write((char *)outbuf, llength);
+      length += llength;
     }
-    frag.SetByteValue(&str[0], (VL::Type)str_size);
-    sq->AddFragment(frag);
+    // update header
+    header.Offset[1 + seg] = (uint32_t)(header.Offset[seg] + length);
+    assert(data.str().size() == length);
+    datastr += data.str();
   }
-  out.SetValue(*sq);
-  if (buffer)
-    delete[] buffer;
-  if (bufferrgb)
-    delete[] bufferrgb;
+  header.Offset[MaxNumSegments] = 0;
+  std::stringstream os;
+  os.write((char *)&header, sizeof(header));
+  str = os.str() + datastr;
+  assert(str.size());
   return true;
 }
 
@@ -29,6 +29,7 @@ namespace mdcm
 
 class Fragment;
 class RLEInternals;
+class RLEFrameTask;
 /**
  * Class to do RLE
  *
@@ -43,6 +44,8 @@ class RLEInternals;
  */
 class MDCM_EXPORT RLECodec : public ImageCodec
 {
+  friend class RLEFrameTask;
+
 public:
   RLECodec();
   ~RLECodec() override;
@@ -53,6 +56,8 @@ public:
   bool
   Decode(DataElement const &, DataElement &) override;
   bool
+  DecodeFrame(const char *, size_t, char *, size_t) override;
+  bool
   Code(DataElement const &, DataElement & out) override;
   unsigned long long
   GetBufferLength() const;
@@ -93,6 +98,8 @@ private:
   DecodeByStreamsCommon(std::istream &, std::ostream &);
   size_t
                      DecodeFragment(Fragment const &, char *, size_t);
+  bool
+                     CodeFrame(const char *, size_t, unsigned int, std::string &) const;
   RLEInternals *     Internals;
   unsigned long long Length;
   unsigned long long BufferLength;
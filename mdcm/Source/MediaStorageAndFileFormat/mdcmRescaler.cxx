@@ -25,15 +25,463 @@
 #include <limits>
 #include <cstring>
 #include <cmath>
+#ifdef MDCM_RESCALER_BENCHMARK
+#  include <chrono>
+#  include <vector>
+#endif
+#ifndef DISABLE_SIMDMATH
+#  if (defined __SSE2__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2))
+#    define MDCM_RESCALER_SSE2
+#    include <emmintrin.h>
+#    if ((defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 5)) && (defined(__x86_64__) || defined(__i386__)))
+#      define MDCM_RESCALER_AVX2
+#      define MDCM_RESCALER_AVX2_TARGET __attribute__((target("avx2")))
+#      include <immintrin.h>
+#    elif (defined(_MSC_VER) && _MSC_VER >= 1800)
+#      define MDCM_RESCALER_AVX2
+#      define MDCM_RESCALER_AVX2_TARGET
+#      include <immintrin.h>
+#      include <intrin.h>
+#    endif
+#  endif
+#endif
 
 namespace mdcm
 {
 
+// Vectorized kernels, 16 bit integer input to int16/uint16/int32/float
+// output (Rescale, AVX2 only, with SSE2 the compiler's vectorization
+// of the scalar loop is as fast) and float/double input to integer
+// output (InverseRescale, SSE2 or AVX2, replaces lround per value).
+// AVX2 is selected at run time. Conversion is done in double with
+// separate multiply and add, results are identical to the scalar
+// loops for values in range of the output type, out of range
+// values are saturated (undefined in the scalar loops).
+
+template <typename T>
+struct RescaleInput16
+{
+  static const bool value = false;
+};
+template <>
+struct RescaleInput16<int16_t>
+{
+  static const bool value = true;
+};
+template <>
+struct RescaleInput16<uint16_t>
+{
+  static const bool value = true;
+};
+
+template <typename T>
+struct RescaleOutputInt
+{
+  static const bool value = false;
+};
+template <>
+struct RescaleOutputInt<int16_t>
+{
+  static const bool value = true;
+};
+template <>
+struct RescaleOutputInt<uint16_t>
+{
+  static const bool value = true;
+};
+template <>
+struct RescaleOutputInt<int32_t>
+{
+  static const bool value = true;
+};
+
+template <typename T>
+struct RescaleOutput
+{
+  static const bool value = RescaleOutputInt<T>::value;
+};
+template <>
+struct RescaleOutput<float>
+{
+  static const bool value = true;
+};
+
+template <typename TOut, typename TIn, bool B>
+struct SIMDRescale
+{
+  static bool
+  Rescale(TOut *, const TIn *, double, double, size_t)
+  {
+    return false;
+  }
+  static bool
+  InverseRescale(TOut *, const TIn *, double, double, size_t)
+  {
+    return false;
+  }
+};
+
+#ifdef MDCM_RESCALER_SSE2
+
+template <typename T>
+static inline double
+ClampToRange(double d)
+{
+  const double lo = (double)std::numeric_limits<T>::min();
+  const double hi = (double)std::numeric_limits<T>::max();
+  // same as max_pd/min_pd, NaN becomes 'lo'
+  d = (d > lo) ? d : lo;
+  return (d < hi) ? d : hi;
+}
+
+template <typename T>
+static inline T
+SaturateCast(double d)
+{
+  return (T)ClampToRange<T>(d);
+}
+
+template <>
+inline float
+SaturateCast<float>(double d)
+{
+  return (float)d;
+}
+
+static inline void
+LoadSSE2(const float * in, __m128d * d)
+{
+  const __m128 f0 = _mm_loadu_ps(in);
+  const __m128 f1 = _mm_loadu_ps(in + 4);
+  d[0] = _mm_cvtps_pd(f0);
+  d[1] = _mm_cvtps_pd(_mm_movehl_ps(f0, f0));
+  d[2] = _mm_cvtps_pd(f1);
+  d[3] = _mm_cvtps_pd(_mm_movehl_ps(f1, f1));
+}
+
+static inline void
+LoadSSE2(const double * in, __m128d * d)
+{
+  d[0] = _mm_loadu_pd(in);
+  d[1] = _mm_loadu_pd(in + 2);
+  d[2] = _mm_loadu_pd(in + 4);
+  d[3] = _mm_loadu_pd(in + 6);
+}
+
+template <typename T>
+static inline void
+TruncateSSE2(const __m128d * d, __m128i & a, __m128i & b)
+{
+  const __m128d lo = _mm_set1_pd((double)std::numeric_limits<T>::min());
+  const __m128d hi = _mm_set1_pd((double)std::numeric_limits<T>::max());
+  __m128i       i[4];
+  for (int k = 0; k < 4; ++k)
+  {
+    i[k] = _mm_cvttpd_epi32(_mm_min_pd(_mm_max_pd(d[k], lo), hi));
+  }
+  a = _mm_unpacklo_epi64(i[0], i[1]);
+  b = _mm_unpacklo_epi64(i[2], i[3]);
+}
+
+static inline void
+StoreSSE2(int16_t * out, const __m128d * d)
+{
+  __m128i a, b;
+  TruncateSSE2<int16_t>(d, a, b);
+  _mm_storeu_si128((__m128i *)out, _mm_packs_epi32(a, b));
+}
+
+static inline void
+StoreSSE2(uint16_t * out, const __m128d * d)
+{
+  __m128i a, b;
+  TruncateSSE2<uint16_t>(d, a, b);
+  // no unsigned saturating pack in SSE2, shift into signed range
+  const __m128i bias32 = _mm_set1_epi32(0x8000);
+  const __m128i bias16 = _mm_set1_epi16((short)0x8000);
+  const __m128i p = _mm_packs_epi32(_mm_sub_epi32(a, bias32), _mm_sub_epi32(b, bias32));
+  _mm_storeu_si128((__m128i *)out, _mm_xor_si128(p, bias16));
+}
+
+static inline void
+StoreSSE2(int32_t * out, const __m128d * d)
+{
+  __m128i a, b;
+  TruncateSSE2<int32_t>(d, a, b);
+  _mm_storeu_si128((__m128i *)out, a);
+  _mm_storeu_si128((__m128i *)(out + 4), b);
+}
+
+// Rounding half away from zero (lround), input is already clamped
+// to the range of the output type.
+static inline __m128d
+RoundSSE2(__m128d x)
+{
+  const __m128d one = _mm_set1_pd(1.0);
+  const __m128d t = _mm_cvtepi32_pd(_mm_cvttpd_epi32(x));
+  const __m128d f = _mm_sub_pd(x, t);
+  const __m128d up = _mm_and_pd(_mm_cmpge_pd(f, _mm_set1_pd(0.5)), one);
+  const __m128d down = _mm_and_pd(_mm_cmple_pd(f, _mm_set1_pd(-0.5)), one);
+  return _mm_sub_pd(_mm_add_pd(t, up), down);
+}
+
+template <typename TOut, typename TIn>
+static void
+InverseRescaleSSE2(TOut * out, const TIn * in, double intercept, double slope, size_t size)
+{
+  const __m128d s = _mm_set1_pd(slope);
+  const __m128d b = _mm_set1_pd(intercept);
+  const __m128d lo = _mm_set1_pd((double)std::numeric_limits<TOut>::min());
+  const __m128d hi = _mm_set1_pd((double)std::numeric_limits<TOut>::max());
+  size_t        i = 0;
+  for (; i + 8 <= size; i += 8)
+  {
+    __m128d d[4];
+    LoadSSE2(in + i, d);
+    for (int k = 0; k < 4; ++k)
+    {
+      d[k] = RoundSSE2(_mm_min_pd(_mm_max_pd(_mm_div_pd(_mm_sub_pd(d[k], b), s), lo), hi));
+    }
+    StoreSSE2(out + i, d);
+  }
+  for (; i < size; ++i)
+  {
+    out[i] = (TOut)lround(ClampToRange<TOut>(((double)in[i] - intercept) / slope));
+  }
+}
+
+#  ifdef MDCM_RESCALER_AVX2
+
+static bool
+HasAVX2()
+{
+#    if (defined(__clang__) || defined(__GNUC__))
+  __builtin_cpu_init();
+  return (__builtin_cpu_supports("avx2") != 0);
+#    else
+  int r[4];
+  __cpuid(r, 0);
+  if (r[0] < 7)
+    return false;
+  __cpuid(r, 1);
+  // OSXSAVE and AVX
+  if ((r[2] & (1 << 27)) == 0 || (r[2] & (1 << 28)) == 0)
+    return false;
+  // XMM and YMM state enabled by OS
+  if ((_xgetbv(0) & 6) != 6)
+    return false;
+  __cpuidex(r, 7, 0);
+  return ((r[1] & (1 << 5)) != 0);
+#    endif
+}
+
+static bool
+UseAVX2()
+{
+  static const bool b = HasAVX2();
+  return b;
+}
+
+MDCM_RESCALER_AVX2_TARGET static inline void
+LoadAVX2(const int16_t * in, __m256d * d)
+{
+  const __m256i v = _mm256_loadu_si256((const __m256i *)in);
+  const __m256i lo = _mm256_cvtepi16_epi32(_mm256_castsi256_si128(v));
+  const __m256i hi = _mm256_cvtepi16_epi32(_mm256_extracti128_si256(v, 1));
+  d[0] = _mm256_cvtepi32_pd(_mm256_castsi256_si128(lo));
+  d[1] = _mm256_cvtepi32_pd(_mm256_extracti128_si256(lo, 1));
+  d[2] = _mm256_cvtepi32_pd(_mm256_castsi256_si128(hi));
+  d[3] = _mm256_cvtepi32_pd(_mm256_extracti128_si256(hi, 1));
+}
+
+MDCM_RESCALER_AVX2_TARGET static inline void
+LoadAVX2(const uint16_t * in, __m256d * d)
+{
+  const __m256i v = _mm256_loadu_si256((const __m256i *)in);
+  const __m256i lo = _mm256_cvtepu16_epi32(_mm256_castsi256_si128(v));
+  const __m256i hi = _mm256_cvtepu16_epi32(_mm256_extracti128_si256(v, 1));
+  d[0] = _mm256_cvtepi32_pd(_mm256_castsi256_si128(lo));
+  d[1] = _mm256_cvtepi32_pd(_mm256_extracti128_si256(lo, 1));
+  d[2] = _mm256_cvtepi32_pd(_mm256_castsi256_si128(hi));
+  d[3] = _mm256_cvtepi32_pd(_mm256_extracti128_si256(hi, 1));
+}
+
+MDCM_RESCALER_AVX2_TARGET static inline void
+LoadAVX2(const float * in, __m256d * d)
+{
+  for (int k = 0; k < 4; ++k)
+  {
+    d[k] = _mm256_cvtps_pd(_mm_loadu_ps(in + 4 * k));
+  }
+}
+
+MDCM_RESCALER_AVX2_TARGET static inline void
+LoadAVX2(const double * in, __m256d * d)
+{
+  for (int k = 0; k < 4; ++k)
+  {
+    d[k] = _mm256_loadu_pd(in + 4 * k);
+  }
+}
+
+template <typename T>
+MDCM_RESCALER_AVX2_TARGET static inline void
+TruncateAVX2(const __m256d * d, __m128i * i)
+{
+  const __m256d lo = _mm256_set1_pd((double)std::numeric_limits<T>::min());
+  const __m256d hi = _mm256_set1_pd((double)std::numeric_limits<T>::max());
+  for (int k = 0; k < 4; ++k)
+  {
+    i[k] = _mm256_cvttpd_epi32(_mm256_min_pd(_mm256_max_pd(d[k], lo), hi));
+  }
+}
+
+MDCM_RESCALER_AVX2_TARGET static inline void
+StoreAVX2(int16_t * out, const __m256d * d)
+{
+  __m128i i[4];
+  TruncateAVX2<int16_t>(d, i);
+  _mm_storeu_si128((__m128i *)out, _mm_packs_epi32(i[0], i[1]));
+  _mm_storeu_si128((__m128i *)(out + 8), _mm_packs_epi32(i[2], i[3]));
+}
+
+MDCM_RESCALER_AVX2_TARGET static inline void
+StoreAVX2(uint16_t * out, const __m256d * d)
+{
+  __m128i i[4];
+  TruncateAVX2<uint16_t>(d, i);
+  _mm_storeu_si128((__m128i *)out, _mm_packus_epi32(i[0], i[1]));
+  _mm_storeu_si128((__m128i *)(out + 8), _mm_packus_epi32(i[2], i[3]));
+}
+
+MDCM_RESCALER_AVX2_TARGET static inline void
+StoreAVX2(int32_t * out, const __m256d * d)
+{
+  __m128i i[4];
+  TruncateAVX2<int32_t>(d, i);
+  for (int k = 0; k < 4; ++k)
+  {
+    _mm_storeu_si128((__m128i *)(out + 4 * k), i[k]);
+  }
+}
+
+MDCM_RESCALER_AVX2_TARGET static inline void
+StoreAVX2(float * out, const __m256d * d)
+{
+  for (int k = 0; k < 4; ++k)
+  {
+    _mm_storeu_ps(out + 4 * k, _mm256_cvtpd_ps(d[k]));
+  }
+}
+
+MDCM_RESCALER_AVX2_TARGET static inline __m256d
+RoundAVX2(__m256d x)
+{
+  const __m256d one = _mm256_set1_pd(1.0);
+  const __m256d t = _mm256_round_pd(x, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+  const __m256d f = _mm256_sub_pd(x, t);
+  const __m256d up = _mm256_and_pd(_mm256_cmp_pd(f, _mm256_set1_pd(0.5), _CMP_GE_OQ), one);
+  const __m256d down = _mm256_and_pd(_mm256_cmp_pd(f, _mm256_set1_pd(-0.5), _CMP_LE_OQ), one);
+  return _mm256_sub_pd(_mm256_add_pd(t, up), down);
+}
+
+template <typename TOut, typename TIn>
+MDCM_RESCALER_AVX2_TARGET static void
+RescaleAVX2(TOut * out, const TIn * in, double intercept, double slope, size_t size)
+{
+  const __m256d s = _mm256_set1_pd(slope);
+  const __m256d b = _mm256_set1_pd(intercept);
+  size_t        i = 0;
+  for (; i + 16 <= size; i += 16)
+  {
+    __m256d d[4];
+    LoadAVX2(in + i, d);
+    for (int k = 0; k < 4; ++k)
+    {
+      d[k] = _mm256_add_pd(_mm256_mul_pd(d[k], s), b);
+    }
+    StoreAVX2(out + i, d);
+  }
+  for (; i < size; ++i)
+  {
+    out[i] = SaturateCast<TOut>(slope * in[i] + intercept);
+  }
+}
+
+template <typename TOut, typename TIn>
+MDCM_RESCALER_AVX2_TARGET static void
+InverseRescaleAVX2(TOut * out, const TIn * in, double intercept, double slope, size_t size)
+{
+  const __m256d s = _mm256_set1_pd(slope);
+  const __m256d b = _mm256_set1_pd(intercept);
+  const __m256d lo = _mm256_set1_pd((double)std::numeric_limits<TOut>::min());
+  const __m256d hi = _mm256_set1_pd((double)std::numeric_limits<TOut>::max());
+  size_t        i = 0;
+  for (; i + 16 <= size; i += 16)
+  {
+    __m256d d[4];
+    LoadAVX2(in + i, d);
+    for (int k = 0; k < 4; ++k)
+    {
+      d[k] = RoundAVX2(_mm256_min_pd(_mm256_max_pd(_mm256_div_pd(_mm256_sub_pd(d[k], b), s), lo), hi));
+    }
+    StoreAVX2(out + i, d);
+  }
+  for (; i < size; ++i)
+  {
+    out[i] = (TOut)lround(ClampToRange<TOut>(((double)in[i] - intercept) / slope));
+  }
+}
+
+#  endif
+
+template <typename TOut, typename TIn>
+struct SIMDRescale<TOut, TIn, true>
+{
+  // 'size' is the number of values
+  static bool
+  Rescale(TOut * out, const TIn * in, double intercept, double slope, size_t size)
+  {
+#  ifdef MDCM_RESCALER_AVX2
+    if (UseAVX2())
+    {
+      RescaleAVX2<TOut, TIn>(out, in, intercept, slope, size);
+      return true;
+    }
+#  else
+    (void)out;
+    (void)in;
+    (void)intercept;
+    (void)slope;
+    (void)size;
+#  endif
+    return false;
+  }
+  static bool
+  InverseRescale(TOut * out, const TIn * in, double intercept, double slope, size_t size)
+  {
+#  ifdef MDCM_RESCALER_AVX2
+    if (UseAVX2())
+    {
+      InverseRescaleAVX2<TOut, TIn>(out, in, intercept, slope, size);
+      return true;
+    }
+#  endif
+    InverseRescaleSSE2<TOut, TIn>(out, in, intercept, slope, size);
+    return true;
+  }
+};
+
+#endif
+
 template <typename TOut, typename TIn>
 void
 RescaleFunction(TOut * out, const TIn * in, double intercept, double slope, size_t size)
 {
   size /= sizeof(TIn);
+  if (SIMDRescale<TOut, TIn, (RescaleInput16<TIn>::value && RescaleOutput<TOut>::value)>::Rescale(
+        out, in, intercept, slope, size))
+    return;
   for (size_t i = 0; i != size; ++i)
   {
     out[i] = (TOut)(slope * in[i] + intercept);
@@ -91,6 +539,8 @@ struct FImpl<TOut, float>
   InverseRescaleFunction(TOut * out, const float * in, double intercept, double slope, size_t size)
   {
     size /= sizeof(float);
+    if (SIMDRescale<TOut, float, RescaleOutputInt<TOut>::value>::InverseRescale(out, in, intercept, slope, size))
+      return;
     for (size_t i = 0; i != size; ++i)
     {
       out[i] = round_impl<TOut>(((double)in[i] - intercept) / slope);
@@ -105,6 +555,8 @@ struct FImpl<TOut, double>
   InverseRescaleFunction(TOut * out, const double * in, double intercept, double slope, size_t size)
   {
     size /= sizeof(double);
+    if (SIMDRescale<TOut, double, RescaleOutputInt<TOut>::value>::InverseRescale(out, in, intercept, slope, size))
+      return;
     for (size_t i = 0; i != size; ++i)
     {
       out[i] = round_impl<TOut>(((double)in[i] - intercept) / slope);
@@ -531,4 +983,112 @@ Rescaler::SetPixelFormat(PixelFormat const & pf)
   PF = pf;
 }
 
+#ifdef MDCM_RESCALER_BENCHMARK
+
+template <typename TOut, typename TIn>
+static void
+RescaleReference(TOut * out, const TIn * in, double intercept, double slope, size_t size)
+{
+  for (size_t i = 0; i != size; ++i)
+  {
+    out[i] = (TOut)(slope * in[i] + intercept);
+  }
+}
+
+template <typename TOut, typename TIn>
+static void
+InverseRescaleReference(TOut * out, const TIn * in, double intercept, double slope, size_t size)
+{
+  for (size_t i = 0; i != size; ++i)
+  {
+    out[i] = (TOut)lround(((double)in[i] - intercept) / slope);
+  }
+}
+
+template <typename TOut, typename TIn>
+static bool
+BenchmarkCase(std::ostream & os,
+              const char *   name,
+              bool           inverse,
+              double         intercept,
+              double         slope,
+              double         min,
+              double         max)
+{
+  // odd size to run the tails too
+  const size_t      n = (1 << 20) + 7;
+  const int         runs = 16;
+  std::vector<TIn>  in(n);
+  std::vector<TOut> out0(n);
+  std::vector<TOut> out1(n);
+  unsigned int      state = 1;
+  for (size_t i = 0; i < n; ++i)
+  {
+    state = state * 1664525U + 1013904223U;
+    const double r = min + (max - min) * ((state >> 8) / 16777216.0);
+    if (inverse)
+    {
+      // every 8th value is a tie
+      const double v = (i % 8 == 0) ? floor(r) + 0.5 : r;
+      in[i] = (TIn)(intercept + slope * v);
+    }
+    else
+    {
+      in[i] = (TIn)r;
+    }
+  }
+  // called through pointers, so runs are not merged or inlined
+  typedef void (*Function)(TOut *, const TIn *, double, double, size_t);
+  Function volatile reference =
+    inverse ? &InverseRescaleReference<TOut, TIn> : &RescaleReference<TOut, TIn>;
+  Function volatile vectorized =
+    inverse ? &InverseRescaleFunction<TOut, TIn> : &RescaleFunction<TOut, TIn>;
+  const std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+  for (int k = 0; k < runs; ++k)
+  {
+    reference(&out0[0], &in[0], intercept, slope, n);
+  }
+  const std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+  for (int k = 0; k < runs; ++k)
+  {
+    vectorized(&out1[0], &in[0], intercept, slope, n * sizeof(TIn));
+  }
+  const std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
+  const double scalar = std::chrono::duration<double, std::milli>(t1 - t0).count() / runs;
+  const double simd = std::chrono::duration<double, std::milli>(t2 - t1).count() / runs;
+  const bool   same = (memcmp(&out0[0], &out1[0], n * sizeof(TOut)) == 0);
+  os << name << ": scalar " << scalar << " ms, vectorized " << simd << " ms, x"
+     << ((simd > 0) ? scalar / simd : 0.0) << (same ? ", identical" : ", MISMATCH") << std::endl;
+  return same;
+}
+
+bool
+Rescaler::Benchmark(std::ostream & os)
+{
+#  if defined(MDCM_RESCALER_AVX2)
+  os << "Rescaler: " << (UseAVX2() ? "AVX2" : "SSE2, InverseRescale only") << std::endl;
+#  elif defined(MDCM_RESCALER_SSE2)
+  os << "Rescaler: SSE2, InverseRescale only" << std::endl;
+#  else
+  os << "Rescaler: scalar" << std::endl;
+#  endif
+  bool ok = true;
+  ok &= BenchmarkCase<int16_t, int16_t>(os, "int16 -> int16", false, -1024.0, 1.0, -2048.0, 2047.0);
+  ok &= BenchmarkCase<int32_t, int16_t>(os, "int16 -> int32", false, 100000.0, 3.0, -32768.0, 32767.0);
+  ok &= BenchmarkCase<float, int16_t>(os, "int16 -> float", false, -10.25, 0.37, -32768.0, 32767.0);
+  ok &= BenchmarkCase<double, int16_t>(os, "int16 -> double", false, -10.25, 0.37, -32768.0, 32767.0);
+  ok &= BenchmarkCase<int16_t, uint16_t>(os, "uint16 -> int16", false, -1024.0, 1.0, 0.0, 4095.0);
+  ok &= BenchmarkCase<uint16_t, uint16_t>(os, "uint16 -> uint16", false, 10.0, 2.0, 0.0, 4095.0);
+  ok &= BenchmarkCase<float, uint16_t>(os, "uint16 -> float", false, -10.25, 0.37, 0.0, 65535.0);
+  ok &= BenchmarkCase<double, uint16_t>(os, "uint16 -> double", false, -10.25, 0.37, 0.0, 65535.0);
+  ok &= BenchmarkCase<int16_t, float>(os, "float -> int16", true, -10.25, 0.5, -32767.0, 32766.0);
+  ok &= BenchmarkCase<uint16_t, float>(os, "float -> uint16", true, -10.25, 0.5, 1.0, 65534.0);
+  ok &= BenchmarkCase<int16_t, double>(os, "double -> int16", true, -10.25, 0.5, -32767.0, 32766.0);
+  ok &= BenchmarkCase<uint16_t, double>(os, "double -> uint16", true, -10.25, 0.5, 1.0, 65534.0);
+  ok &= BenchmarkCase<int32_t, double>(os, "double -> int32", true, 3.5, 0.37, -1000000.0, 1000000.0);
+  return ok;
+}
+
+#endif
+
 } // end namespace mdcm
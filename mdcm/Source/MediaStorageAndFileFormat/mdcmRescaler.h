@@ -24,6 +24,9 @@
 
 #include "mdcmTypes.h"
 #include "mdcmPixelFormat.h"
+#ifdef MDCM_RESCALER_BENCHMARK
+#  include <ostream>
+#endif
 
 namespace mdcm
 {
@@ -102,6 +105,12 @@ public:
   GetSlope() const;
   void
   SetPixelFormat(PixelFormat const &);
+#ifdef MDCM_RESCALER_BENCHMARK
+  // Runs vectorized kernels against scalar reference,
+  // prints timings, returns false if results differ.
+  static bool
+  Benchmark(std::ostream &);
+#endif
 
 protected:
   template <typename TIn>